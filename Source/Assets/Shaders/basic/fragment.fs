@@ -2,9 +2,11 @@
 out vec4 fragment_color;
 
 in vec2 in_texture_coordinates;
+in float in_brightness;
 uniform sampler2D in_texture;
 
 void main()
 {
 	fragment_color = texture(in_texture, in_texture_coordinates);
+	fragment_color.rgb *= in_brightness;
 }
\ No newline at end of file
@@ -1,12 +1,21 @@
 #version 330 core
 layout (location = 0) in vec3 position_values;
 layout (location = 1) in vec2 texture_coordinates;
+layout (location = 2) in float brightness_value;
 
 out vec2 in_texture_coordinates;
-uniform mat4 model, projection;
+out float in_brightness;
+
+layout (std140) uniform FrameData
+{
+    mat4 projection;
+    mat4 view;
+    vec4 frame;
+};
 
 void main()
 {
-    gl_Position = projection * model * vec4(position_values, 1.0f);
+    gl_Position = projection * view * vec4(position_values, 1.0f);
     in_texture_coordinates = texture_coordinates;
+    in_brightness = brightness_value;
 }
\ No newline at end of file
@@ -10,11 +10,25 @@ Application* renai;
 /**
  * @brief Start the application. This function does very little but
  * begin the application and make certain all systems are running.
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments. Passing `--headless`
+ * renders a scripted run of frames offscreen instead of running the
+ * game, `--record` and `--replay` record and replay a session, and
+ * `--compare` compares the timings of two replays; see @ref
+ * ParseApplicationOptions.
  * @return A 32-bit integer flag, typically only <0 for failure and 0
  * for success.
  */
-i32 main(void)
+i32 main(i32 argc, char** argv)
 {
+    // Comparing two runs' timings needs nothing else of the engine,
+    // so it's done before anything's created.
+    ApplicationOptions options;
+    ParseApplicationOptions(argc, argv, &options);
+    if (options.replay.compare_paths[0] != NULL)
+        return !CompareReplayTimings(options.replay.compare_paths[0],
+                                     options.replay.compare_paths[1]);
+
     char* scene_names[1] = {"test"};
     char* scene_descriptions[1] = {"a quick test scene"};
     char* texture_paths[1] = {"texture_missing.jpg"};
@@ -25,7 +39,7 @@ i32 main(void)
     // Initialize the application and try to run its loop. If the loop
     // fails, the process will self-destruct, so don't worry about
     // error checking.
-    renai = CreateApplication();
+    renai = CreateApplication(&options);
     RunApplication(renai);
 
     // Destroy/free all allocated memory and get ready to exit the
@@ -1,31 +1,47 @@
 #include "Application.h"
 #include <Libraries.h>
 
-// The application defined within the entry file. This is here since
-// we need its members for the key callback.
-extern Application* renai;
+bool _application_created = false;
 
 /**
- * @brief The key callback of the application; this fires every single
- * time a key is pressed/actioned upon.
- * @param window The window that was focused when the key was pressed.
- * @param key The key pressed.
- * @param scancode The scancode of the key (unused).
- * @param action The action taken upon the key.
- * @param mods Modifiers to the key action.
+ * @brief What's printed when the command line doesn't make sense.
  */
-void _KeyCallback(GLFWwindow* window, i32 key, i32 scancode,
-                  i32 action, i32 mods)
+#define __USAGE                                                      \
+    "Usage: renai [--headless [--frames <count>] [--size <w>x<h>] "  \
+    "[--dump <interval>] [--statistics <path>]] [--record <log> | "  \
+    "--replay <log>] [--timings <path>] [--compare <timings> "       \
+    "<timings>]"
+
+__KILLFAIL ParseApplicationOptions(i32 argc, char** argv,
+                                   ApplicationOptions* options)
 {
-    if (action == GLFW_RELEASE) return;
-    HandleInput(renai->updater, renai->window, renai->delta_time,
-                key);
-}
+    options->headless = HEADLESS_DEFAULT_OPTIONS;
+    memset(&options->replay, 0, sizeof(ReplayOptions));
 
-bool _application_created = false;
+    for (i32 index = 1; index < argc;)
+    {
+        u8 read = ParseHeadlessArgument(&options->headless,
+                                        argc - index, argv + index);
+        if (read == 0)
+            read = ParseReplayArgument(&options->replay, argc - index,
+                                       argv + index);
+        if (read == 0)
+            PrintError("Unknown argument '%s'. " __USAGE,
+                       argv[index]);
+        index += read;
+    }
+
+    // A headless run is already scripted, so there's nothing for a
+    // recording to add to it.
+    if (options->headless.enabled &&
+        (options->replay.record_path != NULL ||
+         options->replay.replay_path != NULL))
+        PrintError("A headless run can't be recorded or replayed. "
+                   __USAGE);
+}
 
 __CREATE_STRUCT_KILLFAIL(Application)
-CreateApplication(void)
+CreateApplication(const ApplicationOptions* options)
 {
     if (_application_created)
         PrintError("Tried to initialize the application twice.");
@@ -33,6 +49,8 @@ CreateApplication(void)
 // Get the current date and time, and then log that value to the
 // console if we're in debug mode.
 #ifdef DEBUG_MODE
+    // Keep a copy of the session's log on disk, too.
+    SetLogOutputs(log_to_console | log_to_file);
     char current_date[64];
     GetDateString(current_date, 64);
     PrintWarning("Beginning a new session on %s.", current_date);
@@ -49,22 +67,34 @@ CreateApplication(void)
     // Since we assume that we're loading into a startup menu, set the
     // startup state to "menu".
     application->current_application_state = false;
+    application->options = options;
+    const HeadlessOptions* headless =
+        (options->headless.enabled ? &options->headless : NULL);
 
-    InitializeGLFW();
-    const GLFWvidmode* resolution =
-        glfwGetVideoMode(glfwGetPrimaryMonitor());
-    if (resolution == NULL)
-        PrintError(
-            "Failed to get the user's primary monitor's resolution. "
-            "Please report this.");
-    // Set the application's frame cap to the monitor's refresh rate.
-    ChangeApplicationFrameCap(1);
-
-    *(i32*)&application->screen_width = resolution->width;
-    *(i32*)&application->screen_height = resolution->height;
-
-    i32 default_width = resolution->width / 1.25,
+    InitializeGLFW(headless != NULL);
+    i32 default_width, default_height;
+    if (headless != NULL)
+    {
+        // There's no monitor to speak of, so the framebuffer is
+        // exactly the size asked for.
+        *(i32*)&application->screen_width = headless->width;
+        *(i32*)&application->screen_height = headless->height;
+        default_width = headless->width;
+        default_height = headless->height;
+    }
+    else
+    {
+        const GLFWvidmode* resolution =
+            glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (resolution == NULL)
+            PrintError("Failed to get the user's primary monitor's "
+                       "resolution. Please report this.");
+
+        *(i32*)&application->screen_width = resolution->width;
+        *(i32*)&application->screen_height = resolution->height;
+        default_width = resolution->width / 1.25;
         default_height = resolution->height / 1.25;
+    }
 
     PrintSuccess("Calculated application dimensions. Screen: %dx%d, "
                  "Window: %dx%d.",
@@ -73,19 +103,42 @@ CreateApplication(void)
                  default_height);
 
     application->window = CreateWindow(default_width, default_height);
-    // Set the window's key press callback, so we don't have to call a
-    // function redundantly every render call, and can instead rely on
-    // GLFW to tell us when keys are pressed.
-    glfwSetKeyCallback(GetInnerWindow(application->window),
-                       _KeyCallback);
-
-    application->renderer =
-        CreateRenderer(default_width, default_height);
-
-    // Create the keybuffer, where we'll store the keys that have been
-    // pressed in the last 25 cycles and are awaiting their time to be
-    // pressed again.
-    application->updater = CreateUpdater(50);
+    // Set the application's frame cap to the monitor's refresh rate,
+    // unless nothing's ever presented, in which case it's uncapped.
+    ChangeApplicationFrameCap(headless == NULL);
+
+    // The profiler needs the window's context for its GPU timers.
+    application->profiler = CreateProfiler();
+
+    // Spin up the job system before the renderer, since the renderer
+    // uses it to load the first scene.
+    application->jobs = CreateJobSystem(0);
+    application->renderer = CreateRenderer(
+        default_width, default_height, application->jobs);
+
+    // Create the updater, which hooks the input system up to the
+    // window; from here on, input is only ever recorded by GLFW's
+    // callbacks and handled at the start of each tick.
+    application->updater = CreateUpdater(
+        50, application->window, application->renderer->camera);
+    // Hook the session's recording or replay, if there is one, into
+    // that input system.
+    application->replay =
+        CreateReplay(&options->replay, application->updater->input,
+                     application->updater->tick_speed);
+    // A replay runs as fast as it can, so its timings measure the
+    // frames rather than the monitor.
+    if (application->replay != NULL && application->replay->playing)
+        ChangeApplicationFrameCap(0);
+
+    // Everything's in place for the simulation to start ticking on
+    // its own thread; a headless run ticks with its frames instead.
+    application->simulation =
+        (headless != NULL
+             ? NULL
+             : CreateSimulation(application->updater,
+                                application->renderer->scene_manager,
+                                application->replay));
 
     _application_created = true;
     return application;
@@ -99,10 +152,36 @@ __KILL KillApplication(Application* application)
                    "created. Please report this bug.");
     }
 
-    KillWindow(application->window);
+    // The simulation's thread reads most of what's killed below, so
+    // it has to stop first.
+    if (application->simulation != NULL)
+        KillSimulation(application->simulation);
+
+    // Dump what the profiler remembers before it goes, since this is
+    // usually the most interesting part of a session.
+    DumpProfilerTrace(PROFILER_TRACE_PATH);
+    KillProfiler(application->profiler);
+    // The renderer's objects have to go while the window's context is
+    // still around to free them from.
     KillRenderer(application->renderer);
+    KillWindow(application->window);
+    // Every texture and atlas page should be gone by now.
+    ReportAtlasMemory();
+    KillFrameScratch();
+    KillJobSystem(application->jobs);
+    KillInternedNames();
+    // The session's unhooked from the input system before the input
+    // system goes.
+    if (application->replay != NULL) KillReplay(application->replay);
     KillUpdater(application->updater);
     PrintWarning("Killed the application's resources.");
+#ifdef DEBUG_MODE
+    LoggerStatistics logged;
+    GetLoggerStatistics(&logged);
+    PrintSuccess("Logged %lu messages; callers waited on a full "
+                 "buffer %lu times.",
+                 logged.written, logged.stalls);
+#endif
 
     // Free the memory shell associated with the application structure
     // and print what we did.
@@ -110,6 +189,7 @@ __KILL KillApplication(Application* application)
            ("The application freer was given an invalid texture."));
     PrintWarning("Freed the memory of the application.\n\n");
 
+    // The logger writes out whatever's still queued on the way out.
     exit(0);
 }
 
@@ -118,18 +198,39 @@ __KILLFAIL RunApplication(Application* application)
     if (!_application_created || application == NULL)
         PrintError("Tried to run a nonexistent application.");
 
-    i64 last_frame_time = GetCurrentTime();
+    if (application->options->headless.enabled)
+    {
+        RunHeadless(&application->options->headless,
+                    application->renderer, application->updater);
+        return;
+    }
+    Replay* replay = application->replay;
+    const bool replaying = replay != NULL && replay->playing;
+    Simulation* simulation = application->simulation;
+
+    u64 last_frame_time = GetCurrentTimeNS();
     f32 current_fps = 120.0f;
     u8 frames_past = 0;
 
-    while (!GetWindowShouldClose(application->window))
+    while (!GetWindowShouldClose(application->window) &&
+           !IsReplayFinished(replay))
     {
+        BeginProfilerFrame();
+        // Anything allocated from the scratch last frame is gone now.
+        ResetFrameScratch();
         frames_past++;
 
-        i64 current_frame_time = GetCurrentTime();
-        application->delta_time =
-            current_frame_time - last_frame_time;
+        u64 current_frame_time = GetCurrentTimeNS();
+        u64 frame_length = current_frame_time - last_frame_time;
         last_frame_time = current_frame_time;
+        application->delta_time = NSToSeconds(frame_length);
+
+        // Hand the time that's passed to the simulation, which ticks
+        // through it on its own thread while this frame's drawn from
+        // the newest snapshot it's published. Anything it's asked of
+        // the window since the last frame is done here.
+        AdvanceSimulation(simulation, frame_length);
+        HandleWindowRequests(application->updater);
 
         // Clear the background of the window to black and then clear
         // the window's buffers.
@@ -142,11 +243,21 @@ __KILLFAIL RunApplication(Application* application)
         glClear(GL_COLOR_BUFFER_BIT);
         glDisable(GL_SCISSOR_TEST);
 
-        RenderWindowContent(application->renderer);
-        UpdateWindowContent(application->updater,
-                            application->delta_time);
-
-        glfwSwapBuffers(application->window->inner_window);
+        // The time since the snapshot's tick is how far we are into
+        // the next one, which the renderer uses to blend the last
+        // two.
+        PROFILE_SCOPE("render")
+        {
+            f32 alpha;
+            const DrawSnapshot* snapshot =
+                GetSimulationSnapshot(simulation, &alpha);
+            RenderWindowContent(application->renderer, snapshot,
+                                alpha);
+        }
+        PROFILE_SCOPE("swap")
+        {
+            glfwSwapBuffers(application->window->inner_window);
+        }
 
         if (application->current_application_state)
         {
@@ -156,15 +267,28 @@ __KILLFAIL RunApplication(Application* application)
             // monitor's refresh rate. This is simply for diagnostics,
             // telling the user how well the application is running.
             current_fps =
-                CalculatePossibleFramerate(current_frame_time);
+                CalculatePossibleFramerate(GetLastFrameDuration());
 
-            if (frames_past == 5)
+            if (frames_past >= 5)
             {
-                char window_title[64];
+                frames_past = 0;
+                BatchStatistics* statistics =
+                    GetRendererStatistics(application->renderer);
+                StreamStatistics* streaming = GetStreamingStatistics(
+                    application->renderer->scene_manager->streamer);
+                u32 changes = 0, saved = 0;
+                SumStateStatistics(&changes, &saved);
+                char window_title[224];
                 // Format the string accordingly, but make sure we
                 // don't overflow the buffer.
-                snprintf(window_title, 64, "%s -- %.2f FPS", TITLE,
-                         current_fps);
+                snprintf(window_title, 224,
+                         "%s -- %.2f FPS -- %d draws, %d binds, %d "
+                         "of %d state changes saved -- %.1f MB "
+                         "streamed, %d loading",
+                         TITLE, current_fps, statistics->draws,
+                         statistics->binds, saved, changes + saved,
+                         streaming->resident_bytes / 1048576.0,
+                         streaming->pending_loads);
                 glfwSetWindowTitle(
                     GetInnerWindow(application->window),
                     window_title);
@@ -172,7 +296,12 @@ __KILLFAIL RunApplication(Application* application)
 
             // Poll for events like key pressing, resizing, and the
             // like.
-            glfwPollEvents();
+            PROFILE_SCOPE("events")
+            {
+                BeginInputPoll(application->updater->input);
+                glfwPollEvents();
+                EndInputPoll(application->updater->input);
+            }
         }
         else
         {
@@ -188,9 +317,23 @@ __KILLFAIL RunApplication(Application* application)
             // Poll for events like key pressing, resizing, and the
             // like, but impose a delay until an event triggers. We
             // use this for menus since we don't need to process
-            // things while the user isn't doing anything.
-            glfwWaitEvents();
+            // things while the user isn't doing anything. A replay
+            // never waits, since its events come from the log.
+            PROFILE_SCOPE("events")
+            {
+                BeginInputPoll(application->updater->input);
+                if (replaying) glfwPollEvents();
+                else glfwWaitEvents();
+                EndInputPoll(application->updater->input);
+            }
         }
+        // GLFW only lets the gamepad be polled from here.
+        PollGamepad(application->updater->input);
+
+        if (replay != NULL)
+            EndReplayFrame(replay,
+                           GetCurrentTimeNS() - current_frame_time);
+        EndProfilerFrame();
     }
     PrintSuccess(
         "Got through the application's main loop successfully.");
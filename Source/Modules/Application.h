@@ -11,6 +11,18 @@
 #ifndef _RENAI_APPLICATION_
 #define _RENAI_APPLICATION_
 
+// Provides the frame profiler, which times each part of the main
+// loop.
+#include <Profiler.h>
+// Provides the headless mode, which renders a scripted run of frames
+// offscreen instead of running the game.
+#include <Headless.h>
+// Provides session recording and replay, which reruns a recorded
+// session exactly for comparable timings.
+#include <Replay.h>
+// Provides the simulation thread, which ticks the game alongside the
+// frames drawing it.
+#include <Simulation.h>
 // Provides the functionality and data structures needed to render
 // content onto a given window.
 #include <Renderer.h>
@@ -21,6 +33,21 @@
 // window management.
 #include <Window.h>
 
+/**
+ * @brief Everything the command line asked of the application.
+ */
+typedef struct ApplicationOptions
+{
+    /**
+     * @brief The options of a headless run, if one was asked for.
+     */
+    HeadlessOptions headless;
+    /**
+     * @brief What to record, replay, or compare, if anything.
+     */
+    ReplayOptions replay;
+} ApplicationOptions;
+
 /**
  * @brief A structuring for all the data needed by an application.
  * This is 32 bytes large.
@@ -35,9 +62,10 @@ typedef struct Application
     bool current_application_state;
     /**
      * @brief The time difference it took to render the current frame
-     * and the last. This value to used to normalize updating.
+     * and the last, in seconds. This value to used to normalize
+     * updating.
      */
-    f32 delta_time;
+    f64 delta_time;
     /**
      * @brief The width of the user's primary monitor, for use in many
      * calculations and borderless fullscreening the window.
@@ -64,14 +92,54 @@ typedef struct Application
      * that handles processing, keystrokes, and the like.
      */
     Updater* updater;
+    /**
+     * @brief The application's job system; a pool of worker threads
+     * that heavy, parallelizable work (like decoding images) is
+     * spread across.
+     */
+    JobSystem* jobs;
+    /**
+     * @brief The application's profiler, which records where the
+     * time of every frame goes.
+     */
+    Profiler* profiler;
+    /**
+     * @brief The session being recorded or replayed, or NULL.
+     */
+    Replay* replay;
+    /**
+     * @brief The simulation, ticking on its own thread, or NULL for a
+     * headless run, which ticks in step with its frames instead.
+     */
+    Simulation* simulation;
+    /**
+     * @brief The options the application was started with.
+     */
+    const ApplicationOptions* options;
 } Application;
 
+/**
+ * @brief Read the application's options from the command line,
+ * handing each argument to the module it belongs to. Kills the
+ * process with a usage message if an argument belongs to none of
+ * them, or if the options asked for can't be combined.
+ * @param argc The number of arguments.
+ * @param argv The arguments, the executable's path included.
+ * @param options Where to write the options. Anything not given is
+ * left at its default.
+ */
+__KILLFAIL ParseApplicationOptions(i32 argc, char** argv,
+                                   ApplicationOptions* options);
+
 /**
  * @brief Create an application and initialize its starting processes.
  * This can only be called once. Kills the process on failure.
+ * @param options The options to start with. A headless run gets a
+ * hidden window of its size without ever looking for a monitor. These
+ * aren't copied.
  */
 __CREATE_STRUCT_KILLFAIL(Application)
-CreateApplication(void);
+CreateApplication(const ApplicationOptions* options);
 
 /**
  * @brief Destroy an application and all of its innards. This function
@@ -83,7 +151,9 @@ __KILL KillApplication(Application* application);
 
 /**
  * @brief Run an application's main loop methods until the key window
- * is closed. This includes rendering, keyboard polling, and more.
+ * is closed. This includes rendering, keyboard polling, and more. A
+ * headless application renders its run and returns instead, and one
+ * replaying a session returns once the session's over.
  * @param application The application to run.
  */
 __KILLFAIL RunApplication(Application* application);
@@ -0,0 +1,327 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_render
+#include "Batch.h"
+#include <Extensions.h>
+
+/**
+ * @brief Fill the batch's index buffer with the indices of @ref
+ * capacity quads. Since every quad is laid out the same way, this
+ * only has to happen whenever the batch grows.
+ * @param batch The batch whose index buffer to fill.
+ */
+__KILLFAIL _FillBatchIndices(SpriteBatch* batch)
+{
+    u32* indices = malloc(sizeof(u32) * 6 * batch->capacity);
+    if (indices == NULL)
+        PrintError("Failed to allocate the sprite batch's index "
+                   "buffer. Code: %d.",
+                   errno);
+
+    BuildQuadIndices(batch->capacity, indices);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 sizeof(u32) * 6 * batch->capacity, indices,
+                 GL_STATIC_DRAW);
+    free(indices);
+    batch->index_capacity = batch->capacity;
+}
+
+/**
+ * @brief Grow the CPU-side storage of the batch so it can hold at
+ * least the given number of sprites.
+ * @param batch The batch to grow.
+ * @param capacity The new minimum capacity of the batch.
+ */
+__KILLFAIL _GrowSpriteBatch(SpriteBatch* batch, u32 capacity)
+{
+    batch->capacity = capacity;
+    batch->keys = realloc(batch->keys, sizeof(u64) * capacity);
+    batch->scratch =
+        realloc(batch->scratch, sizeof(u64) * capacity);
+    if (batch->keys == NULL || batch->scratch == NULL)
+        PrintError("Failed to grow the sprite batch to %d sprites. "
+                   "Code: %d.",
+                   capacity, errno);
+
+    BatchColumns* columns[2] = {&batch->submitted, &batch->sorted};
+    for (u8 index = 0; index < 2; index++)
+    {
+        BatchColumns* grown = columns[index];
+        grown->shader =
+            realloc(grown->shader, sizeof(u32) * capacity);
+        grown->texture =
+            realloc(grown->texture, sizeof(u32) * capacity);
+        grown->x = realloc(grown->x, sizeof(f32) * capacity);
+        grown->y = realloc(grown->y, sizeof(f32) * capacity);
+        grown->width = realloc(grown->width, sizeof(f32) * capacity);
+        grown->height =
+            realloc(grown->height, sizeof(f32) * capacity);
+        grown->rotation =
+            realloc(grown->rotation, sizeof(f32) * capacity);
+        grown->depth = realloc(grown->depth, sizeof(f32) * capacity);
+        grown->brightness =
+            realloc(grown->brightness, sizeof(f32) * capacity);
+        grown->uv = realloc(grown->uv, sizeof(f32[4]) * capacity);
+        if (grown->shader == NULL || grown->texture == NULL ||
+            grown->x == NULL ||
+            grown->y == NULL || grown->width == NULL ||
+            grown->height == NULL || grown->rotation == NULL ||
+            grown->depth == NULL || grown->brightness == NULL ||
+            grown->uv == NULL)
+            PrintError("Failed to grow the sprite batch to %d "
+                       "sprites. Code: %d.",
+                       capacity, errno);
+    }
+}
+
+/**
+ * @brief Free every column of the given set.
+ * @param columns The columns to free.
+ */
+void _KillBatchColumns(BatchColumns* columns)
+{
+    free(columns->shader);
+    free(columns->texture);
+    free(columns->x);
+    free(columns->y);
+    free(columns->width);
+    free(columns->height);
+    free(columns->rotation);
+    free(columns->depth);
+    free(columns->brightness);
+    free(columns->uv);
+}
+
+__CREATE_STRUCT_KILLFAIL(SpriteBatch) CreateSpriteBatch(u32 capacity)
+{
+    SpriteBatch* batch =
+        __MALLOC(SpriteBatch, batch,
+                 ("Failed to allocate space for the sprite batch. "
+                  "Code: %d.",
+                  errno));
+    batch->keys = batch->scratch = NULL;
+    batch->submitted = batch->sorted = (BatchColumns){0};
+    _GrowSpriteBatch(batch, capacity);
+    BeginSpriteBatch(batch);
+
+    glGenVertexArrays(1, &batch->vao);
+    glGenBuffers(1, &batch->vbo);
+    glGenBuffers(1, &batch->ebo);
+    BindVertexArray(batch->vao);
+
+    // The vertex buffer is respecified every flush, so there's no
+    // need to give it any storage yet.
+    glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+    _FillBatchIndices(batch);
+
+    SetSpriteVertexLayout();
+    LabelObject(GL_VERTEX_ARRAY, batch->vao, "Sprite batch");
+    LabelObject(GL_BUFFER, batch->vbo, "Sprite batch vertices");
+    LabelObject(GL_BUFFER, batch->ebo, "Sprite batch indices");
+
+    PrintSuccess("Created the sprite batch with room for %d sprites. "
+                 "Kernel: %s.",
+                 capacity, GetSpriteKernelName(GetSpriteKernel()));
+    return batch;
+}
+
+void KillSpriteBatch(SpriteBatch* batch)
+{
+    ForgetState(state_vertex_array, batch->vao);
+    glDeleteVertexArrays(1, &batch->vao);
+    glDeleteBuffers(1, &batch->vbo);
+    glDeleteBuffers(1, &batch->ebo);
+
+    free(batch->keys);
+    free(batch->scratch);
+    _KillBatchColumns(&batch->submitted);
+    _KillBatchColumns(&batch->sorted);
+    __FREE(batch, ("The sprite batch freer was given an invalid "
+                   "batch."));
+    PrintWarning("The sprite batch was freed.");
+}
+
+void SubmitSprite(SpriteBatch* batch, u32 shader, u32 texture,
+                  const f32* uv, f32 x, f32 y, u8 z, f32 width,
+                  f32 height, f32 rotation, f32 brightness)
+{
+    // Rather than flushing early (and breaking the depth ordering of
+    // the frame), just double the batch's storage.
+    if (batch->count == batch->capacity)
+        _GrowSpriteBatch(batch, batch->capacity * 2);
+
+    const u32 index = batch->count;
+    batch->keys[index] = MakeBatchKey(z, shader, texture, index);
+
+    BatchColumns* submitted = &batch->submitted;
+    submitted->shader[index] = shader;
+    submitted->texture[index] = texture;
+    submitted->x[index] = x;
+    submitted->y[index] = y;
+    submitted->width[index] = width;
+    submitted->height[index] = height;
+    submitted->rotation[index] = rotation;
+    // Push higher layers closer to the camera, within the
+    // projection's depth range.
+    submitted->depth[index] = (f32)z - 255.0f;
+    submitted->brightness[index] = brightness;
+
+    if (uv == NULL)
+        memcpy(submitted->uv[index], (f32[4]){0, 0, 1, 1}, 16);
+    else memcpy(submitted->uv[index], uv, 16);
+
+    batch->count++;
+    batch->statistics.sprites++;
+}
+
+/**
+ * @brief Radix sort the batch's keys, a byte at a time from the least
+ * significant up. Keys are submitted in order of their low 32 bits,
+ * and every pass is stable, so only the top four bytes ever need a
+ * pass; of those, any byte that's the same across every key (the
+ * program, say, when there's only the one) is skipped outright.
+ * @param batch The batch whose keys to sort.
+ */
+void _SortBatchKeys(SpriteBatch* batch)
+{
+    // Every byte's histogram is counted in a single pass up front.
+    u32 counts[4][256] = {0};
+    for (u32 index = 0; index < batch->count; index++)
+    {
+        const u64 key = batch->keys[index];
+        for (u8 digit = 0; digit < 4; digit++)
+            counts[digit][(key >> (32 + digit * 8)) & 0xFF]++;
+    }
+
+    u64 *from = batch->keys, *to = batch->scratch;
+    for (u8 digit = 0; digit < 4; digit++)
+    {
+        const u8 shift = 32 + digit * 8;
+        u32* offsets = counts[digit];
+        if (offsets[(from[0] >> shift) & 0xFF] == batch->count)
+            continue;
+
+        u32 offset = 0;
+        for (u16 bucket = 0; bucket < 256; bucket++)
+        {
+            const u32 count = offsets[bucket];
+            offsets[bucket] = offset;
+            offset += count;
+        }
+        for (u32 index = 0; index < batch->count; index++)
+        {
+            const u64 key = from[index];
+            to[offsets[(key >> shift) & 0xFF]++] = key;
+        }
+
+        u64* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    // The sorted keys end up in whichever array the last pass wrote
+    // to; since both are the same size, they simply trade places.
+    batch->keys = from;
+    batch->scratch = to;
+}
+
+/**
+ * @brief Copy every submitted sprite into the batch's sorted columns,
+ * in the order of its (already sorted) keys.
+ * @param batch The batch to gather.
+ */
+void _GatherBatchSprites(SpriteBatch* batch)
+{
+    const BatchColumns* from = &batch->submitted;
+    BatchColumns* to = &batch->sorted;
+    for (u32 index = 0; index < batch->count; index++)
+    {
+        const u32 source = (u32)batch->keys[index];
+        to->shader[index] = from->shader[source];
+        to->texture[index] = from->texture[source];
+        to->x[index] = from->x[source];
+        to->y[index] = from->y[source];
+        to->width[index] = from->width[source];
+        to->height[index] = from->height[source];
+        to->rotation[index] = from->rotation[source];
+        to->depth[index] = from->depth[source];
+        to->brightness[index] = from->brightness[source];
+        memcpy(to->uv[index], from->uv[source], 16);
+    }
+}
+
+void FlushSpriteBatch(SpriteBatch* batch)
+{
+    if (batch->count == 0) return;
+
+    // Only the keys are sorted, since they're a fraction of the size
+    // of the sprites themselves; the sprites are then gathered into
+    // place in one pass.
+    _SortBatchKeys(batch);
+    _GatherBatchSprites(batch);
+
+    BindVertexArray(batch->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch->vbo);
+
+    // The batch may have grown since its index buffer was last
+    // filled; if so, refill it.
+    if (batch->index_capacity < batch->capacity)
+        _FillBatchIndices(batch);
+
+    // Orphan the last frame's storage so the driver doesn't have to
+    // wait on any draws still reading from it, then build the entire
+    // frame's vertices straight into the new storage.
+    const u32 vertex_bytes =
+        sizeof(f32) * SPRITE_QUAD_FLOATS * batch->count;
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, NULL,
+                 GL_STREAM_DRAW);
+    f32* vertices = glMapBufferRange(
+        GL_ARRAY_BUFFER, 0, vertex_bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (vertices == NULL)
+        PrintError("Failed to map the sprite batch's vertex buffer. "
+                   "Code: %d.",
+                   glGetError());
+
+    const BatchColumns* sorted = &batch->sorted;
+    BuildSpriteVertices(
+        &(SpriteStream){sorted->x, sorted->y, sorted->width,
+                        sorted->height, sorted->rotation,
+                        sorted->depth, sorted->brightness,
+                        (const f32(*)[4])sorted->uv},
+        batch->count, vertices);
+    // The driver may lose the mapping's contents (on a mode switch,
+    // say); if so, the frame's simply skipped.
+    if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE)
+    {
+        PrintWarning("Lost the contents of the sprite batch's vertex "
+                     "buffer. Skipping a frame.");
+        return;
+    }
+    batch->statistics.vertices += batch->count * 4;
+
+    // Walk the sorted sprites, issuing one draw per run of sprites
+    // that share a program and a texture. Whatever the run before
+    // left bound is left alone.
+    u32 run_start = 0;
+    for (u32 index = 1; index <= batch->count; index++)
+    {
+        if (index < batch->count &&
+            sorted->shader[index] == sorted->shader[run_start] &&
+            sorted->texture[index] == sorted->texture[run_start])
+            continue;
+
+        BindProgram(sorted->shader[run_start]);
+        if (BindTexture2D(sorted->texture[run_start]))
+            batch->statistics.binds++;
+
+        glDrawElements(GL_TRIANGLES, (index - run_start) * 6,
+                       GL_UNSIGNED_INT,
+                       (void*)(sizeof(u32) * 6 * run_start));
+        batch->statistics.draws++;
+        run_start = index;
+    }
+    PollOpenGLErrors();
+}
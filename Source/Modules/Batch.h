@@ -0,0 +1,230 @@
+/**
+ * @file Batch.h
+ * @author Zenais Argos
+ * @brief Provides the sprite batch, a shared dynamic vertex buffer
+ * that collects every sprite drawn within a frame and flushes them in
+ * as few draw calls as possible. Every sprite is queued with a 64-bit
+ * sort key, and the keys are radix sorted on flush, so sprites that
+ * share a program and a texture are drawn together.
+ * @date 2024-07-02
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_BATCH_
+#define _RENAI_BATCH_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the kernels that build the vertices of batched sprites.
+#include <Geometry.h>
+// Provides the logging functions used by the inline functions below.
+#include <Logger.h>
+// Provides the cached binds the batch draws through.
+#include <StateCache.h>
+
+/**
+ * @brief The number of sprites a batch can hold before it has to grow
+ * its buffers.
+ */
+#define BATCH_DEFAULT_CAPACITY 1024
+
+/**
+ * @brief Counters describing the work the batch submitted to OpenGL
+ * over the course of a single frame. These are reset every time @ref
+ * BeginSpriteBatch is called.
+ */
+typedef struct BatchStatistics
+{
+    /**
+     * @brief The number of sprites submitted to the batch.
+     */
+    u32 sprites;
+    /**
+     * @brief The number of draw calls issued by the batch.
+     */
+    u32 draws;
+    /**
+     * @brief The number of vertices uploaded to the GPU.
+     */
+    u32 vertices;
+    /**
+     * @brief The number of texture binds performed by the batch.
+     * Binds of a texture that was already bound aren't counted.
+     */
+    u32 binds;
+} BatchStatistics;
+
+/**
+ * @brief The sprites held by a batch, laid out as one array per
+ * field, so they can be handed straight to the vertex kernels.
+ */
+typedef struct BatchColumns
+{
+    /**
+     * @brief The OpenGL program each sprite is drawn with, and the
+     * texture it samples from.
+     */
+    u32 *shader, *texture;
+    /**
+     * @brief The position (top left corner) and dimensions of each
+     * sprite, in screen units.
+     */
+    f32 *x, *y, *width, *height;
+    /**
+     * @brief The rotation of each sprite around its center, in
+     * radians.
+     */
+    f32* rotation;
+    /**
+     * @brief The depth each sprite's vertices are placed at, worked
+     * out from its layer.
+     */
+    f32* depth;
+    /**
+     * @brief The brightness multiplier applied to each sprite's
+     * color.
+     */
+    f32* brightness;
+    /**
+     * @brief The texture coordinate rectangle of each sprite, in the
+     * order u0, v0, u1, v1.
+     */
+    f32 (*uv)[4];
+} BatchColumns;
+
+/**
+ * @brief The sprite batch itself. One of these is owned by the
+ * renderer and used for everything drawn within a frame.
+ */
+typedef struct SpriteBatch
+{
+    /**
+     * @brief The OpenGL objects backing the batch; one vertex array,
+     * one dynamic vertex buffer, and one static index buffer.
+     */
+    u32 vao, vbo, ebo;
+    /**
+     * @brief How many sprites the batch's buffers can currently hold.
+     */
+    u32 capacity;
+    /**
+     * @brief How many quads the index buffer was last filled with.
+     * Tracked here so a flush never has to ask the driver.
+     */
+    u32 index_capacity;
+    /**
+     * @brief How many sprites have been submitted this frame.
+     */
+    u32 count;
+    /**
+     * @brief The sort key of every sprite submitted this frame, and
+     * the scratch space the keys are sorted through. See @ref
+     * MakeBatchKey for how they're laid out.
+     */
+    u64 *keys, *scratch;
+    /**
+     * @brief The sprites submitted this frame, in submission order.
+     */
+    BatchColumns submitted;
+    /**
+     * @brief The same sprites in drawing order, filled in once the
+     * batch is flushed.
+     */
+    BatchColumns sorted;
+    /**
+     * @brief The statistics of the current frame.
+     */
+    BatchStatistics statistics;
+} SpriteBatch;
+
+/**
+ * @brief Pack the sort key of a sprite. From the top down; its layer
+ * (8 bits), so higher layers draw over lower ones, then its program
+ * (8 bits) and its texture (16 bits), so sprites that draw the same
+ * way end up next to each other, then its submission order (32
+ * bits), which is also its index within @ref SpriteBatch::submitted.
+ * Only the low bits of the program and texture fit, which only
+ * matters if the driver hands out names that large; sprites are still
+ * split into runs by their actual program and texture.
+ * @param z The depth layer of the sprite.
+ * @param shader The program the sprite is drawn with.
+ * @param texture The texture the sprite samples from.
+ * @param index The sprite's submission order.
+ * @return The sort key.
+ */
+__INLINE u64 MakeBatchKey(u8 z, u32 shader, u32 texture, u32 index)
+{
+    return (u64)z << 56 | (u64)(shader & 0xFF) << 48 |
+           (u64)(texture & 0xFFFF) << 32 | index;
+}
+
+/**
+ * @brief Create a sprite batch and its OpenGL buffers. Kills the
+ * process on failure.
+ * @param capacity The number of sprites the batch should be able to
+ * hold before growing.
+ * @return A pointer to the created batch.
+ */
+__CREATE_STRUCT_KILLFAIL(SpriteBatch) CreateSpriteBatch(u32 capacity);
+
+/**
+ * @brief Destroy the given sprite batch, freeing both its memory and
+ * its OpenGL objects.
+ * @param batch The batch to kill.
+ */
+void KillSpriteBatch(SpriteBatch* batch);
+
+/**
+ * @brief Begin a new frame of batching, dropping anything previously
+ * submitted and resetting the batch's statistics.
+ * @param batch The batch to begin.
+ */
+__INLINE void BeginSpriteBatch(SpriteBatch* batch)
+{
+    batch->count = 0;
+    batch->statistics = (BatchStatistics){0};
+}
+
+/**
+ * @brief Queue a sprite to be drawn the next time the batch is
+ * flushed.
+ * @param batch The batch to submit to.
+ * @param shader The OpenGL program the sprite is drawn with.
+ * @param texture The OpenGL texture the sprite samples from.
+ * @param uv The texture coordinate rectangle (u0, v0, u1, v1) of the
+ * sprite, or NULL for the whole texture.
+ * @param x The X coordinate of the sprite's top left corner.
+ * @param y The Y coordinate of the sprite's top left corner.
+ * @param z The depth layer of the sprite.
+ * @param width The width of the sprite.
+ * @param height The height of the sprite.
+ * @param rotation The rotation of the sprite around its center.
+ * @param brightness The brightness multiplier of the sprite.
+ */
+void SubmitSprite(SpriteBatch* batch, u32 shader, u32 texture,
+                  const f32* uv, f32 x, f32 y, u8 z, f32 width,
+                  f32 height, f32 rotation, f32 brightness);
+
+/**
+ * @brief Sort everything submitted to the batch by its key, upload it
+ * in one go, and draw it with one call per run of sprites sharing a
+ * program and a texture. Every bind goes through the state cache, so
+ * a run drawn the same way as whatever came before it binds nothing.
+ * @param batch The batch to flush.
+ */
+void FlushSpriteBatch(SpriteBatch* batch);
+
+/**
+ * @brief Get the statistics of the batch's current frame.
+ * @param batch The batch to query.
+ * @return A pointer to the batch's statistics.
+ */
+__INLINE __GET_STRUCT(BatchStatistics)
+    GetBatchStatistics(SpriteBatch* batch)
+{
+    return &batch->statistics;
+}
+
+#endif // _RENAI_BATCH_
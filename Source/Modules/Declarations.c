@@ -1,6 +1,5 @@
 #include "Declarations.h"
 #include <Logger.h>
-#include <sys/time.h>
 #include <time.h>
 
 __KILLFAIL PollGLFWErrors(void)
@@ -16,38 +15,49 @@ __KILLFAIL PollGLFWErrors(void)
             code, description);
 }
 
-__KILLFAIL PollOpenGLErrors(void)
+#ifdef VALIDATION_MODE
+__KILLFAIL _PollOpenGLErrors(const char* file, u32 line)
 {
     i32 err = glGetError();
     if (err != 0)
-        PrintError("Ran into an error with OpenGL. Code: %d", err);
+        PrintError("Ran into an error with OpenGL at %s:%d. Code: %d",
+                   file, line, err);
 }
+#endif
 
 __PROVIDEDBUFFER GetTimeString(char* buffer, u8 buffer_length)
 {
-    i64 ms = GetCurrentTime(), s = 0, m = 0;
+    FormatTimeString(GetCurrentTime(), buffer, buffer_length);
+}
 
-    // If the count of milliseconds is over 1000 (aka 1 second),
-    // convert it over.
-    if (ms > 1000)
+__PROVIDEDBUFFER FormatTimeString(i64 ms, char* buffer,
+                                  u8 buffer_length)
+{
+    if (buffer_length < 11)
     {
-        s = ms / 1000;
-        // Use the modulus operator, as we need the remainder after
-        // the division.
-        ms = ms % 1000;
+        if (buffer_length != 0) buffer[0] = '\0';
+        return;
     }
-    if (s > 60)
+
+    // Split the milliseconds into minutes and seconds, with the
+    // remainder of each carried down. This is written out digit by
+    // digit, since the logger calls it for every single message.
+    const u16 parts[3] = {(ms / 60000) % 1000, (ms / 1000) % 60,
+                          ms % 1000};
+    const u8 widths[3] = {3, 2, 3};
+    u8 written = 0;
+    for (u8 part = 0; part < 3; part++)
     {
-        m = s / 60;
-        s = s % 60;
+        if (part != 0) buffer[written++] = ':';
+        u16 value = parts[part];
+        for (u8 digit = widths[part]; digit > 0; digit--)
+        {
+            buffer[written + digit - 1] = '0' + value % 10;
+            value /= 10;
+        }
+        written += widths[part];
     }
-
-    // Set the storage string to a formatted time string, using some
-    // string formats so esoteric-looking I'd think Cthulu would be
-    // nervous around them.
-    snprintf(buffer, buffer_length, "%.*s%hu:%.*s%hhu:%.*s%hu",
-             3 - CountDigits(m), "000", (u16)m, 2 - CountDigits(s),
-             "00", (u8)s, 3 - CountDigits(ms), "000", (u16)ms);
+    buffer[written] = '\0';
 }
 
 __PROVIDEDBUFFER GetDateString(char* buffer, u8 buffer_length)
@@ -64,29 +74,34 @@ __PROVIDEDBUFFER GetDateString(char* buffer, u8 buffer_length)
 }
 
 /**
- * @brief The exact amount of milliseconds it had been since the
- * beginning of the epoch when the application began.
+ * @brief The reading of the monotonic clock when the application
+ * began, in nanoseconds. The clock's own starting point is arbitrary,
+ * so this is what makes its readings meaningful.
  */
-i64 start_time = 0;
+static u64 start_time = 0;
 
-i64 GetCurrentTime(void)
+u64 GetCurrentTimeNS(void)
 {
-    // Use the gettimeofday function to grab the current time
-    // information related to this exact moment in time.
-    struct timeval time;
-    gettimeofday(&time, NULL);
+    // The monotonic clock only ever moves forward, no matter what
+    // happens to the system's wall clock (NTP syncs, the user
+    // changing it, and so on), and it's nanosecond-precise.
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    u64 now = (u64)time.tv_sec * NS_PER_SECOND + (u64)time.tv_nsec;
 
     if (start_time == 0)
     {
-        start_time = (i64)time.tv_sec * 1000 + time.tv_usec / 1000;
+        start_time = now;
         return 0;
     }
 
     // Return the distance between the start time of the application
     // and now.
-    return (i64)time.tv_sec * 1000 + time.tv_usec / 1000 - start_time;
+    return now - start_time;
 }
 
+i64 GetCurrentTime(void) { return GetCurrentTimeNS() / NS_PER_MS; }
+
 u16 CountDigits(u32 number)
 {
     char string[255];
@@ -115,7 +130,14 @@ u16 CountDigits(u32 number)
  * @brief An array of frame lengths, @ref SAMPLE_CAP numbers wide.
  * This is explicitly initialized to 0.
  */
-static u32 tick_list[__SAMPLE_CAP] = {0};
+static f64 tick_list[__SAMPLE_CAP] = {0};
+
+/**
+ * @brief The number of samples within the @ref tick_list array that
+ * are actually filled, so the average isn't dragged down by empty
+ * ones early on.
+ */
+static u32 tick_count = 0;
 
 /**
  * @brief The current sample index we're accessing within the @ref
@@ -129,7 +151,7 @@ static u32 current_tick_index = 0;
  */
 static f64 overall_tick_sum = 0.0;
 
-f64 CalculatePossibleFramerate(u32 new_value)
+f64 CalculatePossibleFramerate(f64 new_value)
 {
     // Subtract the value from the overall frame sum that we're
     // overriding, and add the new one.
@@ -139,8 +161,12 @@ f64 CalculatePossibleFramerate(u32 new_value)
 
     // If we've hit the sample cap, send us back to 0.
     current_tick_index = (current_tick_index + 1) % __SAMPLE_CAP;
+    if (tick_count < __SAMPLE_CAP) tick_count++;
 
-    return overall_tick_sum / __SAMPLE_CAP;
+    // The average is of frame lengths, so the framerate is its
+    // reciprocal.
+    if (overall_tick_sum <= 0.0) return 0.0;
+    return 1000.0 / (overall_tick_sum / tick_count);
 }
 
 bool CheckVersionDifference(const char* cause, u8* version)
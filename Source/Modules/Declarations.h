@@ -111,11 +111,27 @@ typedef long double f128;
  */
 __KILLFAIL PollGLFWErrors(void);
 
+#ifdef VALIDATION_MODE
 /**
  * @brief A function to poll the application's runtime for any OpenGL
- * errors.
+ * errors, killing the process if there are any. This is only ever
+ * called through @ref PollOpenGLErrors.
+ * @param file The file it was called from.
+ * @param line The line it was called from.
  */
-__KILLFAIL PollOpenGLErrors(void);
+__KILLFAIL _PollOpenGLErrors(const char* file, u32 line);
+
+/**
+ * @brief Poll the application's runtime for any OpenGL errors. Asking
+ * for errors waits on the driver to catch up, so this is only
+ * compiled into validation builds; debug builds have the driver
+ * report errors as they happen instead (see @ref LoadExtensions), and
+ * release builds don't check at all.
+ */
+#define PollOpenGLErrors() _PollOpenGLErrors(__FILE__, __LINE__)
+#else
+#define PollOpenGLErrors() ((void)0)
+#endif
 
 /**
  * @brief Get a string representation of the current time in
@@ -125,6 +141,17 @@ __KILLFAIL PollOpenGLErrors(void);
  */
 __PROVIDEDBUFFER GetTimeString(char* buffer, u8 buffer_length);
 
+/**
+ * @brief Format the given number of milliseconds the same way as
+ * @ref GetTimeString does; minutes, seconds, and milliseconds, each
+ * zero padded.
+ * @param ms The number of milliseconds.
+ * @param buffer The string which will become the host of the time.
+ * @param buffer_length The size of the buffer.
+ */
+__PROVIDEDBUFFER FormatTimeString(i64 ms, char* buffer,
+                                  u8 buffer_length);
+
 /**
  * @brief Get a string representation of the current time and date,
  * and concatenate it into the given string buffer.
@@ -135,25 +162,54 @@ __PROVIDEDBUFFER GetTimeString(char* buffer, u8 buffer_length);
 __PROVIDEDBUFFER GetDateString(char* buffer, u8 buffer_length);
 
 /**
- * @brief Get the current time, based off of @ref start_time and the
- * @b current number of milliseconds it's been since the beginning of
- * the epoch.
- * @return A 64-bit integer representation of the milliseconds
- * difference between the two; the amount of time the application has
- * been running.
+ * @brief The number of nanoseconds in a millisecond.
+ */
+#define NS_PER_MS 1000000ULL
+
+/**
+ * @brief The number of nanoseconds in a second.
+ */
+#define NS_PER_SECOND 1000000000ULL
+
+/**
+ * @brief Get the amount of time the application has been running,
+ * read from the system's monotonic clock. Unlike the wall clock, this
+ * never jumps backward, so differences between two readings are
+ * always valid durations.
+ * @return The number of nanoseconds since the application started.
+ */
+u64 GetCurrentTimeNS(void);
+
+/**
+ * @brief Get the amount of time the application has been running, in
+ * milliseconds. This is @ref GetCurrentTimeNS, truncated, for
+ * anything that doesn't need the precision.
+ * @return A 64-bit integer representation of the number of
+ * milliseconds the application has been running.
  */
 i64 GetCurrentTime(void);
 
+/**
+ * @brief Convert a number of nanoseconds into seconds.
+ * @param nanoseconds The nanoseconds to convert.
+ * @return The number of seconds.
+ */
+__INLINE f64 NSToSeconds(u64 nanoseconds)
+{
+    return nanoseconds / (f64)NS_PER_SECOND;
+}
+
 /**
  * @brief Calculate how well the application is running, in regards to
  * how many frames it @b could render in a second. Note the 'possible'
  * in this function's name. That is intentional, since the application
  * is clamped to run at an arbitrary VSYNC value as specified by @ref
  * ChangeApplicationFrameCap.
- * @param new_value The newest time it's taken to render a frame.
- * @return The possible framerate.
+ * @param new_value The newest time it's taken to render a frame, in
+ * milliseconds.
+ * @return The possible framerate, averaged over the last few frames.
  */
-f64 CalculatePossibleFramerate(u32 new_value);
+f64 CalculatePossibleFramerate(f64 new_value);
 
 /**
  * @brief Count the number of digits in the number passed to the
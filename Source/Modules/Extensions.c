@@ -0,0 +1,206 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_render
+#include "Extensions.h"
+#include <Logger.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The extensions of the current context. Renai only ever has
+ * the one context, so this is global.
+ */
+static Extensions _extensions = {0};
+
+/**
+ * @brief Check whether the current context is at least the given
+ * OpenGL version.
+ * @param major The major version to check for.
+ * @param minor The minor version to check for.
+ * @return A boolean value; true if the context is new enough.
+ */
+__INLINE __BOOLEAN _HasVersion(i32 major, i32 minor)
+{
+    i32 context_major = 0, context_minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &context_major);
+    glGetIntegerv(GL_MINOR_VERSION, &context_minor);
+    return context_major > major ||
+           (context_major == major && context_minor >= minor);
+}
+
+/**
+ * @brief The IDs of every debug message reported so far, and the
+ * number of them. The driver may report from any thread it likes.
+ */
+static _Atomic u32 _reported_messages[EXTENSIONS_DEBUG_MESSAGES];
+static _Atomic u32 _reported_count = 0;
+
+/**
+ * @brief Get a readable name for the source of a debug message.
+ * @param source The source, from GL_DEBUG_SOURCE_API to
+ * GL_DEBUG_SOURCE_OTHER.
+ * @return The name of the source.
+ */
+__INLINE const char* _GetDebugSourceName(u32 source)
+{
+    static const char* names[] = {
+        "API",         "window system", "shader compiler",
+        "third party", "application",   "other"};
+    if (source < GL_DEBUG_SOURCE_API ||
+        source > GL_DEBUG_SOURCE_OTHER)
+        return "unknown";
+    return names[source - GL_DEBUG_SOURCE_API];
+}
+
+/**
+ * @brief Get a readable name for the type of a debug message.
+ * @param type The type, from GL_DEBUG_TYPE_ERROR to
+ * GL_DEBUG_TYPE_OTHER.
+ * @return The name of the type.
+ */
+__INLINE const char* _GetDebugTypeName(u32 type)
+{
+    static const char* names[] = {
+        "error",       "deprecated behavior", "undefined behavior",
+        "portability", "performance",         "other"};
+    if (type < GL_DEBUG_TYPE_ERROR || type > GL_DEBUG_TYPE_OTHER)
+        return "unknown";
+    return names[type - GL_DEBUG_TYPE_ERROR];
+}
+
+/**
+ * @brief Check whether a debug message has been reported before,
+ * marking it as reported if it hasn't.
+ * @param id The ID of the message.
+ * @return A boolean value; true if the message is new, and there's
+ * still room to remember it.
+ */
+__BOOLEAN _MarkDebugMessage(u32 id)
+{
+    const u32 count = atomic_load(&_reported_count);
+    for (u32 index = 0;
+         index < count && index < EXTENSIONS_DEBUG_MESSAGES; index++)
+        if (atomic_load(&_reported_messages[index]) == id)
+            return false;
+
+    const u32 slot = atomic_fetch_add(&_reported_count, 1);
+    if (slot >= EXTENSIONS_DEBUG_MESSAGES) return false;
+    atomic_store(&_reported_messages[slot], id);
+    return true;
+}
+
+/**
+ * @brief The callback the driver reports its debug messages through.
+ * Errors kill the process, the same as they would've from @ref
+ * PollOpenGLErrors, and anything else is logged once.
+ */
+void APIENTRY _ReceiveDebugMessage(u32 source, u32 type, u32 id,
+                                   u32 severity, i32 length,
+                                   const char* message,
+                                   const void* user)
+{
+    if (type == GL_DEBUG_TYPE_ERROR &&
+        severity == GL_DEBUG_SEVERITY_HIGH)
+        PrintError("OpenGL reported an error (%s, ID %u): %.*s",
+                   _GetDebugSourceName(source), id, length, message);
+
+    if (!_MarkDebugMessage(id)) return;
+    PrintWarning("OpenGL reported %s (%s, ID %u): %.*s",
+                 _GetDebugTypeName(type), _GetDebugSourceName(source),
+                 id, length, message);
+}
+
+/**
+ * @brief Load the entry points of KHR_debug, and start reporting
+ * whatever the driver has to say. Nothing is reported unless the
+ * context was created for debugging, since drivers only bother saying
+ * much of anything then.
+ */
+void _LoadDebugOutput(void)
+{
+    i32 flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) return;
+    if (!_HasVersion(4, 3) && !glfwExtensionSupported("GL_KHR_debug"))
+        return;
+
+    _extensions.DebugMessageCallback =
+        (PFNRENAIDEBUGMESSAGECALLBACKPROC)glfwGetProcAddress(
+            "glDebugMessageCallback");
+    _extensions.DebugMessageControl =
+        (PFNRENAIDEBUGMESSAGECONTROLPROC)glfwGetProcAddress(
+            "glDebugMessageControl");
+    _extensions.ObjectLabel =
+        (PFNRENAIOBJECTLABELPROC)glfwGetProcAddress("glObjectLabel");
+    if (_extensions.DebugMessageCallback == NULL ||
+        _extensions.DebugMessageControl == NULL ||
+        _extensions.ObjectLabel == NULL)
+        return;
+
+    // Notifications are mostly the driver narrating where it put
+    // things, which is far too much to log.
+    _extensions.DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                                    GL_DEBUG_SEVERITY_NOTIFICATION, 0,
+                                    NULL, GL_FALSE);
+    _extensions.DebugMessageCallback(_ReceiveDebugMessage, NULL);
+    glEnable(GL_DEBUG_OUTPUT);
+#ifdef VALIDATION_MODE
+    // Have the driver report from within the offending call, so it's
+    // on the stack when the process is killed. This costs whatever
+    // the driver gained from threading its work.
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+#endif
+    _extensions.debug_output = true;
+}
+
+void LoadExtensions(void)
+{
+    if (_HasVersion(4, 1) ||
+        glfwExtensionSupported("GL_ARB_get_program_binary"))
+    {
+        _extensions.GetProgramBinary =
+            (PFNRENAIGETPROGRAMBINARYPROC)glfwGetProcAddress(
+                "glGetProgramBinary");
+        _extensions.ProgramBinary =
+            (PFNRENAIPROGRAMBINARYPROC)glfwGetProcAddress(
+                "glProgramBinary");
+        _extensions.ProgramParameteri =
+            (PFNRENAIPROGRAMPARAMETERIPROC)glfwGetProcAddress(
+                "glProgramParameteri");
+
+        // Some drivers advertise the extension but support no binary
+        // formats at all, which makes it useless to us.
+        i32 format_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        _extensions.program_binary =
+            _extensions.GetProgramBinary != NULL &&
+            _extensions.ProgramBinary != NULL &&
+            _extensions.ProgramParameteri != NULL && format_count > 0;
+    }
+
+#if defined(DEBUG_MODE) || defined(VALIDATION_MODE)
+    _LoadDebugOutput();
+#endif
+
+    PrintSuccess("Loaded OpenGL extensions. Program binaries: %s. "
+                 "Debug output: %s.",
+                 (_extensions.program_binary ? "yes" : "no"),
+                 (_extensions.debug_output ? "yes" : "no"));
+}
+
+void LabelObject(u32 identifier, u32 name, const char* format, ...)
+{
+    if (!_extensions.debug_output) return;
+
+    char label[EXTENSIONS_LABEL_LENGTH];
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(label, EXTENSIONS_LABEL_LENGTH, format, arguments);
+    va_end(arguments);
+    _extensions.ObjectLabel(identifier, name, -1, label);
+}
+
+__GET_STRUCT(const Extensions) GetExtensions(void)
+{
+    return &_extensions;
+}
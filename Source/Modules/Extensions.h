@@ -0,0 +1,135 @@
+/**
+ * @file Extensions.h
+ * @author Zenais Argos
+ * @brief Provides the optional OpenGL functionality Renai takes
+ * advantage of when the driver has it. GLAD is only generated for
+ * core 3.3, so anything newer is loaded by hand here, and everything
+ * using it has to check for it first. This also reports whatever the
+ * driver has to say about how it's being used, through KHR_debug.
+ * @date 2024-07-09
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_EXTENSIONS_
+#define _RENAI_EXTENSIONS_
+
+// Provides the type definitions and OpenGL headers used in this file.
+#include <Declarations.h>
+
+// The enums of ARB_get_program_binary (core since 4.1).
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// The enums of KHR_debug (core since 4.3).
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_BUFFER 0x82E0
+#define GL_PROGRAM 0x82E2
+#define GL_VERTEX_ARRAY 0x8074
+#endif
+
+/**
+ * @brief The number of distinct debug messages that are reported
+ * before the rest are dropped. Drivers tend to repeat the same one
+ * every frame, so each is only ever reported once.
+ */
+#define EXTENSIONS_DEBUG_MESSAGES 64
+
+/**
+ * @brief The longest label an OpenGL object is given. Anything longer
+ * is cut off.
+ */
+#define EXTENSIONS_LABEL_LENGTH 64
+
+typedef void (*PFNRENAIGETPROGRAMBINARYPROC)(u32 program,
+                                             i32 buffer_size,
+                                             i32* length,
+                                             u32* binary_format,
+                                             void* binary);
+typedef void (*PFNRENAIPROGRAMBINARYPROC)(u32 program,
+                                          u32 binary_format,
+                                          const void* binary,
+                                          i32 length);
+typedef void (*PFNRENAIPROGRAMPARAMETERIPROC)(u32 program, u32 name,
+                                              i32 value);
+typedef void (*PFNRENAIDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback,
+                                                 const void* user);
+typedef void (*PFNRENAIDEBUGMESSAGECONTROLPROC)(u32 source, u32 type,
+                                                u32 severity,
+                                                i32 count,
+                                                const u32* ids,
+                                                u8 enabled);
+typedef void (*PFNRENAIOBJECTLABELPROC)(u32 identifier, u32 name,
+                                        i32 length,
+                                        const char* label);
+
+/**
+ * @brief The optional functionality the current context supports,
+ * and the entry points needed to use it.
+ */
+typedef struct Extensions
+{
+    /**
+     * @brief Whether or not linked programs can be saved and reloaded
+     * as driver-specific binaries (ARB_get_program_binary), and the
+     * functions to do so.
+     */
+    bool program_binary;
+    PFNRENAIGETPROGRAMBINARYPROC GetProgramBinary;
+    PFNRENAIPROGRAMBINARYPROC ProgramBinary;
+    PFNRENAIPROGRAMPARAMETERIPROC ProgramParameteri;
+    /**
+     * @brief Whether or not the driver reports what it has to say
+     * through a callback (KHR_debug), and the functions to set that
+     * up and label objects with. This is only ever set in debug and
+     * validation builds; release builds never ask for any of it.
+     */
+    bool debug_output;
+    PFNRENAIDEBUGMESSAGECALLBACKPROC DebugMessageCallback;
+    PFNRENAIDEBUGMESSAGECONTROLPROC DebugMessageControl;
+    PFNRENAIOBJECTLABELPROC ObjectLabel;
+} Extensions;
+
+/**
+ * @brief Query the current context for every extension Renai can use,
+ * and load their entry points. This must be called after GLAD's been
+ * initialized. In debug and validation builds, this also starts
+ * reporting the driver's debug messages if it can; anything with a
+ * severity above a notification is logged, and errors kill the
+ * process. Validation builds have the driver report each message
+ * from within the call that caused it.
+ */
+void LoadExtensions(void);
+
+/**
+ * @brief Give an OpenGL object a name the driver uses when it reports
+ * anything about it, and debuggers show. This does nothing unless
+ * debug output is on.
+ * @param identifier The kind of object; GL_TEXTURE, GL_BUFFER,
+ * GL_PROGRAM, or GL_VERTEX_ARRAY.
+ * @param name The name of the object.
+ * @param format The label. This is similar to the format string in
+ * any of the @ref printf function family.
+ * @param ... The arguments to concatenate into @param format.
+ */
+void LabelObject(u32 identifier, u32 name, const char* format, ...);
+
+/**
+ * @brief Get the extensions supported by the current context.
+ * @return A pointer to the loaded extensions.
+ */
+__GET_STRUCT(const Extensions) GetExtensions(void);
+
+#endif // _RENAI_EXTENSIONS_
@@ -0,0 +1,363 @@
+#include "Geometry.h"
+#include <Logger.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+// Provides the types and macros cglm's SIMD helpers rely on.
+#include <cglm/common.h>
+// Provides cglm's SSE helpers (its fused multiply-add wrappers, in
+// particular), which the SSE kernel is built from.
+#include <cglm/simd/x86.h>
+#endif
+
+/**
+ * @brief The kernel currently in use, or -1 if one hasn't been chosen
+ * yet.
+ */
+static i8 _current_kernel = -1;
+
+/**
+ * @brief Build the quads of a run of sprites one at a time. This is
+ * the reference every other kernel has to match.
+ * @param sprites The sprites to build.
+ * @param first The index of the first sprite to build.
+ * @param count The number of sprites to build.
+ * @param vertices The buffer to write into.
+ */
+void _BuildSpritesScalar(const SpriteStream* sprites, u32 first,
+                         u32 count, f32* vertices)
+{
+    for (u32 index = first; index < first + count; index++)
+    {
+        // The corners of the quad relative to its center, in the
+        // order top right, bottom right, bottom left, top left.
+        const f32 half_width = sprites->width[index] / 2.0f,
+                  half_height = sprites->height[index] / 2.0f;
+        const f32 corners[4][2] = {{half_width, -half_height},
+                                   {half_width, half_height},
+                                   {-half_width, half_height},
+                                   {-half_width, -half_height}};
+        // Textures are flipped on load, so the top of the sprite
+        // samples from v1.
+        const f32* uv = sprites->uv[index];
+        const f32 texture_coordinates[4][2] = {{uv[2], uv[3]},
+                                               {uv[2], uv[1]},
+                                               {uv[0], uv[1]},
+                                               {uv[0], uv[3]}};
+
+        const f32 sine = sinf(sprites->rotation[index]),
+                  cosine = cosf(sprites->rotation[index]),
+                  center_x = sprites->x[index] + half_width,
+                  center_y = sprites->y[index] + half_height;
+
+        for (u8 corner = 0; corner < 4; corner++)
+        {
+            vertices[0] = center_x + corners[corner][0] * cosine -
+                          corners[corner][1] * sine;
+            vertices[1] = center_y + corners[corner][0] * sine +
+                          corners[corner][1] * cosine;
+            vertices[2] = sprites->depth[index];
+            vertices[3] = texture_coordinates[corner][0];
+            vertices[4] = texture_coordinates[corner][1];
+            vertices[5] = sprites->brightness[index];
+            vertices += SPRITE_VERTEX_FLOATS;
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The coefficients of the minimax polynomials approximating sine and
+// cosine over [-pi/4, pi/4] (from Cephes' sinf and cosf), and the two
+// halves of pi/2 used to reduce angles into that range without losing
+// precision.
+#define __SINE_1 -1.6666654611e-1f
+#define __SINE_2 8.3321608736e-3f
+#define __SINE_3 -1.9515295891e-4f
+#define __COSINE_1 4.166664568298827e-2f
+#define __COSINE_2 -1.388731625493765e-3f
+#define __COSINE_3 2.443315711809948e-5f
+#define __HALF_PI_HIGH 1.5703125f
+#define __HALF_PI_LOW 4.837512969970703125e-4f
+#define __HALF_PI_LOWEST 7.54978995489188216e-8f
+#define __TWO_OVER_PI 0.636619772367581343f
+
+/**
+ * @brief Compute the sine and cosine of four angles at once.
+ * @param angle The angles, in radians.
+ * @param sine Where to write the sines.
+ * @param cosine Where to write the cosines.
+ */
+__INLINE void _SineCosineSSE(__m128 angle, __m128* sine,
+                             __m128* cosine)
+{
+    // Find which quadrant each angle is in, and reduce it to its
+    // offset from the nearest multiple of pi/2.
+    __m128i quadrant =
+        _mm_cvtps_epi32(_mm_mul_ps(angle, glmm_set1(__TWO_OVER_PI)));
+    __m128 multiple = _mm_cvtepi32_ps(quadrant);
+    __m128 reduced =
+        glmm_fnmadd(multiple, glmm_set1(__HALF_PI_HIGH), angle);
+    reduced =
+        glmm_fnmadd(multiple, glmm_set1(__HALF_PI_LOW), reduced);
+    reduced =
+        glmm_fnmadd(multiple, glmm_set1(__HALF_PI_LOWEST), reduced);
+
+    __m128 squared = _mm_mul_ps(reduced, reduced);
+    __m128 reduced_sine =
+        glmm_fmadd(squared, glmm_set1(__SINE_3), glmm_set1(__SINE_2));
+    reduced_sine =
+        glmm_fmadd(reduced_sine, squared, glmm_set1(__SINE_1));
+    reduced_sine = glmm_fmadd(_mm_mul_ps(reduced_sine, squared),
+                              reduced, reduced);
+
+    __m128 reduced_cosine = glmm_fmadd(
+        squared, glmm_set1(__COSINE_3), glmm_set1(__COSINE_2));
+    reduced_cosine =
+        glmm_fmadd(reduced_cosine, squared, glmm_set1(__COSINE_1));
+    reduced_cosine =
+        glmm_fmadd(_mm_mul_ps(reduced_cosine, squared), squared,
+                   glmm_fnmadd(squared, glmm_set1(0.5f),
+                               glmm_set1(1.0f)));
+
+    // Odd quadrants swap sine and cosine, and quadrants 2 and 3 (or
+    // 1 and 2, for cosine) flip their signs.
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+        _mm_and_si128(quadrant, _mm_set1_epi32(1)),
+        _mm_set1_epi32(1)));
+    __m128 sine_sign = _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    __m128 cosine_sign = _mm_castsi128_ps(_mm_slli_epi32(
+        _mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)),
+                      _mm_set1_epi32(2)),
+        30));
+
+    *sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, reduced_cosine),
+                                 _mm_andnot_ps(swap, reduced_sine)),
+                       sine_sign);
+    *cosine =
+        _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, reduced_sine),
+                             _mm_andnot_ps(swap, reduced_cosine)),
+                   cosine_sign);
+}
+
+/**
+ * @brief Write the quads of four sprites, whose corners have already
+ * been worked out, into the vertex buffer.
+ * @param corners The X and Y coordinates of each corner of each
+ * sprite; eight vectors, in the order top right X, top right Y,
+ * bottom right X, and so on.
+ * @param depth The depth of each sprite.
+ * @param brightness The brightness of each sprite.
+ * @param uv The texture coordinate rectangles of the four sprites.
+ * @param vertices The buffer to write into.
+ */
+__INLINE void _StoreSpritesSSE(const __m128* corners, __m128 depth,
+                               __m128 brightness, const f32 (*uv)[4],
+                               f32* vertices)
+{
+    // Turn the four rectangles into vectors of u0, v0, u1 and v1.
+    __m128 u0 = _mm_loadu_ps(uv[0]), v0 = _mm_loadu_ps(uv[1]),
+           u1 = _mm_loadu_ps(uv[2]), v1 = _mm_loadu_ps(uv[3]);
+    _MM_TRANSPOSE4_PS(u0, v0, u1, v1);
+    const __m128 corner_u[4] = {u1, u1, u0, u0},
+                 corner_v[4] = {v1, v0, v0, v1};
+
+    // Transpose each corner's vectors into per-sprite vertices; the
+    // first four floats of each in one vector, the last two in
+    // another.
+    __m128 heads[4][4], tails[4][4];
+    for (u8 corner = 0; corner < 4; corner++)
+    {
+        __m128 x = corners[corner * 2], y = corners[corner * 2 + 1],
+               z = depth, u = corner_u[corner];
+        _MM_TRANSPOSE4_PS(x, y, z, u);
+        heads[corner][0] = x;
+        heads[corner][1] = y;
+        heads[corner][2] = z;
+        heads[corner][3] = u;
+
+        __m128 v = corner_v[corner], b = brightness,
+               unused_1 = _mm_setzero_ps(), unused_2 = unused_1;
+        _MM_TRANSPOSE4_PS(v, b, unused_1, unused_2);
+        tails[corner][0] = v;
+        tails[corner][1] = b;
+        tails[corner][2] = unused_1;
+        tails[corner][3] = unused_2;
+    }
+
+    // Write everything out in order, since the buffer may well be
+    // write-combined memory.
+    for (u8 sprite = 0; sprite < 4; sprite++)
+        for (u8 corner = 0; corner < 4; corner++)
+        {
+            _mm_storeu_ps(vertices, heads[corner][sprite]);
+            _mm_storel_pi((__m64*)(vertices + 4),
+                          tails[corner][sprite]);
+            vertices += SPRITE_VERTEX_FLOATS;
+        }
+}
+
+/**
+ * @brief Work out the corners of the quads of four sprites.
+ * @param x The X coordinates of the sprites.
+ * @param y The Y coordinates of the sprites.
+ * @param width The widths of the sprites.
+ * @param height The heights of the sprites.
+ * @param sine The sines of the sprites' rotations.
+ * @param cosine The cosines of the sprites' rotations.
+ * @param corners Where to write the corners, in the order described
+ * by @ref _StoreSpritesSSE.
+ */
+__INLINE void _BuildCornersSSE(__m128 x, __m128 y, __m128 width,
+                               __m128 height, __m128 sine,
+                               __m128 cosine, __m128* corners)
+{
+    const __m128 half = glmm_set1(0.5f);
+    __m128 half_width = _mm_mul_ps(width, half),
+           half_height = _mm_mul_ps(height, half);
+    __m128 center_x = _mm_add_ps(x, half_width),
+           center_y = _mm_add_ps(y, half_height);
+
+    // Every corner is the center plus or minus each of these.
+    __m128 width_cosine = _mm_mul_ps(half_width, cosine),
+           height_sine = _mm_mul_ps(half_height, sine),
+           width_sine = _mm_mul_ps(half_width, sine),
+           height_cosine = _mm_mul_ps(half_height, cosine);
+    __m128 right_x = _mm_add_ps(center_x, width_cosine),
+           left_x = _mm_sub_ps(center_x, width_cosine),
+           right_y = _mm_add_ps(center_y, width_sine),
+           left_y = _mm_sub_ps(center_y, width_sine);
+
+    corners[0] = _mm_add_ps(right_x, height_sine);
+    corners[1] = _mm_sub_ps(right_y, height_cosine);
+    corners[2] = _mm_sub_ps(right_x, height_sine);
+    corners[3] = _mm_add_ps(right_y, height_cosine);
+    corners[4] = _mm_sub_ps(left_x, height_sine);
+    corners[5] = _mm_add_ps(left_y, height_cosine);
+    corners[6] = _mm_add_ps(left_x, height_sine);
+    corners[7] = _mm_sub_ps(left_y, height_cosine);
+}
+
+/**
+ * @brief Build the quads of a run of sprites four at a time with SSE.
+ * Whatever doesn't fill a group of four is left to the scalar kernel.
+ * @param sprites The sprites to build.
+ * @param count The number of sprites to build.
+ * @param vertices The buffer to write into.
+ */
+void _BuildSpritesSSE(const SpriteStream* sprites, u32 count,
+                      f32* vertices)
+{
+    u32 index = 0;
+    for (; index + 4 <= count; index += 4)
+    {
+        __m128 sine, cosine, corners[8];
+        _SineCosineSSE(_mm_loadu_ps(sprites->rotation + index),
+                       &sine, &cosine);
+        _BuildCornersSSE(_mm_loadu_ps(sprites->x + index),
+                         _mm_loadu_ps(sprites->y + index),
+                         _mm_loadu_ps(sprites->width + index),
+                         _mm_loadu_ps(sprites->height + index), sine,
+                         cosine, corners);
+        _StoreSpritesSSE(corners,
+                         _mm_loadu_ps(sprites->depth + index),
+                         _mm_loadu_ps(sprites->brightness + index),
+                         sprites->uv + index,
+                         vertices + index * SPRITE_QUAD_FLOATS);
+    }
+
+    _BuildSpritesScalar(sprites, index, count - index,
+                        vertices + index * SPRITE_QUAD_FLOATS);
+}
+
+#endif
+
+__BOOLEAN IsSpriteKernelSupported(SpriteKernel kernel)
+{
+    switch (kernel)
+    {
+        case scalar_kernel: return true;
+#if defined(__x86_64__) || defined(__i386__)
+        case sse_kernel: return __builtin_cpu_supports("sse2");
+#endif
+        default: return false;
+    }
+}
+
+SpriteKernel SelectSpriteKernel(SpriteKernel kernel)
+{
+    while (kernel != scalar_kernel &&
+           !IsSpriteKernelSupported(kernel))
+        kernel--;
+    _current_kernel = kernel;
+
+    PrintSuccess("Building sprite vertices with the %s kernel.",
+                 GetSpriteKernelName(kernel));
+    return kernel;
+}
+
+SpriteKernel GetSpriteKernel(void)
+{
+    if (_current_kernel == -1) SelectSpriteKernel(sse_kernel);
+    return _current_kernel;
+}
+
+const char* GetSpriteKernelName(SpriteKernel kernel)
+{
+    switch (kernel)
+    {
+        case sse_kernel: return "SSE";
+        default:         return "scalar";
+    }
+}
+
+void BuildSpriteVertices(const SpriteStream* sprites, u32 count,
+                         f32* vertices)
+{
+    switch (GetSpriteKernel())
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        case sse_kernel:
+            _BuildSpritesSSE(sprites, count, vertices);
+            break;
+#endif
+        default:
+            _BuildSpritesScalar(sprites, 0, count, vertices);
+            break;
+    }
+}
+
+void BuildQuadIndices(u32 quad_count, u32* indices)
+{
+    for (u32 quad = 0; quad < quad_count; quad++)
+    {
+        // Two triangles per quad, matching the corner order of the
+        // vertices (top right, bottom right, bottom left, top left).
+        u32 base = quad * 4, *current = indices + quad * 6;
+        current[0] = base;
+        current[1] = base + 1;
+        current[2] = base + 3;
+        current[3] = base + 1;
+        current[4] = base + 2;
+        current[5] = base + 3;
+    }
+}
+
+void SetSpriteVertexLayout(void)
+{
+    // Position attribute.
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                          SPRITE_VERTEX_FLOATS * sizeof(f32), NULL);
+    glEnableVertexAttribArray(0);
+    // Texture coordinate attribute.
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
+                          SPRITE_VERTEX_FLOATS * sizeof(f32),
+                          (void*)(3 * sizeof(f32)));
+    glEnableVertexAttribArray(1);
+    // Brightness attribute.
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE,
+                          SPRITE_VERTEX_FLOATS * sizeof(f32),
+                          (void*)(5 * sizeof(f32)));
+    glEnableVertexAttribArray(2);
+}
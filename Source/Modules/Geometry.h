@@ -0,0 +1,130 @@
+/**
+ * @file Geometry.h
+ * @author Zenais Argos
+ * @brief Provides the kernels that turn sprites into the vertices of
+ * their quads. Sprites are read as structure-of-arrays streams and
+ * built several at a time with whatever vector instructions the CPU
+ * has, falling back to plain scalar code where it has none.
+ * @date 2024-07-12
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_GEOMETRY_
+#define _RENAI_GEOMETRY_
+
+// Provides the type definitions used in this file.
+#include <Declarations.h>
+
+/**
+ * @brief The number of floats making up a single sprite vertex; three
+ * for position, two for texture coordinates, and one for brightness.
+ */
+#define SPRITE_VERTEX_FLOATS 6
+
+/**
+ * @brief The number of floats making up a whole sprite; four
+ * vertices, in the order top right, bottom right, bottom left, top
+ * left.
+ */
+#define SPRITE_QUAD_FLOATS (4 * SPRITE_VERTEX_FLOATS)
+
+/**
+ * @brief The instruction sets a kernel can be built with, from
+ * slowest to fastest.
+ */
+typedef enum SpriteKernel
+{
+    scalar_kernel,
+    sse_kernel
+} SpriteKernel;
+
+/**
+ * @brief A run of sprites, laid out as one array per field. Every
+ * array must be at least as long as the run.
+ */
+typedef struct SpriteStream
+{
+    /**
+     * @brief The position (top left corner) and dimensions of each
+     * sprite, in screen units.
+     */
+    const f32 *x, *y, *width, *height;
+    /**
+     * @brief The rotation of each sprite around its center, in
+     * radians.
+     */
+    const f32* rotation;
+    /**
+     * @brief The depth of each sprite, as written into its vertices.
+     */
+    const f32* depth;
+    /**
+     * @brief The brightness multiplier of each sprite.
+     */
+    const f32* brightness;
+    /**
+     * @brief The texture coordinate rectangle of each sprite, in the
+     * order u0, v0, u1, v1.
+     */
+    const f32 (*uv)[4];
+} SpriteStream;
+
+/**
+ * @brief Check whether the CPU running the application can use the
+ * given kernel.
+ * @param kernel The kernel to check.
+ * @return A boolean value; true if the kernel can be used.
+ */
+__BOOLEAN IsSpriteKernelSupported(SpriteKernel kernel);
+
+/**
+ * @brief Choose the kernel @ref BuildSpriteVertices uses. If the CPU
+ * can't use the given kernel, the fastest one it can use that's
+ * slower is chosen instead. The fastest supported kernel is chosen by
+ * default.
+ * @param kernel The kernel to use.
+ * @return The kernel actually chosen.
+ */
+SpriteKernel SelectSpriteKernel(SpriteKernel kernel);
+
+/**
+ * @brief Get the kernel @ref BuildSpriteVertices currently uses.
+ * @return The kernel.
+ */
+SpriteKernel GetSpriteKernel(void);
+
+/**
+ * @brief Get the name of the given kernel, for use in log messages.
+ * @param kernel The kernel.
+ * @return The name of the kernel.
+ */
+const char* GetSpriteKernelName(SpriteKernel kernel);
+
+/**
+ * @brief Build the quads of a run of sprites with the current kernel.
+ * @param sprites The sprites to build.
+ * @param count The number of sprites to build.
+ * @param vertices The buffer to write into, @ref SPRITE_QUAD_FLOATS *
+ * count floats large. This is written strictly in order and never
+ * read, so it's fine for it to be a mapped OpenGL buffer.
+ */
+void BuildSpriteVertices(const SpriteStream* sprites, u32 count,
+                         f32* vertices);
+
+/**
+ * @brief Write the indices of the given number of quads, as built by
+ * @ref BuildSpriteVertices; two triangles per quad.
+ * @param quad_count The number of quads.
+ * @param indices The buffer to write into, 6 * quad_count indices
+ * large.
+ */
+void BuildQuadIndices(u32 quad_count, u32* indices);
+
+/**
+ * @brief Describe the layout of sprite vertices to the currently
+ * bound vertex array, reading from the currently bound array buffer.
+ */
+void SetSpriteVertexLayout(void);
+
+#endif // _RENAI_GEOMETRY_
@@ -0,0 +1,299 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_render
+#include "Headless.h"
+#include <Logger.h>
+#include <Profiler.h>
+#include <math.h>
+#include <sys/stat.h>
+
+/**
+ * @brief The offscreen framebuffer a headless run is drawn into.
+ */
+typedef struct _HeadlessTarget
+{
+    u32 framebuffer, color, depth;
+    i32 width, height;
+} _HeadlessTarget;
+
+/**
+ * @brief Create the offscreen framebuffer and bind it, so everything
+ * drawn from here on lands in it.
+ * @param target Where to write the framebuffer's handles.
+ * @param width The width of the framebuffer.
+ * @param height The height of the framebuffer.
+ */
+__KILLFAIL _CreateHeadlessTarget(_HeadlessTarget* target, i32 width,
+                                 i32 height)
+{
+    target->width = width;
+    target->height = height;
+
+    glGenRenderbuffers(1, &target->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &target->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width,
+                          height);
+
+    glGenFramebuffers(1, &target->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, target->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+                              GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, target->depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE)
+        PrintError("Failed to create the %dx%d headless framebuffer.",
+                   width, height);
+}
+
+/**
+ * @brief Unbind and free the offscreen framebuffer.
+ * @param target The framebuffer to kill.
+ */
+__KILLFAIL _KillHeadlessTarget(_HeadlessTarget* target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &target->framebuffer);
+    glDeleteRenderbuffers(1, &target->color);
+    glDeleteRenderbuffers(1, &target->depth);
+}
+
+/**
+ * @brief Write the frame currently in the offscreen framebuffer to
+ * @ref HEADLESS_DUMP_DIRECTORY, as a binary PPM image.
+ * @param target The framebuffer to read.
+ * @param frame The number of the frame, which names the file.
+ */
+__KILLFAIL _DumpHeadlessFrame(const _HeadlessTarget* target,
+                              u32 frame)
+{
+    const u64 row = (u64)target->width * 3;
+    u8* pixels = malloc(row * target->height);
+    if (pixels == NULL)
+        PrintError("Failed to allocate the pixels of frame %d. Code: "
+                   "%d.",
+                   frame, errno);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, target->width, target->height, GL_RGB,
+                 GL_UNSIGNED_BYTE, pixels);
+
+    char path[64];
+    snprintf(path, 64, HEADLESS_DUMP_DIRECTORY "/frame_%05u.ppm",
+             frame);
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        PrintWarning("Failed to open '%s' to dump a frame. Code: %d.",
+                     path, errno);
+        free(pixels);
+        return;
+    }
+
+    // OpenGL reads from the bottom row up, and images are written
+    // from the top down.
+    fprintf(file, "P6\n%d %d\n255\n", target->width, target->height);
+    for (i32 y = target->height - 1; y >= 0; y--)
+        fwrite(pixels + row * y, 1, row, file);
+    fclose(file);
+    free(pixels);
+}
+
+/**
+ * @brief Move the camera to where the script has it at the given
+ * frame; around a circle, @ref HEADLESS_SCRIPT_PERIOD frames a lap,
+ * so culling and streaming are worked the same way every run.
+ * @param camera The camera to move.
+ * @param frame The frame being rendered.
+ */
+__KILLFAIL _StepHeadlessScript(Camera* camera, u32 frame)
+{
+    if (frame == 0) return;
+    const f32 step = 2.0f * GLM_PIf / HEADLESS_SCRIPT_PERIOD,
+              previous = (frame - 1) * step, current = frame * step;
+    PanCamera(camera,
+              HEADLESS_SCRIPT_RADIUS *
+                  (cosf(current) - cosf(previous)),
+              HEADLESS_SCRIPT_RADIUS *
+                  (sinf(current) - sinf(previous)));
+}
+
+/**
+ * @brief Compare two timings, for sorting.
+ */
+i32 _CompareTimings(const void* first, const void* second)
+{
+    const u64 a = *(const u64*)first, b = *(const u64*)second;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief Write a summary of the given timings as a JSON object.
+ * @param file The file to write to.
+ * @param name The name of the object.
+ * @param timings The timings, in nanoseconds. These are sorted.
+ * @param count The number of timings.
+ */
+__KILLFAIL _WriteTimingSummary(FILE* file, const char* name,
+                               u64* timings, u32 count)
+{
+    qsort(timings, count, sizeof(u64), _CompareTimings);
+    u64 total = 0;
+    for (u32 index = 0; index < count; index++)
+        total += timings[index];
+
+    const f64 ms = NS_PER_MS;
+    fprintf(file,
+            "  \"%s\": {\"mean\": %.4f, \"min\": %.4f, \"p50\": "
+            "%.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            name, total / ms / count, timings[0] / ms,
+            timings[count / 2] / ms, timings[count * 95 / 100] / ms,
+            timings[count * 99 / 100] / ms, timings[count - 1] / ms);
+}
+
+u8 ParseHeadlessArgument(HeadlessOptions* options, i32 argc,
+                         char** argv)
+{
+    const char* argument = argv[0];
+    const char* value = (argc > 1 ? argv[1] : "");
+    if (strcmp(argument, "--headless") == 0)
+    {
+        options->enabled = true;
+        return 1;
+    }
+
+    if (strcmp(argument, "--frames") == 0)
+    {
+        if (sscanf(value, "%u", &options->frame_count) != 1 ||
+            options->frame_count == 0)
+            PrintError("'--frames' needs a count of at least 1.");
+    }
+    else if (strcmp(argument, "--size") == 0)
+    {
+        if (sscanf(value, "%dx%d", &options->width,
+                   &options->height) != 2 ||
+            options->width <= 0 || options->height <= 0)
+            PrintError("'--size' needs a size like 1080x1080.");
+    }
+    else if (strcmp(argument, "--dump") == 0)
+    {
+        if (sscanf(value, "%u", &options->dump_interval) != 1)
+            PrintError("'--dump' needs an interval in frames.");
+    }
+    else if (strcmp(argument, "--statistics") == 0)
+    {
+        if (*value == '\0')
+            PrintError("'--statistics' needs a path.");
+        options->statistics_path = value;
+    }
+    else return 0;
+    return 2;
+}
+
+__KILLFAIL RunHeadless(const HeadlessOptions* options,
+                       Renderer* renderer, Updater* updater)
+{
+    const u32 frame_count = options->frame_count;
+    // The time each frame took to submit, then the time it took to
+    // finish on the GPU too.
+    u64* timings = malloc(sizeof(u64) * frame_count * 2);
+    if (timings == NULL)
+        PrintError("Failed to allocate the headless timings. Code: "
+                   "%d.",
+                   errno);
+    u64 *submitted = timings, *finished = timings + frame_count;
+    u64 sprites = 0, draws = 0, binds = 0, changes = 0, saved = 0;
+
+    // Nothing runs alongside the frames, so every snapshot is taken
+    // and drawn in turn, through the same mailbox the simulation
+    // thread would use.
+    SnapshotMailbox* mailbox = CreateSnapshotMailbox();
+    _HeadlessTarget target;
+    _CreateHeadlessTarget(&target, options->width, options->height);
+    if (options->dump_interval != 0)
+        (void)mkdir(HEADLESS_DUMP_DIRECTORY, 0755);
+
+    // Every frame is exactly one tick, whatever time it took, so the
+    // simulation goes through the same states every run.
+    const f64 tick_length = 1.0 / updater->tick_speed;
+    const u64 start_time = GetCurrentTimeNS();
+    for (u32 frame = 0; frame < frame_count; frame++)
+    {
+        BeginProfilerFrame();
+        ResetFrameScratch();
+        const u64 frame_start = GetCurrentTimeNS();
+
+        _StepHeadlessScript(renderer->camera, frame);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        PROFILE_SCOPE("update")
+        {
+            UpdateWindowContent(updater, renderer->scene_manager,
+                                tick_length);
+            SnapshotCurrentScene(renderer->scene_manager,
+                                 renderer->camera,
+                                 GetBackSnapshot(mailbox));
+            PublishSnapshot(mailbox);
+        }
+        PROFILE_SCOPE("render")
+        {
+            RenderWindowContent(renderer, AcquireSnapshot(mailbox),
+                                0.0f);
+        }
+        submitted[frame] = GetCurrentTimeNS() - frame_start;
+        // Nothing's ever presented, so wait on the GPU instead, or
+        // it'd just queue up frames without bound.
+        PROFILE_SCOPE("finish") { glFinish(); }
+        finished[frame] = GetCurrentTimeNS() - frame_start;
+
+        const BatchStatistics* statistics =
+            GetRendererStatistics(renderer);
+        sprites += statistics->sprites;
+        draws += statistics->draws;
+        binds += statistics->binds;
+        u32 frame_changes = 0, frame_saved = 0;
+        SumStateStatistics(&frame_changes, &frame_saved);
+        changes += frame_changes;
+        saved += frame_saved;
+
+        if (options->dump_interval != 0 &&
+            frame % options->dump_interval == 0)
+            _DumpHeadlessFrame(&target, frame);
+        EndProfilerFrame();
+    }
+    const f64 run_length =
+        NSToSeconds(GetCurrentTimeNS() - start_time);
+    _KillHeadlessTarget(&target);
+    KillSnapshotMailbox(mailbox);
+
+    FILE* file = fopen(options->statistics_path, "w");
+    if (file == NULL)
+        PrintError("Failed to open '%s' to write the headless "
+                   "statistics. Code: %d.",
+                   options->statistics_path, errno);
+    fprintf(file,
+            "{\n  \"renderer\": \"%s\",\n  \"width\": %d,\n  "
+            "\"height\": %d,\n  \"frames\": %u,\n  \"seconds\": "
+            "%.4f,\n  \"sprites\": %.2f,\n  \"draws\": %.2f,\n  "
+            "\"binds\": %.2f,\n  \"state_changes\": %.2f,\n  "
+            "\"state_saved\": %.2f,\n",
+            glGetString(GL_RENDERER), options->width, options->height,
+            frame_count, run_length, (f64)sprites / frame_count,
+            (f64)draws / frame_count, (f64)binds / frame_count,
+            (f64)changes / frame_count, (f64)saved / frame_count);
+    _WriteTimingSummary(file, "submit_ms", submitted, frame_count);
+    fputs(",\n", file);
+    _WriteTimingSummary(file, "frame_ms", finished, frame_count);
+    fputs("\n}\n", file);
+    fclose(file);
+
+    PrintSuccess("Rendered %d headless frames in %.2f seconds (%.1f "
+                 "FPS). Statistics are in '%s'.",
+                 frame_count, run_length, frame_count / run_length,
+                 options->statistics_path);
+    free(timings);
+}
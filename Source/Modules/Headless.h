@@ -0,0 +1,116 @@
+/**
+ * @file Headless.h
+ * @author Zenais Argos
+ * @brief Provides the headless mode; Renai without a window or a
+ * monitor, rendering a scripted run of frames into an offscreen
+ * framebuffer and writing out how long each took. Every frame steps
+ * the simulation exactly one tick and moves the camera along the
+ * same path, so two runs draw the same frames, which is what makes
+ * them comparable. The context comes from GLFW's null platform, so
+ * a software driver like Mesa's llvmpipe is all that's needed.
+ * @date 2024-07-19
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_HEADLESS_
+#define _RENAI_HEADLESS_
+
+// Provides the renderer whose frames are drawn and timed.
+#include <Renderer.h>
+// Provides the updater the simulation is stepped with.
+#include <Updater.h>
+
+/**
+ * @brief The number of frames rendered when none is given.
+ */
+#define HEADLESS_DEFAULT_FRAMES 600
+
+/**
+ * @brief The width and height of the framebuffer when no size is
+ * given.
+ */
+#define HEADLESS_DEFAULT_SIZE 1080
+
+/**
+ * @brief Where the timing statistics of a run are written when no
+ * path is given, relative to the executable.
+ */
+#define HEADLESS_STATISTICS_PATH "./headless.json"
+
+/**
+ * @brief The directory dumped frames are written into, relative to
+ * the executable.
+ */
+#define HEADLESS_DUMP_DIRECTORY "./Frames"
+
+/**
+ * @brief The number of frames the camera takes to go around its path
+ * once, and the radius of that path, in screen units.
+ */
+#define HEADLESS_SCRIPT_PERIOD 240
+#define HEADLESS_SCRIPT_RADIUS 512.0f
+
+/**
+ * @brief What a headless run was asked to do, from the command line.
+ */
+typedef struct HeadlessOptions
+{
+    /**
+     * @brief Whether or not a headless run was asked for at all.
+     */
+    bool enabled;
+    /**
+     * @brief The number of frames to render.
+     */
+    u32 frame_count;
+    /**
+     * @brief The size of the offscreen framebuffer.
+     */
+    i32 width, height;
+    /**
+     * @brief Every how many frames one is dumped to @ref
+     * HEADLESS_DUMP_DIRECTORY, or 0 to dump none.
+     */
+    u32 dump_interval;
+    /**
+     * @brief Where the run's timing statistics are written.
+     */
+    const char* statistics_path;
+} HeadlessOptions;
+
+/**
+ * @brief The options of a run nobody's asked for, which everything
+ * not given on the command line is left at.
+ */
+#define HEADLESS_DEFAULT_OPTIONS                                     \
+    ((HeadlessOptions){false, HEADLESS_DEFAULT_FRAMES,               \
+                       HEADLESS_DEFAULT_SIZE, HEADLESS_DEFAULT_SIZE, \
+                       0, HEADLESS_STATISTICS_PATH})
+
+/**
+ * @brief Read a single headless argument; `--headless`, `--frames
+ * <count>`, `--size <width>x<height>`, `--dump <interval>`, or
+ * `--statistics <path>`. Kills the process if the argument is one of
+ * these but its value doesn't make sense.
+ * @param options Where to write the argument's value.
+ * @param argc The number of arguments left, this one included.
+ * @param argv The arguments left, starting with this one.
+ * @return The number of arguments read, or 0 if this isn't a
+ * headless argument.
+ */
+u8 ParseHeadlessArgument(HeadlessOptions* options, i32 argc,
+                         char** argv);
+
+/**
+ * @brief Render the run the given options describe, then write its
+ * statistics. The GLFW window whose context is current is never
+ * drawn to or shown. Kills the process on failure.
+ * @param options The options of the run.
+ * @param renderer The renderer to draw with.
+ * @param updater The updater to step the simulation with.
+ */
+__KILLFAIL RunHeadless(const HeadlessOptions* options,
+                       Renderer* renderer, Updater* updater);
+
+#endif // _RENAI_HEADLESS_
@@ -0,0 +1,375 @@
+#include "Input.h"
+#include <Logger.h>
+
+/**
+ * @brief The input system GLFW's callbacks record into, or NULL if
+ * there isn't one.
+ */
+static Input* _active_input = NULL;
+
+/**
+ * @brief The code of the gamepad button of the given name.
+ */
+#define __GAMEPAD(button)                                            \
+    INPUT_GAMEPAD_CODE(GLFW_GAMEPAD_BUTTON_##button)
+
+/**
+ * @brief The bindings every input system starts with; the keyboard
+ * first, and the gamepad second.
+ */
+static const u16 _default_bindings[action_count]
+                                  [INPUT_ACTION_BINDINGS] = {
+    [action_dump_trace] = {GLFW_KEY_F3, INPUT_UNBOUND},
+    [action_maximize] = {GLFW_KEY_F11, INPUT_UNBOUND},
+    [action_close] = {GLFW_KEY_F12, INPUT_UNBOUND},
+    [action_fullscreen] = {GLFW_KEY_BACKSLASH, INPUT_UNBOUND},
+    [action_pan_left] = {GLFW_KEY_LEFT, __GAMEPAD(DPAD_LEFT)},
+    [action_pan_right] = {GLFW_KEY_RIGHT, __GAMEPAD(DPAD_RIGHT)},
+    [action_pan_up] = {GLFW_KEY_UP, __GAMEPAD(DPAD_UP)},
+    [action_pan_down] = {GLFW_KEY_DOWN, __GAMEPAD(DPAD_DOWN)},
+    [action_zoom_in] = {GLFW_KEY_EQUAL, __GAMEPAD(RIGHT_BUMPER)},
+    [action_zoom_out] = {GLFW_KEY_MINUS, __GAMEPAD(LEFT_BUMPER)},
+};
+
+/**
+ * @brief Apply a single button event to the given input system's
+ * state.
+ * @param input The input system.
+ * @param code The code of the button.
+ * @param pressed Whether it went down or up.
+ */
+__INLINE void _ApplyButtonEvent(Input* input, u16 code, bool pressed)
+{
+    const u64 bit = 1ull << (code % 64);
+    u64* held = &input->held[code / 64];
+    if (pressed && !(*held & bit))
+    {
+        input->pressed[code / 64] |= bit;
+        *held |= bit;
+    }
+    else if (!pressed && (*held & bit))
+    {
+        input->released[code / 64] |= bit;
+        *held &= ~bit;
+    }
+}
+
+/**
+ * @brief Apply a single event to the given input system's state.
+ * @param input The input system.
+ * @param event The event to apply.
+ */
+__KILLFAIL _ApplyInputEvent(Input* input, const InputEvent* event)
+{
+    switch (event->type)
+    {
+        case input_button:
+            if (event->code < INPUT_CODE_COUNT)
+                _ApplyButtonEvent(input, event->code, event->pressed);
+            return;
+        case input_cursor:
+            input->cursor[0] = event->x;
+            input->cursor[1] = event->y;
+            return;
+        case input_scroll:
+            input->scrolled[0] += event->x;
+            input->scrolled[1] += event->y;
+            return;
+        case input_gamepad_axis:
+            if (event->code <= GLFW_GAMEPAD_AXIS_LAST)
+                input->axes[event->code] = event->x;
+            return;
+    }
+}
+
+void PushInputEvent(Input* input, const InputEvent* event)
+{
+    if (input->listener != NULL)
+        input->listener(event, input->hook_data);
+
+    // Cursor movement and scrolling are folded into the event before
+    // them if it's of the same kind, so a flood of either can't push
+    // button events out of the ring.
+    if (input->event_count != 0 &&
+        (event->type == input_cursor || event->type == input_scroll))
+    {
+        InputEvent* last =
+            &input->events[(input->first_event + input->event_count -
+                            1) %
+                           INPUT_EVENT_SLOTS];
+        if (last->type == event->type)
+        {
+            // The cursor only matters where it ended up, but every
+            // bit of scrolling counts.
+            if (event->type == input_cursor) *last = *event;
+            else
+            {
+                last->x += event->x;
+                last->y += event->y;
+            }
+            input->statistics.recorded++;
+            return;
+        }
+    }
+
+    // Rather than lose anything, make room by applying the oldest
+    // event now. The state it leaves is exactly what the tick would
+    // have worked out, just sooner.
+    if (input->event_count == INPUT_EVENT_SLOTS)
+    {
+        _ApplyInputEvent(input, &input->events[input->first_event]);
+        input->first_event =
+            (input->first_event + 1) % INPUT_EVENT_SLOTS;
+        input->event_count--;
+        input->statistics.overflowed++;
+    }
+    input->events[(input->first_event + input->event_count) %
+                  INPUT_EVENT_SLOTS] = *event;
+    input->event_count++;
+    input->statistics.recorded++;
+}
+
+/**
+ * @brief The key callback; fires every time a key changes.
+ * @param window The window that was focused (unused).
+ * @param key The key.
+ * @param scancode The scancode of the key (unused).
+ * @param action The action taken upon the key.
+ * @param mods Modifiers to the key action (unused).
+ */
+void _InputKeyCallback(GLFWwindow* window, i32 key, i32 scancode,
+                       i32 action, i32 mods)
+{
+    // The system's own key repeat is ignored, since actions repeat in
+    // ticks instead.
+    if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT)
+        return;
+    RecordInputEvent(&(InputEvent){input_button, action == GLFW_PRESS,
+                                   key, 0.0f, 0.0f});
+}
+
+/**
+ * @brief The mouse button callback; fires every time a mouse button
+ * changes.
+ * @param window The window that was focused (unused).
+ * @param button The button.
+ * @param action The action taken upon the button.
+ * @param mods Modifiers to the button action (unused).
+ */
+void _InputMouseCallback(GLFWwindow* window, i32 button, i32 action,
+                         i32 mods)
+{
+    if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST) return;
+    RecordInputEvent(&(InputEvent){input_button, action == GLFW_PRESS,
+                                   INPUT_MOUSE_CODE(button), 0.0f,
+                                   0.0f});
+}
+
+/**
+ * @brief The cursor callback; fires every time the cursor moves.
+ * @param window The window that was focused (unused).
+ * @param x The new X coordinate of the cursor.
+ * @param y The new Y coordinate of the cursor.
+ */
+void _InputCursorCallback(GLFWwindow* window, f64 x, f64 y)
+{
+    RecordInputEvent(&(InputEvent){input_cursor, false, 0, x, y});
+}
+
+/**
+ * @brief The scroll callback; fires every time the wheel (or a
+ * touchpad) scrolls.
+ * @param window The window that was focused (unused).
+ * @param x How far it scrolled horizontally.
+ * @param y How far it scrolled vertically.
+ */
+void _InputScrollCallback(GLFWwindow* window, f64 x, f64 y)
+{
+    RecordInputEvent(&(InputEvent){input_scroll, false, 0, x, y});
+}
+
+void PollGamepad(Input* input)
+{
+    GLFWgamepadstate state;
+    if (!glfwJoystickIsGamepad(GLFW_JOYSTICK_1) ||
+        !glfwGetGamepadState(GLFW_JOYSTICK_1, &state))
+        return;
+
+    pthread_mutex_lock(&input->lock);
+    if (!input->live)
+    {
+        pthread_mutex_unlock(&input->lock);
+        return;
+    }
+
+    for (u8 button = 0; button <= GLFW_GAMEPAD_BUTTON_LAST; button++)
+        if (state.buttons[button] != input->gamepad[button])
+        {
+            input->gamepad[button] = state.buttons[button];
+            PushInputEvent(
+                input, &(InputEvent){input_button,
+                                     state.buttons[button] ==
+                                         GLFW_PRESS,
+                                     INPUT_GAMEPAD_CODE(button), 0.0f,
+                                     0.0f});
+        }
+    for (u8 axis = 0; axis <= GLFW_GAMEPAD_AXIS_LAST; axis++)
+        if (state.axes[axis] != input->gamepad_axes[axis])
+        {
+            input->gamepad_axes[axis] = state.axes[axis];
+            PushInputEvent(input,
+                           &(InputEvent){input_gamepad_axis, false,
+                                         axis, state.axes[axis],
+                                         0.0f});
+        }
+    pthread_mutex_unlock(&input->lock);
+}
+
+/**
+ * @brief Work out the state of every action from the state of the
+ * codes it's bound to.
+ * @param input The input system.
+ */
+__KILLFAIL _ResolveActions(Input* input)
+{
+    input->actions_held = 0;
+    input->actions_pressed = 0;
+    input->actions_released = 0;
+
+    for (u8 action = 0; action < action_count; action++)
+    {
+        u64 held = 0, pressed = 0, released = 0;
+        for (u8 binding = 0; binding < INPUT_ACTION_BINDINGS;
+             binding++)
+        {
+            const u16 code = input->bindings[action][binding];
+            if (code == INPUT_UNBOUND) continue;
+            held |= input->held[code / 64] >> (code % 64);
+            pressed |= input->pressed[code / 64] >> (code % 64);
+            released |= input->released[code / 64] >> (code % 64);
+        }
+        input->actions_held |= (held & 1) << action;
+        input->actions_pressed |= (pressed & 1) << action;
+        input->actions_released |= (released & 1) << action;
+
+        // A tap that went down and up within a single tick still
+        // counts as having been held for it.
+        if (held & 1) input->held_ticks[action]++;
+        else input->held_ticks[action] = pressed & 1;
+    }
+}
+
+__CREATE_STRUCT_KILLFAIL(Input) CreateInput(GLFWwindow* window)
+{
+    Input* input = __MALLOC(
+        Input, input,
+        ("Failed to allocate the input system. Code: %d.", errno));
+    memset(input, 0, sizeof(Input));
+    memcpy(input->bindings, _default_bindings,
+           sizeof(_default_bindings));
+    input->live = true;
+    pthread_mutex_init(&input->lock, NULL);
+
+    glfwSetKeyCallback(window, _InputKeyCallback);
+    glfwSetMouseButtonCallback(window, _InputMouseCallback);
+    glfwSetCursorPosCallback(window, _InputCursorCallback);
+    glfwSetScrollCallback(window, _InputScrollCallback);
+    _active_input = input;
+
+    PrintSuccess("Created the input system. Ring: %d events (%d "
+                 "bytes), %d input codes.",
+                 INPUT_EVENT_SLOTS, sizeof(input->events),
+                 INPUT_CODE_COUNT);
+    return input;
+}
+
+void KillInput(Input* input)
+{
+    if (_active_input == input) _active_input = NULL;
+    PrintSuccess("Freed the input system (%lu events over %lu ticks, "
+                 "%lu applied early).",
+                 input->statistics.recorded, input->statistics.ticks,
+                 input->statistics.overflowed);
+    pthread_mutex_destroy(&input->lock);
+    __FREE(input, ("The input freer was given an invalid input."));
+}
+
+/**
+ * @brief Push every event held over the poll underway into the ring,
+ * under a single lock.
+ * @param input The input system.
+ */
+__KILLFAIL _FlushStagedEvents(Input* input)
+{
+    pthread_mutex_lock(&input->lock);
+    if (input->live)
+        for (u32 index = 0; index < input->staged_count; index++)
+            PushInputEvent(input, &input->staged[index]);
+    pthread_mutex_unlock(&input->lock);
+    input->staged_count = 0;
+}
+
+void BeginInputPoll(Input* input) { input->polling = true; }
+
+void EndInputPoll(Input* input)
+{
+    if (input->staged_count != 0) _FlushStagedEvents(input);
+    input->polling = false;
+}
+
+void RecordInputEvent(const InputEvent* event)
+{
+    Input* input = _active_input;
+    if (input == NULL) return;
+
+    // Within a poll, events are only held onto, and only handed over
+    // early if there's more of them than the ring could take anyway.
+    if (input->polling)
+    {
+        if (input->staged_count == INPUT_EVENT_SLOTS)
+            _FlushStagedEvents(input);
+        input->staged[input->staged_count++] = *event;
+        return;
+    }
+
+    pthread_mutex_lock(&input->lock);
+    if (input->live) PushInputEvent(input, event);
+    pthread_mutex_unlock(&input->lock);
+}
+
+void ProcessInput(Input* input)
+{
+    pthread_mutex_lock(&input->lock);
+    if (input->poller != NULL) input->poller(input, input->hook_data);
+    for (u32 index = 0; index < input->event_count; index++)
+        _ApplyInputEvent(input,
+                         &input->events[(input->first_event + index) %
+                                        INPUT_EVENT_SLOTS]);
+    input->first_event = 0;
+    input->event_count = 0;
+    // The lock is held through to the end, since a full ring applies
+    // events to the very state resolved and cleared here.
+    _ResolveActions(input);
+
+    // Everything that happened since the last tick belongs to this
+    // one now.
+    memset(input->pressed, 0, sizeof(input->pressed));
+    memset(input->released, 0, sizeof(input->released));
+    memcpy(input->scroll, input->scrolled, sizeof(input->scroll));
+    input->scrolled[0] = input->scrolled[1] = 0.0f;
+    input->statistics.ticks++;
+    pthread_mutex_unlock(&input->lock);
+}
+
+void BindInputAction(Input* input, InputAction action, u8 binding,
+                     u16 code)
+{
+    if (action >= action_count || binding >= INPUT_ACTION_BINDINGS ||
+        (code >= INPUT_CODE_COUNT && code != INPUT_UNBOUND))
+    {
+        PrintWarning("Tried to bind action %d to an invalid input.",
+                     action);
+        return;
+    }
+    input->bindings[action][binding] = code;
+}
@@ -0,0 +1,387 @@
+/**
+ * @file Input.h
+ * @author Zenais Argos
+ * @brief Provides the input system. GLFW's callbacks do nothing but
+ * record events into a fixed ring, and once per tick the ring is
+ * drained into the state of every key, mouse button, and gamepad
+ * button, along with which of them were pressed or released since
+ * the last tick. Actions are then resolved from that state through
+ * rebindable bindings, so the updater asks about "pan left" rather
+ * than the left arrow key. The ring is locked, so events can be
+ * recorded on the main thread while ticks run on another; a poll's
+ * worth of events is handed over at once, under a single lock.
+ * @date 2024-07-20
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_INPUT_
+#define _RENAI_INPUT_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+#include <pthread.h>
+
+/**
+ * @brief The number of events the ring can hold between two ticks.
+ * Past this, the oldest event is applied to the state early rather
+ * than dropped, so no press or release is ever lost.
+ */
+#define INPUT_EVENT_SLOTS 256
+
+/**
+ * @brief The number of inputs a single action can be bound to.
+ */
+#define INPUT_ACTION_BINDINGS 2
+
+/**
+ * @brief The input code of the given mouse button. Keys keep their
+ * GLFW key codes, and the mouse and gamepad buttons come after them,
+ * so every button has a single code.
+ */
+#define INPUT_MOUSE_CODE(button) (GLFW_KEY_LAST + 1 + (button))
+
+/**
+ * @brief The input code of the given gamepad button.
+ */
+#define INPUT_GAMEPAD_CODE(button)                                   \
+    (INPUT_MOUSE_CODE(GLFW_MOUSE_BUTTON_LAST + 1) + (button))
+
+/**
+ * @brief The number of input codes, and the number of 64-bit words
+ * it takes to hold a bit for each.
+ */
+#define INPUT_CODE_COUNT                                             \
+    INPUT_GAMEPAD_CODE(GLFW_GAMEPAD_BUTTON_LAST + 1)
+#define INPUT_CODE_WORDS ((INPUT_CODE_COUNT + 63) / 64)
+
+/**
+ * @brief A code bound to nothing at all.
+ */
+#define INPUT_UNBOUND UINT16_MAX
+
+/**
+ * @brief The kinds of event the ring records.
+ */
+typedef enum InputEventType
+{
+    input_button,
+    input_cursor,
+    input_scroll,
+    input_gamepad_axis
+} InputEventType;
+
+/**
+ * @brief A single recorded event.
+ */
+typedef struct InputEvent
+{
+    /**
+     * @brief What kind of event this is.
+     */
+    u8 type;
+    /**
+     * @brief Whether the button went down or up. Buttons only.
+     */
+    bool pressed;
+    /**
+     * @brief The input code of the button, or the index of the axis.
+     */
+    u16 code;
+    /**
+     * @brief The cursor's position, the scroll offset, or the axis'
+     * value in x. Everything but buttons.
+     */
+    f32 x, y;
+} InputEvent;
+
+/**
+ * @brief The things the player can do, each of which is bound to
+ * one or more inputs.
+ */
+typedef enum InputAction
+{
+    action_dump_trace,
+    action_maximize,
+    action_close,
+    action_fullscreen,
+    action_pan_left,
+    action_pan_right,
+    action_pan_up,
+    action_pan_down,
+    action_zoom_in,
+    action_zoom_out,
+    action_count
+} InputAction;
+
+/**
+ * @brief What the input system has done over its lifetime.
+ */
+typedef struct InputStatistics
+{
+    /**
+     * @brief The number of events recorded, and the number applied
+     * before their tick because the ring was full.
+     */
+    u64 recorded, overflowed;
+    /**
+     * @brief The number of ticks the ring has been drained on.
+     */
+    u64 ticks;
+} InputStatistics;
+
+struct Input;
+
+/**
+ * @brief Something called at the start of every tick, with the input
+ * system's lock held, to push events into it.
+ */
+typedef void (*InputPoller)(struct Input* input, void* data);
+
+/**
+ * @brief Something told about every event pushed into the input
+ * system, before it's queued.
+ */
+typedef void (*InputListener)(const InputEvent* event, void* data);
+
+/**
+ * @brief The input system. Only one is active at a time, since GLFW's
+ * callbacks aren't handed one.
+ */
+typedef struct Input
+{
+    /**
+     * @brief The ring of events recorded since the last tick, where
+     * the oldest of them is, and how many there are.
+     */
+    InputEvent events[INPUT_EVENT_SLOTS];
+    u32 first_event, event_count;
+    /**
+     * @brief The lock guarding the ring, along with the hooks below
+     * and the gamepad's last state, since events are recorded on the
+     * main thread while ticks drain them on their own. It also guards
+     * the state below up to the actions, which a full ring applies
+     * events to early.
+     */
+    pthread_mutex_t lock;
+    /**
+     * @brief One bit per input code; whether it's down, whether it
+     * went down since the last tick, and whether it went up since
+     * the last tick. The last two are folded into the actions, then
+     * cleared.
+     */
+    u64 held[INPUT_CODE_WORDS], pressed[INPUT_CODE_WORDS],
+        released[INPUT_CODE_WORDS];
+    /**
+     * @brief The position of the cursor, how far the wheel was
+     * scrolled over the last tick, and how far it's been scrolled
+     * since.
+     */
+    f32 cursor[2], scroll[2], scrolled[2];
+    /**
+     * @brief The position of every axis of the gamepad, from -1 to 1.
+     */
+    f32 axes[GLFW_GAMEPAD_AXIS_LAST + 1];
+    /**
+     * @brief The buttons and axes of the gamepad as they were last
+     * polled, which may be a few frames ahead of the last tick.
+     */
+    u8 gamepad[GLFW_GAMEPAD_BUTTON_LAST + 1];
+    f32 gamepad_axes[GLFW_GAMEPAD_AXIS_LAST + 1];
+    /**
+     * @brief The codes every action is bound to, @ref INPUT_UNBOUND
+     * for unused bindings.
+     */
+    u16 bindings[action_count][INPUT_ACTION_BINDINGS];
+    /**
+     * @brief One bit per action; whether any of its bindings are
+     * down, went down, or went up, as of the last tick.
+     */
+    u32 actions_held, actions_pressed, actions_released;
+    /**
+     * @brief The number of ticks each action has been held for, 0 if
+     * it isn't.
+     */
+    u32 held_ticks[action_count];
+    /**
+     * @brief What's called at the start of every tick, what's told
+     * about every event, or NULL, and the data handed to both. These
+     * are how sessions are recorded and replayed.
+     */
+    InputPoller poller;
+    InputListener listener;
+    void* hook_data;
+    /**
+     * @brief Whether or not GLFW's callbacks are recorded. A session
+     * being replayed ignores the user entirely.
+     */
+    bool live;
+    /**
+     * @brief The events recorded over the poll underway, how many
+     * there are, and whether there is one. Only the main thread ever
+     * touches these, so they're handed to the ring under one lock
+     * once the poll is done, rather than one lock an event.
+     */
+    InputEvent staged[INPUT_EVENT_SLOTS];
+    u32 staged_count;
+    bool polling;
+    InputStatistics statistics;
+} Input;
+
+/**
+ * @brief Create an input system with the default bindings, make it
+ * the active one, and hook its callbacks up to the given window.
+ * Kills the process on failure.
+ * @param window The window whose events to record.
+ * @return A pointer to the created input system.
+ */
+__CREATE_STRUCT_KILLFAIL(Input) CreateInput(GLFWwindow* window);
+
+/**
+ * @brief Free the given input system. If it was the active one,
+ * events are ignored afterward.
+ * @param input The input system to kill.
+ */
+void KillInput(Input* input);
+
+/**
+ * @brief Record an event into the active input system, as long as
+ * it's live. This is what GLFW's callbacks call.
+ * @param event The event to record.
+ */
+void RecordInputEvent(const InputEvent* event);
+
+/**
+ * @brief Hold onto every event recorded from here on, rather than
+ * pushing each into the ring as it comes. This is called on the main
+ * thread just before GLFW is polled.
+ * @param input The input system.
+ */
+void BeginInputPoll(Input* input);
+
+/**
+ * @brief Push every event held since @ref BeginInputPoll into the
+ * ring under a single lock, as long as the input system's live, then
+ * go back to pushing events as they're recorded. This is called on
+ * the main thread right after GLFW is polled.
+ * @param input The input system.
+ */
+void EndInputPoll(Input* input);
+
+/**
+ * @brief Push an event into the given input system's ring, telling
+ * its listener about it first. The caller has to hold the input
+ * system's lock, which its poller always does.
+ * @param input The input system.
+ * @param event The event to push.
+ */
+void PushInputEvent(Input* input, const InputEvent* event);
+
+/**
+ * @brief Poll the first gamepad, recording an event for every button
+ * and axis that's changed since it was last polled, as long as the
+ * input system's live. GLFW has no callbacks for these, and only
+ * lets them be polled from the main thread, so this is called there
+ * after polling for events.
+ * @param input The input system to record into.
+ */
+void PollGamepad(Input* input);
+
+/**
+ * @brief Drain every event recorded since the last tick, working out
+ * which buttons went down or up and which actions that triggers. This
+ * is called once at the start of every tick, from whichever thread
+ * runs them.
+ * @param input The input system to process.
+ */
+void ProcessInput(Input* input);
+
+/**
+ * @brief Bind the given action to an input code, replacing whatever
+ * the binding was.
+ * @param input The input system.
+ * @param action The action to bind.
+ * @param binding Which of the action's bindings to replace.
+ * @param code The code to bind it to, or @ref INPUT_UNBOUND.
+ */
+void BindInputAction(Input* input, InputAction action, u8 binding,
+                     u16 code);
+
+/**
+ * @brief Check whether the given input code is down.
+ * @param input The input system.
+ * @param code The code of the key or button.
+ * @return A boolean representing whether or not it's down.
+ */
+__INLINE __BOOLEAN IsInputHeld(const Input* input, u16 code)
+{
+    return (input->held[code / 64] >> (code % 64)) & 1;
+}
+
+/**
+ * @brief Check whether the given action went down this tick.
+ * @param input The input system.
+ * @param action The action to check.
+ * @return A boolean representing whether or not it was pressed.
+ */
+__INLINE __BOOLEAN IsActionPressed(const Input* input,
+                                   InputAction action)
+{
+    return (input->actions_pressed >> action) & 1;
+}
+
+/**
+ * @brief Check whether the given action is down.
+ * @param input The input system.
+ * @param action The action to check.
+ * @return A boolean representing whether or not it's held.
+ */
+__INLINE __BOOLEAN IsActionHeld(const Input* input,
+                                InputAction action)
+{
+    return (input->actions_held >> action) & 1;
+}
+
+/**
+ * @brief Check whether the given action went up this tick.
+ * @param input The input system.
+ * @param action The action to check.
+ * @return A boolean representing whether or not it was released.
+ */
+__INLINE __BOOLEAN IsActionReleased(const Input* input,
+                                    InputAction action)
+{
+    return (input->actions_released >> action) & 1;
+}
+
+/**
+ * @brief Check whether the given action should fire this tick; when
+ * it's first pressed, then every so many ticks for as long as it's
+ * held. This counts in ticks rather than time, so it repeats the same
+ * way at any framerate.
+ * @param input The input system.
+ * @param action The action to check.
+ * @param interval The number of ticks between repeats.
+ * @return A boolean representing whether or not the action fires.
+ */
+__INLINE __BOOLEAN IsActionRepeated(const Input* input,
+                                    InputAction action, u32 interval)
+{
+    const u32 ticks = input->held_ticks[action];
+    if (interval == 0) interval = 1;
+    return ticks != 0 && (ticks - 1) % interval == 0;
+}
+
+/**
+ * @brief Get what the given input system has done.
+ * @param input The input system.
+ * @return A pointer to the input system's statistics.
+ */
+__INLINE __GET_STRUCT(InputStatistics)
+    GetInputStatistics(Input* input)
+{
+    return &input->statistics;
+}
+
+#endif // _RENAI_INPUT_
@@ -0,0 +1,323 @@
+#include "Jobs.h"
+#include <sched.h>
+#include <unistd.h>
+
+/**
+ * @brief The index of the deque owned by the calling thread. The
+ * context thread owns deque 0, and worker N owns deque N + 1.
+ */
+static _Thread_local u8 _deque_index = 0;
+
+/**
+ * @brief Push a job onto the bottom of the given deque. This may only
+ * be called by the deque's owner.
+ * @return A boolean value; true if the job was pushed, false if the
+ * deque is full.
+ */
+__BOOLEAN _PushJob(JobDeque* deque, Job* job)
+{
+    i64 bottom = atomic_load_explicit(&deque->bottom,
+                                      memory_order_relaxed),
+        top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) return false;
+
+    atomic_store_explicit(&deque->jobs[bottom % JOB_DEQUE_CAPACITY],
+                          job, memory_order_relaxed);
+    // Make sure the job is visible before the new bottom is.
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1,
+                          memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Pop a job from the bottom of the given deque. This may only
+ * be called by the deque's owner.
+ * @return The popped job, or NULL if the deque was empty.
+ */
+Job* _PopJob(JobDeque* deque)
+{
+    i64 bottom = atomic_load_explicit(&deque->bottom,
+                                      memory_order_relaxed) -
+                 1;
+    atomic_store_explicit(&deque->bottom, bottom,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // The deque was already empty; put the bottom back.
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(
+        &deque->jobs[bottom % JOB_DEQUE_CAPACITY],
+        memory_order_relaxed);
+    if (top == bottom)
+    {
+        // This is the last job, so we have to race any thieves for
+        // it.
+        if (!atomic_compare_exchange_strong_explicit(
+                &deque->top, &top, top + 1, memory_order_seq_cst,
+                memory_order_relaxed))
+            job = NULL;
+        atomic_store_explicit(&deque->bottom, bottom + 1,
+                              memory_order_relaxed);
+    }
+    return job;
+}
+
+/**
+ * @brief Steal a job from the top of the given deque. This may be
+ * called by any thread.
+ * @return The stolen job, or NULL if the deque was empty or another
+ * thread got there first.
+ */
+Job* _StealJob(JobDeque* deque)
+{
+    i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    i64 bottom =
+        atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+
+    Job* job = atomic_load_explicit(
+        &deque->jobs[top % JOB_DEQUE_CAPACITY], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(
+            &deque->top, &top, top + 1, memory_order_seq_cst,
+            memory_order_relaxed))
+        return NULL;
+    return job;
+}
+
+/**
+ * @brief Find a job for the calling thread to run; first from its own
+ * deque, and then from everybody else's.
+ * @param system The job system to search.
+ * @return The job found, or NULL if there was nothing to run.
+ */
+Job* _FindJob(JobSystem* system)
+{
+    Job* job = _PopJob(&system->deques[_deque_index]);
+
+    // Start stealing from the deque just after our own, so that every
+    // thread doesn't hammer the same victim.
+    for (u8 offset = 1; job == NULL && offset <= system->worker_count;
+         offset++)
+        job = _StealJob(&system->deques[(_deque_index + offset) %
+                                        (system->worker_count + 1)]);
+
+    if (job != NULL) atomic_fetch_sub(&system->queued, 1);
+    return job;
+}
+
+/**
+ * @brief Run the given job and mark it as finished.
+ */
+__INLINE void _RunJob(JobSystem* system, Job* job)
+{
+    job->function(job->data);
+    atomic_fetch_sub(&system->pending, 1);
+}
+
+/**
+ * @brief The arguments handed to each worker thread on creation.
+ */
+typedef struct _WorkerArguments
+{
+    JobSystem* system;
+    u8 index;
+} _WorkerArguments;
+
+/**
+ * @brief The body of every worker thread. Workers run whatever they
+ * can find, and sleep whenever every deque is empty.
+ * @param arguments The worker's @ref _WorkerArguments.
+ */
+void* _RunWorker(void* arguments)
+{
+    JobSystem* system = ((_WorkerArguments*)arguments)->system;
+    _deque_index = ((_WorkerArguments*)arguments)->index;
+    free(arguments);
+
+    while (atomic_load(&system->running))
+    {
+        Job* job = _FindJob(system);
+        if (job != NULL)
+        {
+            _RunJob(system, job);
+            continue;
+        }
+
+        pthread_mutex_lock(&system->sleep_lock);
+        while (atomic_load(&system->running) &&
+               atomic_load(&system->queued) == 0)
+            pthread_cond_wait(&system->sleep_signal,
+                              &system->sleep_lock);
+        pthread_mutex_unlock(&system->sleep_lock);
+    }
+
+    return NULL;
+}
+
+__CREATE_STRUCT_KILLFAIL(JobSystem) CreateJobSystem(u8 worker_count)
+{
+    JobSystem* system = __MALLOC(
+        JobSystem, system,
+        ("Failed to allocate the job system. Code: %d.", errno));
+
+    if (worker_count == 0)
+    {
+        // Leave a core free for the context thread, but always have
+        // at least one worker.
+        i64 cores = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = (cores > 2 ? cores - 1 : 1);
+    }
+    if (worker_count > JOB_MAX_WORKERS)
+        worker_count = JOB_MAX_WORKERS;
+
+    system->worker_count = worker_count;
+    atomic_init(&system->pending, 0);
+    atomic_init(&system->queued, 0);
+    atomic_init(&system->running, true);
+    pthread_mutex_init(&system->sleep_lock, NULL);
+    pthread_cond_init(&system->sleep_signal, NULL);
+
+    system->deques = calloc(worker_count + 1, sizeof(JobDeque));
+    system->workers = malloc(sizeof(pthread_t) * worker_count);
+    if (system->deques == NULL || system->workers == NULL)
+        PrintError("Failed to allocate the job system's workers. "
+                   "Code: %d.",
+                   errno);
+
+    for (u8 index = 0; index < worker_count; index++)
+    {
+        _WorkerArguments* arguments = __MALLOC(
+            _WorkerArguments, arguments,
+            ("Failed to allocate a worker's arguments. Code: %d.",
+             errno));
+        arguments->system = system;
+        arguments->index = index + 1;
+
+        if (pthread_create(&system->workers[index], NULL, _RunWorker,
+                           arguments) != 0)
+            PrintError("Failed to spawn job worker %d. Code: %d.",
+                       index, errno);
+    }
+
+    PrintSuccess("Created the job system with %d workers.",
+                 worker_count);
+    return system;
+}
+
+void KillJobSystem(JobSystem* system)
+{
+    pthread_mutex_lock(&system->sleep_lock);
+    atomic_store(&system->running, false);
+    pthread_cond_broadcast(&system->sleep_signal);
+    pthread_mutex_unlock(&system->sleep_lock);
+
+    for (u8 index = 0; index < system->worker_count; index++)
+        pthread_join(system->workers[index], NULL);
+
+    pthread_mutex_destroy(&system->sleep_lock);
+    pthread_cond_destroy(&system->sleep_signal);
+    free(system->workers);
+    free(system->deques);
+    __FREE(system, ("The job system freer was given an invalid "
+                    "system."));
+    PrintWarning("The job system was freed.");
+}
+
+void SubmitJob(JobSystem* system, Job* job)
+{
+    atomic_fetch_add(&system->pending, 1);
+    if (!_PushJob(&system->deques[_deque_index], job))
+    {
+        // There's no room left to queue the job, so just get it out
+        // of the way here and now.
+        _RunJob(system, job);
+        return;
+    }
+
+    atomic_fetch_add(&system->queued, 1);
+    pthread_mutex_lock(&system->sleep_lock);
+    pthread_cond_signal(&system->sleep_signal);
+    pthread_mutex_unlock(&system->sleep_lock);
+}
+
+void WaitForJobs(JobSystem* system)
+{
+    // Rather than sitting idle, help the workers get through
+    // whatever's left.
+    while (atomic_load(&system->pending) != 0)
+    {
+        Job* job = _FindJob(system);
+        if (job != NULL) _RunJob(system, job);
+        else sched_yield();
+    }
+}
+
+__CREATE_STRUCT_KILLFAIL(CompletionQueue)
+CreateCompletionQueue(u32 capacity)
+{
+    CompletionQueue* queue = __MALLOC(
+        CompletionQueue, queue,
+        ("Failed to allocate a completion queue. Code: %d.", errno));
+    queue->items = malloc(sizeof(void*) * (capacity + 1));
+    if (queue->items == NULL)
+        PrintError("Failed to allocate a completion queue of %d "
+                   "items. Code: %d.",
+                   capacity, errno);
+
+    // The ring keeps one slot empty to tell full and empty apart.
+    queue->capacity = capacity + 1;
+    queue->head = 0;
+    queue->tail = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->signal, NULL);
+
+    return queue;
+}
+
+void KillCompletionQueue(CompletionQueue* queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->signal);
+    free(queue->items);
+    __FREE(queue, ("The completion queue freer was given an invalid "
+                   "queue."));
+}
+
+void PushCompletion(CompletionQueue* queue, void* item)
+{
+    pthread_mutex_lock(&queue->lock);
+    while ((queue->tail + 1) % queue->capacity == queue->head)
+        pthread_cond_wait(&queue->signal, &queue->lock);
+
+    queue->items[queue->tail] = item;
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    pthread_cond_broadcast(&queue->signal);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void* PopCompletion(CompletionQueue* queue, bool wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (wait && queue->head == queue->tail)
+        pthread_cond_wait(&queue->signal, &queue->lock);
+
+    void* item = NULL;
+    if (queue->head != queue->tail)
+    {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        pthread_cond_broadcast(&queue->signal);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
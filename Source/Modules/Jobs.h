@@ -0,0 +1,185 @@
+/**
+ * @file Jobs.h
+ * @author Zenais Argos
+ * @brief Provides the job system; a fixed pool of worker threads that
+ * pull work from each other's deques, used to spread embarrassingly
+ * parallel work (like image decoding) across every core.
+ * @date 2024-07-06
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_JOBS_
+#define _RENAI_JOBS_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the logging functions used by the inline functions below.
+#include <Logger.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The number of jobs a single deque can hold at once. Jobs
+ * submitted to a full deque are simply run on the spot.
+ */
+#define JOB_DEQUE_CAPACITY 4096
+
+/**
+ * @brief The most worker threads a job system will spawn, regardless
+ * of the number of cores the machine has.
+ */
+#define JOB_MAX_WORKERS 32
+
+/**
+ * @brief A function run by a job.
+ */
+typedef void (*JobFunction)(void* data);
+
+/**
+ * @brief A single unit of work. Jobs are owned by whoever submits
+ * them, and must stay alive until they've been run.
+ */
+typedef struct Job
+{
+    JobFunction function;
+    void* data;
+} Job;
+
+/**
+ * @brief A Chase-Lev work-stealing deque. Its owning thread pushes
+ * and pops from the bottom, while every other thread steals from the
+ * top.
+ */
+typedef struct JobDeque
+{
+    _Atomic i64 top, bottom;
+    _Atomic(Job*) jobs[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+/**
+ * @brief The job system. Deque 0 belongs to the thread that created
+ * the system (the context thread); every other deque belongs to its
+ * respective worker.
+ */
+typedef struct JobSystem
+{
+    /**
+     * @brief The number of worker threads in the system.
+     */
+    u8 worker_count;
+    /**
+     * @brief The worker threads themselves.
+     */
+    pthread_t* workers;
+    /**
+     * @brief The deques of the system, @ref worker_count + 1 long.
+     */
+    JobDeque* deques;
+    /**
+     * @brief The number of jobs that have been submitted but haven't
+     * finished running yet.
+     */
+    _Atomic u32 pending;
+    /**
+     * @brief The number of jobs sitting in a deque, waiting for a
+     * thread to pick them up.
+     */
+    _Atomic u32 queued;
+    /**
+     * @brief Whether or not the workers should keep running.
+     */
+    _Atomic bool running;
+    /**
+     * @brief The lock and condition idle workers sleep on until work
+     * shows up.
+     */
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t sleep_signal;
+} JobSystem;
+
+/**
+ * @brief A thread-safe first-in first-out queue, used by jobs to hand
+ * their results back to the context thread.
+ */
+typedef struct CompletionQueue
+{
+    /**
+     * @brief The items in the queue, stored as a ring.
+     */
+    void** items;
+    /**
+     * @brief The ring's capacity, and the read and write positions
+     * within it.
+     */
+    u32 capacity, head, tail;
+    pthread_mutex_t lock;
+    pthread_cond_t signal;
+} CompletionQueue;
+
+/**
+ * @brief Create a job system and spawn its workers. Kills the process
+ * on failure.
+ * @param worker_count The number of workers to spawn, or 0 to spawn
+ * one less than the number of cores the machine has.
+ * @return A pointer to the created job system.
+ */
+__CREATE_STRUCT_KILLFAIL(JobSystem) CreateJobSystem(u8 worker_count);
+
+/**
+ * @brief Stop and join every worker of the given job system, and free
+ * it. Any jobs still queued are dropped.
+ * @param system The job system to kill.
+ */
+void KillJobSystem(JobSystem* system);
+
+/**
+ * @brief Queue a job to be run by the job system. This may be called
+ * from the context thread or from within another job.
+ * @param system The job system to submit to.
+ * @param job The job to run.
+ */
+void SubmitJob(JobSystem* system, Job* job);
+
+/**
+ * @brief Run queued jobs on the calling thread until every submitted
+ * job has finished. This should only be called from the context
+ * thread.
+ * @param system The job system to wait on.
+ */
+void WaitForJobs(JobSystem* system);
+
+/**
+ * @brief Create a completion queue. Kills the process on failure.
+ * @param capacity The number of items the queue can hold at once.
+ * @return A pointer to the created queue.
+ */
+__CREATE_STRUCT_KILLFAIL(CompletionQueue)
+CreateCompletionQueue(u32 capacity);
+
+/**
+ * @brief Free the given completion queue. Any items still inside it
+ * are not freed.
+ * @param queue The queue to kill.
+ */
+void KillCompletionQueue(CompletionQueue* queue);
+
+/**
+ * @brief Push an item onto the back of the queue, blocking while the
+ * queue is full.
+ * @param queue The queue to push to.
+ * @param item The item to push.
+ */
+void PushCompletion(CompletionQueue* queue, void* item);
+
+/**
+ * @brief Pop the item at the front of the queue.
+ * @param queue The queue to pop from.
+ * @param wait Whether or not to block until an item is available.
+ * @return The popped item, or NULL if the queue was empty and @param
+ * wait was false.
+ */
+void* PopCompletion(CompletionQueue* queue, bool wait);
+
+#endif // _RENAI_JOBS_
@@ -1,8 +1,11 @@
 #include "Libraries.h"
+#include <Extensions.h>
 #include <Logger.h>
 
-__KILLFAIL InitializeGLFW(void)
+__KILLFAIL InitializeGLFW(bool headless)
 {
+    // The null platform needs no display or monitor at all.
+    if (headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
     // Try to initialize GLFW, and if it fails, kill the process.
     if (!glfwInit()) PollGLFWErrors();
 
@@ -11,6 +14,17 @@ __KILLFAIL InitializeGLFW(void)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if defined(DEBUG_MODE) || defined(VALIDATION_MODE)
+    // Drivers only say much of anything about how they're being used
+    // to a context created for debugging.
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+    if (headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API,
+                       GLFW_EGL_CONTEXT_API);
+    }
 
     PrintSuccess("Initialized GLFW successfully. Version: %.5s.",
                  glfwGetVersionString());
@@ -21,11 +35,17 @@ void InitializeGLAD(void)
     // Using the built-in GLAD initializer, load OpenGL using GLFW's
     // procedure address. If this fails, kill the application.
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-        PollOpenGLErrors();
+        PrintError("Failed to load OpenGL.");
 
     // Set the OpenGL hint to indicate that we will be using various
     // depth-based functions.
     glEnable(GL_DEPTH_TEST);
+    // Sprites on the same layer share a depth, and are drawn in the
+    // order they're sorted into; each has to paint over whatever
+    // came before it rather than fail the test against it.
+    glDepthFunc(GL_LEQUAL);
+    // Find out what the driver can do beyond core 3.3.
+    LoadExtensions();
 
     PrintSuccess(
         "Initialized GLAD and loaded OpenGL. Version: %.18s.",
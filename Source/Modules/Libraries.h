@@ -18,8 +18,11 @@
 /**
  * @brief Initializes the GLFW library, providing window management
  * functionality. This kills the application on failure.
+ * @param headless Whether or not to go without a display; windows
+ * are never shown, and contexts come from EGL (or OSMesa) instead of
+ * the windowing system.
  */
-__KILLFAIL InitializeGLFW(void);
+__KILLFAIL InitializeGLFW(bool headless);
 
 /**
  * @brief Initializes the GLAD library and fetches OpenGL for use in
@@ -1,5 +1,9 @@
 #include "Logger.h"
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <time.h>
 
 // Most of the code in this file is highly distribution-dependent,
 // meaning that if the application was compiled in debug mode, the
@@ -9,34 +13,353 @@
 #ifdef DEBUG_MODE
 
 /**
- * @brief A boolean value that tells the application if its start time
- * has been recorded or not.
+ * @brief A single message within the ring buffer.
  */
-bool start_time_initialized = false;
+typedef struct _LogSlot
+{
+    /**
+     * @brief The turn of the slot. A slot is free for the message at
+     * position P once this reaches P, and holds that message once it
+     * reaches P + 1.
+     */
+    _Atomic u64 sequence;
+    /**
+     * @brief When the message was logged, in nanoseconds.
+     */
+    u64 time;
+    LogLevel level;
+    /**
+     * @brief The formatted message.
+     */
+    char text[LOG_MESSAGE_LENGTH];
+} _LogSlot;
+
+/**
+ * @brief The ring buffer. Any number of threads write into it, and
+ * only the logger's thread reads from it.
+ */
+static _LogSlot _slots[LOG_QUEUE_SLOTS];
+
+/**
+ * @brief The position the next message will be written to, and the
+ * position the logger's thread will read from next. Positions only
+ * ever grow; their slot is the position masked by the slot count.
+ */
+static _Atomic u64 _write_position = 0;
+static u64 _read_position = 0;
+
+/**
+ * @brief The runtime filters and outputs of the logger.
+ */
+static _Atomic u32 _minimum_level = log_success,
+                   _categories = 0xFFFFFFFFU,
+                   _outputs = log_to_console;
+
+/**
+ * @brief Whether or not the logger's thread is running, and whether
+ * or not it's been told to stop.
+ */
+static _Atomic bool _running = false, _stopping = false;
+static pthread_t _thread;
+/**
+ * @brief Guards starting and stopping the logger's thread. Nothing
+ * that logs ever holds this once the thread is up.
+ */
+static pthread_mutex_t _lifetime_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The open log file, or NULL, and the number of bytes that
+ * have been written to it. These belong to the logger's thread.
+ */
+static FILE* _log_file = NULL;
+static u64 _log_file_size = 0;
+
+/**
+ * @brief What the logger has done. Stalls are counted by callers,
+ * and everything else by the logger's thread.
+ */
+static _Atomic u64 _written = 0, _stalls = 0, _rotations = 0;
+
+/**
+ * @brief Shift every log file one place back, throwing away the
+ * oldest, then open a fresh one.
+ */
+__KILLFAIL _RotateLogFile(void)
+{
+    if (_log_file != NULL) fclose(_log_file);
+
+    char older[64], newer[64];
+    for (u8 index = LOG_FILE_COUNT; index > 0; index--)
+    {
+        snprintf(older, 64, LOG_FILE_PATH ".%d", index);
+        if (index == 1) snprintf(newer, 64, LOG_FILE_PATH);
+        else snprintf(newer, 64, LOG_FILE_PATH ".%d", index - 1);
+        (void)rename(newer, older);
+    }
+
+    // Nothing here can log, since the logger is the one writing.
+    _log_file = fopen(LOG_FILE_PATH, "w");
+    _log_file_size = 0;
+    _rotations++;
+}
 
-__KILLFAIL PrintMessage(u8 state, const char* caller, char* message,
-                        ...)
+/**
+ * @brief Output gathered up by the logger's thread, so a whole batch
+ * of messages goes out in one write.
+ */
+typedef struct _LogBatch
 {
-    if (!start_time_initialized)
+    char data[32768];
+    u32 length;
+} _LogBatch;
+
+static _LogBatch _console_batch = {0}, _file_batch = {0};
+
+/**
+ * @brief Write out everything gathered within a batch.
+ * @param batch The batch to write.
+ * @param output The file to write it to, or NULL to throw it away.
+ */
+__KILLFAIL _FlushLogBatch(_LogBatch* batch, FILE* output)
+{
+    if (output != NULL && batch->length != 0)
     {
-        (void)GetCurrentTime();
-        start_time_initialized = true;
+        fwrite(batch->data, 1, batch->length, output);
+        fflush(output);
     }
+    batch->length = 0;
+}
 
-    // Print the beginning of the message. The main purpose of this
-    // call is to setup the color.
-    printf("\n%s", (state == 1 ? "\033[32m[ " : "\033[33m[ "));
+/**
+ * @brief Add the given pieces of a message onto a batch, writing the
+ * batch out first if they don't fit.
+ * @param batch The batch to add to.
+ * @param output The file the batch is written to.
+ * @param pieces The pieces of the message, NULL terminated.
+ */
+__KILLFAIL _AppendLogBatch(_LogBatch* batch, FILE* output,
+                           const char** pieces)
+{
+    u32 lengths[8], total = 0, count = 0;
+    for (; pieces[count] != NULL; count++)
+        total += lengths[count] = strlen(pieces[count]);
+    if (batch->length + total > sizeof(batch->data))
+        _FlushLogBatch(batch, output);
 
+    for (u32 index = 0; index < count; index++)
+    {
+        memcpy(batch->data + batch->length, pieces[index],
+               lengths[index]);
+        batch->length += lengths[index];
+    }
+}
+
+/**
+ * @brief Write a single message to every output.
+ * @param slot The slot of the message.
+ * @param outputs The outputs to write to.
+ */
+__KILLFAIL _WriteLogMessage(const _LogSlot* slot, u32 outputs)
+{
     char log_time[11];
-    GetTimeString(log_time, 11);
+    FormatTimeString(slot->time / NS_PER_MS, log_time, 11);
+
+    if (outputs & log_to_console)
+        _AppendLogBatch(&_console_batch, stdout,
+                        (const char*[]){
+                            (slot->level == log_success
+                                 ? "\n\033[32m[ "
+                                 : "\n\033[33m[ "),
+                            log_time, " ]\033[0m ", slot->text,
+                            NULL});
+
+    if (outputs & log_to_file)
+    {
+        if (_log_file == NULL || _log_file_size > LOG_FILE_LIMIT)
+        {
+            _FlushLogBatch(&_file_batch, _log_file);
+            _RotateLogFile();
+        }
+        const u32 length = _file_batch.length;
+        _AppendLogBatch(&_file_batch, _log_file,
+                        (const char*[]){
+                            "[ ", log_time,
+                            (slot->level == log_success
+                                 ? " ] success "
+                                 : " ] warning "),
+                            slot->text, "\n", NULL});
+        // The batch may have been written out to make room, so only
+        // what's been added since counts.
+        _log_file_size += (_file_batch.length > length
+                               ? _file_batch.length - length
+                               : _file_batch.length);
+    }
+}
+
+/**
+ * @brief Write out every message that's been published.
+ * @return The number of messages written.
+ */
+u32 _DrainLogQueue(void)
+{
+    const u32 outputs = _outputs;
+    u32 drained = 0;
+    for (;;)
+    {
+        _LogSlot* slot =
+            &_slots[_read_position & (LOG_QUEUE_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->sequence,
+                                 memory_order_acquire) !=
+            _read_position + 1)
+            break;
+
+        _WriteLogMessage(slot, outputs);
+        // Hand the slot back to writers, one lap ahead.
+        atomic_store_explicit(&slot->sequence,
+                              _read_position + LOG_QUEUE_SLOTS,
+                              memory_order_release);
+        _read_position++;
+        drained++;
+    }
+
+    if (drained != 0)
+    {
+        _FlushLogBatch(&_console_batch, stdout);
+        _FlushLogBatch(&_file_batch, _log_file);
+        _written += drained;
+    }
+    return drained;
+}
+
+/**
+ * @brief The body of the logger's thread. Messages are written out in
+ * batches, and the thread naps whenever there's nothing to write.
+ * @param data Unused.
+ * @return Nothing.
+ */
+void* _RunLogger(void* data)
+{
+    while (!_stopping)
+        if (_DrainLogQueue() == 0)
+            nanosleep(&(struct timespec){0, NS_PER_MS}, NULL);
+    // Anything published before the stop was asked for still goes
+    // out.
+    _DrainLogQueue();
+    return NULL;
+}
 
-    printf("%s ]\033[0m ", log_time);
+/**
+ * @brief Start the logger's thread if it isn't running already.
+ */
+__KILLFAIL _StartLogger(void)
+{
+    static bool initialized = false;
+    pthread_mutex_lock(&_lifetime_lock);
+    if (!_running)
+    {
+        if (!initialized)
+        {
+            for (u32 index = 0; index < LOG_QUEUE_SLOTS; index++)
+                atomic_init(&_slots[index].sequence, index);
+            // Whatever's left gets written out however the process
+            // exits, errors included.
+            atexit(StopLogger);
+            initialized = true;
+        }
+
+        _stopping = false;
+        if (pthread_create(&_thread, NULL, _RunLogger, NULL) != 0)
+        {
+            // There's nowhere to log this to, so say it plainly and
+            // carry on; messages just pile up until the next try.
+            fprintf(stderr, "Failed to start the logger's thread. "
+                            "Code: %d.\n",
+                    errno);
+        }
+        else _running = true;
+    }
+    pthread_mutex_unlock(&_lifetime_lock);
+}
+
+__KILLFAIL PrintMessage(LogLevel level, LogCategory category,
+                        const char* caller, char* message, ...)
+{
+    if (level < _minimum_level || !(_categories & (1U << category)))
+        return;
+    if (!_running) _StartLogger();
+    // Stamp the message now, rather than whenever it's written.
+    const u64 time = GetCurrentTimeNS();
+
+    // Claim the next position. If its slot hasn't been read since the
+    // last lap, the buffer is full, so wait on the logger's thread.
+    u64 position =
+        atomic_load_explicit(&_write_position, memory_order_relaxed);
+    _LogSlot* slot;
+    for (;;)
+    {
+        slot = &_slots[position & (LOG_QUEUE_SLOTS - 1)];
+        const i64 turn = (i64)(atomic_load_explicit(
+                                   &slot->sequence,
+                                   memory_order_acquire) -
+                               position);
+        if (turn == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(
+                    &_write_position, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (turn < 0)
+        {
+            _stalls++;
+            sched_yield();
+            position = atomic_load_explicit(&_write_position,
+                                            memory_order_relaxed);
+        }
+        else
+            position = atomic_load_explicit(&_write_position,
+                                            memory_order_relaxed);
+    }
 
-    // Grab the variable arguments of the function call.
+    slot->time = time;
+    slot->level = level;
     va_list args;
     va_start(args, message);
-    // Print out the formatted message with the arguments.
-    vprintf(message, args);
+    vsnprintf(slot->text, LOG_MESSAGE_LENGTH, message, args);
+    va_end(args);
+    // Publish the message to the logger's thread.
+    atomic_store_explicit(&slot->sequence, position + 1,
+                          memory_order_release);
+}
+
+void SetLogLevel(LogLevel level) { _minimum_level = level; }
+
+void SetLogCategories(u32 categories) { _categories = categories; }
+
+void SetLogOutputs(u8 outputs) { _outputs = outputs; }
+
+void StopLogger(void)
+{
+    pthread_mutex_lock(&_lifetime_lock);
+    if (_running)
+    {
+        _stopping = true;
+        pthread_join(_thread, NULL);
+        _running = false;
+        if (_log_file != NULL)
+        {
+            fclose(_log_file);
+            _log_file = NULL;
+        }
+    }
+    pthread_mutex_unlock(&_lifetime_lock);
+}
+
+void GetLoggerStatistics(LoggerStatistics* statistics)
+{
+    statistics->written = _written;
+    statistics->stalls = _stalls;
+    statistics->rotations = _rotations;
 }
 
 #endif
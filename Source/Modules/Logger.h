@@ -4,6 +4,9 @@
  * @brief File to declare functions and various other utilities to be
  * used when logging messages to the console. This should be available
  * in very nearly every translation unit throughout the project.
+ * Messages are formatted on the calling thread into a lock-free ring
+ * buffer, and written out by a background thread, so logging never
+ * waits on the terminal or the disk.
  * @date 2024-05-23
  *
  * @copyright Copyright (c) 2024
@@ -16,35 +19,189 @@
 // its type definitions.
 #include <Declarations.h>
 
+/**
+ * @brief The importance of a message. Messages below the compiled or
+ * runtime minimum are never formatted.
+ */
+typedef enum LogLevel
+{
+    log_success,
+    log_warning
+} LogLevel;
+
+/**
+ * @brief The part of the engine a message comes from. Each can be
+ * switched on and off on its own.
+ */
+typedef enum LogCategory
+{
+    log_general,
+    log_assets,
+    log_render,
+    log_memory,
+    log_streaming,
+    log_category_count
+} LogCategory;
+
+/**
+ * @brief Where written messages go. These can be combined.
+ */
+typedef enum LogOutput
+{
+    log_to_console = 1,
+    log_to_file = 2
+} LogOutput;
+
+/**
+ * @brief The category of every message logged from the including
+ * translation unit. To change it, define this before including
+ * anything.
+ */
+#ifndef LOG_CATEGORY
+#define LOG_CATEGORY log_general
+#endif
+
+/**
+ * @brief The least important level that's compiled in at all. Calls
+ * below it compile down to nothing.
+ */
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL log_success
+#endif
+
+/**
+ * @brief A mask of the categories that are compiled in at all, one
+ * bit per category.
+ */
+#ifndef LOG_COMPILED_CATEGORIES
+#define LOG_COMPILED_CATEGORIES 0xFFFFFFFFU
+#endif
+
+/**
+ * @brief The most bytes a single message can take up once formatted.
+ * Anything longer is cut off.
+ */
+#define LOG_MESSAGE_LENGTH 496
+
+/**
+ * @brief The number of messages the ring buffer can hold. This must
+ * be a power of two. Callers wait on the writer thread once it's
+ * full, rather than dropping anything.
+ */
+#define LOG_QUEUE_SLOTS 1024
+
+/**
+ * @brief The path of the log file, relative to the executable.
+ */
+#define LOG_FILE_PATH "./renai.log"
+
+/**
+ * @brief The size the log file can grow to before it's rotated, in
+ * bytes, and the number of rotated files that are kept.
+ */
+#define LOG_FILE_LIMIT (4 * 1024 * 1024)
+#define LOG_FILE_COUNT 3
+
+/**
+ * @brief What the logger has done since it started.
+ */
+typedef struct LoggerStatistics
+{
+    /**
+     * @brief The number of messages written out.
+     */
+    u64 written;
+    /**
+     * @brief The number of times a caller found the ring buffer full
+     * and had to wait.
+     */
+    u64 stalls;
+    /**
+     * @brief The number of times the log file was rotated.
+     */
+    u64 rotations;
+} LoggerStatistics;
+
 // As to prevent unnecessary bloat--however small it may be--inside
 // the production binaries, add/remove this code althogether depending
 // on the application's state.
 #ifdef DEBUG_MODE
 
 /**
- * @brief Print a message to whatever output the application is
- * currently set to utilize. In debug mode, that would be the standard
- * output, and in production binaries, that would be the @ref
- * notify-send or @ref MessageBox interface, depending on the
- * operating system.
- * @param state The state of the message.
+ * @brief Queue a message to be written to whatever outputs the logger
+ * is set to. This formats the message and nothing else; the writing
+ * happens on the logger's own thread, which is started by the first
+ * message. This is safe to call from any thread.
+ * @param level The level of the message.
+ * @param category The category of the message.
+ * @param caller The name of the calling function.
  * @param message The message to send. This is similar to the format
  * string in any of the @ref printf function family.
  * @param ... The arguments to concatenate into @param message.
  */
-__KILLFAIL PrintMessage(u8 state, const char* caller, char* message,
-                        ...);
+__KILLFAIL PrintMessage(LogLevel level, LogCategory category,
+                        const char* caller, char* message, ...);
+
+/**
+ * @brief Whether or not messages of the given level are compiled in
+ * for the including translation unit. This is always a constant, so
+ * the compiler throws away calls it rules out.
+ */
+#define __LOG_COMPILED(level)                                        \
+    ((level) >= LOG_COMPILED_LEVEL &&                                \
+     ((1U << LOG_CATEGORY) & (LOG_COMPILED_CATEGORIES)) != 0)
 
 /**
  * @brief Print A specifically success message, which is colored in
  * green.
  */
-#define PrintSuccess(...) PrintMessage(1, __func__, __VA_ARGS__)
+#define PrintSuccess(...)                                            \
+    (__LOG_COMPILED(log_success)                                     \
+         ? PrintMessage(log_success, LOG_CATEGORY, __func__,         \
+                        __VA_ARGS__)                                 \
+         : (void)0)
 /**
  * @brief Print a warning message to the standard terminal. This
  * message will be colored yellow.
  */
-#define PrintWarning(...) PrintMessage(0, __func__, __VA_ARGS__)
+#define PrintWarning(...)                                            \
+    (__LOG_COMPILED(log_warning)                                     \
+         ? PrintMessage(log_warning, LOG_CATEGORY, __func__,         \
+                        __VA_ARGS__)                                 \
+         : (void)0)
+
+/**
+ * @brief Set the least important level that's logged. Messages below
+ * it are thrown away before they're formatted.
+ * @param level The new minimum level.
+ */
+void SetLogLevel(LogLevel level);
+
+/**
+ * @brief Set which categories are logged.
+ * @param categories A mask with a bit set for every category to log.
+ */
+void SetLogCategories(u32 categories);
+
+/**
+ * @brief Set where messages are written. The log file is rotated the
+ * first time it's opened, so every session starts a fresh one.
+ * @param outputs A combination of @ref LogOutput flags.
+ */
+void SetLogOutputs(u8 outputs);
+
+/**
+ * @brief Write out every message that's been queued, then stop the
+ * logger's thread. This is called on exit, but it's fine to call it
+ * sooner; the next message simply starts the logger again.
+ */
+void StopLogger(void);
+
+/**
+ * @brief Get what the logger has done since it started.
+ * @param statistics Where to copy the statistics.
+ */
+void GetLoggerStatistics(LoggerStatistics* statistics);
 
 #else
 #define PrintSuccess(...)
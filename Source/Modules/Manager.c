@@ -1,7 +1,12 @@
 #include "Manager.h"
 
+/**
+ * @brief Free a scene of the manager's scene registry.
+ */
+void _KillManagerScene(void* scene) { KillScene(scene); }
+
 __CREATE_STRUCT(SceneManager)
-CreateManager(f32 window_width, f32 window_height)
+CreateManager(f32 window_width, f32 window_height, JobSystem* jobs)
 {
     SceneManager* manager = __MALLOC(
         SceneManager, manager,
@@ -10,34 +15,136 @@ CreateManager(f32 window_width, f32 window_height)
     PrintSuccess("Allocated space for the scene manager: %d bytes.",
                  sizeof(SceneManager));
 
-    manager->scene_list = LoadScenes(window_width, window_height);
-    manager->current_scene =
-        (char*)manager->scene_list->first_node->name;
+    manager->window_width = window_width;
+    manager->window_height = window_height;
+    manager->jobs = jobs;
+    manager->streamer = CreateStreamer(STREAM_DEFAULT_BUDGET);
+    manager->scenes = CreateRegistry("scene", 4, _KillManagerScene);
+    manager->scene_file = OpenSceneFile();
+    if (manager->scene_file->scene_count == 0)
+        PrintError("The scene file doesn't contain any scenes.");
 
+    // Only the first scene is needed to get going; everything else is
+    // loaded once it's asked for.
+    SetCurrentScene(manager, manager->scene_file->entries[0].name);
     return manager;
 }
 
-void RenderCurrentScene(SceneManager* manager, Shader* basic_shader)
+/**
+ * @brief Get the handle of the given scene, loading it from the scene
+ * file if it hasn't been loaded yet.
+ * @param manager The scene manager to load with.
+ * @param name The name of the scene.
+ * @return The handle of the scene, or @ref NULL_HANDLE if the scene
+ * file has no scene of that name.
+ */
+ResourceHandle _LoadManagerScene(SceneManager* manager,
+                                 const char* name)
+{
+    ResourceHandle loaded_handle =
+        FindResource(manager->scenes, name);
+    if (IsHandleValid(manager->scenes, loaded_handle))
+        return loaded_handle;
+
+    SceneFileEntry* entry = FindSceneEntry(manager->scene_file, name);
+    if (entry == NULL)
+    {
+        PrintWarning("Tried to load the nonexistent scene '%s'.",
+                     name);
+        return NULL_HANDLE;
+    }
+
+    Scene* loaded_scene =
+        LoadScene(manager->scene_file, entry, manager->jobs,
+                  manager->window_width, manager->window_height);
+    return RegisterResource(manager->scenes, loaded_scene->name,
+                            loaded_scene);
+}
+
+__GET_STRUCT(Scene) LoadManagerScene(SceneManager* manager,
+                                     const char* name)
+{
+    ResourceHandle handle = _LoadManagerScene(manager, name);
+    if (!IsHandleValid(manager->scenes, handle)) return NULL;
+    return GetResource(manager->scenes, handle, Scene);
+}
+
+void SetCurrentScene(SceneManager* manager, const char* name)
+{
+    ResourceHandle handle = _LoadManagerScene(manager, name);
+    if (!IsHandleValid(manager->scenes, handle)) return;
+    manager->current_scene = handle;
+}
+
+void UpdateCurrentScene(SceneManager* manager, f64 tick_length)
+{
+    UpdateWorld(
+        GetResource(manager->scenes, manager->current_scene, Scene)
+            ->world,
+        tick_length);
+}
+
+void SnapshotCurrentScene(SceneManager* manager, const Camera* camera,
+                          DrawSnapshot* snapshot)
 {
     Scene* current_scene =
-        GetNode(manager->scene_list, manager->current_scene)
-            ->contents.scene;
-
-    printf("\n\n%s\n",
-           current_scene->scene_contents->first_node->name);
-    // Bind the "missing" texture to render as a placeholder.
-    Texture* missing_texture =
-        GetNode(current_scene->scene_contents, "texture_missing.jpg")
-            ->contents.texture;
-    BindTexture(missing_texture);
-
-    // Position transform the bound texture so it's within our
-    // viewport.
-    mat4 model = GLM_MAT4_IDENTITY_INIT;
-    glm_translate(model, (vec3){0.0f, 0.0f, 0.0f});
-    SetMat4(basic_shader->shader, "model", model);
-
-    // Draw the texture.
-    // glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        GetResource(manager->scenes, manager->current_scene, Scene);
+    ClearSnapshot(snapshot);
+    snapshot->camera = *camera;
+    snapshot->tilemap = current_scene->tilemap;
+
+    // Draw the "missing" texture at the origin as a placeholder.
+    Texture* missing_texture = GetResource(
+        current_scene->textures, current_scene->missing, Texture);
+    SpriteCommand* missing = PushSpriteCommand(snapshot);
+    *missing = (SpriteCommand){.texture = missing_texture,
+                               .width = missing_texture->width,
+                               .height = missing_texture->height,
+                               .brightness = 1.0f};
+    memcpy(missing->uv, missing_texture->uv, sizeof(missing->uv));
+
+    f32 view[4];
+    GetCameraBounds(camera, view);
+    SnapshotWorld(current_scene->world, snapshot, view);
+}
+
+void RenderCurrentScene(SceneManager* manager, SpriteBatch* batch,
+                        u32 shader, const DrawSnapshot* snapshot,
+                        f32 alpha)
+{
+    f32 view[4];
+    GetCameraBounds(&snapshot->camera, view);
+    BeginSpriteBatch(batch);
+
+    // Page the map's chunks in and out around the view before
+    // drawing what's resident of it.
+    UpdateStreaming(manager->streamer, snapshot->tilemap, view);
+
+    // Draw the scene's terrain straight away; its chunks already
+    // live on the GPU, so it never goes through the batch.
+    if (snapshot->tilemap != NULL)
+    {
+        BindProgram(shader);
+        batch->statistics.draws +=
+            DrawTilemap(snapshot->tilemap, view);
+    }
+
+    // Queue every sprite of the snapshot, blending the positions of
+    // its last two ticks. These all end up in the same vertex buffer,
+    // and are drawn together once the batch is flushed.
+    for (u32 index = 0; index < snapshot->sprite_count; index++)
+    {
+        const SpriteCommand* sprite = &snapshot->sprites[index];
+        f32 x = sprite->previous_x +
+                (sprite->x - sprite->previous_x) * alpha;
+        f32 y = sprite->previous_y +
+                (sprite->y - sprite->previous_y) * alpha;
+
+        SubmitSprite(batch, shader, GetTextureHandle(sprite->texture),
+                     sprite->uv, x, y, sprite->z, sprite->width,
+                     sprite->height, sprite->rotation,
+                     sprite->brightness);
+    }
+
+    FlushSpriteBatch(batch);
 }
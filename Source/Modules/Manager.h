@@ -11,28 +11,116 @@
 #ifndef _RENAI_MANAGER_
 #define _RENAI_MANAGER_
 
+#include <Batch.h>
 #include <Declarations.h>
-#include <LinkedList.h>
+#include <Jobs.h>
+#include <Registry.h>
 #include <Scene.h>
+#include <Snapshot.h>
+#include <Streamer.h>
 #include <Texture.h>
 
 typedef struct SceneManager
 {
-    char* current_scene;
-    LinkedList* scene_list;
+    /**
+     * @brief The handle of the scene currently being rendered.
+     */
+    ResourceHandle current_scene;
+    /**
+     * @brief The scenes that have been loaded so far. Scenes are only
+     * loaded once they're asked for.
+     */
+    Registry* scenes;
+    /**
+     * @brief The mapped scene file every scene is loaded from. This
+     * stays open for the lifetime of the manager, since texture names
+     * point into it.
+     */
+    SceneFile* scene_file;
+    /**
+     * @brief The dimensions of the key window, used to size the
+     * textures of newly loaded scenes.
+     */
+    f32 window_width, window_height;
+    /**
+     * @brief The job system scenes are decoded with. This is owned by
+     * the application, not the manager.
+     */
+    JobSystem* jobs;
+    /**
+     * @brief The streamer paging the current scene's map in and out
+     * around the camera.
+     */
+    Streamer* streamer;
 } SceneManager;
 
 __CREATE_STRUCT(SceneManager)
-CreateManager(f32 window_width, f32 window_height);
+CreateManager(f32 window_width, f32 window_height, JobSystem* jobs);
 
 __INLINE void KillManager(SceneManager* manager)
 {
-    KillLinkedList(manager->scene_list);
+    // The I/O thread may still be reading from a scene's map, so it
+    // has to stop first.
+    KillStreamer(manager->streamer);
+    KillRegistry(manager->scenes);
+    CloseSceneFile(manager->scene_file);
     __FREE(manager,
            ("The scene manager freer was given an invalid value."));
     PrintWarning("The scene manager was freed.");
 }
 
-void RenderCurrentScene(SceneManager* manager, Shader* basic_shader);
+/**
+ * @brief Get the given scene, loading it from the scene file if it
+ * hasn't been loaded yet.
+ * @param manager The scene manager to load with.
+ * @param name The name of the scene.
+ * @return A pointer to the scene, or NULL if the scene file has no
+ * scene of that name.
+ */
+__GET_STRUCT(Scene) LoadManagerScene(SceneManager* manager,
+                                     const char* name);
+
+/**
+ * @brief Switch the manager's current scene to the given one, loading
+ * it if needed. Nothing happens if the scene doesn't exist.
+ * @param manager The scene manager to affect.
+ * @param name The name of the scene.
+ */
+void SetCurrentScene(SceneManager* manager, const char* name);
+
+/**
+ * @brief Step the entities of the manager's current scene by a single
+ * simulation tick.
+ * @param manager The scene manager to update.
+ * @param tick_length The length of the tick, in seconds.
+ */
+void UpdateCurrentScene(SceneManager* manager, f64 tick_length);
+
+/**
+ * @brief Copy what the given camera can see of the manager's current
+ * scene into the given snapshot, replacing whatever was in it. This
+ * is done by the simulation, once it's finished a tick.
+ * @param manager The scene manager to copy from.
+ * @param camera The camera the scene is viewed through. Anything it
+ * can't see is culled.
+ * @param snapshot The snapshot to fill.
+ */
+void SnapshotCurrentScene(SceneManager* manager, const Camera* camera,
+                          DrawSnapshot* snapshot);
+
+/**
+ * @brief Submit the contents of the given snapshot to the given
+ * sprite batch and flush it. Nothing the simulation touches is read,
+ * so this can run alongside it.
+ * @param manager The scene manager whose streamer pages the terrain.
+ * @param batch The batch to draw the scene with.
+ * @param shader The program to draw the scene with.
+ * @param snapshot The snapshot to draw.
+ * @param alpha How far the simulation is between the snapshot's tick
+ * and the next, from 0 to 1.
+ */
+void RenderCurrentScene(SceneManager* manager, SpriteBatch* batch,
+                        u32 shader, const DrawSnapshot* snapshot,
+                        f32 alpha);
 
 #endif // _RENAI_MANAGER_
@@ -0,0 +1,281 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_memory
+#include "Memory.h"
+#include <Logger.h>
+
+/**
+ * @brief The frame scratch. It's a plain arena, just one that lives
+ * for as long as the process does.
+ */
+static MemoryArena _frame_scratch = {"frame scratch",
+                                     MEMORY_SCRATCH_BLOCK};
+
+/**
+ * @brief Round the given size up to a multiple of @ref
+ * MEMORY_ALIGNMENT, and up to at least one multiple of it.
+ */
+__INLINE u64 _AlignSize(u64 size)
+{
+    if (size == 0) return MEMORY_ALIGNMENT;
+    return (size + MEMORY_ALIGNMENT - 1) &
+           ~(u64)(MEMORY_ALIGNMENT - 1);
+}
+
+/**
+ * @brief Record that the given number of bytes were handed out.
+ * @param statistics The statistics of the allocator.
+ * @param size The number of bytes.
+ */
+__INLINE void _CountAllocation(MemoryStatistics* statistics, u64 size)
+{
+    statistics->used += size;
+    statistics->allocations++;
+    if (statistics->used > statistics->peak)
+        statistics->peak = statistics->used;
+}
+
+/**
+ * @brief Free every block of the given arena, poisoning whatever was
+ * handed out from them first in debug mode.
+ * @param arena The arena to empty.
+ */
+__KILLFAIL _FreeArenaBlocks(MemoryArena* arena)
+{
+    ArenaBlock* block = arena->blocks;
+    while (block != NULL)
+    {
+        ArenaBlock* next = block->next;
+#ifdef DEBUG_MODE
+        memset(block->data, MEMORY_POISON, block->used);
+#endif
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->statistics.reserved = 0;
+    arena->statistics.used = 0;
+}
+
+/**
+ * @brief Start a new block within the given arena.
+ * @param arena The arena to grow.
+ * @param size The size of the block's memory, in bytes.
+ */
+__KILLFAIL _GrowArena(MemoryArena* arena, u64 size)
+{
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL)
+        PrintError("Failed to grow the arena '%s' by %lu bytes. "
+                   "Code: %d.",
+                   arena->name, size, errno);
+    block->next = arena->blocks;
+    block->size = size;
+    block->used = 0;
+    arena->blocks = block;
+    arena->statistics.reserved += size;
+}
+
+__CREATE_STRUCT_KILLFAIL(MemoryArena)
+CreateArena(const char* name, u64 block_size)
+{
+    MemoryArena* arena = __MALLOC(
+        MemoryArena, arena,
+        ("Failed to allocate the arena '%s'. Code: %d.", name,
+         errno));
+    arena->name = name;
+    arena->block_size = _AlignSize(
+        block_size == 0 ? MEMORY_ARENA_BLOCK : block_size);
+    arena->blocks = NULL;
+    memset(&arena->statistics, 0, sizeof(MemoryStatistics));
+    return arena;
+}
+
+void KillArena(MemoryArena* arena)
+{
+    PrintSuccess("Freed the arena '%s' (%lu allocations, %.1f KB at "
+                 "peak).",
+                 arena->name, arena->statistics.allocations,
+                 arena->statistics.peak / 1024.0);
+    _FreeArenaBlocks(arena);
+    __FREE(arena, ("The arena freer was given an invalid arena."));
+}
+
+void* ArenaAllocate(MemoryArena* arena, u64 size)
+{
+    size = _AlignSize(size);
+    ArenaBlock* block = arena->blocks;
+    if (block == NULL || block->size - block->used < size)
+    {
+        _GrowArena(arena,
+                   (size > arena->block_size ? size
+                                             : arena->block_size));
+        block = arena->blocks;
+    }
+
+    void* allocated = block->data + block->used;
+    block->used += size;
+    _CountAllocation(&arena->statistics, size);
+    return allocated;
+}
+
+void ResetArena(MemoryArena* arena)
+{
+    arena->statistics.resets++;
+    if (arena->blocks == NULL) return;
+
+    if (arena->blocks->next == NULL)
+    {
+#ifdef DEBUG_MODE
+        memset(arena->blocks->data, MEMORY_POISON,
+               arena->blocks->used);
+#endif
+        arena->blocks->used = 0;
+        arena->statistics.used = 0;
+        return;
+    }
+
+    // Everything the arena held last time fits in one block from now
+    // on.
+    const u64 reserved = arena->statistics.reserved;
+    _FreeArenaBlocks(arena);
+    _GrowArena(arena, reserved);
+}
+
+__CREATE_STRUCT_KILLFAIL(MemoryPool)
+CreatePool(const char* name, u32 object_size, u32 block_objects)
+{
+    MemoryPool* pool = __MALLOC(
+        MemoryPool, pool,
+        ("Failed to allocate the pool '%s'. Code: %d.", name, errno));
+    pool->name = name;
+    // Free objects hold the free list's links, so they can't be any
+    // smaller than a pointer.
+    pool->object_size = _AlignSize(
+        object_size < sizeof(void*) ? sizeof(void*) : object_size);
+    pool->block_objects = (block_objects == 0 ? 1 : block_objects);
+    pool->free_objects = NULL;
+    pool->blocks = NULL;
+    memset(&pool->statistics, 0, sizeof(MemoryStatistics));
+    return pool;
+}
+
+void KillPool(MemoryPool* pool)
+{
+    const u64 live =
+        pool->statistics.allocations - pool->statistics.frees;
+    if (live != 0)
+        PrintWarning("Killed the pool '%s' while %lu of its objects "
+                     "were still alive.",
+                     pool->name, live);
+
+    void* block = pool->blocks;
+    while (block != NULL)
+    {
+        void* next = *(void**)block;
+        free(block);
+        block = next;
+    }
+    PrintSuccess("Freed the pool '%s' (%lu allocations, %.1f KB at "
+                 "peak).",
+                 pool->name, pool->statistics.allocations,
+                 pool->statistics.peak / 1024.0);
+    __FREE(pool, ("The pool freer was given an invalid pool."));
+}
+
+/**
+ * @brief Add a block of objects to the given pool, linking every one
+ * of them into its free list.
+ * @param pool The pool to grow.
+ */
+__KILLFAIL _GrowPool(MemoryPool* pool)
+{
+    // The block's link takes up the first aligned slot, so the
+    // objects after it stay aligned.
+    const u64 size = MEMORY_ALIGNMENT +
+                     (u64)pool->object_size * pool->block_objects;
+    u8* block = malloc(size);
+    if (block == NULL)
+        PrintError("Failed to grow the pool '%s' by %d objects. "
+                   "Code: %d.",
+                   pool->name, pool->block_objects, errno);
+#ifdef DEBUG_MODE
+    memset(block + MEMORY_ALIGNMENT, MEMORY_POISON,
+           size - MEMORY_ALIGNMENT);
+#endif
+
+    *(void**)block = pool->blocks;
+    pool->blocks = block;
+    pool->statistics.reserved += size;
+
+    // Link the objects back to front, so they're handed out in
+    // address order.
+    for (u32 index = pool->block_objects; index > 0; index--)
+    {
+        void* object = block + MEMORY_ALIGNMENT +
+                       (u64)(index - 1) * pool->object_size;
+        *(void**)object = pool->free_objects;
+        pool->free_objects = object;
+    }
+}
+
+void* PoolAllocate(MemoryPool* pool)
+{
+    if (pool->free_objects == NULL) _GrowPool(pool);
+
+    void* object = pool->free_objects;
+    pool->free_objects = *(void**)object;
+
+#ifdef DEBUG_MODE
+    // Everything past the link should still be poison, unless
+    // something held onto the object after freeing it.
+    const u8* bytes = object;
+    for (u32 index = sizeof(void*); index < pool->object_size;
+         index++)
+        if (bytes[index] != MEMORY_POISON)
+        {
+            PrintWarning("An object of the pool '%s' was written to "
+                         "after it was freed.",
+                         pool->name);
+            break;
+        }
+#endif
+
+    _CountAllocation(&pool->statistics, pool->object_size);
+    return object;
+}
+
+void PoolFree(MemoryPool* pool, void* object)
+{
+    if (object == NULL) return;
+#ifdef DEBUG_MODE
+    memset(object, MEMORY_POISON, pool->object_size);
+#endif
+    *(void**)object = pool->free_objects;
+    pool->free_objects = object;
+    pool->statistics.used -= pool->object_size;
+    pool->statistics.frees++;
+}
+
+void* ScratchAllocate(u64 size)
+{
+    return ArenaAllocate(&_frame_scratch, size);
+}
+
+void ResetFrameScratch(void) { ResetArena(&_frame_scratch); }
+
+void KillFrameScratch(void)
+{
+    PrintSuccess("Freed the frame scratch (%.1f KB reserved, %.1f KB "
+                 "at peak, %lu allocations over %lu frames).",
+                 _frame_scratch.statistics.reserved / 1024.0,
+                 _frame_scratch.statistics.peak / 1024.0,
+                 _frame_scratch.statistics.allocations,
+                 _frame_scratch.statistics.resets);
+    _FreeArenaBlocks(&_frame_scratch);
+}
+
+__GET_STRUCT(MemoryStatistics) GetScratchStatistics(void)
+{
+    return &_frame_scratch.statistics;
+}
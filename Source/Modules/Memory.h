@@ -0,0 +1,243 @@
+/**
+ * @file Memory.h
+ * @author Zenais Argos
+ * @brief Provides the engine's allocators; arenas, which hand out
+ * memory by bumping a pointer and free all of it at once, pools,
+ * which recycle objects of a single size through a free list, and
+ * the frame scratch, an arena that's emptied every frame. None of
+ * them lock, so each belongs to the thread that made it. In debug
+ * mode, freed memory is poisoned, and pools check that nothing has
+ * written to an object after it was freed.
+ * @date 2024-07-18
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_MEMORY_
+#define _RENAI_MEMORY_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+
+/**
+ * @brief The alignment of everything handed out by an allocator.
+ * This is enough for any scalar or SSE vector.
+ */
+#define MEMORY_ALIGNMENT 16
+
+/**
+ * @brief The default size of a single arena block, in bytes. Larger
+ * allocations get a block of their own.
+ */
+#define MEMORY_ARENA_BLOCK (64 * 1024)
+
+/**
+ * @brief The size of the frame scratch's first block, in bytes.
+ */
+#define MEMORY_SCRATCH_BLOCK (256 * 1024)
+
+/**
+ * @brief The byte freed memory is filled with in debug mode, so reads
+ * of it stand out, and writes to it can be caught.
+ */
+#define MEMORY_POISON 0xDD
+
+/**
+ * @brief What an allocator has done over its lifetime.
+ */
+typedef struct MemoryStatistics
+{
+    /**
+     * @brief The memory the allocator has taken from the system, and
+     * how much of it is currently handed out, in bytes.
+     */
+    u64 reserved, used;
+    /**
+     * @brief The most memory that's been handed out at once, in
+     * bytes.
+     */
+    u64 peak;
+    /**
+     * @brief The number of allocations, frees, and resets.
+     */
+    u64 allocations, frees, resets;
+} MemoryStatistics;
+
+/**
+ * @brief A single block of an arena.
+ */
+typedef struct ArenaBlock
+{
+    /**
+     * @brief The block allocated before this one, or NULL.
+     */
+    struct ArenaBlock* next;
+    /**
+     * @brief The size of the block's memory, and how much of it has
+     * been handed out, in bytes.
+     */
+    u64 size, used;
+    /**
+     * @brief The block's memory.
+     */
+    _Alignas(MEMORY_ALIGNMENT) u8 data[];
+} ArenaBlock;
+
+/**
+ * @brief An arena; a list of blocks that allocations are carved out
+ * of in order. Nothing within an arena is freed on its own, it's all
+ * freed at once when the arena is reset or killed.
+ */
+typedef struct MemoryArena
+{
+    /**
+     * @brief The name of the arena, used when reporting on it.
+     */
+    const char* name;
+    /**
+     * @brief The size new blocks are created with.
+     */
+    u64 block_size;
+    /**
+     * @brief The block currently being allocated from, which links to
+     * every block before it.
+     */
+    ArenaBlock* blocks;
+    /**
+     * @brief What the arena has done.
+     */
+    MemoryStatistics statistics;
+} MemoryArena;
+
+/**
+ * @brief A pool; blocks of equally sized objects, with the ones not
+ * in use linked into a free list through their first bytes.
+ */
+typedef struct MemoryPool
+{
+    /**
+     * @brief The name of the pool, used when reporting on it.
+     */
+    const char* name;
+    /**
+     * @brief The size of a single object, rounded up to @ref
+     * MEMORY_ALIGNMENT, and the number of objects in a block.
+     */
+    u32 object_size, block_objects;
+    /**
+     * @brief The first free object, or NULL if every one is in use.
+     */
+    void* free_objects;
+    /**
+     * @brief The most recently allocated block. Each block's first
+     * bytes point to the block before it.
+     */
+    void* blocks;
+    /**
+     * @brief What the pool has done.
+     */
+    MemoryStatistics statistics;
+} MemoryPool;
+
+/**
+ * @brief Create an empty arena. No memory is reserved until the
+ * first allocation. Kills the process on failure.
+ * @param name The name of the arena. This isn't copied.
+ * @param block_size The size of the arena's blocks, in bytes, or 0
+ * for @ref MEMORY_ARENA_BLOCK.
+ * @return A pointer to the created arena.
+ */
+__CREATE_STRUCT_KILLFAIL(MemoryArena)
+CreateArena(const char* name, u64 block_size);
+
+/**
+ * @brief Free every block of the given arena, and the arena itself.
+ * Anything allocated from it is gone.
+ * @param arena The arena to kill.
+ */
+void KillArena(MemoryArena* arena);
+
+/**
+ * @brief Allocate memory from the given arena. Kills the process on
+ * failure.
+ * @param arena The arena to allocate from.
+ * @param size The size of the allocation, in bytes.
+ * @return A pointer to the allocated memory, aligned to @ref
+ * MEMORY_ALIGNMENT. This is uninitialized.
+ */
+void* ArenaAllocate(MemoryArena* arena, u64 size);
+
+/**
+ * @brief Free everything allocated from the given arena at once. If
+ * the arena had grown past a single block, its blocks are merged
+ * into one big enough for all of them, so the next round of
+ * allocations doesn't have to grow it again.
+ * @param arena The arena to reset.
+ */
+void ResetArena(MemoryArena* arena);
+
+/**
+ * @brief Create an empty pool. Kills the process on failure.
+ * @param name The name of the pool. This isn't copied.
+ * @param object_size The size of a single object, in bytes.
+ * @param block_objects The number of objects the pool grows by at a
+ * time.
+ * @return A pointer to the created pool.
+ */
+__CREATE_STRUCT_KILLFAIL(MemoryPool)
+CreatePool(const char* name, u32 object_size, u32 block_objects);
+
+/**
+ * @brief Free every block of the given pool, and the pool itself,
+ * warning about any objects that were never freed.
+ * @param pool The pool to kill.
+ */
+void KillPool(MemoryPool* pool);
+
+/**
+ * @brief Take an object from the given pool. Kills the process on
+ * failure.
+ * @param pool The pool to allocate from.
+ * @return A pointer to the object, aligned to @ref MEMORY_ALIGNMENT.
+ * This is uninitialized.
+ */
+void* PoolAllocate(MemoryPool* pool);
+
+/**
+ * @brief Give an object back to the pool it was taken from. Nothing
+ * happens if it's NULL.
+ * @param pool The pool the object came from.
+ * @param object The object to free.
+ */
+void PoolFree(MemoryPool* pool, void* object);
+
+/**
+ * @brief Allocate memory that lives until the end of the current
+ * frame. This must only be called from the main thread. Kills the
+ * process on failure.
+ * @param size The size of the allocation, in bytes.
+ * @return A pointer to the allocated memory, aligned to @ref
+ * MEMORY_ALIGNMENT. This is uninitialized.
+ */
+void* ScratchAllocate(u64 size);
+
+/**
+ * @brief Free everything allocated from the frame scratch. This is
+ * called once at the start of every frame.
+ */
+void ResetFrameScratch(void);
+
+/**
+ * @brief Free the frame scratch's memory, reporting on how much of
+ * it was used.
+ */
+void KillFrameScratch(void);
+
+/**
+ * @brief Get what the frame scratch has done.
+ * @return A pointer to the frame scratch's statistics.
+ */
+__GET_STRUCT(MemoryStatistics) GetScratchStatistics(void);
+
+#endif // _RENAI_MEMORY_
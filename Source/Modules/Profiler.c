@@ -0,0 +1,394 @@
+#include "Profiler.h"
+#include <Logger.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The profiler scopes are currently recorded into, or NULL if
+ * there isn't one. It's only ever swapped out while no other thread
+ * is running.
+ */
+static Profiler* _active_profiler = NULL;
+
+/**
+ * @brief The scopes a single thread has open, innermost last.
+ */
+typedef struct _ProfileThread
+{
+    /**
+     * @brief The frame each open scope was recorded into, and its
+     * index within that frame, or UINT32_MAX if it wasn't recorded.
+     */
+    u64 frames[PROFILER_MAX_DEPTH];
+    u32 scopes[PROFILER_MAX_DEPTH];
+    u8 depth;
+    /**
+     * @brief The thread's track in traces, or 0 if it hasn't been
+     * given one yet.
+     */
+    u16 track;
+} _ProfileThread;
+
+/**
+ * @brief The calling thread's open scopes.
+ */
+static _Thread_local _ProfileThread _thread = {0};
+
+/**
+ * @brief The number of tracks handed out. The GPU's is track 0.
+ */
+static _Atomic u16 _track_count = 0;
+
+/**
+ * @brief Get the calling thread's track, giving it one if it hasn't
+ * got one yet.
+ * @return The track.
+ */
+__INLINE u16 _GetThreadTrack(void)
+{
+    if (_thread.track == 0) _thread.track = ++_track_count;
+    return _thread.track;
+}
+
+/**
+ * @brief Get the frame of the given number, if it's still remembered.
+ * @param profiler The profiler to search.
+ * @param number The number of the frame.
+ * @return A pointer to the frame, or NULL if it's been overwritten.
+ */
+__INLINE ProfileFrame* _GetProfileFrame(Profiler* profiler,
+                                        u64 number)
+{
+    ProfileFrame* frame =
+        &profiler->frames[number % PROFILER_FRAME_COUNT];
+    return (frame->number == number ? frame : NULL);
+}
+
+/**
+ * @brief Get the frame currently being recorded.
+ * @param profiler The profiler to search.
+ * @return A pointer to the frame.
+ */
+__INLINE ProfileFrame* _GetCurrentFrame(Profiler* profiler)
+{
+    return &profiler->frames[profiler->frame_count %
+                             PROFILER_FRAME_COUNT];
+}
+
+/**
+ * @brief Read back every GPU timer query whose result is ready,
+ * without waiting on any that aren't.
+ * @param profiler The profiler whose queries to read.
+ */
+void _CollectTimerQueries(Profiler* profiler)
+{
+    for (u8 index = 0; index < PROFILER_QUERY_COUNT; index++)
+    {
+        if (!profiler->query_pending[index]) continue;
+
+        i32 available = 0;
+        glGetQueryObjectiv(profiler->queries[index],
+                           GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        u64 elapsed = 0;
+        glGetQueryObjectui64v(profiler->queries[index],
+                              GL_QUERY_RESULT, &elapsed);
+        profiler->query_pending[index] = false;
+
+        ProfileFrame* frame =
+            _GetProfileFrame(profiler, profiler->query_frames[index]);
+        if (frame != NULL) frame->gpu_time = elapsed;
+    }
+}
+
+__CREATE_STRUCT_KILLFAIL(Profiler) CreateProfiler(void)
+{
+    Profiler* profiler = __MALLOC(
+        Profiler, profiler,
+        ("Failed to allocate the profiler. Code: %d.", errno));
+    profiler->frames =
+        calloc(PROFILER_FRAME_COUNT, sizeof(ProfileFrame));
+    if (profiler->frames == NULL)
+        PrintError("Failed to allocate the profiler's frames. Code: "
+                   "%d.",
+                   errno);
+
+    // Mark every frame as one that's never been recorded, so that
+    // frame 0 isn't mistaken for being remembered from the start.
+    for (u32 index = 0; index < PROFILER_FRAME_COUNT; index++)
+        profiler->frames[index].number = UINT64_MAX;
+
+    profiler->frame_count = 0;
+    profiler->recording = false;
+    profiler->frame_track = 0;
+    profiler->query_active = false;
+    pthread_mutex_init(&profiler->lock, NULL);
+    glGenQueries(PROFILER_QUERY_COUNT, profiler->queries);
+    memset(profiler->query_pending, 0,
+           sizeof(profiler->query_pending));
+
+    _active_profiler = profiler;
+    PrintSuccess("Created the profiler. Remembering %d frames (%d "
+                 "bytes).",
+                 PROFILER_FRAME_COUNT,
+                 PROFILER_FRAME_COUNT * sizeof(ProfileFrame));
+    return profiler;
+}
+
+void KillProfiler(Profiler* profiler)
+{
+    if (_active_profiler == profiler) _active_profiler = NULL;
+
+    pthread_mutex_destroy(&profiler->lock);
+    glDeleteQueries(PROFILER_QUERY_COUNT, profiler->queries);
+    free(profiler->frames);
+    __FREE(profiler,
+           ("The profiler freer was given an invalid profiler."));
+}
+
+void BeginProfilerFrame(void)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL) return;
+
+    pthread_mutex_lock(&profiler->lock);
+    ProfileFrame* frame = _GetCurrentFrame(profiler);
+    frame->number = profiler->frame_count;
+    frame->start = GetCurrentTimeNS();
+    frame->end = frame->gpu_time = 0;
+    frame->scope_count = 0;
+    profiler->frame_track = _GetThreadTrack();
+    profiler->recording = true;
+    _thread.depth = 0;
+
+    // If the query we'd reuse still hasn't got its result, the GPU's
+    // more than a few frames behind; skip timing this frame rather
+    // than stall waiting on it.
+    u8 query = profiler->frame_count % PROFILER_QUERY_COUNT;
+    profiler->query_active = !profiler->query_pending[query];
+    if (profiler->query_active)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, profiler->queries[query]);
+        profiler->query_frames[query] = profiler->frame_count;
+        profiler->query_pending[query] = true;
+    }
+    pthread_mutex_unlock(&profiler->lock);
+}
+
+void EndProfilerFrame(void)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL) return;
+
+    pthread_mutex_lock(&profiler->lock);
+    if (!profiler->recording)
+    {
+        pthread_mutex_unlock(&profiler->lock);
+        return;
+    }
+
+    ProfileFrame* frame = _GetCurrentFrame(profiler);
+    frame->end = GetCurrentTimeNS();
+    if (_thread.depth != 0)
+        PrintWarning("Frame %d ended with %d profile scopes open.",
+                     (u32)frame->number, _thread.depth);
+
+    if (profiler->query_active) glEndQuery(GL_TIME_ELAPSED);
+    profiler->query_active = false;
+    profiler->frame_count++;
+    profiler->recording = false;
+
+    _CollectTimerQueries(profiler);
+    pthread_mutex_unlock(&profiler->lock);
+}
+
+void BeginProfileScope(const char* name)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL) return;
+
+    // Scopes past either limit, or opened between frames, are
+    // counted, so that the scopes around them still close correctly,
+    // but aren't recorded.
+    u8 depth = _thread.depth++;
+    if (depth >= PROFILER_MAX_DEPTH) return;
+    _thread.scopes[depth] = UINT32_MAX;
+    const u16 track = _GetThreadTrack();
+
+    pthread_mutex_lock(&profiler->lock);
+    ProfileFrame* frame = _GetCurrentFrame(profiler);
+    if (profiler->recording &&
+        frame->scope_count != PROFILER_MAX_SCOPES)
+    {
+        _thread.frames[depth] = frame->number;
+        _thread.scopes[depth] = frame->scope_count;
+        frame->scopes[frame->scope_count++] = (ProfileScope){
+            name, GetCurrentTimeNS(), 0, depth, track};
+    }
+    pthread_mutex_unlock(&profiler->lock);
+}
+
+void EndProfileScope(void)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL || _thread.depth == 0) return;
+
+    u8 depth = --_thread.depth;
+    if (depth >= PROFILER_MAX_DEPTH ||
+        _thread.scopes[depth] == UINT32_MAX)
+        return;
+
+    // The frame the scope opened in may have ended since, on another
+    // thread, or even been overwritten.
+    pthread_mutex_lock(&profiler->lock);
+    ProfileFrame* frame =
+        _GetProfileFrame(profiler, _thread.frames[depth]);
+    if (frame != NULL)
+        frame->scopes[_thread.scopes[depth]].end = GetCurrentTimeNS();
+    pthread_mutex_unlock(&profiler->lock);
+}
+
+f64 GetLastFrameDuration(void)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL) return 0.0;
+
+    pthread_mutex_lock(&profiler->lock);
+    f64 duration = 0.0;
+    if (profiler->frame_count != 0)
+    {
+        ProfileFrame* frame =
+            _GetProfileFrame(profiler, profiler->frame_count - 1);
+        duration = (frame->end - frame->start) / (f64)NS_PER_MS;
+    }
+    pthread_mutex_unlock(&profiler->lock);
+    return duration;
+}
+
+void DumpProfilerTrace(const char* path)
+{
+    Profiler* profiler = _active_profiler;
+    if (profiler == NULL)
+    {
+        PrintWarning("Tried to dump a trace without a profiler.");
+        return;
+    }
+
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        PrintWarning("Failed to open '%s' to dump a trace. Code: %d.",
+                     path, errno);
+        return;
+    }
+
+    // Name the timelines; the GPU's, made of whole frames, and one
+    // for every thread that's opened a scope, made of its scopes.
+    // The thread that draws the frames has them drawn on its own.
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"tid\":0,\"args\":{\"name\":\"GPU\"}}",
+          file);
+    pthread_mutex_lock(&profiler->lock);
+    const u16 track_count = _track_count;
+    for (u16 track = 1; track <= track_count; track++)
+        fprintf(file,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                "\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU "
+                "%u%s\"}}",
+                track, track,
+                (track == profiler->frame_track ? " (frames)" : ""));
+
+    u64 first = (profiler->frame_count > PROFILER_FRAME_COUNT
+                     ? profiler->frame_count - PROFILER_FRAME_COUNT
+                     : 0);
+    u32 frames_written = 0;
+    for (u64 number = first; number < profiler->frame_count; number++)
+    {
+        ProfileFrame* frame = _GetProfileFrame(profiler, number);
+        if (frame == NULL) continue;
+        frames_written++;
+
+        // Trace timestamps are in (fractional) microseconds.
+        fprintf(file,
+                ",\n{\"name\":\"frame %lu\",\"cat\":\"frame\","
+                "\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                "\"dur\":%.3f}",
+                frame->number, profiler->frame_track,
+                frame->start / 1000.0,
+                (frame->end - frame->start) / 1000.0);
+
+        for (u32 index = 0; index < frame->scope_count; index++)
+        {
+            ProfileScope* scope = &frame->scopes[index];
+            if (scope->end == 0) continue;
+            fprintf(file,
+                    ",\n{\"name\":\"%s\",\"cat\":\"cpu\","
+                    "\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    scope->name, scope->track, scope->start / 1000.0,
+                    (scope->end - scope->start) / 1000.0);
+        }
+
+        // The GPU doesn't tell us when it started on a frame, only
+        // how long it took, so its work is drawn from the frame's
+        // start.
+        if (frame->gpu_time != 0)
+            fprintf(file,
+                    ",\n{\"name\":\"frame %lu\",\"cat\":\"gpu\","
+                    "\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,"
+                    "\"dur\":%.3f}",
+                    frame->number, frame->start / 1000.0,
+                    frame->gpu_time / 1000.0);
+    }
+    pthread_mutex_unlock(&profiler->lock);
+
+    fputs("\n]}\n", file);
+    fclose(file);
+    PrintSuccess("Dumped %d frames of profiling to '%s'.",
+                 frames_written, path);
+}
+
+void RecordTiming(TimingHistogram* histogram, u64 time)
+{
+    u8 bucket = 0;
+    for (u64 edge = PROFILER_HISTOGRAM_BASE;
+         time >= edge && bucket < PROFILER_HISTOGRAM_BUCKETS - 1;
+         edge *= 2)
+        bucket++;
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total += time;
+    if (time > histogram->longest) histogram->longest = time;
+}
+
+void PrintTimingHistogram(const char* name,
+                          const TimingHistogram* histogram)
+{
+    if (histogram->count == 0) return;
+    PrintSuccess("%s: %lu timed, mean %.3f ms, longest %.3f ms.",
+                 name, histogram->count,
+                 histogram->total / (f64)histogram->count / NS_PER_MS,
+                 histogram->longest / (f64)NS_PER_MS);
+
+    u64 edge = PROFILER_HISTOGRAM_BASE;
+    for (u8 bucket = 0; bucket < PROFILER_HISTOGRAM_BUCKETS;
+         bucket++, edge *= 2)
+    {
+        const u64 count = histogram->buckets[bucket];
+        if (count == 0) continue;
+
+        // Scale the bar to the share of timings in the bucket, 40
+        // characters being all of them.
+        char bar[41];
+        const u8 length = count * 40 / histogram->count;
+        memset(bar, '#', length);
+        bar[length] = '\0';
+        if (bucket == PROFILER_HISTOGRAM_BUCKETS - 1)
+            PrintSuccess("  %8.3f ms +      %8lu %s",
+                         edge / 2 / (f64)NS_PER_MS, count, bar);
+        else
+            PrintSuccess("  under %8.3f ms %8lu %s",
+                         edge / (f64)NS_PER_MS, count, bar);
+    }
+}
@@ -0,0 +1,250 @@
+/**
+ * @file Profiler.h
+ * @author Zenais Argos
+ * @brief Provides the frame profiler; nestable, named CPU scopes and
+ * per-frame GPU timings, kept for the last few seconds of frames and
+ * dumpable as a Chrome trace (chrome://tracing, or Perfetto). Scopes
+ * can be opened on any thread, and each thread gets a track of its
+ * own in the trace.
+ * @date 2024-07-10
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_PROFILER_
+#define _RENAI_PROFILER_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+#include <pthread.h>
+
+/**
+ * @brief The number of frames the profiler remembers. Older frames
+ * are overwritten.
+ */
+#define PROFILER_FRAME_COUNT 240
+
+/**
+ * @brief The most scopes a single frame can record. Anything past
+ * this is dropped.
+ */
+#define PROFILER_MAX_SCOPES 64
+
+/**
+ * @brief The deepest scopes can be nested, on any one thread.
+ */
+#define PROFILER_MAX_DEPTH 16
+
+/**
+ * @brief The number of GPU timer queries in flight at once. Query
+ * results are read a few frames late so that reading them never
+ * stalls the pipeline.
+ */
+#define PROFILER_QUERY_COUNT 4
+
+/**
+ * @brief Where traces are written, relative to the executable.
+ */
+#define PROFILER_TRACE_PATH "./trace.json"
+
+/**
+ * @brief The number of buckets in a timing histogram. The first
+ * holds everything under @ref PROFILER_HISTOGRAM_BASE, each one after
+ * it covers twice the time of the one before, and the last holds
+ * everything past that.
+ */
+#define PROFILER_HISTOGRAM_BUCKETS 14
+
+/**
+ * @brief The upper edge of a timing histogram's first bucket, in
+ * nanoseconds.
+ */
+#define PROFILER_HISTOGRAM_BASE (64 * NS_PER_MS / 1000)
+
+/**
+ * @brief A histogram of how long something took, over every time it
+ * happened. Unlike the frames of the profiler, these never forget
+ * anything, and one can be kept by any thread.
+ */
+typedef struct TimingHistogram
+{
+    u64 buckets[PROFILER_HISTOGRAM_BUCKETS];
+    /**
+     * @brief The number of timings recorded, their total, and the
+     * longest of them, in nanoseconds.
+     */
+    u64 count, total, longest;
+} TimingHistogram;
+
+/**
+ * @brief A single closed (or still open) scope of a frame.
+ */
+typedef struct ProfileScope
+{
+    const char* name;
+    /**
+     * @brief When the scope opened and closed, in nanoseconds since
+     * the application started.
+     */
+    u64 start, end;
+    /**
+     * @brief How many scopes this one is nested within, on its
+     * thread.
+     */
+    u8 depth;
+    /**
+     * @brief The track of the thread that opened the scope.
+     */
+    u16 track;
+} ProfileScope;
+
+/**
+ * @brief Every scope recorded within a single frame.
+ */
+typedef struct ProfileFrame
+{
+    /**
+     * @brief The number of the frame, counting from 0 at startup.
+     */
+    u64 number;
+    /**
+     * @brief When the frame started and ended, in nanoseconds since
+     * the application started.
+     */
+    u64 start, end;
+    /**
+     * @brief The time the GPU spent on the frame's commands, in
+     * nanoseconds, or 0 if it isn't known (yet).
+     */
+    u64 gpu_time;
+    u32 scope_count;
+    ProfileScope scopes[PROFILER_MAX_SCOPES];
+} ProfileFrame;
+
+/**
+ * @brief The profiler. Only one is active at a time, since scopes
+ * are opened without being handed one.
+ */
+typedef struct Profiler
+{
+    /**
+     * @brief The ring of remembered frames, and the number of frames
+     * recorded so far.
+     */
+    ProfileFrame* frames;
+    u64 frame_count;
+    /**
+     * @brief The lock guarding the frames, since scopes are recorded
+     * from whichever thread opens them, and whether the current frame
+     * is between a call to @ref BeginProfilerFrame and one to
+     * @ref EndProfilerFrame. Scopes opened outside of a frame aren't
+     * recorded.
+     */
+    pthread_mutex_t lock;
+    bool recording;
+    /**
+     * @brief The track of the thread that begins and ends frames.
+     */
+    u16 frame_track;
+    /**
+     * @brief The GPU timer queries, the frame each one measured, and
+     * whether each is still waiting on its result.
+     */
+    u32 queries[PROFILER_QUERY_COUNT];
+    u64 query_frames[PROFILER_QUERY_COUNT];
+    bool query_pending[PROFILER_QUERY_COUNT];
+    /**
+     * @brief Whether or not the current frame has a timer query
+     * running.
+     */
+    bool query_active;
+} Profiler;
+
+/**
+ * @brief Create a profiler and make it the active one. This needs an
+ * OpenGL context, for the timer queries. Kills the process on
+ * failure.
+ * @return A pointer to the created profiler.
+ */
+__CREATE_STRUCT_KILLFAIL(Profiler) CreateProfiler(void);
+
+/**
+ * @brief Free the given profiler. If it was the active profiler, no
+ * profiler is active afterward.
+ * @param profiler The profiler to kill.
+ */
+void KillProfiler(Profiler* profiler);
+
+/**
+ * @brief Start a new frame in the active profiler. Frames are always
+ * begun and ended on the same thread.
+ */
+void BeginProfilerFrame(void);
+
+/**
+ * @brief End the active profiler's current frame, and collect any GPU
+ * timings that have become available.
+ */
+void EndProfilerFrame(void);
+
+/**
+ * @brief Open a named scope within the current frame, on the calling
+ * thread's track. Every call must be matched by a call to
+ * @ref EndProfileScope on the same thread.
+ * @param name The name of the scope. This must outlive the profiler,
+ * so it's meant to be a string literal.
+ */
+void BeginProfileScope(const char* name);
+
+/**
+ * @brief Close the calling thread's innermost open scope.
+ */
+void EndProfileScope(void);
+
+/**
+ * @brief Get the length of the last finished frame.
+ * @return The length of the frame, in milliseconds.
+ */
+f64 GetLastFrameDuration(void);
+
+/**
+ * @brief Write every remembered frame of the active profiler to the
+ * given file, in the Chrome trace event format.
+ * @param path The path of the file to write.
+ */
+void DumpProfilerTrace(const char* path);
+
+/**
+ * @brief Add a single timing to the given histogram.
+ * @param histogram The histogram.
+ * @param time The timing, in nanoseconds.
+ */
+void RecordTiming(TimingHistogram* histogram, u64 time);
+
+/**
+ * @brief Log the given histogram, one line per bucket that's been
+ * used. Only debug builds log anything.
+ * @param name What the histogram times.
+ * @param histogram The histogram.
+ */
+void PrintTimingHistogram(const char* name,
+                          const TimingHistogram* histogram);
+
+#define __PROFILE_CONCAT(a, b) a##b
+#define __PROFILE_VARIABLE(line)                                     \
+    __PROFILE_CONCAT(__profile_scope_, line)
+
+/**
+ * @brief Profile the statement (or block) following this macro as a
+ * scope of the given name. Since the scope is closed once the
+ * statement finishes, jumping out of it (return, break, goto) leaves
+ * the scope open.
+ */
+#define PROFILE_SCOPE(name)                                          \
+    for (bool __PROFILE_VARIABLE(__LINE__) =                         \
+             (BeginProfileScope(name), true);                        \
+         __PROFILE_VARIABLE(__LINE__);                               \
+         __PROFILE_VARIABLE(__LINE__) = (EndProfileScope(), false))
+
+#endif // _RENAI_PROFILER_
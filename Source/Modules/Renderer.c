@@ -1,30 +1,41 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_render
 #include "Renderer.h"
 #include <Logger.h>
 #include <cglm/cglm.h>
 #include <stbi/stb_image.h>
 
 /**
- * @brief Create the renderer's linked lists, and load their base
+ * @brief Free a shader of the renderer's shader registry.
+ */
+void _KillRendererShader(void* shader) { KillShader(shader); }
+
+/**
+ * @brief Create the renderer's registries, and load their base
  * resources.
  * @param renderer The renderer to write to.
- * @param width The width of the screen.
- * @param height The height of the screen.
  */
-__INLINE __KILLFAIL _CreateLinkedLists(Renderer* renderer,
-                                       f32 window_width,
-                                       f32 window_height)
+__INLINE __KILLFAIL _CreateRegistries(Renderer* renderer)
 {
-    renderer->shader_list =
-        CreateLinkedList(CreateShaderNode("basic"));
+    renderer->shaders =
+        CreateRegistry("shader", 4, _KillRendererShader);
 
+    Shader* basic_shader = LoadShader("basic");
     // Make sure nothing went wrong.
-    if (GetRendererHead(renderer, shader) == NULL)
+    if (basic_shader == NULL)
         PrintError("Failed to create the base resources of the "
                    "renderer (are files missing?).");
+    renderer->basic_shader =
+        RegisterResource(renderer->shaders, "basic", basic_shader);
+
+    PrintSuccess("Shader cache: %d hits, %d misses.",
+                 GetShaderCacheStatistics()->hits,
+                 GetShaderCacheStatistics()->misses);
 }
 
 __CREATE_STRUCT_KILLFAIL(Renderer)
-CreateRenderer(f32 window_width, f32 window_height)
+CreateRenderer(f32 window_width, f32 window_height, JobSystem* jobs)
 {
     Renderer* renderer =
         __MALLOC(Renderer, renderer,
@@ -38,41 +49,69 @@ CreateRenderer(f32 window_width, f32 window_height)
     // Flip the textures loaded from STBI vertically, as otherwise
     // it'll load them upside down.
     stbi_set_flip_vertically_on_load(1);
-    // Create the renderer's various linked lists. This also stands to
+    // Create the renderer's various registries. This also stands to
     // load the base assets for the application.
-    _CreateLinkedLists(renderer, window_width, window_height);
+    _CreateRegistries(renderer);
+
+    Shader* basic_shader = GetResource(
+        renderer->shaders, renderer->basic_shader, Shader);
+    // Every sprite is drawn from texture unit 0.
+    UseShader(basic_shader->shader);
+    SetInteger(GetUniformLocation(basic_shader, "in_texture"), 0);
 
-    Node* basic_shader = GetRendererHead(renderer, shader);
     // Create the projection matrix of the application, using a box
-    // with the dimensions swidth x sheight x 1000.
-    mat4 projection = GLM_MAT4_IDENTITY_INIT;
+    // with the dimensions swidth x sheight x 1000. This lives in the
+    // per-frame uniform block, so every shader shares it.
+    FrameUniforms* uniforms = &renderer->frame_uniforms;
     glm_ortho(0.0f, window_width, window_height, 0.0f, 0.0f, 1000.0f,
-              projection);
-
-    // Slide the projection matrix into the shader.
-    UseShader(GetNodeContents(basic_shader, shader)->shader);
-    SetMat4(GetNodeContents(basic_shader, shader)->shader,
-            "projection", projection);
-    PrintSuccess(
-        "Successfully set up the projection matrix on shader '%s'.",
-        basic_shader->name);
+              uniforms->projection);
+    renderer->camera = CreateCamera(window_width, window_height);
+    GetCameraView(renderer->camera, uniforms->view);
+    glm_vec4_copy((vec4){0.0f, 0.0f, window_width, window_height},
+                  uniforms->frame);
+    renderer->uniform_buffer = CreateFrameUniforms();
+    renderer->last_frame_time = GetCurrentTimeNS();
+    renderer->alpha = 0.0f;
+    UploadFrameUniforms(renderer->uniform_buffer, uniforms);
+    PrintSuccess("Successfully set up the per-frame uniform block.");
 
     renderer->scene_manager =
-        CreateManager(window_width, window_height);
+        CreateManager(window_width, window_height, jobs);
+    renderer->batch = CreateSpriteBatch(BATCH_DEFAULT_CAPACITY);
 
     return renderer;
 }
 
-void RenderWindowContent(Renderer* renderer)
+void RenderWindowContent(Renderer* renderer,
+                         const DrawSnapshot* snapshot, f32 alpha)
 {
-    // Get the basic shader, the one we use to render plain textures,
-    // and slot it as our current one.
-    u32 basic_shader =
-        GetNodeContents(GetRendererHead(renderer, shader), shader)
-            ->shader;
-    UseShader(basic_shader);
+    renderer->alpha = alpha;
+    BeginStateFrame();
 
+    // Refresh the per-frame state every shader sees.
+    u64 current_time = GetCurrentTimeNS();
+    renderer->frame_uniforms.frame[0] = NSToSeconds(current_time);
+    renderer->frame_uniforms.frame[1] =
+        NSToSeconds(current_time - renderer->last_frame_time);
+    renderer->last_frame_time = current_time;
+    GetCameraView(&snapshot->camera, renderer->frame_uniforms.view);
+    UploadFrameUniforms(renderer->uniform_buffer,
+                        &renderer->frame_uniforms);
+
+    // The snapshot was culled to what its camera could see when it
+    // was taken, so all of it is drawn.
+    //
+    // Everything's drawn with the basic shader, the one we use to
+    // render plain textures. It's only bound when something's drawn
+    // with it, and only if it isn't already.
     RenderCurrentScene(
-        renderer->scene_manager,
-        GetNodeContents(GetRendererHead(renderer, shader), shader));
+        renderer->scene_manager, renderer->batch,
+        GetResource(renderer->shaders, renderer->basic_shader, Shader)
+            ->shader,
+        snapshot, alpha);
+
+    // Everything drawn this frame has been marked as used, so
+    // anything else can be evicted if video memory's over budget.
+    TrimAtlasMemory();
+    PollOpenGLErrors();
 }
@@ -11,13 +11,17 @@
 #ifndef _RENAI_RENDERER_
 #define _RENAI_RENDERER_
 
-// This file defines the structure of a linked list, and provides some
-// various helper functions to make working with them easier. It also
-// includes Declarations.h, so we don't bother including that.
-#include <LinkedList.h>
+// This file defines the resource registry, which stores the
+// renderer's shaders. It also includes Declarations.h, so we don't
+// bother including that.
+#include <Registry.h>
 // This file defines the structure and helper functions for the scene
 // manager, which we use for rendering purposes.
 #include <Manager.h>
+// Provides shader loading and management functionality.
+#include <Shader.h>
+// Provides the camera the world is viewed through.
+#include <Camera.h>
 
 /**
  * @brief Basically just a large container for the various things
@@ -27,15 +31,48 @@
 typedef struct Renderer
 {
     /**
-     * @brief A linked list of shaders. This list includes each and
-     * every shader created by the program.
+     * @brief A registry of shaders. This includes each and every
+     * shader created by the program.
      */
-    LinkedList* shader_list;
+    Registry* shaders;
     /**
-     * @brief A storage space for texture instances, spritesheets,
-     * animations, renders, and more.
+     * @brief The handle of the 'basic' shader, the one used to render
+     * plain textures.
+     */
+    ResourceHandle basic_shader;
+    /**
+     * @brief A storage space for scenes, along with the textures
+     * and entities within them.
      */
     SceneManager* scene_manager;
+    /**
+     * @brief The sprite batch every sprite drawn within a frame is
+     * collected into, so they can be drawn in a handful of calls.
+     */
+    SpriteBatch* batch;
+    /**
+     * @brief The camera the scene is viewed through. This belongs to
+     * the simulation, which moves it; frames are drawn through the
+     * copy of it in their snapshot.
+     */
+    Camera* camera;
+    /**
+     * @brief The uniform buffer backing the per-frame uniform block,
+     * and the state most recently uploaded into it.
+     */
+    u32 uniform_buffer;
+    FrameUniforms frame_uniforms;
+    /**
+     * @brief When the last frame was rendered, in nanoseconds.
+     */
+    u64 last_frame_time;
+    /**
+     * @brief How far the simulation has gotten toward its next tick,
+     * from 0 to 1, as of the frame being rendered. Anything drawing
+     * simulated state should blend its last two ticks by this, so
+     * motion stays smooth whatever the framerate.
+     */
+    f32 alpha;
 } Renderer;
 
 /**
@@ -46,10 +83,11 @@ typedef struct Renderer
  * rendering onto.
  * @param window_height The height of the window we're going to be
  * rendering onto.
+ * @param jobs The job system the renderer's scenes are loaded with.
  * @return A pointer to the renderer we just created.
  */
 __CREATE_STRUCT_KILLFAIL(Renderer)
-CreateRenderer(f32 window_width, f32 window_height);
+CreateRenderer(f32 window_width, f32 window_height, JobSystem* jobs);
 
 /**
  * @brief Destroy a renderer object. This frees up all space allocated
@@ -58,30 +96,36 @@ CreateRenderer(f32 window_width, f32 window_height);
  */
 __INLINE void KillRenderer(Renderer* renderer)
 {
-    KillLinkedList(renderer->shader_list);
+    KillRegistry(renderer->shaders);
     KillManager(renderer->scene_manager);
+    KillSpriteBatch(renderer->batch);
+    KillFrameUniforms(renderer->uniform_buffer);
+    KillCamera(renderer->camera);
     __FREE(renderer,
            ("The renderer freer was given an invalid texture."));
     PrintWarning("The renderer was freed.");
 }
 
 /**
- * @brief Get a list of the specified type from the given renderer.
- */
-#define GetRendererList(renderer, list) renderer->list##_list
-
-/**
- * @brief Get the head node of the given renderer's list of the given
- * type.
+ * @brief Render the given snapshot onto whatever window whose context
+ * is set to current.
+ * @param renderer The renderer to use for the process.
+ * @param snapshot The snapshot of the simulation to draw.
+ * @param alpha How far the simulation is between the snapshot's tick
+ * and its next, from 0 to 1.
  */
-#define GetRendererHead(renderer, list)                              \
-    renderer->list##_list->first_node
+void RenderWindowContent(Renderer* renderer,
+                         const DrawSnapshot* snapshot, f32 alpha);
 
 /**
- * @brief Render the content of whatever window whose context is set
- * to current.
- * @param renderer The renderer to use for the process.
+ * @brief Get the draw statistics of the last frame the renderer drew.
+ * @param renderer The renderer to query.
+ * @return A pointer to the statistics of the renderer's sprite batch.
  */
-void RenderWindowContent(Renderer* renderer);
+__INLINE __GET_STRUCT(BatchStatistics)
+    GetRendererStatistics(Renderer* renderer)
+{
+    return GetBatchStatistics(renderer->batch);
+}
 
 #endif // _RENAI_RENDERER_
@@ -0,0 +1,480 @@
+#include "Replay.h"
+#include <Logger.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Log an event as it's pushed into the input system.
+ * @param event The event.
+ * @param data The session recording it.
+ */
+void _RecordReplayEvent(const InputEvent* event, void* data)
+{
+    Replay* replay = data;
+    if (event->type == input_button)
+    {
+        u8 entry[4] = {replay_button, 0, 0, event->pressed};
+        memcpy(entry + 1, &event->code, 2);
+        fwrite(entry, 1, 4, replay->file);
+        return;
+    }
+
+    u8 entry[12] = {replay_motion, event->type};
+    memcpy(entry + 2, &event->code, 2);
+    memcpy(entry + 4, &event->x, sizeof(f32));
+    memcpy(entry + 8, &event->y, sizeof(f32));
+    fwrite(entry, 1, 12, replay->file);
+}
+
+/**
+ * @brief Log the start of a tick.
+ * @param input The input system (unused).
+ * @param data The session recording it.
+ */
+void _RecordReplayTick(Input* input, void* data)
+{
+    Replay* replay = data;
+    fputc(replay_tick, replay->file);
+}
+
+/**
+ * @brief Kill the process over a replay log that doesn't make sense.
+ * @param replay The session being replayed.
+ */
+__KILLFAIL _ReplayMalformed(const Replay* replay)
+{
+    PrintError("The replay log has been tampered with/is malformed "
+               "at byte %lu. Unable to continue.",
+               replay->position);
+}
+
+/**
+ * @brief Read entries from the log, pushing every event into the
+ * input system, until the given entry is reached.
+ * @param replay The session being replayed.
+ * @param until The entry to stop after; either a frame or a tick.
+ * @return A boolean representing whether or not the entry was
+ * reached. False means the log has ended.
+ */
+__BOOLEAN _ReadReplayEntries(Replay* replay, ReplayEntry until)
+{
+    // The end marker is the log's last two bytes, so nothing's read
+    // past them.
+    const u64 end = replay->size - 2;
+    while (replay->position < end)
+    {
+        const u8* entry = replay->data + replay->position;
+        if (*entry == until)
+        {
+            replay->position++;
+            return true;
+        }
+
+        InputEvent event = {0};
+        switch (*entry)
+        {
+            case replay_button:
+                if (end - replay->position < 4)
+                    _ReplayMalformed(replay);
+                event.type = input_button;
+                memcpy(&event.code, entry + 1, 2);
+                event.pressed = entry[3];
+                replay->position += 4;
+                break;
+            case replay_motion:
+                if (end - replay->position < 12)
+                    _ReplayMalformed(replay);
+                event.type = entry[1];
+                memcpy(&event.code, entry + 2, 2);
+                memcpy(&event.x, entry + 4, sizeof(f32));
+                memcpy(&event.y, entry + 8, sizeof(f32));
+                replay->position += 12;
+                break;
+            // A frame where a tick should be, or the other way
+            // around, means the simulation has gone somewhere the
+            // recording never did.
+            default:
+                PrintError("The replay went out of sync at byte %lu. "
+                           "Was it recorded by a different version?",
+                           replay->position);
+        }
+        PushInputEvent(replay->input, &event);
+    }
+
+    atomic_store(&replay->finished, true);
+    return false;
+}
+
+/**
+ * @brief Feed the input system the events logged before the next
+ * tick, in place of the user and the gamepad.
+ * @param input The input system.
+ * @param data The session being replayed.
+ */
+void _ReplayTick(Input* input, void* data)
+{
+    Replay* replay = data;
+    if (!atomic_load(&replay->finished))
+        _ReadReplayEntries(replay, replay_tick);
+}
+
+/**
+ * @brief Start recording into the given log.
+ * @param replay The session.
+ * @param path The path of the log.
+ * @param tick_speed The tick speed of the simulation.
+ */
+__KILLFAIL _StartRecording(Replay* replay, const char* path,
+                           u8 tick_speed)
+{
+    replay->file = fopen(path, "wb");
+    if (replay->file == NULL)
+        PrintError("Failed to open the replay log '%s'. Code: %d.",
+                   path, errno);
+
+    const u8 header[REPLAY_HEADER_SIZE] = {
+        0xFF, 0x01,       MAJOR, MINOR, REVIS, REPLAY_FORMAT_VERSION,
+        tick_speed, 0xFF, 0x02};
+    fwrite(header, 1, REPLAY_HEADER_SIZE, replay->file);
+
+    replay->input->poller = _RecordReplayTick;
+    replay->input->listener = _RecordReplayEvent;
+    replay->input->hook_data = replay;
+    PrintSuccess("Recording the session into '%s'.", path);
+}
+
+/**
+ * @brief Map the given log and start replaying it.
+ * @param replay The session.
+ * @param path The path of the log.
+ * @param tick_speed The tick speed of the simulation.
+ */
+__KILLFAIL _StartReplaying(Replay* replay, const char* path,
+                           u8 tick_speed)
+{
+    i32 descriptor = open(path, O_RDONLY);
+    if (descriptor < 0)
+        PrintError("Failed to open the replay log '%s'. Code: %d.",
+                   path, errno);
+
+    struct stat file_stats;
+    if (fstat(descriptor, &file_stats) < 0 ||
+        file_stats.st_size < REPLAY_HEADER_SIZE + 2)
+        PrintError("The replay log '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+    replay->size = file_stats.st_size;
+    replay->data = mmap(NULL, replay->size, PROT_READ, MAP_PRIVATE,
+                        descriptor, 0);
+    close(descriptor);
+    if (replay->data == MAP_FAILED)
+        PrintError("Failed to map the replay log '%s'. Code: %d.",
+                   path, errno);
+
+    const u8* data = replay->data;
+    if (data[0] != 0xFF || data[1] != 0x01 || data[7] != 0xFF ||
+        data[8] != 0x02 || data[replay->size - 2] != 0xFF ||
+        data[replay->size - 1] != 0x03)
+        PrintError("The replay log '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+    CheckVersionDifference("replays", (u8*)data + 2);
+    if (data[5] != REPLAY_FORMAT_VERSION)
+        PrintError("The replay log '%s' uses format %d, but Renai "
+                   "expects format %d. Please record it again.",
+                   path, data[5], REPLAY_FORMAT_VERSION);
+    if (data[6] != tick_speed)
+        PrintError("The replay log '%s' was recorded at %d ticks a "
+                   "second, but the simulation runs at %d.",
+                   path, data[6], tick_speed);
+    replay->position = REPLAY_HEADER_SIZE;
+
+    // The user has no say in a replay; everything comes from the
+    // log.
+    replay->input->poller = _ReplayTick;
+    replay->input->listener = NULL;
+    replay->input->hook_data = replay;
+    replay->input->live = false;
+    PrintSuccess("Replaying the session in '%s' (%lu bytes).", path,
+                 replay->size);
+}
+
+/**
+ * @brief Write the time every frame of the session took to its
+ * timings file, one frame per line, in milliseconds.
+ * @param replay The session.
+ */
+__KILLFAIL _WriteReplayTimings(const Replay* replay)
+{
+    FILE* file = fopen(replay->timings_path, "w");
+    if (file == NULL)
+    {
+        PrintWarning("Failed to open '%s' to write the replay's "
+                     "timings. Code: %d.",
+                     replay->timings_path, errno);
+        return;
+    }
+
+    fprintf(file, "# Renai frame timings, in milliseconds; %lu "
+                  "frames.\n",
+            replay->frame_count);
+    for (u64 index = 0; index < replay->frame_count; index++)
+        fprintf(file, "%.6f\n",
+                replay->timings[index] / (f64)NS_PER_MS);
+    fclose(file);
+    PrintSuccess("Wrote the timings of %lu frames to '%s'.",
+                 replay->frame_count, replay->timings_path);
+}
+
+/**
+ * @brief Read a timings file.
+ * @param path The path of the file.
+ * @param count Where to write the number of frames read.
+ * @return The time of every frame, in milliseconds, or NULL if the
+ * file couldn't be read. This must be freed.
+ */
+f64* _ReadReplayTimings(const char* path, u64* count)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Failed to open the timings '%s'.\n", path);
+        return NULL;
+    }
+
+    u64 capacity = 1024;
+    f64* timings = malloc(sizeof(f64) * capacity);
+    char line[64];
+    *count = 0;
+    while (timings != NULL && fgets(line, 64, file) != NULL)
+    {
+        f64 timing;
+        if (line[0] == '#' || sscanf(line, "%lf", &timing) != 1)
+            continue;
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            f64* grown = realloc(timings, sizeof(f64) * capacity);
+            if (grown == NULL) free(timings);
+            timings = grown;
+            if (timings == NULL) break;
+        }
+        timings[(*count)++] = timing;
+    }
+    fclose(file);
+
+    if (timings == NULL)
+        fprintf(stderr, "Failed to allocate the timings of '%s'.\n",
+                path);
+    return timings;
+}
+
+/**
+ * @brief Compare two frame times, for sorting.
+ */
+i32 _CompareFrameTimes(const void* first, const void* second)
+{
+    const f64 a = *(const f64*)first, b = *(const f64*)second;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief Print the mean and percentiles of a run's frame times.
+ * @param name The name of the run.
+ * @param timings The frame times, in milliseconds. These are sorted.
+ * @param count The number of frames.
+ */
+__KILLFAIL _PrintTimingSummary(const char* name, f64* timings,
+                               u64 count)
+{
+    f64 total = 0.0;
+    for (u64 index = 0; index < count; index++)
+        total += timings[index];
+    qsort(timings, count, sizeof(f64), _CompareFrameTimes);
+    printf("%-10s mean %8.3f  p50 %8.3f  p95 %8.3f  p99 %8.3f  max "
+           "%8.3f\n",
+           name, total / count, timings[count / 2],
+           timings[count * 95 / 100], timings[count * 99 / 100],
+           timings[count - 1]);
+}
+
+u8 ParseReplayArgument(ReplayOptions* options, i32 argc, char** argv)
+{
+    const char* argument = argv[0];
+    if (strcmp(argument, "--compare") == 0)
+    {
+        if (argc < 3)
+            PrintError("'--compare' needs two timing files.");
+        options->compare_paths[0] = argv[1];
+        options->compare_paths[1] = argv[2];
+        return 3;
+    }
+
+    const char** value = NULL;
+    if (strcmp(argument, "--record") == 0)
+        value = &options->record_path;
+    else if (strcmp(argument, "--replay") == 0)
+        value = &options->replay_path;
+    else if (strcmp(argument, "--timings") == 0)
+        value = &options->timings_path;
+    else return 0;
+
+    if (argc < 2) PrintError("'%s' needs a path.", argument);
+    *value = argv[1];
+    return 2;
+}
+
+__CREATE_STRUCT_KILLFAIL(Replay)
+CreateReplay(const ReplayOptions* options, Input* input,
+             u8 tick_speed)
+{
+    if (options->record_path == NULL && options->replay_path == NULL)
+        return NULL;
+    if (options->record_path != NULL && options->replay_path != NULL)
+        PrintError("Can't record a session while replaying one.");
+
+    Replay* replay = __MALLOC(
+        Replay, replay,
+        ("Failed to allocate the replay. Code: %d.", errno));
+    memset(replay, 0, sizeof(Replay));
+    atomic_init(&replay->finished, false);
+    replay->input = input;
+    replay->playing = options->replay_path != NULL;
+    replay->timings_path =
+        (options->timings_path == NULL && replay->playing
+             ? REPLAY_TIMINGS_PATH
+             : options->timings_path);
+
+    if (replay->playing)
+        _StartReplaying(replay, options->replay_path, tick_speed);
+    else _StartRecording(replay, options->record_path, tick_speed);
+    return replay;
+}
+
+void KillReplay(Replay* replay)
+{
+    if (replay->playing)
+        munmap((void*)replay->data, replay->size);
+    else
+    {
+        const u8 file_end[2] = {replay_end, 0x03};
+        fwrite(file_end, 1, 2, replay->file);
+        fclose(replay->file);
+    }
+
+    Input* input = replay->input;
+    input->poller = NULL;
+    input->listener = NULL;
+    input->hook_data = NULL;
+    input->live = true;
+
+    if (replay->timings_path != NULL) _WriteReplayTimings(replay);
+    PrintSuccess("Finished %s the session (%lu frames).",
+                 (replay->playing ? "replaying" : "recording"),
+                 replay->frame_count);
+    free(replay->timings);
+    __FREE(replay, ("The replay freer was given an invalid replay."));
+}
+
+u64 StepReplayFrame(Replay* replay, u64 frame_length)
+{
+    // The input system's lock keeps the frame in order with the
+    // events recorded on the main thread, or keeps the events read
+    // here from racing them into the ring.
+    pthread_mutex_t* lock = &replay->input->lock;
+    pthread_mutex_lock(lock);
+    if (!replay->playing)
+    {
+        // Frames are clamped well short of four seconds, so their
+        // length always fits in 32 bits.
+        u8 entry[5] = {replay_frame};
+        const u32 length = frame_length;
+        memcpy(entry + 1, &length, 4);
+        fwrite(entry, 1, 5, replay->file);
+        pthread_mutex_unlock(lock);
+        return frame_length;
+    }
+
+    if (!atomic_load(&replay->finished) &&
+        _ReadReplayEntries(replay, replay_frame))
+    {
+        if (replay->size - 2 - replay->position < 4)
+            _ReplayMalformed(replay);
+
+        u32 length;
+        memcpy(&length, replay->data + replay->position, 4);
+        replay->position += 4;
+        frame_length = length;
+    }
+    pthread_mutex_unlock(lock);
+    return frame_length;
+}
+
+void EndReplayFrame(Replay* replay, u64 frame_time)
+{
+    if (replay->frame_count == replay->frame_capacity)
+    {
+        replay->frame_capacity = (replay->frame_capacity == 0
+                                      ? 1024
+                                      : replay->frame_capacity * 2);
+        u64* timings = realloc(replay->timings,
+                               sizeof(u64) * replay->frame_capacity);
+        if (timings == NULL)
+            PrintError("Failed to grow the replay's timings. Code: "
+                       "%d.",
+                       errno);
+        replay->timings = timings;
+    }
+    replay->timings[replay->frame_count++] = frame_time;
+}
+
+__BOOLEAN CompareReplayTimings(const char* first, const char* second)
+{
+    u64 first_count, second_count;
+    f64* baseline = _ReadReplayTimings(first, &first_count);
+    f64* compared = _ReadReplayTimings(second, &second_count);
+    if (baseline == NULL || compared == NULL || first_count == 0 ||
+        second_count == 0)
+    {
+        free(baseline);
+        free(compared);
+        return false;
+    }
+
+    // Replays of the same log run the same frames, so a difference
+    // in count means the runs weren't comparable to begin with.
+    const u64 count =
+        (first_count < second_count ? first_count : second_count);
+    if (first_count != second_count)
+        printf("The runs have different frame counts (%lu and %lu); "
+               "only the first %lu are compared.\n",
+               first_count, second_count, count);
+
+    u64 regressions = 0, improvements = 0;
+    printf("%8s %12s %12s %12s\n", "frame", "baseline ms",
+           "compared ms", "difference");
+    for (u64 index = 0; index < count; index++)
+    {
+        const f64 difference = compared[index] - baseline[index],
+                  ratio = difference / baseline[index];
+        if (ratio > REPLAY_REGRESSION_THRESHOLD) regressions++;
+        else if (ratio < -REPLAY_REGRESSION_THRESHOLD) improvements++;
+        printf("%8lu %12.3f %12.3f %+11.3f (%+.1f%%)\n", index,
+               baseline[index], compared[index], difference,
+               ratio * 100.0);
+    }
+
+    printf("\n");
+    _PrintTimingSummary("baseline", baseline, count);
+    _PrintTimingSummary("compared", compared, count);
+    printf("%lu of %lu frames were over %.0f%% slower, and %lu over "
+           "%.0f%% faster.\n",
+           regressions, count, REPLAY_REGRESSION_THRESHOLD * 100.0,
+           improvements, REPLAY_REGRESSION_THRESHOLD * 100.0);
+
+    free(baseline);
+    free(compared);
+    return true;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file Replay.h
+ * @author Zenais Argos
+ * @brief Provides session recording and replay. A recording logs the
+ * time the simulation is handed each step and every input event,
+ * along with where each tick fell between them, into a compact binary
+ * log. Replaying the log drives the simulation from a virtual clock,
+ * feeding the events back in at exactly the same points, so it goes
+ * through exactly the same states as it did live. Each run can write
+ * the time every frame took, and two of those can be compared frame
+ * by frame.
+ * @date 2024-07-21
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_REPLAY_
+#define _RENAI_REPLAY_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the input system whose events are recorded and replayed.
+#include <Input.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The version of the replay log format. This is separate from
+ * the application version, and only changes when the layout of the
+ * log does.
+ */
+#define REPLAY_FORMAT_VERSION 1
+
+/**
+ * @brief The size of a replay log's header, in bytes; the magic
+ * number, application version, format version, tick speed, and end
+ * marker.
+ */
+#define REPLAY_HEADER_SIZE 9
+
+/**
+ * @brief Where a replay writes the time each frame took when no path
+ * is given, relative to the executable.
+ */
+#define REPLAY_TIMINGS_PATH "./replay_timings.txt"
+
+/**
+ * @brief How much slower a frame has to be than its counterpart for
+ * a comparison to call it a regression, as a fraction.
+ */
+#define REPLAY_REGRESSION_THRESHOLD 0.10
+
+/**
+ * @brief The kinds of entry a replay log is made of. Each entry is
+ * its tag byte followed by its fields.
+ */
+typedef enum ReplayEntry
+{
+    /**
+     * @brief The start of a step of the simulation; the time it was
+     * handed in nanoseconds, as a 32-bit integer.
+     */
+    replay_frame = 1,
+    /**
+     * @brief The start of a tick, where the events before it are
+     * processed.
+     */
+    replay_tick = 2,
+    /**
+     * @brief A button event; its code, as a 16-bit integer, then
+     * whether it went down.
+     */
+    replay_button = 3,
+    /**
+     * @brief Any other event; its type, its code as a 16-bit integer,
+     * then its two values as floats.
+     */
+    replay_motion = 4,
+    /**
+     * @brief The end of the log, followed by a second marker byte.
+     */
+    replay_end = 0xFF
+} ReplayEntry;
+
+/**
+ * @brief What the command line asked to record, replay, or compare.
+ */
+typedef struct ReplayOptions
+{
+    /**
+     * @brief The log to record into, or NULL.
+     */
+    const char* record_path;
+    /**
+     * @brief The log to replay, or NULL.
+     */
+    const char* replay_path;
+    /**
+     * @brief Where to write the time each frame took, or NULL to
+     * write nothing. A replay defaults to @ref REPLAY_TIMINGS_PATH.
+     */
+    const char* timings_path;
+    /**
+     * @brief The two timing files to compare, or NULL.
+     */
+    const char* compare_paths[2];
+} ReplayOptions;
+
+/**
+ * @brief A session being recorded or replayed.
+ */
+typedef struct Replay
+{
+    /**
+     * @brief Whether the session's being replayed, rather than
+     * recorded.
+     */
+    bool playing;
+    /**
+     * @brief The log being recorded into. Recordings only.
+     */
+    FILE* file;
+    /**
+     * @brief The mapped log, its size, and how far into it the replay
+     * has read. Replays only.
+     */
+    const u8* data;
+    u64 size, position;
+    /**
+     * @brief The time each frame took so far, in nanoseconds, and how
+     * many there's room for.
+     */
+    u64* timings;
+    u64 frame_count, frame_capacity;
+    /**
+     * @brief Where the timings are written once the session's done,
+     * or NULL.
+     */
+    const char* timings_path;
+    /**
+     * @brief The input system being recorded or fed.
+     */
+    Input* input;
+    /**
+     * @brief Whether or not the replay has run out of frames. This is
+     * set by the simulation's thread, and read by the main one.
+     */
+    _Atomic bool finished;
+} Replay;
+
+/**
+ * @brief Read a single replay argument; `--record <log>`, `--replay
+ * <log>`, `--timings <path>`, or `--compare <timings> <timings>`.
+ * Kills the process if the argument is one of these but is missing
+ * its values.
+ * @param options Where to write the argument's values.
+ * @param argc The number of arguments left, this one included.
+ * @param argv The arguments left, starting with this one.
+ * @return The number of arguments read, or 0 if this isn't a replay
+ * argument.
+ */
+u8 ParseReplayArgument(ReplayOptions* options, i32 argc, char** argv);
+
+/**
+ * @brief Start recording or replaying a session, hooking into the
+ * given input system. Kills the process if the log can't be opened
+ * or is malformed.
+ * @param options The options the session was asked for.
+ * @param input The input system to record or feed.
+ * @param tick_speed The tick speed of the simulation. Replays have to
+ * run at the speed they were recorded at.
+ * @return A pointer to the session, or NULL if there's nothing to
+ * record or replay.
+ */
+__CREATE_STRUCT_KILLFAIL(Replay)
+CreateReplay(const ReplayOptions* options, Input* input,
+             u8 tick_speed);
+
+/**
+ * @brief Finish the given session, ending its log or unmapping it,
+ * writing its timings, and unhooking it from its input system.
+ * @param replay The session to kill.
+ */
+void KillReplay(Replay* replay);
+
+/**
+ * @brief Start a step of the simulation. A recording logs the time
+ * the step was handed, while a replay swaps it for the recorded time,
+ * feeding in any events logged since the last tick on the way. This
+ * is called from the simulation's thread.
+ * @param replay The session.
+ * @param frame_length The time the step was handed by the wall
+ * clock, in nanoseconds.
+ * @return The time the step should be simulated as.
+ */
+u64 StepReplayFrame(Replay* replay, u64 frame_length);
+
+/**
+ * @brief Note how long the frame just finished took to run. This is
+ * called from the main thread, once per frame drawn.
+ * @param replay The session.
+ * @param frame_time The time the frame took, in nanoseconds.
+ */
+void EndReplayFrame(Replay* replay, u64 frame_time);
+
+/**
+ * @brief Compare two timing files frame by frame, printing the
+ * difference of every frame and a summary of both runs.
+ * @param first The path of the baseline's timings.
+ * @param second The path of the timings to compare against it.
+ * @return A boolean representing whether or not both files could be
+ * read.
+ */
+__BOOLEAN CompareReplayTimings(const char* first, const char* second);
+
+/**
+ * @brief Check whether the given session, if any, has replayed every
+ * frame it recorded.
+ * @param replay The session, or NULL.
+ * @return A boolean representing whether or not it's finished.
+ */
+__INLINE __BOOLEAN IsReplayFinished(const Replay* replay)
+{
+    return replay != NULL && atomic_load(&replay->finished);
+}
+
+#endif // _RENAI_REPLAY_
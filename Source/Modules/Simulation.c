@@ -0,0 +1,191 @@
+#include "Simulation.h"
+#include <Logger.h>
+
+/**
+ * @brief Snapshot what's to be drawn as of the latest tick, and
+ * publish it.
+ * @param simulation The simulation.
+ */
+__KILLFAIL _PublishSimulation(Simulation* simulation)
+{
+    DrawSnapshot* snapshot = GetBackSnapshot(simulation->mailbox);
+    SnapshotCurrentScene(simulation->manager,
+                         simulation->updater->camera, snapshot);
+    snapshot->tick = simulation->tick;
+    // Whatever wasn't ticked through is how long ago the latest tick
+    // was due.
+    snapshot->time = GetCurrentTimeNS() - simulation->accumulator;
+    PublishSnapshot(simulation->mailbox);
+}
+
+/**
+ * @brief Tick through the time handed over since the thread last
+ * woke, then publish the result.
+ * @param simulation The simulation.
+ * @param frame_length The time handed over, in nanoseconds.
+ * @param frames The number of frames that time was over.
+ */
+__KILLFAIL _StepSimulation(Simulation* simulation, u64 frame_length,
+                           u32 frames)
+{
+    const u64 step_start = GetCurrentTimeNS();
+    if (frame_length > SIMULATION_MAX_STEP)
+        frame_length = SIMULATION_MAX_STEP;
+
+    // A recording logs everything handed over as a single step, but
+    // a replay takes one logged step per frame drawn, so it runs at
+    // the pace it was recorded at.
+    Replay* replay = simulation->replay;
+    const u32 steps =
+        (replay != NULL && replay->playing ? frames : 1);
+    const u64 tick_length = simulation->tick_length;
+    bool ticked = false;
+    for (u32 step = 0; step < steps && !IsReplayFinished(replay);
+         step++)
+    {
+        u64 length = frame_length;
+        if (replay != NULL) length = StepReplayFrame(replay, length);
+        if (IsReplayFinished(replay)) break;
+
+        // The simulation runs in fixed ticks, as many as fit in the
+        // time that's passed, with the remainder carried over to the
+        // next step. This keeps its results independent of the
+        // framerate.
+        simulation->accumulator += length;
+        for (; simulation->accumulator >= tick_length;
+             simulation->accumulator -= tick_length)
+        {
+            const u64 tick_start = GetCurrentTimeNS();
+            PROFILE_SCOPE("update")
+            {
+                UpdateWindowContent(simulation->updater,
+                                    simulation->manager,
+                                    NSToSeconds(tick_length));
+            }
+            RecordTiming(&simulation->tick_times,
+                         GetCurrentTimeNS() - tick_start);
+            simulation->tick++;
+            ticked = true;
+        }
+    }
+
+    if (ticked) _PublishSimulation(simulation);
+    simulation->busy_time += GetCurrentTimeNS() - step_start;
+}
+
+/**
+ * @brief The body of the simulation's thread. It sleeps until it's
+ * handed time, then ticks through all of it at once.
+ * @param data The simulation.
+ */
+void* _RunSimulation(void* data)
+{
+    Simulation* simulation = data;
+    while (true)
+    {
+        pthread_mutex_lock(&simulation->lock);
+        while (simulation->running && simulation->pending_frames == 0)
+            pthread_cond_wait(&simulation->signal, &simulation->lock);
+        if (!simulation->running)
+        {
+            pthread_mutex_unlock(&simulation->lock);
+            break;
+        }
+
+        const u64 frame_length = simulation->pending_time;
+        const u32 frames = simulation->pending_frames;
+        simulation->pending_time = 0;
+        simulation->pending_frames = 0;
+        pthread_mutex_unlock(&simulation->lock);
+
+        _StepSimulation(simulation, frame_length, frames);
+    }
+    return NULL;
+}
+
+__CREATE_STRUCT_KILLFAIL(Simulation)
+CreateSimulation(Updater* updater, SceneManager* manager,
+                 Replay* replay)
+{
+    Simulation* simulation = __MALLOC(
+        Simulation, simulation,
+        ("Failed to allocate the simulation. Code: %d.", errno));
+    memset(simulation, 0, sizeof(Simulation));
+    simulation->updater = updater;
+    simulation->manager = manager;
+    simulation->replay = replay;
+    simulation->tick_length = NS_PER_SECOND / updater->tick_speed;
+    simulation->running = true;
+    simulation->start_time = GetCurrentTimeNS();
+    pthread_mutex_init(&simulation->lock, NULL);
+    pthread_cond_init(&simulation->signal, NULL);
+
+    // The first frame is drawn before the first tick, so it needs
+    // something to draw.
+    simulation->mailbox = CreateSnapshotMailbox();
+    _PublishSimulation(simulation);
+
+    if (pthread_create(&simulation->thread, NULL, _RunSimulation,
+                       simulation) != 0)
+        PrintError("Failed to spawn the simulation thread. Code: %d.",
+                   errno);
+    PrintSuccess("Started the simulation thread. Tick length: %.2f "
+                 "ms.",
+                 simulation->tick_length / (f64)NS_PER_MS);
+    return simulation;
+}
+
+void KillSimulation(Simulation* simulation)
+{
+    pthread_mutex_lock(&simulation->lock);
+    simulation->running = false;
+    pthread_cond_signal(&simulation->signal);
+    pthread_mutex_unlock(&simulation->lock);
+    pthread_join(simulation->thread, NULL);
+
+    PrintTimingHistogram("Frames", &simulation->frame_times);
+    PrintTimingHistogram("Ticks", &simulation->tick_times);
+#ifdef DEBUG_MODE
+    const u64 run_length =
+        GetCurrentTimeNS() - simulation->start_time;
+    PrintSuccess("Ran %lu ticks off the main thread, busy for %.1f "
+                 "ms of %.1f ms (%.1f%%).",
+                 simulation->tick,
+                 simulation->busy_time / (f64)NS_PER_MS,
+                 run_length / (f64)NS_PER_MS,
+                 simulation->busy_time * 100.0 / run_length);
+#endif
+
+    KillSnapshotMailbox(simulation->mailbox);
+    pthread_mutex_destroy(&simulation->lock);
+    pthread_cond_destroy(&simulation->signal);
+    __FREE(simulation,
+           ("The simulation freer was given an invalid simulation."));
+}
+
+void AdvanceSimulation(Simulation* simulation, u64 frame_length)
+{
+    RecordTiming(&simulation->frame_times, frame_length);
+
+    pthread_mutex_lock(&simulation->lock);
+    simulation->pending_time += frame_length;
+    simulation->pending_frames++;
+    pthread_cond_signal(&simulation->signal);
+    pthread_mutex_unlock(&simulation->lock);
+}
+
+__GET_STRUCT(DrawSnapshot)
+GetSimulationSnapshot(Simulation* simulation, f32* alpha)
+{
+    DrawSnapshot* snapshot = AcquireSnapshot(simulation->mailbox);
+    const u64 current_time = GetCurrentTimeNS();
+    const u64 since = (current_time > snapshot->time
+                           ? current_time - snapshot->time
+                           : 0);
+
+    // The next tick may be overdue if the simulation's running
+    // behind, but nothing's drawn past it.
+    *alpha = (f32)since / simulation->tick_length;
+    if (*alpha > 1.0f) *alpha = 1.0f;
+    return snapshot;
+}
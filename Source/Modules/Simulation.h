@@ -0,0 +1,136 @@
+/**
+ * @file Simulation.h
+ * @author Zenais Argos
+ * @brief Provides the simulation thread. The main thread owns the
+ * window and the OpenGL context, and hands the simulation however
+ * much time each frame took; the simulation ticks through it on its
+ * own thread, and publishes a snapshot of what there is to draw once
+ * it's done. The main thread always draws the newest snapshot there
+ * is, so a slow tick delays what's drawn rather than when.
+ * @date 2024-07-22
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_SIMULATION_
+#define _RENAI_SIMULATION_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the timing histograms of ticks and frames.
+#include <Profiler.h>
+// Provides the session being recorded or replayed, whose clock the
+// simulation may run on.
+#include <Replay.h>
+// Provides the mailbox snapshots are handed over through.
+#include <Snapshot.h>
+// Provides the updater that runs every tick.
+#include <Updater.h>
+#include <pthread.h>
+
+/**
+ * @brief The most time the simulation is handed at once, in
+ * nanoseconds. Anything past this (a breakpoint, a dragged window, a
+ * blocking wait on events, a tick slower than the frames) is dropped,
+ * so the simulation doesn't try to catch up on all of it at once and
+ * fall further behind doing so.
+ */
+#define SIMULATION_MAX_STEP (250 * NS_PER_MS)
+
+/**
+ * @brief The simulation, and the thread it runs on.
+ */
+typedef struct Simulation
+{
+    /**
+     * @brief The updater every tick is run with, the scene manager
+     * whose current scene is ticked and snapshotted, and the session
+     * being recorded or replayed, or NULL.
+     */
+    Updater* updater;
+    SceneManager* manager;
+    Replay* replay;
+    /**
+     * @brief The mailbox every snapshot is published to.
+     */
+    SnapshotMailbox* mailbox;
+    /**
+     * @brief The simulation's thread, and the lock and condition it
+     * sleeps on until it's handed time.
+     */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t signal;
+    /**
+     * @brief The time handed over since the thread last woke, and the
+     * number of frames that was over. Both are guarded by the lock.
+     */
+    u64 pending_time;
+    u32 pending_frames;
+    /**
+     * @brief Whether or not the thread should keep running. This is
+     * guarded by the lock.
+     */
+    bool running;
+    /**
+     * @brief The length of a single tick, the time handed over that
+     * hasn't been ticked through yet, and the number of ticks run
+     * so far, in nanoseconds. The simulation's thread owns these.
+     */
+    u64 tick_length, accumulator, tick;
+    /**
+     * @brief How long every tick took, on the simulation's thread,
+     * and how long every frame took, on the main one.
+     */
+    TimingHistogram tick_times, frame_times;
+    /**
+     * @brief When the simulation started, and how long its thread has
+     * spent ticking and snapshotting since, in nanoseconds. All of
+     * that is time the main thread no longer spends.
+     */
+    u64 start_time, busy_time;
+} Simulation;
+
+/**
+ * @brief Create the simulation, publish a snapshot of the state it
+ * starts in, and start its thread. Kills the process on failure.
+ * @param updater The updater to run every tick with.
+ * @param manager The scene manager whose current scene to simulate.
+ * @param replay The session being recorded or replayed, or NULL.
+ * @return A pointer to the created simulation.
+ */
+__CREATE_STRUCT_KILLFAIL(Simulation)
+CreateSimulation(Updater* updater, SceneManager* manager,
+                 Replay* replay);
+
+/**
+ * @brief Stop and join the simulation's thread, log its timings, and
+ * free it. Any time handed over but not yet ticked through is
+ * dropped.
+ * @param simulation The simulation to kill.
+ */
+void KillSimulation(Simulation* simulation);
+
+/**
+ * @brief Hand the simulation the time the last frame took, waking its
+ * thread to tick through it. This never waits on the thread. A
+ * recording logs the time, and a replay swaps it for the logged time.
+ * @param simulation The simulation.
+ * @param frame_length The length of the frame, in nanoseconds.
+ */
+void AdvanceSimulation(Simulation* simulation, u64 frame_length);
+
+/**
+ * @brief Get the newest snapshot the simulation has published, and
+ * how far it's been since then toward the next tick.
+ * @param simulation The simulation.
+ * @param alpha Where to write how far into the next tick it is, from
+ * 0 to 1.
+ * @return A pointer to the snapshot. This stays untouched until the
+ * next call.
+ */
+__GET_STRUCT(DrawSnapshot)
+GetSimulationSnapshot(Simulation* simulation, f32* alpha);
+
+#endif // _RENAI_SIMULATION_
@@ -0,0 +1,98 @@
+#include "Snapshot.h"
+#include <Logger.h>
+
+/**
+ * @brief The mask of a mailbox's ready slot index, without the @ref
+ * SNAPSHOT_FRESH bit.
+ */
+#define __SLOT_MASK 0x3
+
+__CREATE_STRUCT_KILLFAIL(SnapshotMailbox) CreateSnapshotMailbox(void)
+{
+    SnapshotMailbox* mailbox =
+        __MALLOC(SnapshotMailbox, mailbox,
+                 ("Failed to allocate the snapshot mailbox. Code: "
+                  "%d.",
+                  errno));
+    memset(mailbox, 0, sizeof(SnapshotMailbox));
+
+    for (u8 slot = 0; slot < 3; slot++)
+    {
+        DrawSnapshot* snapshot = &mailbox->snapshots[slot];
+        snapshot->sprites =
+            malloc(sizeof(SpriteCommand) * SNAPSHOT_DEFAULT_CAPACITY);
+        if (snapshot->sprites == NULL)
+            PrintError("Failed to allocate a snapshot's sprites. "
+                       "Code: %d.",
+                       errno);
+        snapshot->sprite_capacity = SNAPSHOT_DEFAULT_CAPACITY;
+    }
+
+    mailbox->back = 0;
+    atomic_init(&mailbox->ready, 1);
+    mailbox->front = 2;
+    atomic_init(&mailbox->published, 0);
+    atomic_init(&mailbox->skipped, 0);
+    PrintSuccess("Created the snapshot mailbox: %d bytes.",
+                 sizeof(SnapshotMailbox) +
+                     sizeof(SpriteCommand) *
+                         SNAPSHOT_DEFAULT_CAPACITY * 3);
+    return mailbox;
+}
+
+void KillSnapshotMailbox(SnapshotMailbox* mailbox)
+{
+    PrintSuccess("Freed the snapshot mailbox (%lu published, %lu "
+                 "never drawn).",
+                 atomic_load(&mailbox->published),
+                 atomic_load(&mailbox->skipped));
+    for (u8 slot = 0; slot < 3; slot++)
+        free(mailbox->snapshots[slot].sprites);
+    __FREE(mailbox,
+           ("The snapshot mailbox freer was given an invalid "
+            "mailbox."));
+}
+
+__GET_STRUCT(SpriteCommand) PushSpriteCommand(DrawSnapshot* snapshot)
+{
+    if (snapshot->sprite_count == snapshot->sprite_capacity)
+    {
+        snapshot->sprite_capacity *= 2;
+        snapshot->sprites =
+            realloc(snapshot->sprites, sizeof(SpriteCommand) *
+                                           snapshot->sprite_capacity);
+        if (snapshot->sprites == NULL)
+            PrintError("Failed to grow a snapshot to %d sprites. "
+                       "Code: %d.",
+                       snapshot->sprite_capacity, errno);
+    }
+    return &snapshot->sprites[snapshot->sprite_count++];
+}
+
+void PublishSnapshot(SnapshotMailbox* mailbox)
+{
+    // The release orders everything written into the snapshot before
+    // the swap, and the acquire makes the slot handed back safe to
+    // write into.
+    const u8 previous =
+        atomic_exchange_explicit(&mailbox->ready,
+                                 mailbox->back | SNAPSHOT_FRESH,
+                                 memory_order_acq_rel);
+    mailbox->back = previous & __SLOT_MASK;
+    atomic_fetch_add_explicit(&mailbox->published, 1,
+                              memory_order_relaxed);
+    if (previous & SNAPSHOT_FRESH)
+        atomic_fetch_add_explicit(&mailbox->skipped, 1,
+                                  memory_order_relaxed);
+}
+
+__GET_STRUCT(DrawSnapshot) AcquireSnapshot(SnapshotMailbox* mailbox)
+{
+    if (atomic_load_explicit(&mailbox->ready, memory_order_relaxed) &
+        SNAPSHOT_FRESH)
+        mailbox->front =
+            atomic_exchange_explicit(&mailbox->ready, mailbox->front,
+                                     memory_order_acq_rel) &
+            __SLOT_MASK;
+    return &mailbox->snapshots[mailbox->front];
+}
@@ -0,0 +1,180 @@
+/**
+ * @file Snapshot.h
+ * @author Zenais Argos
+ * @brief Provides draw snapshots; everything a frame needs to draw
+ * the simulation as of a single tick, copied out of it so that it can
+ * be drawn while the simulation moves on. Snapshots are handed from
+ * the thread taking them to the thread drawing them through a
+ * triple-buffered mailbox, so neither ever waits on the other; the
+ * drawing thread always gets the newest snapshot there is, and the
+ * simulation always has a free one to write into.
+ * @date 2024-07-22
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_SNAPSHOT_
+#define _RENAI_SNAPSHOT_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the camera whose view a snapshot is drawn through.
+#include <Camera.h>
+// Provides the tilemaps whose terrain a snapshot draws.
+#include <Tilemap.h>
+// Provides the textures sprites are drawn from.
+#include <Texture.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The number of sprites a snapshot has room for when it's
+ * created. Snapshots grow as needed, and never shrink.
+ */
+#define SNAPSHOT_DEFAULT_CAPACITY 1024
+
+/**
+ * @brief The bit of a mailbox's ready slot marking it as not having
+ * been taken yet.
+ */
+#define SNAPSHOT_FRESH 0x4
+
+/**
+ * @brief A single sprite to draw, along with where it was as of the
+ * tick before, so it can be blended between the two.
+ */
+typedef struct SpriteCommand
+{
+    /**
+     * @brief The texture the sprite is drawn from. The GPU side of it
+     * is only looked up when it's drawn.
+     */
+    Texture* texture;
+    f32 uv[4];
+    /**
+     * @brief Where the sprite is, and where it was a tick ago.
+     */
+    f32 x, y, previous_x, previous_y;
+    f32 width, height, rotation, brightness;
+    u8 z;
+} SpriteCommand;
+
+/**
+ * @brief Everything needed to draw the simulation as of a single
+ * tick. Once it's been published, nothing about it changes until
+ * it's handed back.
+ */
+typedef struct DrawSnapshot
+{
+    /**
+     * @brief The number of the tick the snapshot was taken after.
+     */
+    u64 tick;
+    /**
+     * @brief When that tick was due, in nanoseconds. Drawing blends
+     * toward the next tick by how long it's been since.
+     */
+    u64 time;
+    /**
+     * @brief The camera, as of the tick.
+     */
+    Camera camera;
+    /**
+     * @brief The terrain to draw, or NULL. Its chunks already live on
+     * the GPU, so only the map itself is needed.
+     */
+    Tilemap* tilemap;
+    /**
+     * @brief The sprites to draw, the number of them, and the number
+     * there's room for.
+     */
+    SpriteCommand* sprites;
+    u32 sprite_count, sprite_capacity;
+} DrawSnapshot;
+
+/**
+ * @brief A triple-buffered mailbox of snapshots. The producer owns
+ * one slot (the back), the consumer owns another (the front), and the
+ * third (the ready slot) is swapped with either of them atomically.
+ */
+typedef struct SnapshotMailbox
+{
+    DrawSnapshot snapshots[3];
+    /**
+     * @brief The index of the ready slot, along with @ref
+     * SNAPSHOT_FRESH if it's been published and not yet taken.
+     */
+    _Atomic u8 ready;
+    /**
+     * @brief The slots owned by the producer and the consumer. Each
+     * is only ever touched by its owner.
+     */
+    u8 back, front;
+    /**
+     * @brief The number of snapshots published, and the number of
+     * them replaced before they were ever taken.
+     */
+    _Atomic u64 published, skipped;
+} SnapshotMailbox;
+
+/**
+ * @brief Create a mailbox of empty snapshots. Kills the process on
+ * failure.
+ * @return A pointer to the created mailbox.
+ */
+__CREATE_STRUCT_KILLFAIL(SnapshotMailbox) CreateSnapshotMailbox(void);
+
+/**
+ * @brief Free the given mailbox, along with every snapshot in it.
+ * @param mailbox The mailbox to kill.
+ */
+void KillSnapshotMailbox(SnapshotMailbox* mailbox);
+
+/**
+ * @brief Empty the given snapshot, keeping the memory it has.
+ * @param snapshot The snapshot to clear.
+ */
+__INLINE void ClearSnapshot(DrawSnapshot* snapshot)
+{
+    snapshot->tilemap = NULL;
+    snapshot->sprite_count = 0;
+}
+
+/**
+ * @brief Make room for another sprite at the end of the given
+ * snapshot. Kills the process on failure.
+ * @param snapshot The snapshot to add to.
+ * @return A pointer to the sprite, to be filled in by the caller.
+ */
+__GET_STRUCT(SpriteCommand) PushSpriteCommand(DrawSnapshot* snapshot);
+
+/**
+ * @brief Get the snapshot the producer should write into next. This
+ * is the producer's to do with as it likes until it's published.
+ * @param mailbox The mailbox.
+ * @return A pointer to the snapshot.
+ */
+__INLINE __GET_STRUCT(DrawSnapshot)
+    GetBackSnapshot(SnapshotMailbox* mailbox)
+{
+    return &mailbox->snapshots[mailbox->back];
+}
+
+/**
+ * @brief Publish the producer's snapshot, replacing whatever was
+ * published before it if it was never taken.
+ * @param mailbox The mailbox.
+ */
+void PublishSnapshot(SnapshotMailbox* mailbox);
+
+/**
+ * @brief Take the newest published snapshot, if there's one the
+ * consumer hasn't seen yet. This never waits.
+ * @param mailbox The mailbox.
+ * @return A pointer to the snapshot the consumer should draw; the
+ * same one as last time if nothing new has been published. It stays
+ * untouched until the next call.
+ */
+__GET_STRUCT(DrawSnapshot) AcquireSnapshot(SnapshotMailbox* mailbox);
+
+#endif // _RENAI_SNAPSHOT_
@@ -0,0 +1,76 @@
+#include "StateCache.h"
+
+/**
+ * @brief What the cache holds for a binding it knows nothing about.
+ * No object is ever given this name.
+ */
+#define __UNKNOWN_STATE UINT32_MAX
+
+/**
+ * @brief What's bound of each kind, as far as the cache knows.
+ */
+static u32 _bound[state_binding_count] = {
+    __UNKNOWN_STATE, __UNKNOWN_STATE, __UNKNOWN_STATE};
+
+/**
+ * @brief The statistics of the current frame.
+ */
+static StateStatistics _state_statistics = {0};
+
+void BeginStateFrame(void)
+{
+    _state_statistics = (StateStatistics){0};
+}
+
+void ResetStateCache(void)
+{
+    for (u8 binding = 0; binding < state_binding_count; binding++)
+        _bound[binding] = __UNKNOWN_STATE;
+}
+
+__BOOLEAN BindState(StateBinding binding, u32 name)
+{
+    if (_bound[binding] == name)
+    {
+        _state_statistics.saved[binding]++;
+        return false;
+    }
+
+    switch (binding)
+    {
+        case state_program:
+            glUseProgram(name);
+            break;
+        case state_texture:
+            glBindTexture(GL_TEXTURE_2D, name);
+            break;
+        case state_vertex_array:
+            glBindVertexArray(name);
+            break;
+        default:
+            return false;
+    }
+    _bound[binding] = name;
+    _state_statistics.changes[binding]++;
+    return true;
+}
+
+void ForgetState(StateBinding binding, u32 name)
+{
+    if (_bound[binding] == name) _bound[binding] = 0;
+}
+
+__GET_STRUCT(const StateStatistics) GetStateStatistics(void)
+{
+    return &_state_statistics;
+}
+
+void SumStateStatistics(u32* changes, u32* saved)
+{
+    *changes = *saved = 0;
+    for (u8 binding = 0; binding < state_binding_count; binding++)
+    {
+        *changes += _state_statistics.changes[binding];
+        *saved += _state_statistics.saved[binding];
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * @file StateCache.h
+ * @author Zenais Argos
+ * @brief Provides the OpenGL state cache. Every bind of a program, a
+ * texture, or a vertex array goes through here, so that binding
+ * whatever's already bound never reaches the driver. Renai only ever
+ * has the one context, and only ever touches it from the main thread,
+ * so the cache is global.
+ * @date 2024-07-23
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_STATE_CACHE_
+#define _RENAI_STATE_CACHE_
+
+// Provides the type definitions and OpenGL headers used in this file.
+#include <Declarations.h>
+
+/**
+ * @brief The kinds of binding the cache keeps track of.
+ */
+typedef enum StateBinding
+{
+    /**
+     * @brief The program in use, set with @ref glUseProgram.
+     */
+    state_program,
+    /**
+     * @brief The 2D texture bound to texture unit 0. Nothing in Renai
+     * samples from any other unit.
+     */
+    state_texture,
+    /**
+     * @brief The bound vertex array, along with the index buffer
+     * bound to it.
+     */
+    state_vertex_array,
+    state_binding_count
+} StateBinding;
+
+/**
+ * @brief Counters of the binds asked of the cache over a single
+ * frame. These are reset every time @ref BeginStateFrame is called.
+ */
+typedef struct StateStatistics
+{
+    /**
+     * @brief The number of binds of each kind that reached the
+     * driver.
+     */
+    u32 changes[state_binding_count];
+    /**
+     * @brief The number of binds of each kind that were skipped,
+     * since what was asked for was already bound.
+     */
+    u32 saved[state_binding_count];
+} StateStatistics;
+
+/**
+ * @brief Start a new frame of statistics.
+ */
+void BeginStateFrame(void);
+
+/**
+ * @brief Forget everything the cache knows about the context, so the
+ * next bind of each kind always reaches the driver. This has to be
+ * called whenever something's been bound behind the cache's back.
+ */
+void ResetStateCache(void);
+
+/**
+ * @brief Bind the given object, unless it's already bound.
+ * @param binding The kind of object to bind.
+ * @param name The name of the object.
+ * @return A boolean value; true if the bind reached the driver.
+ */
+__BOOLEAN BindState(StateBinding binding, u32 name);
+
+/**
+ * @brief Tell the cache the given object is about to be deleted.
+ * OpenGL unbinds deleted objects, and their names are free to be
+ * handed out again, so the cache can't keep thinking it's bound.
+ * @param binding The kind of object being deleted.
+ * @param name The name of the object.
+ */
+void ForgetState(StateBinding binding, u32 name);
+
+/**
+ * @brief Use the given program. Wrapper around @ref BindState.
+ * @param program The program to use.
+ * @return A boolean value; true if the bind reached the driver.
+ */
+__INLINE __BOOLEAN BindProgram(u32 program)
+{
+    return BindState(state_program, program);
+}
+
+/**
+ * @brief Bind the given 2D texture to texture unit 0. Wrapper around
+ * @ref BindState.
+ * @param texture The texture to bind.
+ * @return A boolean value; true if the bind reached the driver.
+ */
+__INLINE __BOOLEAN BindTexture2D(u32 texture)
+{
+    return BindState(state_texture, texture);
+}
+
+/**
+ * @brief Bind the given vertex array. Wrapper around @ref BindState.
+ * @param vao The vertex array to bind.
+ * @return A boolean value; true if the bind reached the driver.
+ */
+__INLINE __BOOLEAN BindVertexArray(u32 vao)
+{
+    return BindState(state_vertex_array, vao);
+}
+
+/**
+ * @brief Get the statistics of the current frame.
+ * @return A pointer to the cache's statistics.
+ */
+__GET_STRUCT(const StateStatistics) GetStateStatistics(void);
+
+/**
+ * @brief Get the total number of binds that reached the driver this
+ * frame, and the total number that were skipped.
+ * @param changes Where to write the number of binds that happened.
+ * @param saved Where to write the number of binds that were skipped.
+ */
+void SumStateStatistics(u32* changes, u32* saved);
+
+#endif // _RENAI_STATE_CACHE_
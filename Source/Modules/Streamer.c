@@ -0,0 +1,299 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_streaming
+#include "Streamer.h"
+#include <Logger.h>
+
+/**
+ * @brief The body of the I/O thread. Requests are read one at a time
+ * until the NULL request telling the thread to stop shows up.
+ * @param data The streamer.
+ * @return Nothing.
+ */
+void* _RunStreamer(void* data)
+{
+    Streamer* streamer = data;
+    StreamRequest* request;
+    while ((request = PopCompletion(streamer->requests, true)) !=
+           NULL)
+    {
+        request->tiles =
+            malloc(sizeof(TileID) * TILEMAP_CHUNK_TILES *
+                   request->map->layer_count);
+        request->read =
+            request->tiles != NULL &&
+            ReadTilemapChunk(request->map, request->chunk,
+                             request->tiles);
+        PushCompletion(streamer->completions, request);
+    }
+    return NULL;
+}
+
+__CREATE_STRUCT_KILLFAIL(Streamer) CreateStreamer(u64 budget)
+{
+    Streamer* streamer = __MALLOC(
+        Streamer, streamer,
+        ("Failed to allocate the streamer. Code: %d.", errno));
+
+    // One extra slot for the request that stops the thread, so
+    // pushing either queue never blocks.
+    streamer->requests =
+        CreateCompletionQueue(STREAM_MAX_PENDING + 1);
+    streamer->completions = CreateCompletionQueue(STREAM_MAX_PENDING);
+    for (u32 index = 0; index < STREAM_MAX_PENDING; index++)
+        streamer->free_requests[index] = &streamer->pool[index];
+    streamer->free_count = STREAM_MAX_PENDING;
+
+    streamer->map = NULL;
+    streamer->resident = NULL;
+    streamer->resident_count = streamer->resident_capacity = 0;
+    streamer->budget = budget;
+    streamer->frame = 0;
+    streamer->total_latency = 0;
+    memset(&streamer->statistics, 0, sizeof(StreamStatistics));
+
+    if (pthread_create(&streamer->thread, NULL, _RunStreamer,
+                       streamer) != 0)
+        PrintError("Failed to spawn the streamer's I/O thread. Code: "
+                   "%d.",
+                   errno);
+
+    PrintSuccess("Created the streamer. Budget: %.1f MB.",
+                 budget / 1048576.0);
+    return streamer;
+}
+
+void KillStreamer(Streamer* streamer)
+{
+    PushCompletion(streamer->requests, NULL);
+    pthread_join(streamer->thread, NULL);
+
+    // Anything the thread finished after the last update is simply
+    // thrown away.
+    StreamRequest* request;
+    while ((request = PopCompletion(streamer->completions, false)) !=
+           NULL)
+        free(request->tiles);
+
+    KillCompletionQueue(streamer->requests);
+    KillCompletionQueue(streamer->completions);
+    free(streamer->resident);
+    __FREE(streamer,
+           ("The streamer freer was given an invalid streamer."));
+    PrintWarning("The streamer was freed.");
+}
+
+/**
+ * @brief Start tracking a chunk the streamer has paged in.
+ * @param streamer The streamer.
+ * @param chunk The index of the chunk.
+ */
+__KILLFAIL _TrackResidentChunk(Streamer* streamer, u32 chunk)
+{
+    if (streamer->resident_count == streamer->resident_capacity)
+    {
+        streamer->resident_capacity =
+            (streamer->resident_capacity == 0
+                 ? 64
+                 : streamer->resident_capacity * 2);
+        streamer->resident =
+            realloc(streamer->resident,
+                    sizeof(u32) * streamer->resident_capacity);
+        if (streamer->resident == NULL)
+            PrintError("Failed to grow the streamer's resident "
+                       "chunks to %d. Code: %d.",
+                       streamer->resident_capacity, errno);
+    }
+    streamer->resident[streamer->resident_count++] = chunk;
+}
+
+/**
+ * @brief Page in every chunk the I/O thread has finished reading.
+ * @param streamer The streamer.
+ */
+__KILLFAIL _CollectStreamedChunks(Streamer* streamer)
+{
+    StreamStatistics* statistics = &streamer->statistics;
+    StreamRequest* request;
+    while ((request = PopCompletion(streamer->completions, false)) !=
+           NULL)
+    {
+        streamer->free_requests[streamer->free_count++] = request;
+        Tilemap* map = request->map;
+
+        // Chunks of a map that's no longer being streamed are left
+        // unloaded, to be requested again if it ever comes back.
+        if (map != streamer->map)
+        {
+            free(request->tiles);
+            map->chunks[request->chunk].state = chunk_unloaded;
+            continue;
+        }
+
+        if (!request->read)
+        {
+            // Page in an empty chunk rather than asking again every
+            // frame.
+            PrintWarning("Failed to read chunk %d of a streamed map. "
+                         "Leaving it empty.",
+                         request->chunk);
+            if (request->tiles == NULL)
+                request->tiles = malloc(sizeof(TileID) *
+                                        TILEMAP_CHUNK_TILES *
+                                        map->layer_count);
+            if (request->tiles == NULL)
+                PrintError("Failed to allocate the tiles of a map "
+                           "chunk. Code: %d.",
+                           errno);
+            memset(request->tiles, 0,
+                   sizeof(TileID) * TILEMAP_CHUNK_TILES *
+                       map->layer_count);
+        }
+
+        PageInTilemapChunk(map, request->chunk, request->tiles);
+        map->chunks[request->chunk].last_seen = streamer->frame;
+        _TrackResidentChunk(streamer, request->chunk);
+
+        const u64 latency = GetCurrentTimeNS() - request->requested;
+        streamer->total_latency += latency;
+        statistics->loads++;
+        statistics->last_latency = latency;
+        statistics->average_latency =
+            streamer->total_latency / statistics->loads;
+        if (latency > statistics->peak_latency)
+            statistics->peak_latency = latency;
+    }
+}
+
+/**
+ * @brief Page out every chunk the streamer has paged in, except for
+ * the ones that have been edited since.
+ * @param streamer The streamer.
+ */
+__INLINE void _DropStreamedChunks(Streamer* streamer)
+{
+    for (u32 index = 0; index < streamer->resident_count; index++)
+        if (streamer->map->chunks[streamer->resident[index]].state ==
+            chunk_resident)
+            PageOutTilemapChunk(streamer->map,
+                                streamer->resident[index]);
+    streamer->resident_count = 0;
+}
+
+/**
+ * @brief Request every unloaded chunk within the given range, and
+ * mark every chunk within it as seen this frame.
+ * @param streamer The streamer.
+ * @param range The chunks; the first column, first row, and one past
+ * the last column and row.
+ */
+__INLINE void _RequestChunkRange(Streamer* streamer,
+                                 const u32 range[4])
+{
+    Tilemap* map = streamer->map;
+    for (u32 row = range[1]; row < range[3]; row++)
+        for (u32 column = range[0]; column < range[2]; column++)
+        {
+            const u32 index = row * map->chunk_columns + column;
+            TilemapChunk* chunk = &map->chunks[index];
+            chunk->last_seen = streamer->frame;
+            if (chunk->state != chunk_unloaded ||
+                streamer->free_count == 0)
+                continue;
+
+            StreamRequest* request =
+                streamer->free_requests[--streamer->free_count];
+            request->map = map;
+            request->chunk = index;
+            request->tiles = NULL;
+            request->read = false;
+            request->requested = GetCurrentTimeNS();
+            chunk->state = chunk_pending;
+            PushCompletion(streamer->requests, request);
+        }
+}
+
+/**
+ * @brief Page out the least recently seen chunks until the map is
+ * within budget, or nothing else can go.
+ * @param streamer The streamer.
+ */
+__INLINE void _EvictStreamedChunks(Streamer* streamer)
+{
+    Tilemap* map = streamer->map;
+    StreamStatistics* statistics = &streamer->statistics;
+
+    u64 resident_bytes = 0;
+    for (u32 index = 0; index < streamer->resident_count; index++)
+        resident_bytes += GetTilemapChunkBytes(
+            map, &map->chunks[streamer->resident[index]]);
+
+    // There are only ever a few hundred resident chunks, so the
+    // oldest is simply searched for each time.
+    while (resident_bytes > streamer->budget)
+    {
+        u32 oldest = UINT32_MAX;
+        for (u32 index = 0; index < streamer->resident_count; index++)
+        {
+            const TilemapChunk* chunk =
+                &map->chunks[streamer->resident[index]];
+            if (chunk->state != chunk_resident ||
+                chunk->last_seen == streamer->frame)
+                continue;
+            if (oldest == UINT32_MAX ||
+                chunk->last_seen <
+                    map->chunks[streamer->resident[oldest]].last_seen)
+                oldest = index;
+        }
+        if (oldest == UINT32_MAX) break;
+
+        const u32 chunk = streamer->resident[oldest];
+        resident_bytes -=
+            GetTilemapChunkBytes(map, &map->chunks[chunk]);
+        PageOutTilemapChunk(map, chunk);
+        streamer->resident[oldest] =
+            streamer->resident[--streamer->resident_count];
+        statistics->evictions++;
+    }
+
+    statistics->resident_bytes = resident_bytes;
+    statistics->resident_chunks = streamer->resident_count;
+    statistics->pending_loads =
+        STREAM_MAX_PENDING - streamer->free_count;
+}
+
+void UpdateStreaming(Streamer* streamer, Tilemap* map,
+                     const f32 view[4])
+{
+    streamer->frame++;
+    _CollectStreamedChunks(streamer);
+
+    if (map != NULL && map->stream == -1) map = NULL;
+    if (map != streamer->map)
+    {
+        if (streamer->map != NULL) _DropStreamedChunks(streamer);
+        streamer->map = map;
+        streamer->total_latency = 0;
+        // Requests still in flight for the old map are dropped as
+        // they come back.
+        memset(&streamer->statistics, 0, sizeof(StreamStatistics));
+    }
+    if (map == NULL) return;
+
+    // Whatever's on screen is asked for first, so it's never stuck
+    // behind the chunks being read ahead.
+    u32 range[4];
+    GetTilemapChunkRange(map, view, range);
+    _RequestChunkRange(streamer, range);
+
+    const f32 reach =
+        STREAM_PREFETCH_CHUNKS * TILEMAP_CHUNK_SIZE * map->tile_size;
+    GetTilemapChunkRange(map,
+                         (f32[4]){view[0] - reach, view[1] - reach,
+                                  view[2] + reach * 2.0f,
+                                  view[3] + reach * 2.0f},
+                         range);
+    _RequestChunkRange(streamer, range);
+
+    _EvictStreamedChunks(streamer);
+}
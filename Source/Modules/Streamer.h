@@ -0,0 +1,202 @@
+/**
+ * @file Streamer.h
+ * @author Zenais Argos
+ * @brief Provides the streamer; what pages the chunks of the current
+ * scene's map in and out around the camera. Chunks are read on a
+ * dedicated I/O thread, so a slow disk never holds up a frame, and
+ * the chunks that have gone unseen the longest are paged back out
+ * whenever the map grows past its memory budget.
+ * @date 2024-07-15
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_STREAMER_
+#define _RENAI_STREAMER_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the completion queues requests are passed along through.
+#include <Jobs.h>
+// Provides the maps whose chunks are streamed.
+#include <Tilemap.h>
+
+/**
+ * @brief The default memory budget of a streamer, in bytes.
+ */
+#define STREAM_DEFAULT_BUDGET (32 * 1024 * 1024)
+
+/**
+ * @brief How many chunks past the edge of the screen are read ahead
+ * of time, so they're already resident by the time they scroll into
+ * view.
+ */
+#define STREAM_PREFETCH_CHUNKS 2
+
+/**
+ * @brief The most chunks that can be waiting on the I/O thread at
+ * once. Anything past this is requested on a later frame.
+ */
+#define STREAM_MAX_PENDING 64
+
+/**
+ * @brief The streaming statistics of the current map.
+ */
+typedef struct StreamStatistics
+{
+    /**
+     * @brief The memory taken up by the map's resident chunks, and
+     * the number of them.
+     */
+    u64 resident_bytes;
+    u32 resident_chunks;
+    /**
+     * @brief The number of chunks waiting on the I/O thread.
+     */
+    u32 pending_loads;
+    /**
+     * @brief The number of chunks paged in and out since the map
+     * started streaming.
+     */
+    u32 loads, evictions;
+    /**
+     * @brief How long it took from requesting a chunk to it being
+     * resident; for the last chunk, on average, and at worst, in
+     * nanoseconds.
+     */
+    u64 last_latency, average_latency, peak_latency;
+} StreamStatistics;
+
+/**
+ * @brief A single chunk read, handed to the I/O thread and back.
+ */
+typedef struct StreamRequest
+{
+    /**
+     * @brief The map the chunk belongs to.
+     */
+    Tilemap* map;
+    /**
+     * @brief The index of the chunk.
+     */
+    u32 chunk;
+    /**
+     * @brief The chunk's tiles, filled in by the I/O thread.
+     */
+    TileID* tiles;
+    /**
+     * @brief Whether or not the I/O thread managed to read the
+     * chunk.
+     */
+    bool read;
+    /**
+     * @brief When the chunk was requested, in nanoseconds.
+     */
+    u64 requested;
+} StreamRequest;
+
+/**
+ * @brief The streamer.
+ */
+typedef struct Streamer
+{
+    /**
+     * @brief The I/O thread.
+     */
+    pthread_t thread;
+    /**
+     * @brief The chunks waiting to be read, and the chunks the I/O
+     * thread has finished with.
+     */
+    CompletionQueue *requests, *completions;
+    /**
+     * @brief Every request the streamer can have in flight, and the
+     * ones that aren't currently in use.
+     */
+    StreamRequest pool[STREAM_MAX_PENDING];
+    StreamRequest* free_requests[STREAM_MAX_PENDING];
+    u32 free_count;
+    /**
+     * @brief The map currently being streamed, or NULL.
+     */
+    Tilemap* map;
+    /**
+     * @brief The indices of every chunk of the map the streamer has
+     * paged in.
+     */
+    u32* resident;
+    u32 resident_count, resident_capacity;
+    /**
+     * @brief The most memory the map's chunks should take up, in
+     * bytes. Chunks near the camera are never paged out, so a budget
+     * too small to hold them is simply overrun.
+     */
+    u64 budget;
+    /**
+     * @brief The number of frames the streamer has been updated for.
+     */
+    u32 frame;
+    /**
+     * @brief The sum of every load's latency, used for the average.
+     */
+    u64 total_latency;
+    /**
+     * @brief The streaming statistics of the current map.
+     */
+    StreamStatistics statistics;
+} Streamer;
+
+/**
+ * @brief Create a streamer and spawn its I/O thread. Kills the
+ * process on failure.
+ * @param budget The memory budget of streamed maps, in bytes.
+ * @return A pointer to the created streamer.
+ */
+__CREATE_STRUCT_KILLFAIL(Streamer) CreateStreamer(u64 budget);
+
+/**
+ * @brief Stop and join the streamer's I/O thread, and free it. This
+ * has to happen before any streamed map is killed.
+ * @param streamer The streamer to kill.
+ */
+void KillStreamer(Streamer* streamer);
+
+/**
+ * @brief Change the streamer's memory budget. Chunks past the new
+ * budget are paged out on the next update.
+ * @param streamer The streamer to affect.
+ * @param budget The new budget, in bytes.
+ */
+__INLINE void SetStreamingBudget(Streamer* streamer, u64 budget)
+{
+    streamer->budget = budget;
+}
+
+/**
+ * @brief Stream the given map for a single frame; page in the chunks
+ * the I/O thread has finished, request the chunks in and around the
+ * view that aren't resident, and page out the least recently seen
+ * chunks while the map is over budget. Switching maps pages out
+ * every chunk of the last one. This must be called from the thread
+ * owning the OpenGL context.
+ * @param streamer The streamer to update.
+ * @param map The map to stream, or NULL if there is none. Maps that
+ * aren't streamed are ignored.
+ * @param view The area on screen; its X, Y, width, and height.
+ */
+void UpdateStreaming(Streamer* streamer, Tilemap* map,
+                     const f32 view[4]);
+
+/**
+ * @brief Get the streaming statistics of the current map.
+ * @param streamer The streamer to query.
+ * @return A pointer to the streamer's statistics.
+ */
+__INLINE __GET_STRUCT(StreamStatistics)
+    GetStreamingStatistics(Streamer* streamer)
+{
+    return &streamer->statistics;
+}
+
+#endif // _RENAI_STREAMER_
@@ -1,85 +1,47 @@
 #include "Updater.h"
 #include <Logger.h>
+#include <Profiler.h>
 
 /**
- * @brief Transforms a GLFW key code into a compressed key value to be
- * used in the keyboard cooldown buffer.
- * @param key The key to be transformed.
- * @return The key number in the keyboard cooldown map the key
- * corresponds to (0-20).
+ * @brief The delay, in milliseconds, between repeats of the camera
+ * actions while they're held.
  */
-__INLINE u8 _GetKeyCode(i32 key)
-{
-    // For the sake of simplicity and conciseness, this is simply an
-    // if statement. The values are all self-explanatory.
-    return (key >= 290   ? key - 281 // Function keys (f1 - f12)
-            : key >= 262 ? key - 257 // Arrow keys
-            : key == GLFW_KEY_ESCAPE       ? 4
-            : key == GLFW_KEY_BACKSLASH    ? 3
-            : key == GLFW_KEY_GRAVE_ACCENT ? 2
-            : key == GLFW_KEY_EQUAL        ? 1
-            : key == GLFW_KEY_MINUS        ? 0
-                                           : 0);
-}
+#define __KEY_DELAY_MS 100
 
 /**
- * @brief The delay, in milliseconds, each control key has to endure
- * before their callback can be triggered again.
+ * @brief How far, in screen units, each press of an arrow key pans
+ * the camera.
  */
-#define __KEY_DELAY_MS 100
+#define __CAMERA_PAN_STEP 64.0f
 
 /**
- * @brief Handle the given control key. This function should only be
- * called for the 21 keys that need a cooldown.
- * @param updater The updater to use for the operation.
- * @param key The key pressed.
- * @return A boolean value representing what should be done with the
- * key's callback. True for call, false for wait.
+ * @brief What each press of the zoom keys scales the camera's zoom
+ * by.
  */
-__BOOLEAN _HandleKey(Updater* updater, i32 key)
-{
-    i64 current_time = GetCurrentTime();
-    // Translate the GLFW input key into the one we'll use within the
-    // cooldown buffer.
-    u8 key_number = _GetKeyCode(key);
-    void* stored_value =
-        GetMapItemValue(updater->key_buffer, key_number);
-
-    if (stored_value == NULL)
-    {
-        AppendMapItem(updater->key_buffer, key_number, current_time);
-        return true;
-    }
-
-    // If the key's already been hit, check to see if the proper
-    // amount of time has past, and reset the time limit and trigger
-    // its callback if it has.
-    if (current_time - VPTT(i64, stored_value) > __KEY_DELAY_MS)
-    {
-        EditMapValue(updater->key_buffer, unsigned8, TTVP(key_number),
-                     signed64, TTVP(current_time));
-        return true;
-    }
-
-    return false;
-}
+#define __CAMERA_ZOOM_STEP 1.25f
 
 __CREATE_STRUCT(Updater)
-CreateUpdater(u8 tick_speed)
+CreateUpdater(u8 tick_speed, Window* window, Camera* camera)
 {
     Updater* updater =
         __MALLOC(Updater, updater,
                  ("Failed to allocate space for the application's "
                   "allocater. Code: %d.",
                   errno));
+    // The simulation's step is a fraction of a second, so a tick
+    // speed of 0 would never step at all.
+    if (tick_speed == 0)
+        PrintError("Tried to create an updater with a tick speed of "
+                   "0.");
     PrintSuccess(
         "Allocated space for the application's updater: %d bytes.",
         sizeof(Updater));
 
-    // We only need 21 cooldown characters, each one is a keyboard
-    // shortcut of some kind.
-    updater->key_buffer = CreateMap(unsigned8, signed64, 21);
+    updater->input = CreateInput(GetInnerWindow(window));
+    updater->window = window;
+    updater->camera = camera;
     updater->tick_speed = tick_speed;
+    atomic_init(&updater->requests, 0);
 
     PrintSuccess("Created the application's updater successfully. "
                  "Tick speed: %d o/s",
@@ -87,32 +49,56 @@ CreateUpdater(u8 tick_speed)
     return updater;
 }
 
-void HandleInput(Updater* updater, Window* key_window, f32 delta_time,
-                 i32 key)
+void HandleInput(Updater* updater)
 {
-    // We use a switch here both to properly carry out the
-    // functionality of control keys and filter out any non-control
-    // keys from this first flow.
-    switch (key)
-    {
-        case GLFW_KEY_F11:
-            if (_HandleKey(updater, GLFW_KEY_F11))
-                ToggleMaximizeWindow(key_window);
-            return;
-        case GLFW_KEY_F12:
-            if (_HandleKey(updater, GLFW_KEY_F12))
-                CloseWindow(key_window);
-            return;
-        case GLFW_KEY_BACKSLASH:
-            if (_HandleKey(updater, GLFW_KEY_BACKSLASH))
-                ToggleFullscreenWindow(key_window);
-            return;
-        default: break;
-    }
+    Input* input = updater->input;
+    ProcessInput(input);
+
+    // The profiler and the window both belong to the main thread.
+    const u32 requested = input->actions_pressed &
+                          (1 << action_dump_trace |
+                           1 << action_maximize | 1 << action_close |
+                           1 << action_fullscreen);
+    if (requested != 0)
+        atomic_fetch_or(&updater->requests, requested);
+
+    // The camera keeps moving for as long as its actions are held,
+    // a step every so many ticks. This rounds up, so slow tick speeds
+    // still step at most once a delay, and never every zero ticks.
+    const u32 interval =
+        (updater->tick_speed * __KEY_DELAY_MS + 999) / 1000;
+    Camera* camera = updater->camera;
+    if (IsActionRepeated(input, action_pan_left, interval))
+        PanCamera(camera, -__CAMERA_PAN_STEP, 0.0f);
+    if (IsActionRepeated(input, action_pan_right, interval))
+        PanCamera(camera, __CAMERA_PAN_STEP, 0.0f);
+    if (IsActionRepeated(input, action_pan_up, interval))
+        PanCamera(camera, 0.0f, -__CAMERA_PAN_STEP);
+    if (IsActionRepeated(input, action_pan_down, interval))
+        PanCamera(camera, 0.0f, __CAMERA_PAN_STEP);
+    if (IsActionRepeated(input, action_zoom_in, interval))
+        ZoomCamera(camera, __CAMERA_ZOOM_STEP);
+    if (IsActionRepeated(input, action_zoom_out, interval))
+        ZoomCamera(camera, 1.0f / __CAMERA_ZOOM_STEP);
+}
+
+void HandleWindowRequests(Updater* updater)
+{
+    const u32 requests = atomic_exchange(&updater->requests, 0);
+    if (requests == 0) return;
+
+    if (requests & 1 << action_dump_trace)
+        DumpProfilerTrace(PROFILER_TRACE_PATH);
+    if (requests & 1 << action_maximize)
+        ToggleMaximizeWindow(updater->window);
+    if (requests & 1 << action_close) CloseWindow(updater->window);
+    if (requests & 1 << action_fullscreen)
+        ToggleFullscreenWindow(updater->window);
 }
 
-void UpdateWindowContent(Updater* updater, f32 delta_time)
+void UpdateWindowContent(Updater* updater, SceneManager* manager,
+                         f64 tick_length)
 {
-    // There is nothing to update at this point in time, so this
-    // function will remain empty for now.
+    HandleInput(updater);
+    UpdateCurrentScene(manager, tick_length);
 }
@@ -14,12 +14,16 @@
 // This is used for its type definitions and utility macros in this
 // file.
 #include <Declarations.h>
-// This is needed to properly store key-value pairs in the renderer's
-// keybuffer.
-#include <Map.h>
+// Provides the input system whose actions the updater carries out.
+#include <Input.h>
+// Provides the scene manager, whose current scene is what's updated.
+#include <Manager.h>
 // We use helper functions from this file to handle window-related
 // control shortcuts.
 #include <Window.h>
+// Provides the camera the arrow and zoom keys move around.
+#include <Camera.h>
+#include <stdatomic.h>
 
 /**
  * @brief A structure to hold the data relevant to updating a window
@@ -39,21 +43,39 @@ typedef struct Updater
      */
     u8 tick_speed;
     /**
-     * @brief A buffer to hold each key that has been pressed in the
-     * last 100 milliseconds, each awaiting their turn to be pressed
-     * again. There are only 21 items in this map, because only 21
-     * keys do a function in-game.
+     * @brief The input system, whose events are processed at the
+     * start of every tick.
      */
-    Map* key_buffer;
+    Input* input;
+    /**
+     * @brief The window acted upon by window-related actions, like
+     * maximizing.
+     */
+    Window* window;
+    /**
+     * @brief The camera panned and zoomed by the camera actions.
+     */
+    Camera* camera;
+    /**
+     * @brief One bit per action that's fired since the main thread
+     * last looked. Ticks may run on their own thread, but windows can
+     * only be touched from the main one, so actions that do are left
+     * here for it to carry out.
+     */
+    _Atomic u32 requests;
 } Updater;
 
 /**
- * @brief Create an updater object.
+ * @brief Create an updater object, along with the input system that
+ * records the given window's events. Kills the process if the tick
+ * speed is 0.
  * @param tick_speed The updater's default tickspeed.
+ * @param window The window whose input to handle.
+ * @param camera The camera moved by the player.
  * @return A pointer to the object just created.
  */
 __CREATE_STRUCT(Updater)
-CreateUpdater(u8 tick_speed);
+CreateUpdater(u8 tick_speed, Window* window, Camera* camera);
 
 /**
  * @brief Kill the updater. This frees all resources related to the
@@ -62,7 +84,7 @@ CreateUpdater(u8 tick_speed);
  */
 __INLINE void KillUpdater(Updater* updater)
 {
-    KillMap(updater->key_buffer);
+    KillInput(updater->input);
     __FREE(updater,
            ("The updater freer was given an invalid texture."));
     PrintWarning("The updater was freed.");
@@ -70,28 +92,35 @@ __INLINE void KillUpdater(Updater* updater)
 
 /**
  * @brief This is a kind of dedicated subfunction for @ref
- * UpdateWindowContent, but for keys pressed by the user. This is a
- * separate function because running it every frame is a waste,
- * instead only calling it via GLFW's @ref keycallback is more
- * efficient.
+ * UpdateWindowContent, but for the user's input. Everything recorded
+ * since the last tick is processed at once, and then every action
+ * that fired is carried out, or left for the main thread if it
+ * touches the window.
  * @param updater The updater to use for this process.
- * @param window The window we will be operating on for keybinds like
- * maximization, etc.
- * @param delta_time The difference in processing time between last
- * frame and this one, to be used in speed normalization.
- * @param key The key pressed.
  */
-void HandleInput(Updater* updater, Window* window, f32 delta_time,
-                 i32 key);
+void HandleInput(Updater* updater);
+
+/**
+ * @brief Carry out every action left for the main thread since it
+ * last looked; maximizing, closing, and fullscreening the window,
+ * and dumping the profiler's trace. This has to be called from the
+ * main thread.
+ * @param updater The updater whose actions to carry out.
+ */
+void HandleWindowRequests(Updater* updater);
 
 /**
  * @brief Similar to the @ref RenderWindowContent function, this
  * updates a window's contents, moving NPC, swapping animation frames,
- * etc.
+ * etc. This is called at a fixed rate, @ref Updater::tick_speed
+ * times a second, no matter the framerate, on the simulation's
+ * thread.
  * @param updater The updater to use for the process.
- * @param delta_time The difference in processing time between last
- * frame and this one, to be used in speed normalization.
+ * @param manager The scene manager whose current scene to update.
+ * @param tick_length The length of a single tick, in seconds. This is
+ * the same every call.
  */
-void UpdateWindowContent(Updater* updater, f32 delta_time);
+void UpdateWindowContent(Updater* updater, SceneManager* manager,
+                         f64 tick_length);
 
 #endif // _RENAI_UPDATER
@@ -44,6 +44,19 @@ CreateWindow(i32 width, i32 height)
     // whatever TITLE is defined as, bordered, and primary-monitored.
     window->inner_window =
         glfwCreateWindow(width, height, TITLE, NULL, NULL);
+    // Not every driver offers EGL without a display, but OSMesa
+    // renders on the CPU regardless, so headless runs fall back to
+    // it.
+    if (GetInnerWindow(window) == NULL &&
+        glfwGetPlatform() == GLFW_PLATFORM_NULL)
+    {
+        PrintWarning("Failed to create an EGL context. Trying "
+                     "OSMesa.");
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API,
+                       GLFW_OSMESA_CONTEXT_API);
+        window->inner_window =
+            glfwCreateWindow(width, height, TITLE, NULL, NULL);
+    }
     if (GetInnerWindow(window) == NULL) PollGLFWErrors();
     PrintSuccess("Created the window with title '%s' successfully.",
                  TITLE);
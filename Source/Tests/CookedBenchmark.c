@@ -0,0 +1,533 @@
+/**
+ * @file CookedBenchmark.c
+ * @author Zenais Argos
+ * @brief Generates a tileset of 500 distinct 64x64 PNG tiles, cooks
+ * it, then compares loading it through @ref LoadCookedAtlas against
+ * the decode path a scene falls back on; decoding every image on the
+ * job system, packing them, and letting the driver build the mipmaps.
+ * Both paths upload to a real (headless) context, and the growth of
+ * the process' resident memory over a first load of each, once
+ * loaded and at its peak, is reported alongside their times. The
+ * tiles are stored uncompressed, so decoding them is cheaper than
+ * decoding real art, and the decode path only looks better for it.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Cooked.h>
+#include <Jobs.h>
+#include <Libraries.h>
+#include <Window.h>
+#include <stbi/stb_image.h>
+#include <unistd.h>
+
+/**
+ * @brief Where the tileset is cooked to. This is removed once the
+ * benchmark's done.
+ */
+#define __COOKED_PATH "./CookedBenchmark.cooked"
+
+/**
+ * @brief The number of tiles in the tileset, and the width and height
+ * of every one of them.
+ */
+#define __TILE_COUNT 500
+#define __TILE_SIZE 64
+
+/**
+ * @brief The size of the window textures are sized against, and of
+ * the headless framebuffer.
+ */
+#define __WINDOW_SIZE 256
+
+/**
+ * @brief The number of times each path is timed. The best of these is
+ * reported.
+ */
+#define __ROUNDS 5
+
+/**
+ * @brief A single tile of the tileset, encoded and decoded.
+ */
+typedef struct _BenchmarkTile
+{
+    Job job;
+    char name[16];
+    u8* image;
+    u64 image_size;
+    u8* pixels;
+    i32 width, height;
+    CompletionQueue* completed;
+} _BenchmarkTile;
+
+/**
+ * @brief Get the CRC of the given bytes, the way PNG chunks are
+ * checked.
+ */
+u32 _GetCRC(const u8* data, u64 size, u32 crc)
+{
+    crc = ~crc;
+    for (u64 index = 0; index < size; index++)
+    {
+        crc ^= data[index];
+        for (u8 bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Write a big endian 32-bit value.
+ */
+__INLINE void _WriteBig32(u8* destination, u32 value)
+{
+    destination[0] = value >> 24;
+    destination[1] = value >> 16;
+    destination[2] = value >> 8;
+    destination[3] = value;
+}
+
+/**
+ * @brief Append a PNG chunk to the given image.
+ * @param cursor Where to write the chunk.
+ * @param type The four character type of the chunk.
+ * @param data The contents of the chunk.
+ * @param size The size of the contents, in bytes.
+ * @return Where the next chunk goes.
+ */
+u8* _WriteChunk(u8* cursor, const char* type, const u8* data,
+                u32 size)
+{
+    _WriteBig32(cursor, size);
+    memcpy(cursor + 4, type, 4);
+    memcpy(cursor + 8, data, size);
+    _WriteBig32(cursor + 8 + size, _GetCRC(cursor + 4, size + 4, 0));
+    return cursor + 12 + size;
+}
+
+/**
+ * @brief Encode an RGBA8 tile as a PNG, its rows unfiltered and
+ * deflated into a single stored block.
+ * @param tile The tile to encode into.
+ * @param pixels The pixels of the tile.
+ */
+void _EncodeTile(_BenchmarkTile* tile, const u8* pixels)
+{
+    const u32 row = __TILE_SIZE * 4 + 1,
+              raw_size = row * __TILE_SIZE,
+              deflated_size = raw_size + 11;
+    tile->image = malloc(8 + 25 + 12 + deflated_size + 12);
+    u8* raw = malloc(deflated_size);
+
+    // The zlib header, a single final stored block, the rows each led
+    // by a filter byte of 0, then the Adler-32 of the rows.
+    raw[0] = 0x78;
+    raw[1] = 0x01;
+    raw[2] = 0x01;
+    raw[3] = raw_size & 0xFF;
+    raw[4] = raw_size >> 8;
+    raw[5] = ~raw[3];
+    raw[6] = ~raw[4];
+    for (u32 y = 0; y < __TILE_SIZE; y++)
+    {
+        raw[7 + y * row] = 0;
+        memcpy(raw + 7 + y * row + 1,
+               pixels + (u64)y * __TILE_SIZE * 4, __TILE_SIZE * 4);
+    }
+    u32 low = 1, high = 0;
+    for (u32 index = 0; index < raw_size; index++)
+    {
+        low = (low + raw[7 + index]) % 65521;
+        high = (high + low) % 65521;
+    }
+    _WriteBig32(raw + 7 + raw_size, high << 16 | low);
+
+    u8 header[13] = {0};
+    _WriteBig32(header, __TILE_SIZE);
+    _WriteBig32(header + 4, __TILE_SIZE);
+    header[8] = 8;
+    header[9] = 6;
+
+    u8* cursor = tile->image;
+    memcpy(cursor, "\x89PNG\r\n\x1A\n", 8);
+    cursor = _WriteChunk(cursor + 8, "IHDR", header, 13);
+    cursor = _WriteChunk(cursor, "IDAT", raw, deflated_size);
+    cursor = _WriteChunk(cursor, "IEND", NULL, 0);
+    tile->image_size = cursor - tile->image;
+    free(raw);
+}
+
+/**
+ * @brief Generate every tile of the tileset; a base colour per tile,
+ * with noise over it so no two pages of mipmaps come out flat.
+ */
+void _GenerateTiles(_BenchmarkTile* tiles)
+{
+    u8* pixels = malloc(__TILE_SIZE * __TILE_SIZE * 4);
+    u32 state = 0x2545F491;
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+    {
+        const u32 base = TestRandom(&state);
+        for (u32 pixel = 0; pixel < __TILE_SIZE * __TILE_SIZE;
+             pixel++)
+        {
+            const u32 noise = TestRandom(&state);
+            for (u8 channel = 0; channel < 3; channel++)
+                pixels[pixel * 4 + channel] =
+                    (base >> (channel * 8) & 0xC0) |
+                    (noise >> (channel * 8) & 0x3F);
+            pixels[pixel * 4 + 3] = 0xFF;
+        }
+
+        snprintf(tiles[index].name, sizeof(tiles[index].name),
+                 "tile_%03u.png", index);
+        _EncodeTile(&tiles[index], pixels);
+    }
+    free(pixels);
+}
+
+/**
+ * @brief Decode a single tile on a worker.
+ * @param data The @ref _BenchmarkTile to decode.
+ */
+void _DecodeTile(void* data)
+{
+    _BenchmarkTile* tile = data;
+    i32 channels;
+    tile->pixels = stbi_load_from_memory(
+        tile->image, tile->image_size, &tile->width, &tile->height,
+        &channels, 4);
+    PushCompletion(tile->completed, tile);
+}
+
+/**
+ * @brief Free a texture of the benchmark's registries.
+ */
+void _KillBenchmarkTexture(void* texture) { KillTexture(texture); }
+
+/**
+ * @brief Decode and pack every tile, exactly as a scene without a
+ * cooked atlas does; in file order, whatever order the workers finish
+ * in.
+ * @param jobs The job system to decode on.
+ * @param atlas The atlas to pack into.
+ * @param textures The registry to register every tile within.
+ * @param tiles The tiles to load.
+ */
+void _DecodeTiles(JobSystem* jobs, TextureAtlas* atlas,
+                  Registry* textures, _BenchmarkTile* tiles)
+{
+    CompletionQueue* completed = CreateCompletionQueue(__TILE_COUNT);
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+    {
+        tiles[index].job.function = _DecodeTile;
+        tiles[index].job.data = &tiles[index];
+        tiles[index].pixels = NULL;
+        tiles[index].completed = completed;
+        SubmitJob(jobs, &tiles[index].job);
+    }
+
+    bool decoded[__TILE_COUNT] = {0};
+    u32 next = 0;
+    for (u32 received = 0; received < __TILE_COUNT; received++)
+    {
+        _BenchmarkTile* finished = PopCompletion(completed, true);
+        decoded[finished - tiles] = true;
+        for (; next < __TILE_COUNT && decoded[next]; next++)
+        {
+            _BenchmarkTile* tile = &tiles[next];
+            TEST_CHECK(tile->pixels != NULL, "'%s' failed to decode.",
+                       tile->name);
+            if (tile->pixels == NULL) continue;
+
+            Texture* texture = CreateTextureFromPixels(
+                tile->name, tileset, atlas, NULL, tile->pixels,
+                tile->width, tile->height, __WINDOW_SIZE,
+                __WINDOW_SIZE);
+            stbi_image_free(tile->pixels);
+            RegisterResource(textures, texture->name, texture);
+        }
+    }
+    KillCompletionQueue(completed);
+}
+
+/**
+ * @brief Get one of the memory figures of the process, as the kernel
+ * reports them.
+ * @param field The figure to get, such as "VmRSS:".
+ * @return The figure, in bytes, or 0 if it couldn't be read.
+ */
+u64 _GetMemoryFigure(const char* field)
+{
+    FILE* status = fopen("/proc/self/status", "r");
+    if (status == NULL) return 0;
+
+    char line[128];
+    u64 kilobytes = 0;
+    const u64 field_length = strlen(field);
+    while (fgets(line, sizeof(line), status) != NULL)
+        if (strncmp(line, field, field_length) == 0)
+        {
+            kilobytes = strtoull(line + field_length, NULL, 10);
+            break;
+        }
+    fclose(status);
+    return kilobytes * 1024;
+}
+
+/**
+ * @brief Load the tileset through the cooked atlas, or through the
+ * decode path, waiting for the driver to finish with every upload.
+ * @param cooked Whether to load the cooked atlas.
+ * @param jobs The job system the decode path decodes on.
+ * @param tiles The tiles of the tileset.
+ * @param names The names of the tiles, in order.
+ * @param atlas The atlas to load into.
+ * @param textures The registry to register every tile within.
+ */
+void _LoadTiles(bool cooked, JobSystem* jobs, _BenchmarkTile* tiles,
+                const char** names, TextureAtlas* atlas,
+                Registry* textures)
+{
+    if (cooked)
+        TEST_CHECK(LoadCookedAtlas(__COOKED_PATH, atlas, NULL,
+                                   textures, names, __TILE_COUNT,
+                                   __WINDOW_SIZE, __WINDOW_SIZE),
+                   "The cooked tileset wasn't loaded.");
+    else
+    {
+        _DecodeTiles(jobs, atlas, textures, tiles);
+        UploadTextureAtlas(atlas);
+    }
+    // Uploads can be queued, so wait for the driver to be done with
+    // them.
+    glFinish();
+}
+
+/**
+ * @brief The result of timing a path.
+ */
+typedef struct _PathResult
+{
+    f64 best;
+    u64 video_bytes;
+    u32 pages;
+    f32 uv[__TILE_COUNT][4];
+} _PathResult;
+
+/**
+ * @brief Time loading the tileset through the cooked atlas, or
+ * through the decode path.
+ * @param cooked Whether to load the cooked atlas.
+ * @param jobs The job system the decode path decodes on.
+ * @param tiles The tiles of the tileset.
+ * @param names The names of the tiles, in order.
+ * @param result Where to write how the path went.
+ */
+void _TimePath(bool cooked, JobSystem* jobs, _BenchmarkTile* tiles,
+               const char** names, _PathResult* result)
+{
+    result->best = -1.0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        TextureAtlas* atlas = CreateTextureAtlas(ATLAS_PAGE_SIZE);
+        Registry* textures = CreateRegistry("texture", __TILE_COUNT,
+                                            _KillBenchmarkTexture);
+
+        const u64 start = GetCurrentTimeNS();
+        _LoadTiles(cooked, jobs, tiles, names, atlas, textures);
+        const f64 elapsed = TestElapsedMS(start);
+        if (result->best < 0.0 || elapsed < result->best)
+            result->best = elapsed;
+
+        result->video_bytes = GetAtlasMemory()->resident_bytes;
+        result->pages = atlas->page_count;
+        for (u32 index = 0; index < __TILE_COUNT; index++)
+        {
+            const ResourceHandle handle =
+                FindResource(textures, names[index]);
+            TEST_CHECK(IsHandleValid(textures, handle),
+                       "'%s' wasn't registered.", names[index]);
+            if (!IsHandleValid(textures, handle)) continue;
+            memcpy(result->uv[index],
+                   GetResource(textures, handle, Texture)->uv,
+                   sizeof(f32) * 4);
+        }
+
+        KillRegistry(textures);
+        KillTextureAtlas(atlas);
+    }
+}
+
+/**
+ * @brief Load the tileset once, and report how much the process'
+ * resident memory grew by, both once loaded and at its peak. This is
+ * run in a process of its own for each path, since memory the other
+ * path freed would otherwise be reused, and the peak never resets.
+ * @param cooked Whether to load the cooked atlas.
+ * @param jobs The job system the decode path decodes on.
+ * @param tiles The tiles of the tileset.
+ * @param names The names of the tiles, in order.
+ */
+void _MeasurePath(bool cooked, JobSystem* jobs, _BenchmarkTile* tiles,
+                  const char** names)
+{
+    TextureAtlas* atlas = CreateTextureAtlas(ATLAS_PAGE_SIZE);
+    Registry* textures = CreateRegistry("texture", __TILE_COUNT,
+                                        _KillBenchmarkTexture);
+
+    // Writing 5 here resets the peak to what's resident right now.
+    FILE* clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs != NULL)
+    {
+        fputs("5", clear_refs);
+        fclose(clear_refs);
+    }
+    const u64 resident = _GetMemoryFigure("VmRSS:");
+    _LoadTiles(cooked, jobs, tiles, names, atlas, textures);
+    const u64 loaded = _GetMemoryFigure("VmRSS:"),
+              peak = _GetMemoryFigure("VmHWM:");
+
+    printf("%-8s resident %+6.1f MB once loaded, %+6.1f MB at its "
+           "peak.\n",
+           (cooked ? "Cooked:" : "Decoded:"),
+           ((f64)loaded - resident) / 1048576.0,
+           ((f64)peak - resident) / 1048576.0);
+    KillRegistry(textures);
+    KillTextureAtlas(atlas);
+}
+
+/**
+ * @brief Pack the tileset into an atlas, the way the cooker does, and
+ * cook it.
+ * @param tiles The tiles of the tileset.
+ * @return The size of the cooked atlas, in bytes.
+ */
+u64 _CookTiles(_BenchmarkTile* tiles)
+{
+    TextureAtlas* atlas = CreateTextureAtlas(ATLAS_PAGE_SIZE);
+    Texture** textures = malloc(sizeof(Texture*) * __TILE_COUNT);
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+    {
+        i32 width, height, channels;
+        u8* pixels = stbi_load_from_memory(
+            tiles[index].image, tiles[index].image_size, &width,
+            &height, &channels, 4);
+        textures[index] = CreateTextureFromPixels(
+            tiles[index].name, tileset, atlas, NULL, pixels, width,
+            height, __WINDOW_SIZE, __WINDOW_SIZE);
+        stbi_image_free(pixels);
+    }
+
+    TEST_CHECK(SaveCookedAtlas(__COOKED_PATH, atlas, textures,
+                               __TILE_COUNT),
+               "The tileset couldn't be cooked.");
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+        KillTexture(textures[index]);
+    free(textures);
+    KillTextureAtlas(atlas);
+
+    FILE* cooked = fopen(__COOKED_PATH, "rb");
+    if (cooked == NULL) return 0;
+    fseek(cooked, 0, SEEK_END);
+    const u64 size = ftell(cooked);
+    fclose(cooked);
+    return size;
+}
+
+/**
+ * @brief Measure the memory of both paths, each in a fresh copy of
+ * this process.
+ * @param program The path this process was started from.
+ */
+void _MeasureInChildren(const char* program)
+{
+    const char* paths[2] = {"decoded", "cooked"};
+    for (u8 path = 0; path < 2; path++)
+    {
+        char command[512];
+        snprintf(command, sizeof(command), "'%s' %s", program,
+                 paths[path]);
+        fflush(stdout);
+        TEST_CHECK(system(command) == 0,
+                   "Measuring the %s path's memory failed.",
+                   paths[path]);
+    }
+}
+
+i32 main(i32 argc, char** argv)
+{
+    // Run with the name of a path, the benchmark only measures that
+    // path's memory; this is how it runs itself for each.
+    const bool measuring = (argc == 2);
+
+    InitializeGLFW(true);
+    Window* window = CreateWindow(__WINDOW_SIZE, __WINDOW_SIZE);
+    JobSystem* jobs = CreateJobSystem(0);
+
+    _BenchmarkTile* tiles =
+        calloc(__TILE_COUNT, sizeof(_BenchmarkTile));
+    const char** names = malloc(sizeof(const char*) * __TILE_COUNT);
+    _GenerateTiles(tiles);
+    u64 encoded_size = 0;
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+    {
+        names[index] = tiles[index].name;
+        encoded_size += tiles[index].image_size;
+    }
+
+    if (measuring)
+        _MeasurePath(strcmp(argv[1], "cooked") == 0, jobs, tiles,
+                     names);
+    else
+    {
+        const u64 cooked_size = _CookTiles(tiles);
+        _PathResult* decoded = malloc(sizeof(_PathResult));
+        _PathResult* cooked = malloc(sizeof(_PathResult));
+        _TimePath(false, jobs, tiles, names, decoded);
+        _TimePath(true, jobs, tiles, names, cooked);
+
+        // Cooking packs exactly the way the game does, so every tile
+        // has to land in the same place either way.
+        TEST_CHECK(decoded->pages == cooked->pages,
+                   "The decode path made %u pages, the cooked atlas "
+                   "%u.",
+                   decoded->pages, cooked->pages);
+        TEST_CHECK(
+            memcmp(decoded->uv, cooked->uv, sizeof(decoded->uv)) == 0,
+            "The cooked tiles aren't where the decoded ones are.");
+        TEST_CHECK(decoded->video_bytes == cooked->video_bytes,
+                   "The paths hold %lu and %lu bytes of video "
+                   "memory.",
+                   decoded->video_bytes, cooked->video_bytes);
+
+        printf("%u %ux%u tiles, %.1f MB encoded, %.1f MB cooked, %u "
+               "pages, %.1f MB of video memory.\n",
+               __TILE_COUNT, __TILE_SIZE, __TILE_SIZE,
+               encoded_size / 1048576.0, cooked_size / 1048576.0,
+               cooked->pages, cooked->video_bytes / 1048576.0);
+        printf("Decoded: %8.3f ms (%u workers).\n", decoded->best,
+               jobs->worker_count);
+        printf("Cooked:  %8.3f ms (%.1fx faster).\n", cooked->best,
+               decoded->best /
+                   (cooked->best > 0.0 ? cooked->best : 1.0));
+        _MeasureInChildren(argv[0]);
+
+        unlink(__COOKED_PATH);
+        free(decoded);
+        free(cooked);
+    }
+
+    for (u32 index = 0; index < __TILE_COUNT; index++)
+        free(tiles[index].image);
+    free(tiles);
+    free(names);
+    KillJobSystem(jobs);
+    KillWindow(window);
+    // The children only report their measurements; the parent's the
+    // one that passes or fails.
+    if (measuring) return _test_failures != 0;
+    return FinishTest("CookedBenchmark");
+}
@@ -0,0 +1,177 @@
+/**
+ * @file CullingBenchmark.c
+ * @author Zenais Argos
+ * @brief Fills a large map with 1M sprites and times taking a
+ * snapshot of a view covering 1% of it, against snapshotting every
+ * sprite the way the renderer did before it culled. The world starts
+ * out sized for an ordinary scene, so its spatial grid has to grow
+ * all the way.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Snapshot.h>
+#include <World.h>
+
+/**
+ * @brief The number of sprites on the map.
+ */
+#define __OBJECT_COUNT 1000000
+
+/**
+ * @brief The width and height of the map, and of the view. The view
+ * covers 1% of the map, and both are whole numbers of cells.
+ */
+#define __MAP_SIZE (WORLD_CELL_SIZE * 400.0f)
+#define __VIEW_SIZE (WORLD_CELL_SIZE * 40.0f)
+
+/**
+ * @brief The width and height of every sprite.
+ */
+#define __SPRITE_SIZE 16
+
+/**
+ * @brief The number of times each snapshot is timed. The best of
+ * these is reported.
+ */
+#define __ROUNDS 10
+
+/**
+ * @brief Snapshot every sprite in the world, culling nothing.
+ */
+void _SnapshotEverything(World* world, DrawSnapshot* snapshot)
+{
+    TransformPool* transforms = &world->transforms;
+    SpritePool* sprites = &world->sprites;
+    for (u32 sprite = 0; sprite < sprites->pool.count; sprite++)
+    {
+        const u32 transform = GetComponentIndex(
+            &transforms->pool, sprites->pool.dense[sprite]);
+        if (transform == POOL_EMPTY) continue;
+
+        SpriteCommand* command = PushSpriteCommand(snapshot);
+        command->texture = sprites->texture[sprite];
+        memcpy(command->uv, sprites->uv[sprite], sizeof(command->uv));
+        command->x = transforms->x[transform];
+        command->y = transforms->y[transform];
+        command->previous_x = transforms->previous_x[transform];
+        command->previous_y = transforms->previous_y[transform];
+        command->z = transforms->z[transform];
+        command->width = sprites->width[sprite];
+        command->height = sprites->height[sprite];
+        command->rotation = transforms->rotation[transform];
+        command->brightness = sprites->brightness[sprite];
+    }
+}
+
+/**
+ * @brief Count the sprites that actually overlap the view.
+ */
+u32 _CountVisible(World* world, const f32 view[4])
+{
+    const TransformPool* transforms = &world->transforms;
+    u32 visible = 0;
+    for (u32 index = 0; index < transforms->pool.count; index++)
+        visible += transforms->x[index] + __SPRITE_SIZE > view[0] &&
+                   transforms->x[index] < view[0] + view[2] &&
+                   transforms->y[index] + __SPRITE_SIZE > view[1] &&
+                   transforms->y[index] < view[1] + view[3];
+    return visible;
+}
+
+/**
+ * @brief Count the sprites of a snapshot that overlap the view.
+ */
+u32 _CountSnapshotVisible(const DrawSnapshot* snapshot,
+                          const f32 view[4])
+{
+    u32 visible = 0;
+    for (u32 index = 0; index < snapshot->sprite_count; index++)
+    {
+        const SpriteCommand* command = &snapshot->sprites[index];
+        visible += command->x + command->width > view[0] &&
+                   command->x < view[0] + view[2] &&
+                   command->y + command->height > view[1] &&
+                   command->y < view[1] + view[3];
+    }
+    return visible;
+}
+
+i32 main(void)
+{
+    Texture texture = {0};
+    texture.width = texture.height = __SPRITE_SIZE;
+    texture.uv[2] = texture.uv[3] = 1.0f;
+
+    // Scenes create their worlds expecting about a thousand entities.
+    World* world = CreateWorld(1024);
+    u32 state = 0x1B873593;
+    u64 start = GetCurrentTimeNS();
+    for (u32 index = 0; index < __OBJECT_COUNT; index++)
+    {
+        Entity entity = CreateEntity(world);
+        AddTransform(world, entity,
+                     TestRandomFloat(&state, 0.0f, __MAP_SIZE),
+                     TestRandomFloat(&state, 0.0f, __MAP_SIZE), 0,
+                     1.0f, 0.0f);
+        AddSprite(world, entity, &texture, 1.0f);
+    }
+    printf("Placed %u sprites in %.1f ms; the grid grew to %u "
+           "buckets.\n",
+           __OBJECT_COUNT, TestElapsedMS(start),
+           world->grid->bucket_mask + 1);
+    TEST_CHECK(world->grid->item_count == __OBJECT_COUNT,
+               "The grid holds %u items, not %u.",
+               world->grid->item_count, __OBJECT_COUNT);
+    TEST_CHECK(world->grid->bucket_mask + 1 >= __OBJECT_COUNT,
+               "The grid has %u buckets for %u items.",
+               world->grid->bucket_mask + 1, __OBJECT_COUNT);
+
+    const f32 view[4] = {(__MAP_SIZE - __VIEW_SIZE) / 2.0f,
+                         (__MAP_SIZE - __VIEW_SIZE) / 2.0f,
+                         __VIEW_SIZE, __VIEW_SIZE};
+    const u32 visible = _CountVisible(world, view);
+
+    SnapshotMailbox* mailbox = CreateSnapshotMailbox();
+    DrawSnapshot* snapshot = GetBackSnapshot(mailbox);
+    f64 culled_time = -1.0, everything_time = -1.0;
+    u32 culled_count = 0, everything_count = 0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        ClearSnapshot(snapshot);
+        start = GetCurrentTimeNS();
+        SnapshotWorld(world, snapshot, view);
+        f64 elapsed = TestElapsedMS(start);
+        if (culled_time < 0.0 || elapsed < culled_time)
+            culled_time = elapsed;
+        culled_count = snapshot->sprite_count;
+        TEST_CHECK(_CountSnapshotVisible(snapshot, view) == visible,
+                   "The culled snapshot is missing sprites.");
+
+        ClearSnapshot(snapshot);
+        start = GetCurrentTimeNS();
+        _SnapshotEverything(world, snapshot);
+        elapsed = TestElapsedMS(start);
+        if (everything_time < 0.0 || elapsed < everything_time)
+            everything_time = elapsed;
+        everything_count = snapshot->sprite_count;
+    }
+
+    // The grid works in whole cells, so a little past the view gets
+    // through, but nowhere near everything.
+    TEST_CHECK(culled_count < __OBJECT_COUNT / 50,
+               "The culled snapshot took %u sprites.", culled_count);
+    printf("%u sprites (%.2f%%) are visible.\n", visible,
+           visible * 100.0 / __OBJECT_COUNT);
+    printf("Culled:     %8.3f ms for %7u sprites.\n", culled_time,
+           culled_count);
+    printf("Everything: %8.3f ms for %7u sprites (%.0fx slower).\n",
+           everything_time, everything_count,
+           everything_time / culled_time);
+
+    KillSnapshotMailbox(mailbox);
+    KillWorld(world);
+    return FinishTest("CullingBenchmark");
+}
@@ -0,0 +1,157 @@
+/**
+ * @file DecodeBenchmark.c
+ * @author Zenais Argos
+ * @brief Reports how many images per second the job system decodes
+ * with 1 worker, then 2, and so on up to one per core. Images are
+ * decoded the same way a scene's are while it loads; handed to the
+ * workers, and passed back through a completion queue.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Jobs.h>
+#include <stbi/stb_image.h>
+#include <unistd.h>
+
+/**
+ * @brief The image every decode is of.
+ */
+#define __IMAGE_PATH "./Assets/Tilesets/texture_missing.jpg"
+
+/**
+ * @brief The number of images decoded at each thread count.
+ */
+#define __IMAGE_COUNT 4096
+
+/**
+ * @brief The least number of thread counts measured, even on
+ * machines with fewer cores than this.
+ */
+#define __MINIMUM_THREADS 4
+
+/**
+ * @brief A single image decode, as the scene loader runs them.
+ */
+typedef struct _BenchmarkDecode
+{
+    Job job;
+    const u8* image;
+    u64 image_size;
+    i32 width, height;
+    bool decoded;
+    CompletionQueue* completed;
+} _BenchmarkDecode;
+
+/**
+ * @brief Decode a single image on a worker.
+ * @param data The @ref _BenchmarkDecode to run.
+ */
+void _RunBenchmarkDecode(void* data)
+{
+    _BenchmarkDecode* decode = data;
+    i32 channels;
+    u8* pixels = stbi_load_from_memory(decode->image,
+                                       decode->image_size,
+                                       &decode->width,
+                                       &decode->height, &channels, 4);
+    decode->decoded = (pixels != NULL);
+    stbi_image_free(pixels);
+    PushCompletion(decode->completed, decode);
+}
+
+/**
+ * @brief Read the whole of the benchmark's image into memory.
+ * @param size Where to write the size of the image, in bytes.
+ * @return The image, or NULL if it couldn't be read.
+ */
+u8* _ReadImage(u64* size)
+{
+    FILE* file = fopen(__IMAGE_PATH, "rb");
+    if (file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    rewind(file);
+
+    u8* image = malloc(*size);
+    if (image != NULL && fread(image, 1, *size, file) != *size)
+    {
+        free(image);
+        image = NULL;
+    }
+    fclose(file);
+    return image;
+}
+
+/**
+ * @brief Decode every image with the given number of workers.
+ * @param worker_count The number of workers to decode with.
+ * @param decodes The decodes to run, @ref __IMAGE_COUNT long.
+ * @return The number of images decoded per second.
+ */
+f64 _BenchmarkWorkers(u8 worker_count, _BenchmarkDecode* decodes)
+{
+    JobSystem* jobs = CreateJobSystem(worker_count);
+    CompletionQueue* completed = CreateCompletionQueue(__IMAGE_COUNT);
+
+    const u64 start = GetCurrentTimeNS();
+    for (u32 index = 0; index < __IMAGE_COUNT; index++)
+    {
+        decodes[index].decoded = false;
+        decodes[index].completed = completed;
+        SubmitJob(jobs, &decodes[index].job);
+    }
+
+    u32 decoded = 0;
+    for (u32 received = 0; received < __IMAGE_COUNT; received++)
+    {
+        _BenchmarkDecode* finished = PopCompletion(completed, true);
+        decoded += finished->decoded;
+    }
+    const f64 elapsed = TestElapsedMS(start);
+
+    TEST_CHECK(decoded == __IMAGE_COUNT,
+               "Only %u of %u images decoded with %u workers.",
+               decoded, __IMAGE_COUNT, worker_count);
+    KillCompletionQueue(completed);
+    KillJobSystem(jobs);
+    return __IMAGE_COUNT * 1000.0 / (elapsed > 0.0 ? elapsed : 1.0);
+}
+
+i32 main(void)
+{
+    u64 image_size = 0;
+    u8* image = _ReadImage(&image_size);
+    TEST_CHECK(image != NULL, "Failed to read '%s'.", __IMAGE_PATH);
+    if (image == NULL) return FinishTest("DecodeBenchmark");
+
+    _BenchmarkDecode* decodes =
+        calloc(__IMAGE_COUNT, sizeof(_BenchmarkDecode));
+    for (u32 index = 0; index < __IMAGE_COUNT; index++)
+    {
+        decodes[index].job.function = _RunBenchmarkDecode;
+        decodes[index].job.data = &decodes[index];
+        decodes[index].image = image;
+        decodes[index].image_size = image_size;
+    }
+
+    i64 cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < __MINIMUM_THREADS) cores = __MINIMUM_THREADS;
+    if (cores > JOB_MAX_WORKERS) cores = JOB_MAX_WORKERS;
+
+    f64 single_rate = 0.0;
+    for (u8 workers = 1; workers <= cores; workers++)
+    {
+        const f64 rate = _BenchmarkWorkers(workers, decodes);
+        if (workers == 1) single_rate = rate;
+        printf("%2u threads: %9.0f images/sec (%.2fx).\n", workers,
+               rate, rate / single_rate);
+    }
+    printf("Decoded %u %dx%d images per thread count.\n",
+           __IMAGE_COUNT, decodes[0].width, decodes[0].height);
+
+    free(decodes);
+    free(image);
+    return FinishTest("DecodeBenchmark");
+}
@@ -0,0 +1,220 @@
+/**
+ * @file GeometryTest.c
+ * @author Zenais Argos
+ * @brief Tests every sprite kernel the CPU supports against the
+ * scalar kernel, on random sprites and on rotations right at the
+ * edges of the quadrants the vector kernels reduce angles into. Also
+ * reports how many sprites a microsecond each kernel builds.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Geometry.h>
+#include <math.h>
+
+/**
+ * @brief The number of random sprites built. This is deliberately not
+ * a multiple of four, so the kernels' leftovers are built too.
+ */
+#define __SPRITE_COUNT 100003
+
+/**
+ * @brief The furthest a kernel's corner may be from the scalar
+ * kernel's, in screen units. Sprites are at most 256 units across,
+ * and placed within 4096 units of the origin.
+ */
+#define __POSITION_TOLERANCE 2e-3f
+
+/**
+ * @brief The number of times each kernel builds every sprite while
+ * being timed. The best of these is reported.
+ */
+#define __SPEED_ROUNDS 20
+
+/**
+ * @brief The columns of a run of sprites, owned by the test.
+ */
+typedef struct _SpriteColumns
+{
+    f32 *x, *y, *width, *height, *rotation, *depth, *brightness;
+    f32 (*uv)[4];
+} _SpriteColumns;
+
+/**
+ * @brief Allocate the columns of the given number of sprites, and
+ * point a stream at them.
+ */
+void _CreateColumns(_SpriteColumns* columns, SpriteStream* stream,
+                    u32 count)
+{
+    f32** arrays[7] = {&columns->x,        &columns->y,
+                       &columns->width,    &columns->height,
+                       &columns->rotation, &columns->depth,
+                       &columns->brightness};
+    for (u8 array = 0; array < 7; array++)
+        *arrays[array] = malloc(sizeof(f32) * count);
+    columns->uv = malloc(sizeof(f32[4]) * count);
+
+    *stream = (SpriteStream){columns->x,        columns->y,
+                             columns->width,    columns->height,
+                             columns->rotation, columns->depth,
+                             columns->brightness,
+                             (const f32(*)[4])columns->uv};
+}
+
+/**
+ * @brief Free the columns of a run of sprites.
+ */
+void _KillColumns(_SpriteColumns* columns)
+{
+    f32* arrays[8] = {columns->x,        columns->y,
+                      columns->width,    columns->height,
+                      columns->rotation, columns->depth,
+                      columns->brightness, (f32*)columns->uv};
+    for (u8 array = 0; array < 8; array++) free(arrays[array]);
+}
+
+/**
+ * @brief Fill in random sprites. Every rotation at or next to an odd
+ * multiple of pi/4 (where the vector kernels switch quadrant) within
+ * four turns either way comes first, followed by random ones.
+ */
+void _FillColumns(_SpriteColumns* columns, u32 count)
+{
+    u32 state = 0x3C6EF372, index = 0;
+    for (i32 eighth = -31; eighth <= 31 && index + 3 <= count;
+         eighth += 2)
+    {
+        const f32 edge = eighth * (f32)M_PI / 4.0f;
+        columns->rotation[index++] = nextafterf(edge, edge - 1.0f);
+        columns->rotation[index++] = edge;
+        columns->rotation[index++] = nextafterf(edge, edge + 1.0f);
+    }
+    for (i32 quarter = -16; quarter <= 16 && index < count; quarter++)
+        columns->rotation[index++] = quarter * (f32)M_PI / 2.0f;
+    for (; index < count; index++)
+        columns->rotation[index] = TestRandomFloat(
+            &state, -8.0f * (f32)M_PI, 8.0f * (f32)M_PI);
+
+    for (index = 0; index < count; index++)
+    {
+        columns->x[index] =
+            TestRandomFloat(&state, -4096.0f, 4096.0f);
+        columns->y[index] =
+            TestRandomFloat(&state, -4096.0f, 4096.0f);
+        columns->width[index] =
+            TestRandomFloat(&state, 1.0f, 256.0f);
+        columns->height[index] =
+            TestRandomFloat(&state, 1.0f, 256.0f);
+        columns->depth[index] = TestRandomFloat(&state, -1.0f, 1.0f);
+        columns->brightness[index] =
+            TestRandomFloat(&state, 0.0f, 2.0f);
+        for (u8 corner = 0; corner < 4; corner++)
+            columns->uv[index][corner] =
+                TestRandomFloat(&state, 0.0f, 1.0f);
+    }
+}
+
+/**
+ * @brief Check a kernel's vertices against the scalar kernel's.
+ * Positions may differ by rounding; everything else is copied, so it
+ * has to match exactly.
+ */
+void _CompareVertices(SpriteKernel kernel, const f32* expected,
+                      const f32* actual,
+                      const _SpriteColumns* columns, u32 count)
+{
+    u32 failures = 0;
+    f32 worst = 0.0f;
+    for (u32 sprite = 0; sprite < count; sprite++)
+        for (u8 corner = 0; corner < 4; corner++)
+        {
+            const u64 offset = (u64)sprite * SPRITE_QUAD_FLOATS +
+                               corner * SPRITE_VERTEX_FLOATS;
+            const f32 *want = expected + offset,
+                      *got = actual + offset;
+            const f32 error = fmaxf(fabsf(want[0] - got[0]),
+                                    fabsf(want[1] - got[1]));
+            if (error > worst) worst = error;
+
+            if (error <= __POSITION_TOLERANCE &&
+                memcmp(want + 2, got + 2, sizeof(f32) * 4) == 0)
+                continue;
+            if (failures++ < 8)
+                TEST_CHECK(false,
+                           "%s sprite %u (rotation %.9g) corner %u: "
+                           "(%g, %g) instead of (%g, %g).",
+                           GetSpriteKernelName(kernel), sprite,
+                           columns->rotation[sprite], corner, got[0],
+                           got[1], want[0], want[1]);
+        }
+
+    TEST_CHECK(failures == 0, "%s: %u corners differ in all.",
+               GetSpriteKernelName(kernel), failures);
+    printf("%s matches the scalar kernel; worst corner %.2e units "
+           "off.\n",
+           GetSpriteKernelName(kernel), worst);
+}
+
+/**
+ * @brief Time the current kernel building every sprite.
+ * @return The number of sprites built a microsecond.
+ */
+f64 _TimeKernel(const SpriteStream* stream, f32* vertices, u32 count)
+{
+    f64 best = -1.0;
+    for (u32 round = 0; round < __SPEED_ROUNDS; round++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        BuildSpriteVertices(stream, count, vertices);
+        const f64 elapsed = TestElapsedMS(start);
+        if (best < 0.0 || elapsed < best) best = elapsed;
+    }
+    return count / (best * 1000.0);
+}
+
+i32 main(void)
+{
+    _SpriteColumns columns;
+    SpriteStream stream;
+    _CreateColumns(&columns, &stream, __SPRITE_COUNT);
+    _FillColumns(&columns, __SPRITE_COUNT);
+
+    const u64 vertex_size =
+        sizeof(f32) * SPRITE_QUAD_FLOATS * __SPRITE_COUNT;
+    f32* expected = malloc(vertex_size);
+    f32* actual = malloc(vertex_size);
+
+    SelectSpriteKernel(scalar_kernel);
+    BuildSpriteVertices(&stream, __SPRITE_COUNT, expected);
+    printf("%-8s %7.1f sprites/us.\n",
+           GetSpriteKernelName(scalar_kernel),
+           _TimeKernel(&stream, actual, __SPRITE_COUNT));
+
+    for (SpriteKernel kernel = scalar_kernel + 1;
+         kernel <= sse_kernel; kernel++)
+    {
+        if (!IsSpriteKernelSupported(kernel))
+        {
+            printf("%s isn't supported here; skipped.\n",
+                   GetSpriteKernelName(kernel));
+            continue;
+        }
+
+        SelectSpriteKernel(kernel);
+        memset(actual, 0, vertex_size);
+        BuildSpriteVertices(&stream, __SPRITE_COUNT, actual);
+        _CompareVertices(kernel, expected, actual, &columns,
+                         __SPRITE_COUNT);
+        printf("%-8s %7.1f sprites/us.\n",
+               GetSpriteKernelName(kernel),
+               _TimeKernel(&stream, actual, __SPRITE_COUNT));
+    }
+
+    free(expected);
+    free(actual);
+    _KillColumns(&columns);
+    return FinishTest("GeometryTest");
+}
@@ -0,0 +1,338 @@
+/**
+ * @file InputBenchmark.c
+ * @author Zenais Argos
+ * @brief Reports what each key event costs under a storm of them, at
+ * several events a frame; through the old callback path, which
+ * debounced every control key against a map of when it last fired,
+ * and through the input system, both taking its lock for every event
+ * and handing each poll's events over under a single lock, the way
+ * the game does. The input system's drain is counted against it,
+ * since the old path had none. Also checks that, however full the
+ * ring gets, no press or release is ever lost.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Input.h>
+#include <Libraries.h>
+#include <Map.h>
+#include <math.h>
+#include <Window.h>
+
+/**
+ * @brief The number of events in every run, however they're split
+ * into frames.
+ */
+#define __STORM_EVENTS (1u << 20)
+
+/**
+ * @brief The number of times each path is timed; the best run is the
+ * one reported.
+ */
+#define __RUNS 5
+
+/**
+ * @brief The size of the window the input system is hooked up to.
+ */
+#define __WINDOW_SIZE 64
+
+/**
+ * @brief The delay the old path made each control key wait before it
+ * could fire again, in milliseconds.
+ */
+#define __KEY_DELAY_MS 100
+
+/**
+ * @brief The keys the storm presses; every bound key, along with a
+ * few that aren't bound to anything.
+ */
+static const i32 _storm_keys[] = {
+    GLFW_KEY_F3,    GLFW_KEY_F11,   GLFW_KEY_F12, GLFW_KEY_BACKSLASH,
+    GLFW_KEY_LEFT,  GLFW_KEY_RIGHT, GLFW_KEY_UP,  GLFW_KEY_DOWN,
+    GLFW_KEY_EQUAL, GLFW_KEY_MINUS, GLFW_KEY_A,   GLFW_KEY_S,
+    GLFW_KEY_D,     GLFW_KEY_W,     GLFW_KEY_Q,   GLFW_KEY_E};
+#define __STORM_KEY_COUNT (sizeof(_storm_keys) / sizeof(i32))
+
+/**
+ * @brief A single key event of the storm.
+ */
+typedef struct _StormEvent
+{
+    u8 key, action;
+} _StormEvent;
+
+/**
+ * @brief The number of times a control key fired through the old
+ * path; stands in for the work it would've done.
+ */
+static u32 _fired = 0;
+
+/**
+ * @brief Generate a storm of presses, repeats, and releases. A key
+ * that's up is pressed, and one that's down is either repeated or
+ * released.
+ * @param events Where to write the storm's events.
+ */
+void _GenerateStorm(_StormEvent* events)
+{
+    u32 seed = 0x1A2B3C4D;
+    bool held[__STORM_KEY_COUNT] = {0};
+    for (u32 index = 0; index < __STORM_EVENTS; index++)
+    {
+        const u8 key =
+            TestRandomRange(&seed, 0, __STORM_KEY_COUNT - 1);
+        u8 action = GLFW_PRESS;
+        if (held[key])
+            action = (TestRandom(&seed) % 5 < 2 ? GLFW_REPEAT
+                                                 : GLFW_RELEASE);
+        held[key] = (action != GLFW_RELEASE);
+        events[index] = (_StormEvent){key, action};
+    }
+}
+
+/**
+ * @brief Transforms a GLFW key code into its slot in the old path's
+ * cooldown map, exactly as the old path did.
+ * @param key The key to be transformed.
+ * @return The key's slot in the cooldown map (0-20).
+ */
+__INLINE u8 _GetKeyCode(i32 key)
+{
+    return (key >= 290   ? key - 281
+            : key >= 262 ? key - 257
+            : key == GLFW_KEY_ESCAPE       ? 4
+            : key == GLFW_KEY_BACKSLASH    ? 3
+            : key == GLFW_KEY_GRAVE_ACCENT ? 2
+            : key == GLFW_KEY_EQUAL        ? 1
+            : key == GLFW_KEY_MINUS        ? 0
+                                           : 0);
+}
+
+/**
+ * @brief Debounce a control key against the time it last fired, the
+ * way the old path did.
+ * @param key_buffer The map of when each control key last fired.
+ * @param key The key pressed.
+ * @return A boolean representing whether or not the key fires.
+ */
+__BOOLEAN _HandleKey(Map* key_buffer, i32 key)
+{
+    i64 current_time = GetCurrentTime();
+    u8 key_number = _GetKeyCode(key);
+    void* stored_value = GetMapItemValue(key_buffer, key_number);
+
+    if (stored_value == NULL)
+    {
+        AppendMapItem(key_buffer, key_number, current_time);
+        return true;
+    }
+    if (current_time - VPTT(i64, stored_value) > __KEY_DELAY_MS)
+    {
+        EditMapValue(key_buffer, unsigned8, TTVP(key_number),
+                     signed64, TTVP(current_time));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief The old key callback, which handled each control key as it
+ * came in.
+ * @param key_buffer The map of when each control key last fired.
+ * @param key The key.
+ * @param action The action taken upon the key.
+ */
+void _OldKeyCallback(Map* key_buffer, i32 key, i32 action)
+{
+    if (action == GLFW_RELEASE) return;
+    switch (key)
+    {
+        case GLFW_KEY_F3:
+        case GLFW_KEY_F11:
+        case GLFW_KEY_F12:
+        case GLFW_KEY_BACKSLASH:
+        case GLFW_KEY_LEFT:
+        case GLFW_KEY_RIGHT:
+        case GLFW_KEY_UP:
+        case GLFW_KEY_DOWN:
+        case GLFW_KEY_EQUAL:
+        case GLFW_KEY_MINUS:
+            if (_HandleKey(key_buffer, key)) _fired++;
+            return;
+        default: return;
+    }
+}
+
+/**
+ * @brief The input system's key callback, which only records.
+ * @param key The key.
+ * @param action The action taken upon the key.
+ */
+void _KeyCallback(i32 key, i32 action)
+{
+    if (action == GLFW_REPEAT) return;
+    RecordInputEvent(&(InputEvent){input_button, action == GLFW_PRESS,
+                                   key, 0.0f, 0.0f});
+}
+
+/**
+ * @brief Let go of every key, so each run starts from the same
+ * state.
+ * @param input The input system.
+ */
+void _ResetInput(Input* input)
+{
+    memset(input->held, 0, sizeof(input->held));
+    memset(input->held_ticks, 0, sizeof(input->held_ticks));
+}
+
+/**
+ * @brief Play the storm through the input system, a frame at a time,
+ * draining it after each frame.
+ * @param input The input system.
+ * @param events The storm.
+ * @param per_frame The number of events each frame.
+ * @param batched Whether each frame's events are handed over under
+ * a single lock, or each under its own.
+ * @return How long the storm took, in milliseconds.
+ */
+f64 _RunInput(Input* input, const _StormEvent* events, u32 per_frame,
+              bool batched)
+{
+    _ResetInput(input);
+    const u64 start = GetCurrentTimeNS();
+    for (u32 first = 0; first < __STORM_EVENTS; first += per_frame)
+    {
+        if (batched) BeginInputPoll(input);
+        for (u32 index = first; index < first + per_frame; index++)
+            _KeyCallback(_storm_keys[events[index].key],
+                         events[index].action);
+        if (batched) EndInputPoll(input);
+        ProcessInput(input);
+    }
+    return TestElapsedMS(start);
+}
+
+/**
+ * @brief Play the storm through the old callback path.
+ * @param key_buffer The map of when each control key last fired.
+ * @param events The storm.
+ * @return How long the storm took, in milliseconds.
+ */
+f64 _RunOld(Map* key_buffer, const _StormEvent* events)
+{
+    const u64 start = GetCurrentTimeNS();
+    for (u32 index = 0; index < __STORM_EVENTS; index++)
+        _OldKeyCallback(key_buffer, _storm_keys[events[index].key],
+                        events[index].action);
+    return TestElapsedMS(start);
+}
+
+/**
+ * @brief Play the storm through the input system, a frame at a time,
+ * checking after every frame that each key is down exactly when it
+ * should be, and that each action went down or up exactly when one
+ * of its keys did.
+ * @param input The input system.
+ * @param events The storm.
+ * @param per_frame The number of events each frame.
+ * @return The number of frames where something was lost.
+ */
+u32 _CheckStorm(Input* input, const _StormEvent* events,
+                u32 per_frame)
+{
+    bool held[__STORM_KEY_COUNT] = {0};
+    u32 lost = 0;
+    _ResetInput(input);
+    for (u32 first = 0; first < __STORM_EVENTS; first += per_frame)
+    {
+        u32 pressed = 0, released = 0;
+        BeginInputPoll(input);
+        for (u32 index = first; index < first + per_frame; index++)
+        {
+            const _StormEvent* event = &events[index];
+            _KeyCallback(_storm_keys[event->key], event->action);
+            if (event->action == GLFW_PRESS)
+                pressed |= 1u << event->key;
+            if (event->action == GLFW_RELEASE)
+                released |= 1u << event->key;
+            held[event->key] = (event->action != GLFW_RELEASE);
+        }
+        EndInputPoll(input);
+        ProcessInput(input);
+
+        bool intact = true;
+        for (u8 key = 0; key < __STORM_KEY_COUNT; key++)
+            if (IsInputHeld(input, _storm_keys[key]) != held[key])
+                intact = false;
+        // The first ten keys are bound to the actions, in order.
+        for (u8 action = 0; action < action_count; action++)
+            if (IsActionPressed(input, action) !=
+                    ((pressed >> action) & 1) ||
+                IsActionReleased(input, action) !=
+                    ((released >> action) & 1))
+                intact = false;
+        if (!intact) lost++;
+    }
+    return lost;
+}
+
+/**
+ * @brief Time each path through a storm split into frames of the
+ * given size, and check the input system lost nothing.
+ * @param input The input system.
+ * @param key_buffer The old path's map of when each key last fired.
+ * @param events The storm.
+ * @param per_frame The number of events each frame.
+ */
+void _Benchmark(Input* input, Map* key_buffer,
+                const _StormEvent* events, u32 per_frame)
+{
+    const u64 overflowed = input->statistics.overflowed;
+    const u32 lost = _CheckStorm(input, events, per_frame);
+    const u64 early = input->statistics.overflowed - overflowed;
+    TEST_CHECK(lost == 0,
+               "At %u events a frame, %u of %u frames lost a press "
+               "or release.",
+               per_frame, lost, __STORM_EVENTS / per_frame);
+
+    f64 old = 1e30, locked = 1e30, batched = 1e30;
+    for (u32 run = 0; run < __RUNS; run++)
+    {
+        old = fmin(old, _RunOld(key_buffer, events));
+        locked =
+            fmin(locked, _RunInput(input, events, per_frame, false));
+        batched =
+            fmin(batched, _RunInput(input, events, per_frame, true));
+    }
+    const f64 to_ns = 1e6 / __STORM_EVENTS;
+    printf("%4u events/frame: old %6.1f ns/event, locked each %6.1f "
+           "ns/event, locked each poll %6.1f ns/event (%lu applied "
+           "early).\n",
+           per_frame, old * to_ns, locked * to_ns, batched * to_ns,
+           early);
+}
+
+i32 main(void)
+{
+    InitializeGLFW(true);
+    Window* window = CreateWindow(__WINDOW_SIZE, __WINDOW_SIZE);
+    Input* input = CreateInput(GetInnerWindow(window));
+    Map* key_buffer = CreateMap(unsigned8, signed64, 21);
+
+    _StormEvent* events =
+        malloc(sizeof(_StormEvent) * __STORM_EVENTS);
+    _GenerateStorm(events);
+    _Benchmark(input, key_buffer, events, 16);
+    _Benchmark(input, key_buffer, events, 64);
+    _Benchmark(input, key_buffer, events, 1024);
+    printf("The old path fired %u times.\n", _fired);
+
+    free(events);
+    KillMap(key_buffer);
+    KillInput(input);
+    KillWindow(window);
+    return FinishTest("InputBenchmark");
+}
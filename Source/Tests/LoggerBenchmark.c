@@ -0,0 +1,272 @@
+/**
+ * @file LoggerBenchmark.c
+ * @author Zenais Argos
+ * @brief Reports how many messages a second the logger gets through
+ * from one producer and from several at once, and how long callers
+ * spend logging each message; both in short bursts that fit within
+ * the ring buffer, and in floods that keep it full. Also checks that
+ * nothing is lost or reordered when the ring wraps many times over.
+ * The benchmark logs to a file within a directory of its own, so it
+ * never touches the game's log.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Logger.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/**
+ * @brief The number of threads logging at once in the multi-producer
+ * runs.
+ */
+#define __PRODUCER_COUNT 4
+
+/**
+ * @brief The number of messages logged in a flood, across every
+ * producer.
+ */
+#define __FLOOD_MESSAGES 200000
+
+/**
+ * @brief The number of messages in a burst, and the number of bursts
+ * timed. A burst fits well within the ring buffer.
+ */
+#define __BURST_MESSAGES (LOG_QUEUE_SLOTS / 2)
+#define __BURST_COUNT 64
+
+/**
+ * @brief The number of times over the loss check wraps the ring. It
+ * stays small enough that the log file is never rotated.
+ */
+#define __WRAP_LAPS 16
+
+/**
+ * @brief A thread logging its share of messages.
+ */
+typedef struct _Producer
+{
+    pthread_t thread;
+    u32 index, count;
+    /**
+     * @brief How long each call took, in nanoseconds.
+     */
+    u64* latencies;
+} _Producer;
+
+/**
+ * @brief Log a producer's share of messages, timing each call.
+ * @param data The @ref _Producer to run.
+ * @return Nothing.
+ */
+void* _RunProducer(void* data)
+{
+    _Producer* producer = data;
+    for (u32 message = 0; message < producer->count; message++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        PrintSuccess("Producer %u, message %u, %.3f ms in.",
+                     producer->index, message, start / 1e6);
+        producer->latencies[message] = GetCurrentTimeNS() - start;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compare two latencies, for sorting.
+ */
+i32 _CompareLatencies(const void* first, const void* second)
+{
+    const u64 a = *(const u64*)first, b = *(const u64*)second;
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief Sort the given latencies, and print their median and 99th
+ * percentile.
+ * @param latencies The latencies of every call.
+ * @param count The number of calls.
+ */
+void _ReportLatencies(u64* latencies, u32 count)
+{
+    qsort(latencies, count, sizeof(u64), _CompareLatencies);
+    printf("caller p50 %6lu ns, p99 %8lu ns", latencies[count / 2],
+           latencies[(u64)count * 99 / 100]);
+}
+
+/**
+ * @brief Log the given number of messages split across the given
+ * number of threads, timed until the last of them is written out.
+ * @param producer_count The number of threads logging.
+ * @param message_count The number of messages, across every thread.
+ * @param name What to call the run.
+ */
+void _Flood(u32 producer_count, u32 message_count, const char* name)
+{
+    _Producer producers[__PRODUCER_COUNT];
+    u64* latencies = malloc(sizeof(u64) * message_count);
+    LoggerStatistics before, after;
+    GetLoggerStatistics(&before);
+
+    const u32 share = message_count / producer_count,
+              total = share * producer_count;
+    const u64 start = GetCurrentTimeNS();
+    for (u32 index = 0; index < producer_count; index++)
+    {
+        producers[index] =
+            (_Producer){.index = index,
+                        .count = share,
+                        .latencies = latencies + (u64)index * share};
+        pthread_create(&producers[index].thread, NULL, _RunProducer,
+                       &producers[index]);
+    }
+    for (u32 index = 0; index < producer_count; index++)
+        pthread_join(producers[index].thread, NULL);
+    const f64 logged = TestElapsedMS(start);
+    // Stopping writes out everything that's still queued.
+    StopLogger();
+    const f64 written = TestElapsedMS(start);
+    GetLoggerStatistics(&after);
+
+    TEST_CHECK(after.written - before.written == total,
+               "%s wrote %lu of its %u messages.", name,
+               after.written - before.written, total);
+    printf("%-18s %9.0f msg/s logged, %9.0f msg/s written, ", name,
+           total * 1000.0 / logged, total * 1000.0 / written);
+    _ReportLatencies(latencies, total);
+    printf(", %lu stalls.\n", after.stalls - before.stalls);
+    free(latencies);
+}
+
+/**
+ * @brief Log bursts of messages that fit within the ring buffer,
+ * letting the logger write each out before the next; the way the
+ * game logs, a handful of messages at a time.
+ */
+void _Bursts(void)
+{
+    u64* latencies =
+        malloc(sizeof(u64) * __BURST_MESSAGES * __BURST_COUNT);
+    _Producer producer = {.count = __BURST_MESSAGES};
+    for (u32 burst = 0; burst < __BURST_COUNT; burst++)
+    {
+        producer.latencies = latencies + burst * __BURST_MESSAGES;
+        _RunProducer(&producer);
+        StopLogger();
+    }
+
+    printf("%-18s ", "Bursts (1 thread):");
+    _ReportLatencies(latencies, __BURST_MESSAGES * __BURST_COUNT);
+    printf(".\n");
+    free(latencies);
+}
+
+/**
+ * @brief Wrap the ring buffer many times over from every producer,
+ * then read the log file back, checking that every message of every
+ * producer is there, once, and in the order it was logged.
+ */
+void _CheckWrapping(void)
+{
+    const u32 per_producer =
+        LOG_QUEUE_SLOTS * __WRAP_LAPS / __PRODUCER_COUNT;
+    _Producer producers[__PRODUCER_COUNT];
+    u64* latencies =
+        malloc(sizeof(u64) * per_producer * __PRODUCER_COUNT);
+    LoggerStatistics before, after;
+    GetLoggerStatistics(&before);
+
+    // Start from a fresh file, so it holds exactly this run.
+    StopLogger();
+    unlink(LOG_FILE_PATH);
+    for (u32 index = 0; index < __PRODUCER_COUNT; index++)
+    {
+        producers[index] = (_Producer){
+            .index = index,
+            .count = per_producer,
+            .latencies = latencies + (u64)index * per_producer};
+        pthread_create(&producers[index].thread, NULL, _RunProducer,
+                       &producers[index]);
+    }
+    for (u32 index = 0; index < __PRODUCER_COUNT; index++)
+        pthread_join(producers[index].thread, NULL);
+    StopLogger();
+    GetLoggerStatistics(&after);
+    free(latencies);
+    TEST_CHECK(after.rotations - before.rotations <= 1,
+               "The log was rotated partway through the check.");
+
+    FILE* log = fopen(LOG_FILE_PATH, "r");
+    TEST_CHECK(log != NULL, "The log file wasn't written.");
+    if (log == NULL) return;
+
+    u32 next[__PRODUCER_COUNT] = {0}, out_of_order = 0, foreign = 0;
+    char line[LOG_MESSAGE_LENGTH + 64];
+    while (fgets(line, sizeof(line), log) != NULL)
+    {
+        const char* text = strstr(line, " ] success ");
+        u32 index, message;
+        if (text == NULL ||
+            sscanf(text, " ] success Producer %u, message %u", &index,
+                   &message) != 2 ||
+            index >= __PRODUCER_COUNT)
+        {
+            foreign++;
+            continue;
+        }
+        if (message != next[index]) out_of_order++;
+        next[index] = message + 1;
+    }
+    fclose(log);
+
+    u32 missing = 0;
+    for (u32 index = 0; index < __PRODUCER_COUNT; index++)
+        missing += per_producer - next[index];
+    TEST_CHECK(out_of_order == 0 && missing == 0 && foreign == 0,
+               "Wrapping the ring lost %u messages, reordered %u, "
+               "and mangled %u.",
+               missing, out_of_order, foreign);
+    printf("Wrapped the ring %u times across %u threads; all %u "
+           "messages written in order (%lu stalls).\n",
+           __WRAP_LAPS, __PRODUCER_COUNT,
+           per_producer * __PRODUCER_COUNT,
+           after.stalls - before.stalls);
+}
+
+/**
+ * @brief Remove everything the logger wrote, then the directory it
+ * was written within.
+ * @param directory The directory to remove.
+ */
+void _RemoveLogs(const char* directory)
+{
+    char path[64];
+    unlink(LOG_FILE_PATH);
+    for (u8 index = 1; index <= LOG_FILE_COUNT; index++)
+    {
+        snprintf(path, sizeof(path), LOG_FILE_PATH ".%u", index);
+        unlink(path);
+    }
+    if (chdir("/") == 0) rmdir(directory);
+}
+
+i32 main(void)
+{
+    char directory[] = "/tmp/LoggerBenchmark.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0)
+    {
+        TEST_CHECK(false, "Failed to make a directory to log to.");
+        return FinishTest("LoggerBenchmark");
+    }
+    SetLogOutputs(log_to_file);
+
+    _Bursts();
+    _Flood(1, __FLOOD_MESSAGES, "Flood (1 thread):");
+    _Flood(__PRODUCER_COUNT, __FLOOD_MESSAGES, "Flood (4 threads):");
+    _CheckWrapping();
+
+    _RemoveLogs(directory);
+    return FinishTest("LoggerBenchmark");
+}
@@ -0,0 +1,225 @@
+/**
+ * @file MapTest.c
+ * @author Zenais Argos
+ * @brief Tests the Robin Hood map against a plain array over a long
+ * run of random inserts, lookups and removals, then times it against
+ * the linear scan it replaced at 21, 1k and 1M entries.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Map.h>
+
+/**
+ * @brief The number of distinct keys the random operations are drawn
+ * from. This is kept small so keys are hit again and again.
+ */
+#define __KEY_RANGE 4096
+
+/**
+ * @brief The number of random operations checked.
+ */
+#define __OPERATION_COUNT 200000
+
+/**
+ * @brief The number of slots the linear scan is allowed to visit
+ * while being timed; at 1M entries it's far too slow to do a lookup
+ * of every key.
+ */
+#define __LINEAR_BUDGET 200000000ULL
+
+/**
+ * @brief The number of lookups the Robin Hood map is timed over, at
+ * every size.
+ */
+#define __LOOKUP_COUNT (1 << 22)
+
+/**
+ * @brief A pair of the linear scan map, laid out as it was.
+ */
+typedef struct _LinearPair
+{
+    u8 set;
+    AmbiguousType key, value;
+} _LinearPair;
+
+/**
+ * @brief Insert into the linear scan map, the way it used to; into
+ * the first slot that isn't set.
+ */
+void _LinearAppend(_LinearPair* pairs, u32 size, u64 key, u32 value)
+{
+    for (u32 index = 0; index < size; index++)
+    {
+        if (pairs[index].set) continue;
+        pairs[index].set = true;
+        AssignAmbiguousType(&pairs[index].key, unsigned64, &key);
+        AssignAmbiguousType(&pairs[index].value, unsigned32, &value);
+        return;
+    }
+}
+
+/**
+ * @brief Look up a key in the linear scan map, the way it used to;
+ * by comparing against every slot in turn.
+ */
+void* _LinearGet(_LinearPair* pairs, u32 size, u64 key)
+{
+    for (u32 index = 0; index < size; index++)
+    {
+        if (!CompareAmbiguousType(&pairs[index].key, unsigned64,
+                                  &key))
+            continue;
+        return GetAmbiguousType(&pairs[index].value, unsigned32);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Get the key of the given index. Multiplying by an odd
+ * constant keeps every key distinct while scattering them.
+ */
+__INLINE u64 _GetKey(u32 index)
+{
+    return (index + 1) * 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+ * @brief Run random operations on a map and on a plain array side by
+ * side, checking that they always agree.
+ */
+void _TestOperations(void)
+{
+    Map* map = CreateMap(unsigned32, unsigned32, 0);
+    bool* present = calloc(__KEY_RANGE, sizeof(bool));
+    u32* values = calloc(__KEY_RANGE, sizeof(u32));
+    u32 state = 0x1D872B41, present_count = 0;
+
+    for (u32 operation = 0; operation < __OPERATION_COUNT;
+         operation++)
+    {
+        const u32 key = TestRandom(&state) % __KEY_RANGE,
+                  kind = TestRandom(&state) % 3;
+        if (kind == 0)
+        {
+            const u32 value = TestRandom(&state);
+            AppendMapItem(map, key, value);
+            present_count += !present[key];
+            present[key] = true;
+            values[key] = value;
+        }
+        else if (kind == 1)
+        {
+            RemoveMapItem(map, key);
+            present_count -= present[key];
+            present[key] = false;
+        }
+
+        const u32* found = GetMapItemValue(map, key);
+        if (present[key])
+            TEST_CHECK(found != NULL && *found == values[key],
+                       "Key %u lost its value after operation %u.",
+                       key, operation);
+        else
+            TEST_CHECK(found == NULL,
+                       "Key %u outlived its removal at operation %u.",
+                       key, operation);
+    }
+
+    TEST_CHECK(map->filled_size == present_count,
+               "The map holds %u pairs, not %u.", map->filled_size,
+               present_count);
+    for (u32 key = 0; key < __KEY_RANGE; key++)
+    {
+        const bool found = (GetMapItemValue(map, key) != NULL);
+        TEST_CHECK(found == present[key],
+                   "Key %u is wrongly %s at the end.", key,
+                   present[key] ? "missing" : "present");
+    }
+
+    free(present);
+    free(values);
+    KillMap(map);
+}
+
+/**
+ * @brief Time both maps filling up with, then looking up, the given
+ * number of entries.
+ * @param count The number of entries.
+ */
+void _BenchmarkSize(u32 count)
+{
+    // The Robin Hood map starts small, so its growth is timed too.
+    Map* map = CreateMap(unsigned64, unsigned32, 0);
+    u64 start = GetCurrentTimeNS();
+    for (u32 index = 0; index < count; index++)
+        AppendMapItem(map, _GetKey(index), index);
+    const f64 map_insert = TestElapsedMS(start) * 1e6 / count;
+
+    u32 misses = 0;
+    start = GetCurrentTimeNS();
+    for (u32 lookup = 0; lookup < __LOOKUP_COUNT; lookup++)
+    {
+        const u32 index = lookup % count;
+        const u32* found = GetMapItemValue(map, _GetKey(index));
+        misses += (found == NULL || *found != index);
+    }
+    const f64 map_lookup =
+        TestElapsedMS(start) * 1e6 / __LOOKUP_COUNT;
+    TEST_CHECK(misses == 0, "The map missed %u of its lookups at %u.",
+               misses, count);
+    KillMap(map);
+
+    // Filling the linear scan map the old way is quadratic, so past
+    // a point it's filled directly and only its lookups are timed.
+    _LinearPair* pairs = calloc(count, sizeof(_LinearPair));
+    f64 linear_insert = -1.0;
+    start = GetCurrentTimeNS();
+    for (u32 index = 0; index < count; index++)
+    {
+        if ((u64)count * count <= __LINEAR_BUDGET)
+            _LinearAppend(pairs, count, _GetKey(index), index);
+        else _LinearAppend(pairs + index, 1, _GetKey(index), index);
+    }
+    if ((u64)count * count <= __LINEAR_BUDGET)
+        linear_insert = TestElapsedMS(start) * 1e6 / count;
+
+    u32 lookups = __LINEAR_BUDGET / count;
+    if (lookups > __LOOKUP_COUNT) lookups = __LOOKUP_COUNT;
+    misses = 0;
+    start = GetCurrentTimeNS();
+    for (u32 lookup = 0; lookup < lookups; lookup++)
+    {
+        // Spread the lookups across the whole map, so the average
+        // scan length is what it would be over every key.
+        const u32 index = (u64)lookup * 2654435761U % count;
+        const u32* found = _LinearGet(pairs, count, _GetKey(index));
+        misses += (found == NULL || *found != index);
+    }
+    const f64 linear_lookup = TestElapsedMS(start) * 1e6 / lookups;
+    TEST_CHECK(misses == 0,
+               "The linear scan missed %u of its lookups at %u.",
+               misses, count);
+    free(pairs);
+
+    printf("%7u entries: lookup %8.1f ns vs %12.1f ns (%.0fx), ",
+           count, map_lookup, linear_lookup,
+           linear_lookup / map_lookup);
+    if (linear_insert < 0.0)
+        printf("insert %6.1f ns vs (too slow to time).\n",
+               map_insert);
+    else
+        printf("insert %6.1f ns vs %10.1f ns.\n", map_insert,
+               linear_insert);
+}
+
+i32 main(void)
+{
+    _TestOperations();
+    _BenchmarkSize(21);
+    _BenchmarkSize(1000);
+    _BenchmarkSize(1000000);
+    return FinishTest("MapTest");
+}
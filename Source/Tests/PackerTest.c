@@ -0,0 +1,160 @@
+/**
+ * @file PackerTest.c
+ * @author Zenais Argos
+ * @brief Tests the skyline packer on a fixed set of tile and sprite
+ * sized rectangles; nothing placed may overlap or leave the page, and
+ * the page has to end up densely packed. Also reports how fast
+ * rectangles are placed.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Packer.h>
+
+/**
+ * @brief The size of the page packed into.
+ */
+#define __PAGE_SIZE 2048
+
+/**
+ * @brief The most rectangles the fixed input set holds.
+ */
+#define __RECT_COUNT 8192
+
+/**
+ * @brief The least of the page the fixed input set has to cover
+ * before the first rectangle fails to fit.
+ */
+#define __MINIMUM_OCCUPANCY 0.85f
+
+/**
+ * @brief The number of times the whole input set is packed when
+ * timing the packer.
+ */
+#define __SPEED_ROUNDS 50
+
+/**
+ * @brief Fill in the fixed input set; mostly 16 and 32 pixel tiles,
+ * with odd sprite sizes mixed in.
+ * @param widths Where to write the widths.
+ * @param heights Where to write the heights.
+ */
+void _FillInputSet(u16* widths, u16* heights)
+{
+    u32 state = 0x2545F491;
+    for (u32 index = 0; index < __RECT_COUNT; index++)
+    {
+        const u32 kind = TestRandom(&state) % 4;
+        if (kind < 2) widths[index] = heights[index] = 16 << kind;
+        else
+        {
+            widths[index] = TestRandomRange(&state, 8, 96);
+            heights[index] = TestRandomRange(&state, 8, 96);
+        }
+    }
+}
+
+/**
+ * @brief Check whether two placed rectangles overlap.
+ */
+__INLINE __BOOLEAN _Overlaps(const PackerRect* a, const PackerRect* b)
+{
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+           a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+/**
+ * @brief Pack the input set until the first rectangle that doesn't
+ * fit, checking every placement.
+ */
+void _TestPlacement(const u16* widths, const u16* heights)
+{
+    SkylinePacker* packer =
+        CreateSkylinePacker(__PAGE_SIZE, __PAGE_SIZE);
+    PackerRect* placed = malloc(sizeof(PackerRect) * __RECT_COUNT);
+
+    u32 count = 0;
+    while (count < __RECT_COUNT &&
+           PackRectangle(packer, widths[count], heights[count],
+                         &placed[count]))
+        count++;
+    TEST_CHECK(count < __RECT_COUNT,
+               "The input set never filled the page.");
+
+    u64 area = 0;
+    for (u32 index = 0; index < count; index++)
+    {
+        const PackerRect* rect = &placed[index];
+        TEST_CHECK(rect->width == widths[index] &&
+                       rect->height == heights[index],
+                   "Rectangle %u was placed at the wrong size.",
+                   index);
+        TEST_CHECK((u32)rect->x + rect->width <= __PAGE_SIZE &&
+                       (u32)rect->y + rect->height <= __PAGE_SIZE,
+                   "Rectangle %u was placed outside the page.",
+                   index);
+        for (u32 other = 0; other < index; other++)
+            TEST_CHECK(!_Overlaps(rect, &placed[other]),
+                       "Rectangles %u and %u overlap.", index, other);
+        area += (u64)rect->width * rect->height;
+    }
+
+    const f32 occupancy = GetPackerOccupancy(packer);
+    TEST_CHECK(area == packer->used_area,
+               "The packer's used area is off; %lu, not %lu.",
+               packer->used_area, area);
+    TEST_CHECK(occupancy >= __MINIMUM_OCCUPANCY,
+               "The page was only %.1f%% full.", occupancy * 100.0f);
+    printf("Packed %u rectangles into %dx%d: %.1f%% full.\n", count,
+           __PAGE_SIZE, __PAGE_SIZE, occupancy * 100.0f);
+
+    free(placed);
+    KillSkylinePacker(packer);
+}
+
+/**
+ * @brief Time how long packing the input set takes, starting a new
+ * page whenever one fills up.
+ */
+void _TestSpeed(const u16* widths, const u16* heights)
+{
+    SkylinePacker* packer =
+        CreateSkylinePacker(__PAGE_SIZE, __PAGE_SIZE);
+    PackerRect placed;
+    u32 pages = 0;
+
+    const u64 start = GetCurrentTimeNS();
+    for (u32 round = 0; round < __SPEED_ROUNDS; round++)
+        for (u32 index = 0; index < __RECT_COUNT; index++)
+            if (!PackRectangle(packer, widths[index], heights[index],
+                               &placed))
+            {
+                ResetSkylinePacker(packer);
+                pages++;
+                PackRectangle(packer, widths[index], heights[index],
+                              &placed);
+            }
+    const f64 elapsed = TestElapsedMS(start);
+
+    printf("Placed %u rectangles across %u pages in %.2f ms (%.0f "
+           "rectangles/ms).\n",
+           __SPEED_ROUNDS * __RECT_COUNT, pages + 1, elapsed,
+           __SPEED_ROUNDS * __RECT_COUNT / elapsed);
+    KillSkylinePacker(packer);
+}
+
+i32 main(void)
+{
+    u16* widths = malloc(sizeof(u16) * __RECT_COUNT);
+    u16* heights = malloc(sizeof(u16) * __RECT_COUNT);
+    _FillInputSet(widths, heights);
+
+    _TestPlacement(widths, heights);
+    _TestSpeed(widths, heights);
+
+    free(widths);
+    free(heights);
+    return FinishTest("PackerTest");
+}
@@ -0,0 +1,183 @@
+/**
+ * @file SceneBenchmark.c
+ * @author Zenais Argos
+ * @brief Compares how long the game takes to get to its first scene
+ * from a scene file of 1, 100 and 1000 scenes. The old reader went
+ * through the file front to back with fread, decoding every scene's
+ * images before the game could start; the mapped reader only reads
+ * the table of contents, then decodes the one scene that's asked for.
+ * Nothing's uploaded, so no context is needed.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Scene.h>
+#include <stbi/stb_image.h>
+
+/**
+ * @brief The number of times each reader is timed on each file. The
+ * best of these is reported.
+ */
+#define __ROUNDS 5
+
+/**
+ * @brief Decode the given image, checking that it decoded.
+ * @param data The encoded image.
+ * @param size The size of the encoded image, in bytes.
+ */
+void _DecodeTestImage(const u8* data, u64 size)
+{
+    i32 width, height, channels;
+    u8* pixels = stbi_load_from_memory(data, size, &width, &height,
+                                       &channels, 4);
+    TEST_CHECK(pixels != NULL, "An image failed to decode.");
+    stbi_image_free(pixels);
+}
+
+/**
+ * @brief Read the scene file the way the old reader did; every scene,
+ * one after another, copying and decoding each of their images.
+ * @param scene_count The number of scenes in the file.
+ * @return The number of images decoded.
+ */
+u32 _ReadLinearly(u16 scene_count)
+{
+    FILE* file = fopen(SCENE_FILE_PATH, "rb");
+    TEST_CHECK(file != NULL, "Failed to open the scene file.");
+    if (file == NULL) return 0;
+
+    // The old format had no table of contents, so it's skipped.
+    fseek(file,
+          SCENE_HEADER_SIZE + (u64)scene_count * SCENE_ENTRY_SIZE,
+          SEEK_SET);
+
+    u32 images = 0;
+    for (u16 scene_index = 0; scene_index < scene_count;
+         scene_index++)
+    {
+        u16 lengths[3];
+        fread(lengths, 2, 3, file);
+        char* strings = malloc(lengths[0] + lengths[1]);
+        fread(strings, 1, lengths[0] + lengths[1], file);
+        free(strings);
+
+        u64* image_sizes = malloc(sizeof(u64) * lengths[2]);
+        for (u16 asset_index = 0; asset_index < lengths[2];
+             asset_index++)
+        {
+            u8 asset[SCENE_ASSET_SIZE];
+            fread(asset, 1, SCENE_ASSET_SIZE, file);
+            memcpy(&image_sizes[asset_index], asset + 72, 8);
+        }
+
+        for (u16 asset_index = 0; asset_index < lengths[2];
+             asset_index++)
+        {
+            u8* image = malloc(image_sizes[asset_index]);
+            fread(image, 1, image_sizes[asset_index], file);
+            _DecodeTestImage(image, image_sizes[asset_index]);
+            free(image);
+            images++;
+        }
+        free(image_sizes);
+    }
+
+    fclose(file);
+    return images;
+}
+
+/**
+ * @brief Read the scene file with the mapped reader, decoding only
+ * the images of the given scene.
+ * @param name The name of the scene to load.
+ * @return The number of images decoded.
+ */
+u32 _ReadMapped(const char* name)
+{
+    SceneFile* file = OpenSceneFile();
+    SceneFileEntry* entry = FindSceneEntry(file, name);
+    TEST_CHECK(entry != NULL, "Scene '%s' wasn't found.", name);
+    if (entry == NULL)
+    {
+        CloseSceneFile(file);
+        return 0;
+    }
+
+    u16 lengths[3];
+    memcpy(lengths, file->data + entry->offset, 6);
+    const u64 table = entry->offset + 6 + lengths[0] + lengths[1];
+    for (u16 asset_index = 0; asset_index < lengths[2]; asset_index++)
+    {
+        const u8* asset =
+            file->data + table + (u64)asset_index * SCENE_ASSET_SIZE;
+        u64 image_offset, image_size;
+        memcpy(&image_offset, asset + 64, 8);
+        memcpy(&image_size, asset + 72, 8);
+        _DecodeTestImage(file->data + image_offset, image_size);
+    }
+
+    CloseSceneFile(file);
+    return lengths[2];
+}
+
+/**
+ * @brief Write a scene file of the given number of scenes, and time
+ * both readers getting to the last of them.
+ * @param scene_count The number of scenes to write.
+ */
+void _BenchmarkScenes(u16 scene_count)
+{
+    char** names = malloc(sizeof(char*) * scene_count);
+    char** descriptions = malloc(sizeof(char*) * scene_count);
+    char* textures[1] = {"texture_missing.jpg"};
+    for (u16 index = 0; index < scene_count; index++)
+    {
+        names[index] = malloc(32);
+        snprintf(names[index], 32, "scene_%u", index);
+        descriptions[index] = "a benchmark scene";
+    }
+    CreateScenes(names, descriptions, textures, 1, scene_count);
+
+    f64 linear_time = -1.0, mapped_time = -1.0;
+    u32 linear_images = 0, mapped_images = 0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        u64 start = GetCurrentTimeNS();
+        linear_images = _ReadLinearly(scene_count);
+        f64 elapsed = TestElapsedMS(start);
+        if (linear_time < 0.0 || elapsed < linear_time)
+            linear_time = elapsed;
+
+        start = GetCurrentTimeNS();
+        mapped_images = _ReadMapped(names[scene_count - 1]);
+        elapsed = TestElapsedMS(start);
+        if (mapped_time < 0.0 || elapsed < mapped_time)
+            mapped_time = elapsed;
+    }
+
+    TEST_CHECK(linear_images == scene_count,
+               "The old reader decoded %u images, not %u.",
+               linear_images, scene_count);
+    TEST_CHECK(mapped_images == 1,
+               "The mapped reader decoded %u images, not 1.",
+               mapped_images);
+    printf("%4u scenes: old reader %8.3f ms, mapped reader %8.3f ms "
+           "(%.1fx).\n",
+           scene_count, linear_time, mapped_time,
+           linear_time / (mapped_time > 0.0 ? mapped_time : 1.0));
+
+    for (u16 index = 0; index < scene_count; index++)
+        free(names[index]);
+    free(names);
+    free(descriptions);
+}
+
+i32 main(void)
+{
+    _BenchmarkScenes(1);
+    _BenchmarkScenes(100);
+    _BenchmarkScenes(1000);
+    return FinishTest("SceneBenchmark");
+}
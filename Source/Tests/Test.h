@@ -0,0 +1,103 @@
+/**
+ * @file Test.h
+ * @author Zenais Argos
+ * @brief Provides what every test and benchmark under Source/Tests
+ * shares; checks that count their failures rather than killing the
+ * process, a deterministic random number generator so every run sees
+ * the same inputs, and a timer. Each test is its own executable, and
+ * reports failure through its exit code.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_TEST_
+#define _RENAI_TEST_
+
+// Provides the type definitions and the clock used in this file.
+#include <Declarations.h>
+
+/**
+ * @brief The number of checks that have failed so far.
+ */
+static u32 _test_failures = 0;
+
+/**
+ * @brief Check that the given condition holds, printing the given
+ * message and counting a failure if it doesn't. Testing carries on
+ * either way.
+ */
+#define TEST_CHECK(condition, ...)                                   \
+    do {                                                             \
+        if (!(condition))                                            \
+        {                                                            \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);              \
+            printf(__VA_ARGS__);                                     \
+            putchar('\n');                                           \
+            _test_failures++;                                        \
+        }                                                            \
+    } while (0)
+
+/**
+ * @brief Print how the test went, and get the exit code to report it
+ * with.
+ * @param name The name of the test.
+ * @return 0 if every check passed, 1 if not.
+ */
+__INLINE i32 FinishTest(const char* name)
+{
+    if (_test_failures == 0) printf("%s: passed.\n", name);
+    else printf("%s: %u checks failed.\n", name, _test_failures);
+    return _test_failures != 0;
+}
+
+/**
+ * @brief Get the next number of a xorshift sequence.
+ * @param state The state of the sequence. This must start nonzero.
+ * @return The next number.
+ */
+__INLINE u32 TestRandom(u32* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**
+ * @brief Get a random number within the given range.
+ * @param state The state of the sequence.
+ * @param minimum The lowest number to return.
+ * @param maximum The highest number to return.
+ * @return The number.
+ */
+__INLINE u32 TestRandomRange(u32* state, u32 minimum, u32 maximum)
+{
+    return minimum + TestRandom(state) % (maximum - minimum + 1);
+}
+
+/**
+ * @brief Get a random float within the given range.
+ * @param state The state of the sequence.
+ * @param minimum The lowest number to return.
+ * @param maximum The highest number to return.
+ * @return The number.
+ */
+__INLINE f32 TestRandomFloat(u32* state, f32 minimum, f32 maximum)
+{
+    const f32 unit = (TestRandom(state) & 0xFFFFFF) / 16777215.0f;
+    return minimum + (maximum - minimum) * unit;
+}
+
+/**
+ * @brief Get how long it's been since the given time, in
+ * milliseconds.
+ * @param start The time to measure from, from @ref GetCurrentTimeNS.
+ * @return The time since, in milliseconds.
+ */
+__INLINE f64 TestElapsedMS(u64 start)
+{
+    return (GetCurrentTimeNS() - start) / (f64)NS_PER_MS;
+}
+
+#endif // _RENAI_TEST_
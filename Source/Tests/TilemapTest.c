@@ -0,0 +1,179 @@
+/**
+ * @file TilemapTest.c
+ * @author Zenais Argos
+ * @brief Paints a map whose edges don't line up with its chunks,
+ * saves it, and checks that loading it back (whole, and chunk by
+ * chunk as a stream) gives back exactly what was painted.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <Tilemap.h>
+#include <unistd.h>
+
+/**
+ * @brief Where the painted map is saved. This is removed once the
+ * test's done.
+ */
+#define __MAP_PATH "./TilemapTest.map"
+
+/**
+ * @brief The dimensions of the painted map. Neither is a multiple of
+ * the chunk size, so the last row and column of chunks are partial.
+ */
+#define __MAP_WIDTH 100
+#define __MAP_HEIGHT 70
+#define __MAP_LAYERS 3
+
+/**
+ * @brief The number of tiles in the map's palette.
+ */
+#define __PALETTE_SIZE 12
+
+/**
+ * @brief Get where a tile sits in the test's own copy of the map.
+ */
+__INLINE u32 _GetExpectedIndex(u8 layer, u32 x, u32 y)
+{
+    return (layer * __MAP_HEIGHT + y) * __MAP_WIDTH + x;
+}
+
+/**
+ * @brief Paint a random tile (or nothing) at every position of every
+ * layer, keeping a copy of what was painted.
+ */
+void _PaintMap(Tilemap* map, TileID* expected)
+{
+    char name[32];
+    for (u32 tile = 0; tile < __PALETTE_SIZE; tile++)
+    {
+        snprintf(name, sizeof(name), "tile_%u.png", tile);
+        TEST_CHECK(AddTilemapTile(map, name) == tile + 1,
+                   "Tile '%s' didn't get the next ID.", name);
+    }
+    TEST_CHECK(AddTilemapTile(map, "tile_3.png") == 4,
+               "Adding a tile twice gave it a new ID.");
+
+    u32 state = 0x7F4A7C15;
+    for (u8 layer = 0; layer < __MAP_LAYERS; layer++)
+        for (u32 y = 0; y < __MAP_HEIGHT; y++)
+            for (u32 x = 0; x < __MAP_WIDTH; x++)
+            {
+                // Leave a good part of each layer empty, like a real
+                // map's upper layers.
+                TileID tile =
+                    TestRandom(&state) % (__PALETTE_SIZE * 2);
+                if (tile > __PALETTE_SIZE) tile = EMPTY_TILE;
+                SetTile(map, layer, x, y, tile);
+                expected[_GetExpectedIndex(layer, x, y)] = tile;
+            }
+
+    // None of these should paint anything.
+    SetTile(map, 0, __MAP_WIDTH, 0, 1);
+    SetTile(map, 0, 0, __MAP_HEIGHT, 1);
+    SetTile(map, __MAP_LAYERS, 0, 0, 1);
+    SetTile(map, 0, 0, 0, __PALETTE_SIZE + 1);
+    TEST_CHECK(GetTile(map, 0, 0, 0) == expected[0],
+               "An unknown tile was painted.");
+    TEST_CHECK(GetTile(map, 0, __MAP_WIDTH, 0) == EMPTY_TILE,
+               "A tile outside the map isn't empty.");
+}
+
+/**
+ * @brief Check that the given map holds exactly what was painted.
+ */
+void _CompareMap(Tilemap* map, const TileID* expected,
+                 const char* name)
+{
+    TEST_CHECK(map->width == __MAP_WIDTH &&
+                   map->height == __MAP_HEIGHT &&
+                   map->layer_count == __MAP_LAYERS,
+               "The %s map is %ux%u with %u layers.", name,
+               map->width, map->height, map->layer_count);
+    TEST_CHECK(map->palette_count == __PALETTE_SIZE,
+               "The %s map has %u tiles in its palette.", name,
+               map->palette_count);
+    for (u16 tile = 0; tile < map->palette_count; tile++)
+    {
+        char expected_name[32];
+        snprintf(expected_name, sizeof(expected_name), "tile_%u.png",
+                 tile);
+        TEST_CHECK(
+            strcmp(map->palette[tile].name, expected_name) == 0,
+            "Tile %u of the %s map is called '%s'.", tile, name,
+            map->palette[tile].name);
+    }
+
+    u32 mismatches = 0;
+    for (u8 layer = 0; layer < __MAP_LAYERS; layer++)
+        for (u32 y = 0; y < __MAP_HEIGHT; y++)
+            for (u32 x = 0; x < __MAP_WIDTH; x++)
+            {
+                const u32 index = _GetExpectedIndex(layer, x, y);
+                mismatches += GetTile(map, layer, x, y) !=
+                              expected[index];
+            }
+    TEST_CHECK(mismatches == 0, "%u tiles of the %s map differ.",
+               mismatches, name);
+}
+
+/**
+ * @brief Read every chunk of a streamed copy of the map, and page it
+ * in, so the streamed map can be compared like any other.
+ */
+void _PageInStream(Tilemap* map)
+{
+    for (u32 chunk = 0; chunk < map->chunk_columns * map->chunk_rows;
+         chunk++)
+    {
+        TileID* tiles = malloc(sizeof(TileID) * TILEMAP_CHUNK_TILES *
+                               map->layer_count);
+        TEST_CHECK(ReadTilemapChunk(map, chunk, tiles),
+                   "Chunk %u of the streamed map couldn't be read.",
+                   chunk);
+        PageInTilemapChunk(map, chunk, tiles);
+    }
+}
+
+i32 main(void)
+{
+    TileID* expected =
+        malloc(sizeof(TileID) * __MAP_WIDTH * __MAP_HEIGHT *
+               __MAP_LAYERS);
+    Tilemap* painted =
+        CreateTilemap(__MAP_WIDTH, __MAP_HEIGHT, __MAP_LAYERS, 16.0f);
+    _PaintMap(painted, expected);
+    _CompareMap(painted, expected, "painted");
+
+    TEST_CHECK(SaveTilemap(painted, __MAP_PATH),
+               "The map couldn't be saved.");
+    KillTilemap(painted);
+
+    Tilemap* loaded = LoadTilemap(__MAP_PATH);
+    TEST_CHECK(loaded != NULL, "The saved map couldn't be loaded.");
+    if (loaded != NULL)
+    {
+        _CompareMap(loaded, expected, "loaded");
+
+        // The streamed copy below is opened from this second save,
+        // so a loaded map has to save just as well as a painted one.
+        TEST_CHECK(SaveTilemap(loaded, __MAP_PATH),
+                   "The loaded map couldn't be saved again.");
+        KillTilemap(loaded);
+    }
+
+    Tilemap* streamed = OpenTilemapStream(__MAP_PATH);
+    TEST_CHECK(streamed != NULL, "The saved map couldn't be opened.");
+    if (streamed != NULL)
+    {
+        _PageInStream(streamed);
+        _CompareMap(streamed, expected, "streamed");
+        KillTilemap(streamed);
+    }
+
+    unlink(__MAP_PATH);
+    free(expected);
+    return FinishTest("TilemapTest");
+}
@@ -0,0 +1,224 @@
+/**
+ * @file WorldBenchmark.c
+ * @author Zenais Argos
+ * @brief Times walking a world of 100k entities; straight down a
+ * pool's arrays, through views of two and three components, and a
+ * whole tick of the world's systems. The same walk is timed over a
+ * linked list of individually allocated instances, the way entities
+ * were stored before the world, for comparison.
+ * @date 2024-07-24
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#include "Test.h"
+#include <World.h>
+
+/**
+ * @brief The number of entities in the benchmark's world.
+ */
+#define __ENTITY_COUNT 100000
+
+/**
+ * @brief The number of times each walk is timed. The best of these is
+ * reported.
+ */
+#define __ROUNDS 50
+
+/**
+ * @brief An entity the way it used to be stored; a heap allocated
+ * instance, reached through a heap allocated list node.
+ */
+typedef struct _ListInstance
+{
+    Texture* inherits;
+    f32 x, y;
+    u8 z, scale;
+    f32 brightness, rotation;
+} _ListInstance;
+
+typedef struct _ListNode
+{
+    struct _ListNode* next;
+    const char* name;
+    _ListInstance* instance;
+} _ListNode;
+
+/**
+ * @brief The result of a single walk, kept so the compiler can't
+ * throw the walk away.
+ */
+static f64 _walk_sum = 0.0;
+
+/**
+ * @brief Print how long a walk took.
+ * @param name The name of the walk.
+ * @param best The best time of the walk, in milliseconds.
+ * @param visited The number of entities the walk visited.
+ */
+void _ReportWalk(const char* name, f64 best, u32 visited)
+{
+    printf("%-28s %7.3f ms, %6.2f ns/entity (%u entities).\n", name,
+           best, best * 1e6 / visited, visited);
+}
+
+/**
+ * @brief Fill the world, giving every entity a transform and a
+ * sprite, every other one an AI, and every fourth an animation.
+ * @param world The world to fill.
+ * @param texture The texture every sprite is drawn from.
+ */
+void _FillWorld(World* world, Texture* texture)
+{
+    u32 state = 0x6C078965;
+    for (u32 index = 0; index < __ENTITY_COUNT; index++)
+    {
+        Entity entity = CreateEntity(world);
+        AddTransform(world, entity,
+                     TestRandomFloat(&state, 0.0f, 16384.0f),
+                     TestRandomFloat(&state, 0.0f, 16384.0f),
+                     TestRandom(&state) % 4, 1.0f, 0.0f);
+        AddSprite(world, entity, texture, 1.0f);
+        if (index % 2 == 0) AddAI(world, entity, 32.0f);
+        if (index % 4 == 0) AddAnimation(world, entity, 4, 0.1f);
+    }
+}
+
+/**
+ * @brief Time walking every transform straight down its pool.
+ */
+void _WalkPool(World* world)
+{
+    const TransformPool* transforms = &world->transforms;
+    f64 best = -1.0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        f32 sum = 0.0f;
+        for (u32 index = 0; index < transforms->pool.count; index++)
+            sum += transforms->x[index] + transforms->y[index];
+        const f64 elapsed = TestElapsedMS(start);
+        _walk_sum += sum;
+        if (best < 0.0 || elapsed < best) best = elapsed;
+    }
+    _ReportWalk("Transform pool", best, transforms->pool.count);
+}
+
+/**
+ * @brief Time walking a view of the given components, checking that
+ * it visits the expected number of entities.
+ */
+void _WalkView(World* world, u8 components, const char* name,
+               u32 expected)
+{
+    f64 best = -1.0;
+    u32 visited = 0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        EntityView view = ViewEntities(world, components);
+        f32 sum = 0.0f;
+        visited = 0;
+        while (NextEntity(&view))
+        {
+            sum += world->transforms.x[view.transform] *
+                   world->sprites.brightness[view.sprite];
+            visited++;
+        }
+        const f64 elapsed = TestElapsedMS(start);
+        _walk_sum += sum;
+        if (best < 0.0 || elapsed < best) best = elapsed;
+    }
+    TEST_CHECK(visited == expected,
+               "The view '%s' visited %u entities, not %u.", name,
+               visited, expected);
+    _ReportWalk(name, best, visited);
+}
+
+/**
+ * @brief Time a whole tick of every system of the world.
+ */
+void _TickWorld(World* world)
+{
+    f64 best = -1.0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        UpdateWorld(world, 1.0 / 60.0);
+        const f64 elapsed = TestElapsedMS(start);
+        if (best < 0.0 || elapsed < best) best = elapsed;
+    }
+    _ReportWalk("World tick", best, world->alive_count);
+}
+
+/**
+ * @brief Time the same walk as @ref _WalkPool over a linked list of
+ * instances.
+ */
+void _WalkList(Texture* texture)
+{
+    _ListNode *first = NULL, *last = NULL;
+    u32 state = 0x6C078965;
+    for (u32 index = 0; index < __ENTITY_COUNT; index++)
+    {
+        _ListNode* node = malloc(sizeof(_ListNode));
+        node->next = NULL;
+        node->name = "instance";
+        node->instance = malloc(sizeof(_ListInstance));
+        *node->instance = (_ListInstance){
+            texture, TestRandomFloat(&state, 0.0f, 16384.0f),
+            TestRandomFloat(&state, 0.0f, 16384.0f),
+            TestRandom(&state) % 4, 1, 1.0f, 0.0f};
+
+        if (last == NULL) first = node;
+        else last->next = node;
+        last = node;
+    }
+
+    f64 best = -1.0;
+    for (u32 round = 0; round < __ROUNDS; round++)
+    {
+        const u64 start = GetCurrentTimeNS();
+        f32 sum = 0.0f;
+        for (_ListNode* node = first; node != NULL; node = node->next)
+            sum += node->instance->x + node->instance->y;
+        const f64 elapsed = TestElapsedMS(start);
+        _walk_sum += sum;
+        if (best < 0.0 || elapsed < best) best = elapsed;
+    }
+    _ReportWalk("Linked list (old)", best, __ENTITY_COUNT);
+
+    while (first != NULL)
+    {
+        _ListNode* next = first->next;
+        free(first->instance);
+        free(first);
+        first = next;
+    }
+}
+
+i32 main(void)
+{
+    Texture texture = {0};
+    texture.width = texture.height = 16;
+    texture.uv[2] = texture.uv[3] = 1.0f;
+
+    World* world = CreateWorld(__ENTITY_COUNT);
+    _FillWorld(world, &texture);
+    TEST_CHECK(world->alive_count == __ENTITY_COUNT,
+               "The world holds %u entities, not %u.",
+               world->alive_count, __ENTITY_COUNT);
+
+    _WalkPool(world);
+    _WalkView(world, transform_component | sprite_component,
+              "View: transform, sprite", __ENTITY_COUNT);
+    _WalkView(world,
+              transform_component | sprite_component | ai_component,
+              "View: transform, sprite, AI", __ENTITY_COUNT / 2);
+    _TickWorld(world);
+    _WalkList(&texture);
+
+    printf("(Walk checksum %.0f.)\n", _walk_sum);
+    KillWorld(world);
+    return FinishTest("WorldBenchmark");
+}
@@ -0,0 +1,96 @@
+/**
+ * @file Cooker.c
+ * @author Zenais Argos
+ * @brief The asset cooker; an offline tool that decodes a scene's
+ * images, packs them into an atlas exactly the way the game would,
+ * and saves the result, mipmaps and all, as a cooked atlas the game
+ * can upload without decoding anything. Usage is `Cooker <scene>
+ * <image>...`, where the images are listed in the same order as the
+ * scene's, and the atlas is written into @ref COOKED_DIRECTORY.
+ * @date 2024-07-17
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+// Provides the cooked atlas format, and everything it's built from.
+#include <Cooked.h>
+#include <stbi/stb_image.h>
+#include <sys/stat.h>
+
+/**
+ * @brief The size of the window textures are cooked against. This
+ * only affects the size textures are drawn at, which is worked out
+ * again at load time, so it doesn't matter what it is.
+ */
+#define __COOKER_WINDOW_SIZE 1080.0f
+
+/**
+ * @brief Cook the images given on the command line.
+ * @param argc The number of arguments.
+ * @param argv The arguments; the scene's name, then its images.
+ * @return 0 on success, 1 on failure.
+ */
+i32 main(i32 argc, char** argv)
+{
+    if (argc < 3 || argc - 2 > UINT16_MAX)
+    {
+        fprintf(stderr, "Usage: %s <scene> <image>...\n", argv[0]);
+        return 1;
+    }
+    const u64 start_time = GetCurrentTimeNS();
+    const u16 image_count = argc - 2;
+
+    TextureAtlas* atlas = CreateTextureAtlas(ATLAS_PAGE_SIZE);
+    Texture** textures = malloc(sizeof(Texture*) * image_count);
+    if (textures == NULL)
+        PrintError("Failed to allocate the cooked textures. Code: "
+                   "%d.",
+                   errno);
+
+    for (u16 index = 0; index < image_count; index++)
+    {
+        const char* path = argv[index + 2];
+        // Scenes know their images by file name alone.
+        const char* name = strrchr(path, '/');
+        name = (name == NULL ? path : name + 1);
+        if (strlen(name) > 63)
+            PrintError("The image name '%s' is too long to cook.",
+                       name);
+
+        i32 width, height, channels;
+        u8* pixels = stbi_load(path, &width, &height, &channels, 4);
+        if (pixels == NULL)
+            PrintError("Failed to decode the image '%s'. Reason: %s.",
+                       path, stbi_failure_reason());
+
+        textures[index] = CreateTextureFromPixels(
+            name, tileset, atlas, NULL, pixels, width, height,
+            __COOKER_WINDOW_SIZE, __COOKER_WINDOW_SIZE);
+        stbi_image_free(pixels);
+    }
+
+    char cooked_path[128];
+    snprintf(cooked_path, 128, COOKED_DIRECTORY "/%s.cooked",
+             argv[1]);
+    mkdir(COOKED_DIRECTORY, 0755);
+    const bool cooked =
+        SaveCookedAtlas(cooked_path, atlas, textures, image_count);
+
+    // The atlas was never uploaded, so freeing it never touches
+    // OpenGL, and the cooker gets away without a context.
+    for (u16 index = 0; index < image_count; index++)
+        KillTexture(textures[index]);
+    free(textures);
+    const u16 page_count = atlas->page_count;
+    KillTextureAtlas(atlas);
+
+    if (!cooked)
+    {
+        fprintf(stderr, "Failed to cook '%s'.\n", cooked_path);
+        return 1;
+    }
+    printf("Cooked %d images into %d pages at '%s' in %.2f ms.\n",
+           image_count, page_count, cooked_path,
+           NSToSeconds(GetCurrentTimeNS() - start_time) * 1000.0);
+    return 0;
+}
@@ -0,0 +1,496 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_assets
+#include "Atlas.h"
+#include <Extensions.h>
+#include <StateCache.h>
+
+/**
+ * @brief The state of video memory across every atlas.
+ */
+static AtlasMemory _atlas_memory = {.budget = ATLAS_DEFAULT_BUDGET};
+
+/**
+ * @brief A page that's been uploaded, and so can be evicted.
+ */
+typedef struct _UploadedPage
+{
+    TextureAtlas* atlas;
+    u16 page;
+} _UploadedPage;
+
+/**
+ * @brief Every page of every atlas that's been uploaded, and the
+ * number of pages there's room for.
+ */
+static _UploadedPage* _uploaded_pages = NULL;
+static u32 _uploaded_count = 0, _uploaded_capacity = 0;
+
+/**
+ * @brief Get the number of levels in the full mipmap chain of a page.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @return The number of levels, the page itself included.
+ */
+__INLINE u8 _GetPageLevels(u32 width, u32 height)
+{
+    u8 levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+        levels++;
+    }
+    return levels;
+}
+
+/**
+ * @brief Get the memory a page of the given dimensions takes up,
+ * every level of its mipmap chain included.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @param levels The number of levels in the page's chain.
+ * @return The size of the page, in bytes.
+ */
+__INLINE u64 _GetPageBytes(u32 width, u32 height, u8 levels)
+{
+    u64 bytes = 0;
+    for (u8 level = 0; level < levels; level++)
+    {
+        bytes += (u64)width * height * 4;
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Round the given value up to the nearest power of two.
+ */
+__INLINE u32 _NextPowerOfTwo(u32 value)
+{
+    u32 power = 1;
+    while (power < value) power <<= 1;
+    return power;
+}
+
+__CREATE_STRUCT_KILLFAIL(TextureAtlas)
+CreateTextureAtlas(u16 page_size)
+{
+    TextureAtlas* atlas = __MALLOC(
+        TextureAtlas, atlas,
+        ("Failed to allocate a texture atlas. Code: %d.", errno));
+    atlas->page_size = page_size;
+    atlas->page_count = 0;
+    atlas->page_capacity = 0;
+    atlas->pages = NULL;
+
+    return atlas;
+}
+
+void KillTextureAtlas(TextureAtlas* atlas)
+{
+    for (u16 index = 0; index < atlas->page_count; index++)
+    {
+        AtlasPage* page = &atlas->pages[index];
+        if (page->references != 0)
+            PrintWarning("Killed atlas page %d while %d of its "
+                         "textures were still alive.",
+                         index, page->references);
+        if (page->resident)
+        {
+            _atlas_memory.resident_bytes -= page->bytes;
+            _atlas_memory.resident_pages--;
+        }
+        if (page->texture != 0)
+        {
+            ForgetState(state_texture, page->texture);
+            glDeleteTextures(1, &page->texture);
+        }
+        free(page->pixels);
+        if (page->packer != NULL) KillSkylinePacker(page->packer);
+        _atlas_memory.live_pages--;
+    }
+
+    // Forget every page of the atlas, so they're never considered for
+    // eviction again.
+    for (u32 index = 0; index < _uploaded_count;)
+        if (_uploaded_pages[index].atlas == atlas)
+            _uploaded_pages[index] =
+                _uploaded_pages[--_uploaded_count];
+        else index++;
+    if (_uploaded_count == 0)
+    {
+        free(_uploaded_pages);
+        _uploaded_pages = NULL;
+        _uploaded_capacity = 0;
+    }
+
+    free(atlas->pages);
+    __FREE(atlas, ("The atlas freer was given an invalid atlas."));
+}
+
+/**
+ * @brief Append a page to the given atlas, filling in everything but
+ * its contents.
+ * @param atlas The atlas to grow.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @return A pointer to the new page.
+ */
+AtlasPage* _AppendAtlasPage(TextureAtlas* atlas, u16 width,
+                            u16 height)
+{
+    if (atlas->page_count == atlas->page_capacity)
+    {
+        atlas->page_capacity = (atlas->page_capacity == 0
+                                    ? 4
+                                    : atlas->page_capacity * 2);
+        atlas->pages =
+            realloc(atlas->pages,
+                    sizeof(AtlasPage) * atlas->page_capacity);
+        if (atlas->pages == NULL)
+            PrintError("Failed to grow a texture atlas. Code: %d.",
+                       errno);
+    }
+
+    AtlasPage* page = &atlas->pages[atlas->page_count++];
+    page->texture = 0;
+    page->width = width;
+    page->height = height;
+    page->pixels = NULL;
+    page->packer = NULL;
+    page->resident = false;
+    page->levels = _GetPageLevels(width, height);
+    page->bytes = _GetPageBytes(width, height, page->levels);
+    page->last_used = 0;
+    page->references = 0;
+    _atlas_memory.live_pages++;
+    return page;
+}
+
+/**
+ * @brief Append a new, empty page to the given atlas.
+ * @param atlas The atlas to grow.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @return The index of the new page.
+ */
+u16 _CreateAtlasPage(TextureAtlas* atlas, u16 width, u16 height)
+{
+    AtlasPage* page = _AppendAtlasPage(atlas, width, height);
+    // Start the page out fully transparent, so the padding between
+    // images samples as nothing.
+    page->pixels = calloc((u64)width * height, 4);
+    if (page->pixels == NULL)
+        PrintError("Failed to allocate a %dx%d atlas page. Code: %d.",
+                   width, height, errno);
+    page->packer = CreateSkylinePacker(width, height);
+
+    PrintSuccess("Created atlas page %d (%dx%d).",
+                 atlas->page_count - 1, width, height);
+    return atlas->page_count - 1;
+}
+
+__KILLFAIL InsertAtlasImage(TextureAtlas* atlas, const u8* pixels,
+                            u32 width, u32 height, u16* page,
+                            f32 uv[4])
+{
+    // Page sizes are powers of two that have to fit in 16 bits, which
+    // anything bigger than this would round up past.
+    if (width > ATLAS_MAX_IMAGE_SIZE || height > ATLAS_MAX_IMAGE_SIZE)
+        PrintError("Tried to pack a %dx%d image into an atlas; the "
+                   "most it can hold is %dx%d.",
+                   width, height, ATLAS_MAX_IMAGE_SIZE,
+                   ATLAS_MAX_IMAGE_SIZE);
+
+    const u16 padded_width = width + ATLAS_PADDING * 2,
+              padded_height = height + ATLAS_PADDING * 2;
+
+    // Try every page that's still open before making a new one.
+    PackerRect placed;
+    bool found = false;
+    for (u16 index = 0; index < atlas->page_count && !found; index++)
+    {
+        if (atlas->pages[index].texture != 0) continue;
+        found = PackRectangle(atlas->pages[index].packer,
+                              padded_width, padded_height, &placed);
+        *page = index;
+    }
+
+    if (!found)
+    {
+        // Images bigger than a standard page get a page of their own,
+        // still sized to a power of two.
+        u16 page_width = atlas->page_size, page_height = page_width;
+        if (padded_width > page_width)
+            page_width = _NextPowerOfTwo(padded_width);
+        if (padded_height > page_height)
+            page_height = _NextPowerOfTwo(padded_height);
+
+        *page = _CreateAtlasPage(atlas, page_width, page_height);
+        if (!PackRectangle(atlas->pages[*page].packer, padded_width,
+                           padded_height, &placed))
+            PrintError("Failed to pack a %dx%d image into an empty "
+                       "atlas page.",
+                       width, height);
+    }
+
+    // Copy the image into the page row by row, skipping over the
+    // padding.
+    AtlasPage* destination = &atlas->pages[*page];
+    const u16 x = placed.x + ATLAS_PADDING,
+              y = placed.y + ATLAS_PADDING;
+    for (u16 row = 0; row < height; row++)
+        memcpy(destination->pixels +
+                   ((u64)(y + row) * destination->width + x) * 4,
+               pixels + (u64)row * width * 4, (u64)width * 4);
+
+    uv[0] = (f32)x / destination->width;
+    uv[1] = (f32)y / destination->height;
+    uv[2] = (f32)(x + width) / destination->width;
+    uv[3] = (f32)(y + height) / destination->height;
+}
+
+/**
+ * @brief Start tracking a page as resident, now that every level of
+ * it is in video memory.
+ * @param page The page that was uploaded.
+ */
+__INLINE void _MarkPageResident(AtlasPage* page)
+{
+    page->resident = true;
+    page->last_used = _atlas_memory.frame;
+    _atlas_memory.resident_bytes += page->bytes;
+    _atlas_memory.resident_pages++;
+}
+
+/**
+ * @brief Send a freshly packed page's pixels to its OpenGL texture
+ * and generate its mipmaps, freeing the pixels afterward. The texture
+ * is left bound.
+ * @param page The page to upload.
+ */
+__INLINE void _UploadAtlasPage(AtlasPage* page)
+{
+    BindTexture2D(page->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page->width, page->height,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, page->pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    free(page->pixels);
+    page->pixels = NULL;
+    _MarkPageResident(page);
+}
+
+/**
+ * @brief Send every level of a page's mipmap chain, laid out one
+ * after the other, to its OpenGL texture as is. The texture is left
+ * bound.
+ * @param page The page to upload.
+ * @param data The levels of the page, largest first.
+ */
+__INLINE void _UploadPageLevels(AtlasPage* page, const u8* data)
+{
+    BindTexture2D(page->texture);
+    // The chain may stop short of 1x1, so tell the driver where it
+    // ends rather than leave the texture incomplete.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    page->levels - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    u32 width = page->width, height = page->height;
+    for (u8 level = 0; level < page->levels; level++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, data);
+        data += (u64)width * height * 4;
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+    }
+}
+
+/**
+ * @brief Create the OpenGL texture of a page, and start tracking the
+ * page as uploaded. The texture is left bound.
+ * @param atlas The atlas of the page.
+ * @param index The index of the page.
+ */
+__KILLFAIL _CreatePageTexture(TextureAtlas* atlas, u16 index)
+{
+    AtlasPage* page = &atlas->pages[index];
+    glGenTextures(1, &page->texture);
+    BindTexture2D(page->texture);
+    LabelObject(GL_TEXTURE, page->texture, "Atlas page %d", index);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                    GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                    GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    _atlas_memory.uploads++;
+
+    if (_uploaded_count == _uploaded_capacity)
+    {
+        _uploaded_capacity =
+            (_uploaded_capacity == 0 ? 16 : _uploaded_capacity * 2);
+        _uploaded_pages =
+            realloc(_uploaded_pages,
+                    sizeof(_UploadedPage) * _uploaded_capacity);
+        if (_uploaded_pages == NULL)
+            PrintError("Failed to grow the list of uploaded atlas "
+                       "pages. Code: %d.",
+                       errno);
+    }
+    _uploaded_pages[_uploaded_count++] =
+        (_UploadedPage){atlas, index};
+}
+
+void UploadTextureAtlas(TextureAtlas* atlas)
+{
+    for (u16 index = 0; index < atlas->page_count; index++)
+    {
+        AtlasPage* page = &atlas->pages[index];
+        if (page->texture != 0) continue;
+
+        _CreatePageTexture(atlas, index);
+        _UploadAtlasPage(page);
+
+        PrintSuccess("Uploaded atlas page %d (%dx%d, %.1f%% full, "
+                     "%.1f MB).",
+                     index, page->width, page->height,
+                     GetPackerOccupancy(page->packer) * 100.0f,
+                     page->bytes / 1048576.0);
+    }
+}
+
+u16 UploadCookedAtlasPage(TextureAtlas* atlas, u16 width, u16 height,
+                          u8 levels, const u8* data)
+{
+    AtlasPage* page = _AppendAtlasPage(atlas, width, height);
+    const u16 index = atlas->page_count - 1;
+    page->levels = levels;
+    page->bytes = _GetPageBytes(width, height, levels);
+    _CreatePageTexture(atlas, index);
+    _UploadPageLevels(page, data);
+    _MarkPageResident(page);
+
+    PrintSuccess("Uploaded cooked atlas page %d (%dx%d, %d levels).",
+                 index, width, height, levels);
+    return index;
+}
+
+u32 UseAtlasPage(TextureAtlas* atlas, u16 page)
+{
+    AtlasPage* used = &atlas->pages[page];
+    used->last_used = _atlas_memory.frame;
+    if (!used->resident && used->pixels != NULL)
+    {
+        // The page's whole chain was read back when it was evicted,
+        // cooked levels and all, so it goes back exactly as it was.
+        _UploadPageLevels(used, used->pixels);
+        free(used->pixels);
+        used->pixels = NULL;
+        _MarkPageResident(used);
+        _atlas_memory.restores++;
+    }
+    return used->texture;
+}
+
+/**
+ * @brief Evict a resident page from video memory, reading every level
+ * of it back first so it can be uploaded again later. The page's
+ * texture keeps its name, but every level of it is emptied.
+ * @param page The page to evict.
+ */
+__KILLFAIL _EvictAtlasPage(AtlasPage* page)
+{
+    page->pixels = malloc(page->bytes);
+    if (page->pixels == NULL)
+        PrintError("Failed to allocate space to evict a %dx%d atlas "
+                   "page into. Code: %d.",
+                   page->width, page->height, errno);
+
+    BindTexture2D(page->texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    u8* level_pixels = page->pixels;
+    u32 width = page->width, height = page->height;
+    for (u8 level = 0; level < page->levels; level++)
+    {
+        glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE,
+                      level_pixels);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, NULL);
+        level_pixels += (u64)width * height * 4;
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+    }
+
+    page->resident = false;
+    _atlas_memory.resident_bytes -= page->bytes;
+    _atlas_memory.resident_pages--;
+    _atlas_memory.evictions++;
+}
+
+void TrimAtlasMemory(void)
+{
+    // There are only ever a handful of pages, so the least recently
+    // used one is simply searched for each time.
+    while (_atlas_memory.resident_bytes > _atlas_memory.budget)
+    {
+        AtlasPage* oldest = NULL;
+        for (u32 index = 0; index < _uploaded_count; index++)
+        {
+            const _UploadedPage* uploaded = &_uploaded_pages[index];
+            AtlasPage* page = &uploaded->atlas->pages[uploaded->page];
+            if (!page->resident ||
+                page->last_used == _atlas_memory.frame)
+                continue;
+            if (oldest == NULL || page->last_used < oldest->last_used)
+                oldest = page;
+        }
+        if (oldest == NULL) break;
+        _EvictAtlasPage(oldest);
+    }
+
+    _atlas_memory.frame++;
+}
+
+void SetAtlasMemoryBudget(u64 budget)
+{
+    _atlas_memory.budget = budget;
+}
+
+__GET_STRUCT(const AtlasMemory) GetAtlasMemory(void)
+{
+    return &_atlas_memory;
+}
+
+void ReportAtlasMemory(void)
+{
+    PrintSuccess("Atlas memory: %d uploads, %d restores, %d "
+                 "evictions.",
+                 _atlas_memory.uploads, _atlas_memory.restores,
+                 _atlas_memory.evictions);
+    if (_atlas_memory.live_pages != 0 ||
+        _atlas_memory.live_textures != 0 ||
+        _atlas_memory.resident_bytes != 0)
+        PrintWarning("Leaked %d atlas pages (%.1f MB of video "
+                     "memory) and %d textures.",
+                     _atlas_memory.live_pages,
+                     _atlas_memory.resident_bytes / 1048576.0,
+                     _atlas_memory.live_textures);
+}
+
+void ReferenceAtlasPage(TextureAtlas* atlas, u16 page)
+{
+    atlas->pages[page].references++;
+    _atlas_memory.live_textures++;
+}
+
+void ReleaseAtlasPage(TextureAtlas* atlas, u16 page)
+{
+    atlas->pages[page].references--;
+    _atlas_memory.live_textures--;
+}
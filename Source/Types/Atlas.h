@@ -0,0 +1,265 @@
+/**
+ * @file Atlas.h
+ * @author Zenais Argos
+ * @brief Provides texture atlases; sets of power-of-two OpenGL
+ * textures ("pages") that many small images are packed into, so that
+ * drawing them doesn't require a texture bind per image. Uploaded
+ * pages are kept within a video memory budget; the pages gone unused
+ * the longest are evicted once it's exceeded, and transparently
+ * uploaded again the next time anything draws from them.
+ * @date 2024-07-04
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_ATLAS_
+#define _RENAI_ATLAS_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the rectangle packer each atlas page uses to lay out its
+// images.
+#include <Packer.h>
+
+/**
+ * @brief The default width and height of an atlas page, in pixels.
+ */
+#define ATLAS_PAGE_SIZE 2048
+
+/**
+ * @brief The number of empty pixels kept around every image packed
+ * into a page, so that neighbouring images never bleed into each
+ * other when sampled.
+ */
+#define ATLAS_PADDING 1
+
+/**
+ * @brief The widest and tallest image an atlas can hold, padding
+ * included in neither. Its padded size rounds up to a 32768 pixel
+ * page, the largest power of two a page's 16-bit dimensions fit.
+ */
+#define ATLAS_MAX_IMAGE_SIZE (32768 - ATLAS_PADDING * 2)
+
+/**
+ * @brief The default video memory budget of every atlas page
+ * combined, in bytes.
+ */
+#define ATLAS_DEFAULT_BUDGET (256 * 1024 * 1024)
+
+/**
+ * @brief A single page of an atlas. Until the page is uploaded its
+ * pixels live on the CPU, and images can still be packed into it.
+ */
+typedef struct AtlasPage
+{
+    /**
+     * @brief The OpenGL texture of the page. This is 0 until the page
+     * has been uploaded, and never changes after; evicting the page
+     * only frees the texture's storage, so anything holding onto the
+     * name stays valid.
+     */
+    u32 texture;
+    /**
+     * @brief The dimensions of the page, always powers of two.
+     */
+    u16 width, height;
+    /**
+     * @brief The RGBA8 pixels of the page, or NULL while the page is
+     * resident in video memory. Before the page's first upload this
+     * is just the page itself; once evicted, it's every level of the
+     * page's mipmap chain, one after the other.
+     */
+    u8* pixels;
+    /**
+     * @brief The number of levels in the page's mipmap chain; the
+     * full chain, unless the page was cooked with fewer.
+     */
+    u8 levels;
+    /**
+     * @brief Whether or not the page's image is in video memory.
+     */
+    bool resident;
+    /**
+     * @brief The video memory the page takes up once uploaded,
+     * mipmaps included, in bytes.
+     */
+    u64 bytes;
+    /**
+     * @brief The last frame anything was drawn from the page.
+     */
+    u32 last_used;
+    /**
+     * @brief The number of live textures packed into the page.
+     */
+    u32 references;
+    /**
+     * @brief The packer keeping track of the page's free space, or
+     * NULL if the page was cooked, and so never had any.
+     */
+    SkylinePacker* packer;
+} AtlasPage;
+
+/**
+ * @brief A texture atlas; a growable list of pages.
+ */
+typedef struct TextureAtlas
+{
+    /**
+     * @brief The width and height new pages are created with.
+     */
+    u16 page_size;
+    /**
+     * @brief The number of pages in the atlas, and how many the page
+     * array has room for.
+     */
+    u16 page_count, page_capacity;
+    /**
+     * @brief The atlas' pages.
+     */
+    AtlasPage* pages;
+} TextureAtlas;
+
+/**
+ * @brief The state of video memory across every atlas.
+ */
+typedef struct AtlasMemory
+{
+    /**
+     * @brief The most video memory uploaded pages should take up, in
+     * bytes. Pages used within the current frame are never evicted,
+     * so a budget smaller than a single frame's pages is overrun.
+     */
+    u64 budget;
+    /**
+     * @brief The video memory taken up by resident pages, and the
+     * number of them.
+     */
+    u64 resident_bytes;
+    u32 resident_pages;
+    /**
+     * @brief The number of pages and textures that have been created
+     * but not killed. Both should be 0 by shutdown.
+     */
+    u32 live_pages, live_textures;
+    /**
+     * @brief The number of times a page has been uploaded for the
+     * first time, uploaded again after eviction, and evicted.
+     */
+    u32 uploads, restores, evictions;
+    /**
+     * @brief The number of the current frame.
+     */
+    u32 frame;
+} AtlasMemory;
+
+/**
+ * @brief Create an empty texture atlas.
+ * @param page_size The width and height of the atlas' pages. This
+ * must be a power of two.
+ * @return A pointer to the created atlas.
+ */
+__CREATE_STRUCT_KILLFAIL(TextureAtlas)
+CreateTextureAtlas(u16 page_size);
+
+/**
+ * @brief Destroy the given atlas, deleting every one of its pages'
+ * OpenGL textures. Any textures still packed into it are reported as
+ * leaked.
+ * @param atlas The atlas to kill.
+ */
+void KillTextureAtlas(TextureAtlas* atlas);
+
+/**
+ * @brief Pack an image into the atlas, creating a new page if none of
+ * the pages still open have room for it. Kills the process if the
+ * image is bigger than @ref ATLAS_MAX_IMAGE_SIZE either way.
+ * @param atlas The atlas to pack into.
+ * @param pixels The RGBA8 pixels of the image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param page The index of the page the image ended up on.
+ * @param uv The texture coordinate rectangle (u0, v0, u1, v1) of the
+ * image within its page.
+ */
+__KILLFAIL InsertAtlasImage(TextureAtlas* atlas, const u8* pixels,
+                            u32 width, u32 height, u16* page,
+                            f32 uv[4]);
+
+/**
+ * @brief Upload every page of the atlas that hasn't been uploaded
+ * yet, freeing its CPU-side pixels. Pages that have been uploaded are
+ * closed, and won't receive any more images.
+ * @param atlas The atlas to upload.
+ */
+void UploadTextureAtlas(TextureAtlas* atlas);
+
+/**
+ * @brief Append a page that's already been packed and mipmapped
+ * offline, uploading every level of it as is. Nothing more can be
+ * packed into the page.
+ * @param atlas The atlas to grow.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @param levels The number of levels in the page's mipmap chain.
+ * @param data Every level of the page's RGBA8 mipmap chain, largest
+ * first, back to back.
+ * @return The index of the new page.
+ */
+u16 UploadCookedAtlasPage(TextureAtlas* atlas, u16 width, u16 height,
+                          u8 levels, const u8* data);
+
+/**
+ * @brief Get the OpenGL texture of an atlas page that's about to be
+ * drawn from, marking it as used this frame and uploading it again
+ * first if it was evicted. This may change the texture bound to the
+ * active texture unit.
+ * @param atlas The atlas of the page.
+ * @param page The index of the page.
+ * @return The OpenGL texture of the page.
+ */
+u32 UseAtlasPage(TextureAtlas* atlas, u16 page);
+
+/**
+ * @brief Evict the least recently used pages of every atlas until
+ * they're back within budget, and start a new frame. This should be
+ * called once every frame, after everything has been drawn.
+ */
+void TrimAtlasMemory(void);
+
+/**
+ * @brief Change the video memory budget of every atlas. Pages past
+ * the new budget are evicted on the next trim.
+ * @param budget The new budget, in bytes.
+ */
+void SetAtlasMemoryBudget(u64 budget);
+
+/**
+ * @brief Get the state of video memory across every atlas.
+ * @return A pointer to the state.
+ */
+__GET_STRUCT(const AtlasMemory) GetAtlasMemory(void);
+
+/**
+ * @brief Log the state of video memory, warning about any pages or
+ * textures still alive. This is meant to be called at shutdown, once
+ * everything has been killed.
+ */
+void ReportAtlasMemory(void);
+
+/**
+ * @brief Note that a texture has been packed into the given page.
+ * @param atlas The atlas of the page.
+ * @param page The index of the page.
+ */
+void ReferenceAtlasPage(TextureAtlas* atlas, u16 page);
+
+/**
+ * @brief Note that a texture packed into the given page has been
+ * killed.
+ * @param atlas The atlas of the page.
+ * @param page The index of the page.
+ */
+void ReleaseAtlasPage(TextureAtlas* atlas, u16 page);
+
+#endif // _RENAI_ATLAS_
@@ -0,0 +1,44 @@
+#include "Camera.h"
+
+__CREATE_STRUCT_KILLFAIL(Camera) CreateCamera(f32 width, f32 height)
+{
+    Camera* camera = __MALLOC(
+        Camera, camera,
+        ("Failed to allocate the camera. Code: %d.", errno));
+    camera->x = width / 2.0f;
+    camera->y = height / 2.0f;
+    camera->zoom = 1.0f;
+    camera->width = width;
+    camera->height = height;
+    return camera;
+}
+
+void PanCamera(Camera* camera, f32 x, f32 y)
+{
+    camera->x += x / camera->zoom;
+    camera->y += y / camera->zoom;
+}
+
+void ZoomCamera(Camera* camera, f32 factor)
+{
+    camera->zoom = glm_clamp(camera->zoom * factor, CAMERA_MIN_ZOOM,
+                             CAMERA_MAX_ZOOM);
+}
+
+void GetCameraView(const Camera* camera, mat4 view)
+{
+    // Move the camera's point to the origin, scale around it, then
+    // move it to the center of the screen.
+    glm_translate_make(view, (vec3){camera->width / 2.0f,
+                                    camera->height / 2.0f, 0.0f});
+    glm_scale(view, (vec3){camera->zoom, camera->zoom, 1.0f});
+    glm_translate(view, (vec3){-camera->x, -camera->y, 0.0f});
+}
+
+void GetCameraBounds(const Camera* camera, f32 bounds[4])
+{
+    bounds[2] = camera->width / camera->zoom;
+    bounds[3] = camera->height / camera->zoom;
+    bounds[0] = camera->x - bounds[2] / 2.0f;
+    bounds[1] = camera->y - bounds[3] / 2.0f;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file Camera.h
+ * @author Zenais Argos
+ * @brief Provides the camera; what part of the world is on screen,
+ * and how closely it's looked at. The camera supplies the view matrix
+ * of the per-frame uniform block, and the area everything drawing the
+ * world culls against.
+ * @date 2024-07-14
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_CAMERA_
+#define _RENAI_CAMERA_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the error logging the camera's freer relies on.
+#include <Logger.h>
+// Provides the matrix math the view matrix is built with.
+#include <cglm/cglm.h>
+
+/**
+ * @brief How far the camera can zoom out and in.
+ */
+#define CAMERA_MIN_ZOOM 0.125f
+#define CAMERA_MAX_ZOOM 8.0f
+
+/**
+ * @brief A camera.
+ */
+typedef struct Camera
+{
+    /**
+     * @brief The point of the world at the center of the screen.
+     */
+    f32 x, y;
+    /**
+     * @brief How many screen units a single world unit covers.
+     */
+    f32 zoom;
+    /**
+     * @brief The dimensions of the screen, in screen units.
+     */
+    f32 width, height;
+} Camera;
+
+/**
+ * @brief Create a camera looking at the world exactly as the
+ * projection alone would show it; the world's origin in the top left
+ * corner of the screen, at a zoom of 1.
+ * @param width The width of the screen.
+ * @param height The height of the screen.
+ * @return A pointer to the created camera.
+ */
+__CREATE_STRUCT_KILLFAIL(Camera) CreateCamera(f32 width, f32 height);
+
+/**
+ * @brief Free the given camera.
+ * @param camera The camera to kill.
+ */
+__INLINE void KillCamera(Camera* camera)
+{
+    __FREE(camera,
+           ("The camera freer was given an invalid camera."));
+}
+
+/**
+ * @brief Move the camera by the given distance on screen, so the pan
+ * feels the same however far the camera is zoomed.
+ * @param camera The camera to move.
+ * @param x The distance to move right, in screen units.
+ * @param y The distance to move down, in screen units.
+ */
+void PanCamera(Camera* camera, f32 x, f32 y);
+
+/**
+ * @brief Scale the camera's zoom, keeping the center of the screen
+ * where it is. The zoom is kept between @ref CAMERA_MIN_ZOOM and @ref
+ * CAMERA_MAX_ZOOM.
+ * @param camera The camera to zoom.
+ * @param factor What to multiply the zoom by.
+ */
+void ZoomCamera(Camera* camera, f32 factor);
+
+/**
+ * @brief Build the camera's view matrix.
+ * @param camera The camera.
+ * @param view Where to write the matrix.
+ */
+void GetCameraView(const Camera* camera, mat4 view);
+
+/**
+ * @brief Get the area of the world the camera can see.
+ * @param camera The camera.
+ * @param bounds Where to write the area; its X, Y, width, and height,
+ * in world units.
+ */
+void GetCameraBounds(const Camera* camera, f32 bounds[4]);
+
+#endif // _RENAI_CAMERA_
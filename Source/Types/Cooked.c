@@ -0,0 +1,328 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_assets
+#include "Cooked.h"
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Get the number of levels in the full mipmap chain of a page.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @return The number of levels, the page itself included.
+ */
+__INLINE u8 _GetMipmapLevels(u32 width, u32 height)
+{
+    u8 levels = 1;
+    while (width > 1 || height > 1)
+    {
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+        levels++;
+    }
+    return levels;
+}
+
+/**
+ * @brief Get the size of every level of a page's mipmap chain
+ * combined, in bytes.
+ * @param width The width of the page.
+ * @param height The height of the page.
+ * @param levels The number of levels in the chain.
+ * @return The size of the chain.
+ */
+__INLINE u64 _GetMipmapBytes(u32 width, u32 height, u8 levels)
+{
+    u64 bytes = 0;
+    for (u8 level = 0; level < levels; level++)
+    {
+        bytes += (u64)width * height * 4;
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Shrink a level of a mipmap chain to half its size, averaging
+ * every 2x2 block of pixels into one.
+ * @param source The RGBA8 pixels of the level.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param destination Where to write the next level.
+ */
+__KILLFAIL _ShrinkMipmapLevel(const u8* source, u32 width,
+                              u32 height, u8* destination)
+{
+    const u32 next_width = (width > 1 ? width / 2 : 1),
+              next_height = (height > 1 ? height / 2 : 1);
+    for (u32 y = 0; y < next_height; y++)
+        for (u32 x = 0; x < next_width; x++)
+        {
+            // Levels that are a single pixel along one axis just
+            // sample that pixel twice.
+            const u32 left = x * 2, top = y * 2,
+                      right = (width > 1 ? left + 1 : left),
+                      bottom = (height > 1 ? top + 1 : top);
+            for (u8 channel = 0; channel < 4; channel++)
+            {
+                const u32 sum =
+                    source[((u64)top * width + left) * 4 + channel] +
+                    source[((u64)top * width + right) * 4 + channel] +
+                    source[((u64)bottom * width + left) * 4 +
+                           channel] +
+                    source[((u64)bottom * width + right) * 4 +
+                           channel];
+                destination[((u64)y * next_width + x) * 4 + channel] =
+                    (sum + 2) / 4;
+            }
+        }
+}
+
+/**
+ * @brief Write a page's full mipmap chain to the cooked atlas.
+ * @param cooked_file The file being written.
+ * @param page The page to write. Its pixels must still be on the CPU.
+ * @return A boolean representing whether or not the chain could be
+ * built.
+ */
+__BOOLEAN _WriteCookedPage(FILE* cooked_file, const AtlasPage* page)
+{
+    u32 width = page->width, height = page->height;
+    fwrite(page->pixels, 4, (u64)width * height, cooked_file);
+
+    // Each level is built from the one before it, so only two are
+    // ever held at once.
+    u8* previous = malloc((u64)width * height * 4);
+    u8* current = malloc((u64)width * height * 4);
+    if (previous == NULL || current == NULL)
+    {
+        free(previous);
+        free(current);
+        return false;
+    }
+    memcpy(previous, page->pixels, (u64)width * height * 4);
+
+    while (width > 1 || height > 1)
+    {
+        _ShrinkMipmapLevel(previous, width, height, current);
+        width = (width > 1 ? width / 2 : 1);
+        height = (height > 1 ? height / 2 : 1);
+        fwrite(current, 4, (u64)width * height, cooked_file);
+
+        u8* swapped = previous;
+        previous = current;
+        current = swapped;
+    }
+
+    free(previous);
+    free(current);
+    return true;
+}
+
+__BOOLEAN SaveCookedAtlas(const char* path, TextureAtlas* atlas,
+                          Texture** textures, u16 texture_count)
+{
+    for (u16 index = 0; index < atlas->page_count; index++)
+        if (atlas->pages[index].pixels == NULL)
+        {
+            PrintWarning("Tried to cook an atlas that's already been "
+                         "uploaded.");
+            return false;
+        }
+
+    FILE* cooked_file = fopen(path, "wb");
+    if (cooked_file == NULL)
+    {
+        PrintWarning("Failed to open the cooked atlas '%s'. Code: "
+                     "%d.",
+                     path, errno);
+        return false;
+    }
+
+    u8 header[COOKED_HEADER_SIZE] = {
+        0xFF, 0x01, MAJOR, MINOR, REVIS, COOKED_FORMAT_VERSION};
+    memcpy(header + 6, &atlas->page_count, 2);
+    memcpy(header + 8, &texture_count, 2);
+    header[10] = 0xFF;
+    header[11] = 0x02;
+    fwrite(header, 1, COOKED_HEADER_SIZE, cooked_file);
+
+    for (u16 index = 0; index < atlas->page_count; index++)
+    {
+        const AtlasPage* page = &atlas->pages[index];
+        u8 entry[COOKED_PAGE_SIZE] = {0};
+        memcpy(entry, &page->width, 2);
+        memcpy(entry + 2, &page->height, 2);
+        entry[4] = _GetMipmapLevels(page->width, page->height);
+        fwrite(entry, 1, COOKED_PAGE_SIZE, cooked_file);
+    }
+
+    for (u16 index = 0; index < texture_count; index++)
+    {
+        const Texture* texture = textures[index];
+        const AtlasPage* page = &atlas->pages[texture->page];
+        // Textures don't keep the size of their image around, but
+        // it's exactly what their coordinates span within the page.
+        const u16 width =
+                      lroundf((texture->uv[2] - texture->uv[0]) *
+                              page->width),
+                  height =
+                      lroundf((texture->uv[3] - texture->uv[1]) *
+                              page->height);
+
+        u8 entry[COOKED_IMAGE_SIZE] = {0};
+        strncpy((char*)entry, texture->name, 63);
+        memcpy(entry + 64, &texture->page, 2);
+        memcpy(entry + 66, &width, 2);
+        memcpy(entry + 68, &height, 2);
+        memcpy(entry + 72, texture->uv, sizeof(f32) * 4);
+        fwrite(entry, 1, COOKED_IMAGE_SIZE, cooked_file);
+    }
+
+    bool written = true;
+    for (u16 index = 0; index < atlas->page_count && written; index++)
+        written = _WriteCookedPage(cooked_file, &atlas->pages[index]);
+
+    u8 file_end[2] = {0xFF, 0x03};
+    fwrite(file_end, 1, 2, cooked_file);
+    written = written && !ferror(cooked_file);
+    fclose(cooked_file);
+
+    if (!written)
+    {
+        PrintWarning("Failed to write the cooked atlas '%s'.", path);
+        return false;
+    }
+    PrintSuccess("Cooked %d images across %d pages into '%s'.",
+                 texture_count, atlas->page_count, path);
+    return true;
+}
+
+__BOOLEAN LoadCookedAtlas(const char* path, TextureAtlas* atlas,
+                          MemoryArena* arena, Registry* textures,
+                          const char** names, u16 name_count,
+                          f32 window_width, f32 window_height)
+{
+    i32 descriptor = open(path, O_RDONLY);
+    if (descriptor < 0)
+    {
+        PrintWarning("There's no cooked atlas at '%s'.", path);
+        return false;
+    }
+
+    struct stat file_stats;
+    if (fstat(descriptor, &file_stats) < 0 ||
+        file_stats.st_size < COOKED_HEADER_SIZE + 2)
+        PrintError("The cooked atlas '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+    const u64 size = file_stats.st_size;
+    const u8* data =
+        mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (data == MAP_FAILED)
+        PrintError("Failed to map the cooked atlas '%s'. Code: %d.",
+                   path, errno);
+
+    if (data[0] != 0xFF || data[1] != 0x01 || data[10] != 0xFF ||
+        data[11] != 0x02 || data[size - 2] != 0xFF ||
+        data[size - 1] != 0x03)
+        PrintError("The cooked atlas '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+
+    CheckVersionDifference("cooked atlases", (u8*)data + 2);
+    if (data[5] != COOKED_FORMAT_VERSION)
+        PrintError("The cooked atlas '%s' uses format %d, but Renai "
+                   "expects format %d. Please recook it.",
+                   path, data[5], COOKED_FORMAT_VERSION);
+
+    u16 page_count, image_count;
+    memcpy(&page_count, data + 6, 2);
+    memcpy(&image_count, data + 8, 2);
+    const u8 *pages = data + COOKED_HEADER_SIZE,
+             *images = pages + (u64)page_count * COOKED_PAGE_SIZE,
+             *pixels = images + (u64)image_count * COOKED_IMAGE_SIZE;
+    if (pixels + 2 > data + size)
+        PrintError("The cooked atlas '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+
+    // An atlas cooked from anything other than exactly the scene's
+    // images is stale, and the scene's own images are used instead.
+    bool stale = image_count != name_count;
+    for (u16 index = 0; index < image_count && !stale; index++)
+        stale = strncmp((const char*)images +
+                            (u64)index * COOKED_IMAGE_SIZE,
+                        names[index], 64) != 0;
+    if (stale)
+    {
+        PrintWarning("The cooked atlas '%s' doesn't match its scene. "
+                     "Please recook it.",
+                     path);
+        munmap((void*)data, size);
+        return false;
+    }
+
+    // Make sure every page is there before uploading any of them.
+    u64 pixel_bytes = 0;
+    for (u16 index = 0; index < page_count; index++)
+    {
+        const u8* entry = pages + (u64)index * COOKED_PAGE_SIZE;
+        u16 width, height;
+        memcpy(&width, entry, 2);
+        memcpy(&height, entry + 2, 2);
+        if (width == 0 || height == 0 || entry[4] == 0 ||
+            entry[4] > _GetMipmapLevels(width, height))
+            PrintError("Page %d of the cooked atlas '%s' has been "
+                       "tampered with/is malformed. Unable to "
+                       "continue.",
+                       index, path);
+        pixel_bytes += _GetMipmapBytes(width, height, entry[4]);
+    }
+    if ((u64)(pixels - data) + pixel_bytes + 2 != size)
+        PrintError("The cooked atlas '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+
+    for (u16 index = 0; index < page_count; index++)
+    {
+        const u8* entry = pages + (u64)index * COOKED_PAGE_SIZE;
+        u16 width, height;
+        memcpy(&width, entry, 2);
+        memcpy(&height, entry + 2, 2);
+        UploadCookedAtlasPage(atlas, width, height, entry[4], pixels);
+        pixels += _GetMipmapBytes(width, height, entry[4]);
+    }
+
+    for (u16 index = 0; index < image_count; index++)
+    {
+        const u8* entry = images + (u64)index * COOKED_IMAGE_SIZE;
+        u16 page, width, height;
+        f32 uv[4];
+        memcpy(&page, entry + 64, 2);
+        memcpy(&width, entry + 66, 2);
+        memcpy(&height, entry + 68, 2);
+        memcpy(uv, entry + 72, sizeof(f32) * 4);
+        if (width == 0 || height == 0)
+            PrintError("Image %d of the cooked atlas '%s' has been "
+                       "tampered with/is malformed. Unable to "
+                       "continue.",
+                       index, path);
+
+        Texture* texture = CreateTextureFromAtlas(
+            names[index], tileset, atlas, arena, page, uv, width,
+            height, window_width, window_height);
+        RegisterResource(textures, texture->name, texture);
+    }
+
+    munmap((void*)data, size);
+    PrintSuccess("Loaded the cooked atlas '%s' (%d images, %d "
+                 "pages).",
+                 path, image_count, page_count);
+    return true;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file Cooked.h
+ * @author Zenais Argos
+ * @brief Provides cooked atlases; a scene's atlas, packed and
+ * mipmapped ahead of time by the cooker and saved exactly as it's
+ * laid out in video memory. Loading one decodes nothing and packs
+ * nothing, every level of every page goes straight from the mapped
+ * file to the GPU.
+ * @date 2024-07-17
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_COOKED_
+#define _RENAI_COOKED_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the registry cooked textures are registered within.
+#include <Registry.h>
+// Provides the textures and atlases that get cooked.
+#include <Texture.h>
+
+/**
+ * @brief The directory cooked atlases are saved to and loaded from,
+ * relative to the executable. Each scene's atlas is named after the
+ * scene.
+ */
+#define COOKED_DIRECTORY "./Assets/Cooked"
+
+/**
+ * @brief The version of the cooked atlas format. This is separate
+ * from the application version, and only changes when the layout of
+ * the file does.
+ */
+#define COOKED_FORMAT_VERSION 1
+
+/**
+ * @brief The size of a cooked atlas' header, in bytes; the magic
+ * number, application version, format version, page count, image
+ * count, and end marker.
+ */
+#define COOKED_HEADER_SIZE 12
+
+/**
+ * @brief The size of a single page table entry, in bytes; the
+ * page's width and height, its number of mipmap levels, and three
+ * bytes of padding.
+ */
+#define COOKED_PAGE_SIZE 8
+
+/**
+ * @brief The size of a single image table entry, in bytes; a 64 byte
+ * name, the image's page, width, and height, two bytes of padding,
+ * then its texture coordinate rectangle as four floats.
+ */
+#define COOKED_IMAGE_SIZE 88
+
+/**
+ * @brief Save the given atlas and the images packed into it as a
+ * cooked atlas. The atlas must not have been uploaded yet, since its
+ * pages' pixels are read from the CPU; every page's mipmaps are
+ * generated here rather than by the driver.
+ * @param path The path of the file to write.
+ * @param atlas The atlas to cook.
+ * @param textures The textures packed into the atlas, in the order
+ * the scene lists them.
+ * @param texture_count The number of textures.
+ * @return A boolean representing whether or not the atlas was saved.
+ */
+__BOOLEAN SaveCookedAtlas(const char* path, TextureAtlas* atlas,
+                          Texture** textures, u16 texture_count);
+
+/**
+ * @brief Load a cooked atlas into the given (empty) atlas, uploading
+ * every page and registering a texture for every image. This must be
+ * called from the thread owning the OpenGL context. Kills the process
+ * if the file is malformed.
+ * @param path The path of the cooked atlas.
+ * @param atlas The atlas to load into.
+ * @param arena The arena to allocate the textures from, or NULL.
+ * @param textures The registry to register the textures within.
+ * @param names The names of the images the scene expects, in order.
+ * These are what the textures are named, so they have to outlive
+ * them.
+ * @param name_count The number of names.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ * @return A boolean representing whether or not the atlas was loaded;
+ * false if there's no cooked atlas, or it was cooked from a different
+ * set of images. Nothing is touched in that case.
+ */
+__BOOLEAN LoadCookedAtlas(const char* path, TextureAtlas* atlas,
+                          MemoryArena* arena, Registry* textures,
+                          const char** names, u16 name_count,
+                          f32 window_width, f32 window_height);
+
+#endif // _RENAI_COOKED_
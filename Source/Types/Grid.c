@@ -0,0 +1,263 @@
+#include "Grid.h"
+#include <Logger.h>
+#include <math.h>
+
+/**
+ * @brief Hash a cell into one of the grid's buckets.
+ * @param grid The grid.
+ * @param cell_x The column of the cell.
+ * @param cell_y The row of the cell.
+ * @return The bucket of the cell.
+ */
+__INLINE u32 _GetCellBucket(const SpatialGrid* grid, i32 cell_x,
+                            i32 cell_y)
+{
+    return ((u32)cell_x * 73856093U ^ (u32)cell_y * 19349663U) &
+           grid->bucket_mask;
+}
+
+/**
+ * @brief Get the cell containing the given coordinate along one axis.
+ * Coordinates too far out to fit are clamped to the outermost cells.
+ * @param grid The grid.
+ * @param coordinate The coordinate.
+ * @return The cell of the coordinate.
+ */
+__INLINE i32 _GetCell(const SpatialGrid* grid, f32 coordinate)
+{
+    const f32 cell = floorf(coordinate / grid->cell_size);
+    if (cell < (f32)INT32_MIN) return INT32_MIN;
+    if (cell > (f32)INT32_MAX) return INT32_MAX;
+    return (i32)cell;
+}
+
+__CREATE_STRUCT_KILLFAIL(SpatialGrid)
+CreateSpatialGrid(f32 cell_size, u32 bucket_count)
+{
+    if (cell_size <= 0.0f)
+        PrintError("Tried to create a spatial grid with cells of "
+                   "size %.2f.",
+                   cell_size);
+
+    SpatialGrid* grid = __MALLOC(
+        SpatialGrid, grid,
+        ("Failed to allocate a spatial grid. Code: %d.", errno));
+    grid->cell_size = cell_size;
+
+    u32 buckets = 16;
+    while (buckets < bucket_count) buckets *= 2;
+    grid->bucket_mask = buckets - 1;
+    grid->buckets = malloc(sizeof(u32) * buckets);
+    if (grid->buckets == NULL)
+        PrintError("Failed to allocate the buckets of a spatial "
+                   "grid. Code: %d.",
+                   errno);
+    // Every byte of GRID_EMPTY is 0xFF, so this empties every bucket.
+    memset(grid->buckets, 0xFF, sizeof(u32) * buckets);
+
+    grid->item_count = 0;
+    grid->items = NULL;
+    grid->item_capacity = 0;
+    grid->results = NULL;
+    grid->result_capacity = 0;
+    return grid;
+}
+
+void KillSpatialGrid(SpatialGrid* grid)
+{
+    free(grid->buckets);
+    free(grid->items);
+    free(grid->results);
+    __FREE(grid, ("The spatial grid freer was given an invalid "
+                  "grid."));
+}
+
+/**
+ * @brief Unlink an item from its bucket's list.
+ * @param grid The grid.
+ * @param item The ID of the item, which must be in the grid.
+ */
+__INLINE void _UnlinkGridItem(SpatialGrid* grid, u32 item)
+{
+    GridItem* unlinked = &grid->items[item];
+    if (unlinked->previous != GRID_EMPTY)
+        grid->items[unlinked->previous].next = unlinked->next;
+    else grid->buckets[unlinked->bucket] = unlinked->next;
+    if (unlinked->next != GRID_EMPTY)
+        grid->items[unlinked->next].previous = unlinked->previous;
+    unlinked->bucket = GRID_EMPTY;
+}
+
+/**
+ * @brief Link an item into the front of the given bucket's list.
+ * @param grid The grid.
+ * @param item The ID of the item, which mustn't be in any list.
+ * @param bucket The bucket to link it into.
+ */
+__INLINE void _LinkGridItem(SpatialGrid* grid, u32 item, u32 bucket)
+{
+    GridItem* linked = &grid->items[item];
+    linked->bucket = bucket;
+    linked->previous = GRID_EMPTY;
+    linked->next = grid->buckets[bucket];
+    if (linked->next != GRID_EMPTY)
+        grid->items[linked->next].previous = item;
+    grid->buckets[bucket] = item;
+}
+
+/**
+ * @brief Double the number of buckets of the grid until there's at
+ * least one per item, and relink every item into its new bucket.
+ * Otherwise the lists would grow with the item count, and every
+ * lookup along with them.
+ * @param grid The grid to rehash.
+ */
+__KILLFAIL _RehashSpatialGrid(SpatialGrid* grid)
+{
+    u32 buckets = grid->bucket_mask + 1;
+    while (buckets < grid->item_count && buckets < (1U << 31))
+        buckets *= 2;
+    if (buckets == grid->bucket_mask + 1) return;
+
+    u32* rehashed = realloc(grid->buckets, sizeof(u32) * buckets);
+    if (rehashed == NULL)
+        PrintError("Failed to grow a spatial grid to %d buckets. "
+                   "Code: %d.",
+                   buckets, errno);
+    grid->buckets = rehashed;
+    grid->bucket_mask = buckets - 1;
+    memset(grid->buckets, 0xFF, sizeof(u32) * buckets);
+
+    for (u32 item = 0; item < grid->item_capacity; item++)
+    {
+        const GridItem* relinked = &grid->items[item];
+        if (relinked->bucket == GRID_EMPTY) continue;
+        _LinkGridItem(grid, item,
+                      _GetCellBucket(grid, relinked->cell_x,
+                                     relinked->cell_y));
+    }
+}
+
+void PlaceGridItem(SpatialGrid* grid, u32 item, f32 x, f32 y)
+{
+    if (item >= grid->item_capacity)
+    {
+        u32 capacity =
+            (grid->item_capacity == 0 ? 64 : grid->item_capacity * 2);
+        while (capacity <= item) capacity *= 2;
+
+        grid->items =
+            realloc(grid->items, sizeof(GridItem) * capacity);
+        if (grid->items == NULL)
+            PrintError("Failed to grow a spatial grid to %d items. "
+                       "Code: %d.",
+                       capacity, errno);
+        for (u32 index = grid->item_capacity; index < capacity;
+             index++)
+            grid->items[index].bucket = GRID_EMPTY;
+        grid->item_capacity = capacity;
+    }
+
+    GridItem* placed = &grid->items[item];
+    const i32 cell_x = _GetCell(grid, x), cell_y = _GetCell(grid, y);
+    if (placed->bucket != GRID_EMPTY)
+    {
+        if (placed->cell_x == cell_x && placed->cell_y == cell_y)
+            return;
+        _UnlinkGridItem(grid, item);
+    }
+    else grid->item_count++;
+
+    placed->cell_x = cell_x;
+    placed->cell_y = cell_y;
+    _LinkGridItem(grid, item, _GetCellBucket(grid, cell_x, cell_y));
+
+    // The item's already linked in, so it's moved along with every
+    // other.
+    if (grid->item_count > grid->bucket_mask + 1)
+        _RehashSpatialGrid(grid);
+}
+
+void RemoveGridItem(SpatialGrid* grid, u32 item)
+{
+    if (item >= grid->item_capacity ||
+        grid->items[item].bucket == GRID_EMPTY)
+        return;
+    _UnlinkGridItem(grid, item);
+    grid->item_count--;
+}
+
+/**
+ * @brief Add an item to the results of the current query.
+ * @param grid The grid being queried.
+ * @param count The number of results so far.
+ * @param item The ID of the item.
+ */
+__INLINE void _AddGridResult(SpatialGrid* grid, u32 count, u32 item)
+{
+    if (count == grid->result_capacity)
+    {
+        grid->result_capacity =
+            (grid->result_capacity == 0 ? 256
+                                        : grid->result_capacity * 2);
+        grid->results = realloc(grid->results,
+                                sizeof(u32) * grid->result_capacity);
+        if (grid->results == NULL)
+            PrintError("Failed to grow the results of a spatial grid "
+                       "to %d items. Code: %d.",
+                       grid->result_capacity, errno);
+    }
+    grid->results[count] = item;
+}
+
+u32 QuerySpatialGrid(SpatialGrid* grid, const f32 area[4],
+                     const u32** results)
+{
+    const i32 first_x = _GetCell(grid, area[0]),
+              last_x = _GetCell(grid, area[0] + area[2]),
+              first_y = _GetCell(grid, area[1]),
+              last_y = _GetCell(grid, area[1] + area[3]);
+    const u64 cell_count =
+        ((u64)((i64)last_x - first_x) + 1) *
+        ((u64)((i64)last_y - first_y) + 1);
+
+    u32 count = 0;
+    // Several cells can share a bucket, so items are always checked
+    // against the area's cells. If the area covers more cells than
+    // there are buckets, it's cheaper to just walk every bucket once.
+    if (cell_count > (u64)grid->bucket_mask + 1)
+    {
+        for (u32 bucket = 0; bucket <= grid->bucket_mask; bucket++)
+            for (u32 item = grid->buckets[bucket]; item != GRID_EMPTY;
+                 item = grid->items[item].next)
+            {
+                const GridItem* found = &grid->items[item];
+                if (found->cell_x >= first_x &&
+                    found->cell_x <= last_x &&
+                    found->cell_y >= first_y &&
+                    found->cell_y <= last_y)
+                    _AddGridResult(grid, count++, item);
+            }
+    }
+    else
+    {
+        for (i64 cell_y = first_y; cell_y <= last_y; cell_y++)
+            for (i64 cell_x = first_x; cell_x <= last_x; cell_x++)
+            {
+                const u32 bucket =
+                    _GetCellBucket(grid, cell_x, cell_y);
+                for (u32 item = grid->buckets[bucket];
+                     item != GRID_EMPTY;
+                     item = grid->items[item].next)
+                {
+                    const GridItem* found = &grid->items[item];
+                    if (found->cell_x == cell_x &&
+                        found->cell_y == cell_y)
+                        _AddGridResult(grid, count++, item);
+                }
+            }
+    }
+
+    *results = grid->results;
+    return count;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file Grid.h
+ * @author Zenais Argos
+ * @brief Provides spatial grids; uniform spatial hashes that bucket
+ * items by the square cell they sit in, so everything within an area
+ * can be found without looking at anything outside it. Cells are
+ * hashed rather than stored, so a grid costs the same no matter how
+ * large the space it covers is.
+ * @date 2024-07-14
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_GRID_
+#define _RENAI_GRID_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+
+/**
+ * @brief The marker of the end of a bucket's list, and of an item
+ * that isn't in the grid.
+ */
+#define GRID_EMPTY UINT32_MAX
+
+/**
+ * @brief Where a single item of a grid is. Items are linked into
+ * their bucket's list in place, so moving one never allocates.
+ */
+typedef struct GridItem
+{
+    /**
+     * @brief The neighbours of the item within its bucket's list.
+     */
+    u32 next, previous;
+    /**
+     * @brief The bucket the item is in, or @ref GRID_EMPTY if it
+     * isn't in the grid.
+     */
+    u32 bucket;
+    /**
+     * @brief The cell the item is in.
+     */
+    i32 cell_x, cell_y;
+} GridItem;
+
+/**
+ * @brief A spatial grid. Items are identified by index (an entity
+ * slot, for instance), and can be placed anywhere.
+ */
+typedef struct SpatialGrid
+{
+    /**
+     * @brief The width and height of a single cell.
+     */
+    f32 cell_size;
+    /**
+     * @brief The first item of every bucket. There's always a power
+     * of two of these, so a cell's bucket is its hash masked by @ref
+     * bucket_mask. The grid rehashes into twice as many whenever it
+     * holds more items than it has buckets.
+     */
+    u32* buckets;
+    u32 bucket_mask;
+    /**
+     * @brief The number of items currently in the grid.
+     */
+    u32 item_count;
+    /**
+     * @brief Every item the grid has room for, indexed by the item's
+     * ID.
+     */
+    GridItem* items;
+    u32 item_capacity;
+    /**
+     * @brief The items found by the last query, and the number
+     * there's room for.
+     */
+    u32* results;
+    u32 result_capacity;
+} SpatialGrid;
+
+/**
+ * @brief Create an empty spatial grid. Kills the process on failure.
+ * @param cell_size The width and height of a single cell. This should
+ * be a few times the size of the items being placed.
+ * @param bucket_count The number of buckets cells are hashed into to
+ * begin with. This is rounded up to a power of two, and grows along
+ * with the number of items.
+ * @return A pointer to the created grid.
+ */
+__CREATE_STRUCT_KILLFAIL(SpatialGrid)
+CreateSpatialGrid(f32 cell_size, u32 bucket_count);
+
+/**
+ * @brief Free the given grid.
+ * @param grid The grid to kill.
+ */
+void KillSpatialGrid(SpatialGrid* grid);
+
+/**
+ * @brief Put an item at the given position, moving it there if it's
+ * already in the grid. This does next to nothing if the item stays
+ * within the same cell, so it's fine to call for every item, every
+ * tick.
+ * @param grid The grid to place the item in.
+ * @param item The ID of the item.
+ * @param x The X coordinate of the item.
+ * @param y The Y coordinate of the item.
+ */
+void PlaceGridItem(SpatialGrid* grid, u32 item, f32 x, f32 y);
+
+/**
+ * @brief Take an item out of the grid. Nothing happens if it isn't in
+ * the grid.
+ * @param grid The grid to remove from.
+ * @param item The ID of the item.
+ */
+void RemoveGridItem(SpatialGrid* grid, u32 item);
+
+/**
+ * @brief Find every item within a cell that overlaps the given area.
+ * This works at the granularity of cells, so items just outside the
+ * area may be found too; items are found by position alone, so
+ * anything with a size should widen the area by it.
+ * @param grid The grid to search.
+ * @param area The area to search; its X, Y, width, and height.
+ * @param results Where to point to the found items. This belongs to
+ * the grid, and is only valid until the next query.
+ * @return The number of items found.
+ */
+u32 QuerySpatialGrid(SpatialGrid* grid, const f32 area[4],
+                     const u32** results);
+
+#endif // _RENAI_GRID_
@@ -1,27 +1,37 @@
 #include "LinkedList.h"
 #include <Logger.h>
 
-#define __TYPE_SWITCH(type, ex1, ex2, ex3, ex4)                      \
+#define __TYPE_SWITCH(type, ex1, ex2, ex3)                           \
     switch (type)                                                    \
     {                                                                \
-        case shader:   ex1; break;                                   \
-        case texture:  ex2; break;                                   \
-        case instance: ex3; break;                                   \
-        case scene:    ex4; break;                                      \
+        case shader:  ex1; break;                                    \
+        case texture: ex2; break;                                    \
+        case scene:   ex3; break;                                    \
     }
 
+/**
+ * @brief Where every node is allocated from. This only exists while
+ * there are nodes alive.
+ */
+static MemoryPool* _node_pool = NULL;
+
+/**
+ * @brief The number of nodes the node pool grows by at a time.
+ */
+#define __NODE_POOL_BLOCK 64
+
 Node* __CreateNode(NodeType type, const char* name, void* contents)
 {
-    Node* created_node = __MALLOC(
-        Node, created_node,
-        ("Failed to allocate node '%s'. Code: %d.", name, errno));
+    if (_node_pool == NULL)
+        _node_pool =
+            CreatePool("nodes", sizeof(Node), __NODE_POOL_BLOCK);
+    Node* created_node = PoolAllocate(_node_pool);
     created_node->next = NULL;
     created_node->name = name;
     created_node->type = type;
 
     __TYPE_SWITCH(type, created_node->contents.shader = contents,
                   created_node->contents.texture = contents,
-                  created_node->contents.instance = contents,
                   created_node->contents.scene = contents);
 
     return created_node;
@@ -47,9 +57,18 @@ void KillLinkedList(LinkedList* list)
     {
         Node* next_node = current_node->next;
         KillNode(current_node);
+        PoolFree(_node_pool, current_node);
         current_node = next_node;
     }
 
+    // Give the pool's memory back once the last node is gone.
+    if (_node_pool->statistics.allocations ==
+        _node_pool->statistics.frees)
+    {
+        KillPool(_node_pool);
+        _node_pool = NULL;
+    }
+
     __FREE(list,
            ("The linked list freer was given an invalid list."));
 }
@@ -58,8 +77,8 @@ void KillLinkedList(LinkedList* list)
 __BOOLEAN VerifyNodeContents(NodeType type, NodeContents* contents)
 {
     if (type == shader && contents->shader != 0) return true;
-    else if (type == texture && contents->texture->texture != 0 &&
-             contents->texture->vao != 0)
+    else if (type == texture &&
+             GetTextureHandle(contents->texture) != 0)
         return true;
 
     return false;
@@ -13,6 +13,8 @@
 
 // Provides the various type definitions used in this file.
 #include <Declarations.h>
+// Provides the pool every node is allocated from.
+#include <Memory.h>
 // Provides shader loading and management functionality.
 #include <Scene.h>
 #include <Shader.h>
@@ -35,7 +37,6 @@ typedef enum NodeType
      * information associated with it.
      */
     texture,
-    instance,
     /**
      * @brief The node contains a scene object.
      */
@@ -58,7 +59,6 @@ typedef union NodeContents
      * it.
      */
     Texture* texture;
-    TextureInstance* instance;
     /**
      * @brief
      */
@@ -86,14 +86,10 @@ typedef struct LinkedList
 
 #define CreateShaderNode(name)                                       \
     __CreateNode(shader, name, LoadShader(name))
-#define CreateTextureNode(name, swidth, sheight)                     \
-    __CreateNode(texture, name,                                      \
-                 CreateTexture(name, tileset, swidth, sheight))
-#define RegisterTextureNode(name, from, x, y, z, scale, brightness,  \
-                            rotation)                                \
+#define CreateTextureNode(name, atlas, swidth, sheight)              \
     __CreateNode(                                                    \
-        instance, name,                                              \
-        RegisterTexture(from, x, y, z, scale, brightness, rotation))
+        texture, name,                                               \
+        CreateTexture(name, tileset, atlas, swidth, sheight))
 
 // stupid fucking solution
 Node* __CreateNode(NodeType type, const char* name, void* contents);
@@ -107,7 +103,6 @@ LinkedList* CreateLinkedList(Node* head);
         current_node->type,                                          \
         KillShader(current_node->contents.shader),                   \
         KillTexture(current_node->contents.texture),                 \
-        DeregisterTexture(current_node->contents.instance),          \
         KillScene(current_node->contents.scene))
 
 void KillLinkedList(LinkedList* list);
@@ -1,6 +1,136 @@
 #include "Map.h"
 #include <Logger.h>
 
+/**
+ * @brief Widen the given key into a 64-bit value, so keys of every
+ * type can be hashed and compared the same way.
+ * @param key_type The type of the key.
+ * @param key A pointer to the key.
+ * @return The widened key.
+ */
+__INLINE u64 _ReadKey(AmbiguousTypeSpecifier key_type, void* key)
+{
+#define WIDEN(state, size) return (u64)VPTT(state##size, key);
+    __AMBIGUOUS_BODY(key_type, WIDEN);
+    return 0;
+}
+
+/**
+ * @brief Hash the given widened key. Each key width gets its own
+ * function; 8-bit keys already spread perfectly and are used as-is,
+ * while wider keys go through a finalizer so that sequential keys
+ * don't all clump together.
+ * @param key_type The type of the key.
+ * @param key The widened key.
+ * @return The hash of the key.
+ */
+__INLINE u64 _HashKey(AmbiguousTypeSpecifier key_type, u64 key)
+{
+    switch (key_type)
+    {
+        case unsigned8:
+        case signed8:    return (u8)key;
+        case unsigned32:
+        case signed32:
+        {
+            // The 32-bit murmur3 finalizer.
+            u32 hash = (u32)key;
+            hash ^= hash >> 16;
+            hash *= 0x85EBCA6BU;
+            hash ^= hash >> 13;
+            hash *= 0xC2B2AE35U;
+            return hash ^ (hash >> 16);
+        }
+        default:
+            // The 64-bit murmur3 finalizer.
+            key ^= key >> 33;
+            key *= 0xFF51AFD7ED558CCDULL;
+            key ^= key >> 33;
+            key *= 0xC4CEB9FE1A85EC53ULL;
+            return key ^ (key >> 33);
+    }
+}
+
+/**
+ * @brief Place the given pair into the map's slots, without checking
+ * whether its key is already present or whether the map has room.
+ * @param map The map to place within.
+ * @param pair The pair to place. Its distance is overwritten.
+ */
+void _PlaceKeyPair(Map* map, KeyPair pair)
+{
+    const u32 mask = map->max_size - 1;
+    u32 index =
+        _HashKey(map->key_type, _ReadKey(map->key_type, &pair.key)) &
+        mask;
+    pair.distance = 1;
+
+    while (map->map_values[index].distance != 0)
+    {
+        // Whichever pair is closer to home gives up its slot and
+        // carries on probing in our place.
+        if (map->map_values[index].distance < pair.distance)
+        {
+            KeyPair displaced = map->map_values[index];
+            map->map_values[index] = pair;
+            pair = displaced;
+        }
+        index = (index + 1) & mask;
+        pair.distance++;
+    }
+
+    map->map_values[index] = pair;
+    map->filled_size++;
+}
+
+/**
+ * @brief Double the number of slots in the map, and rehash every pair
+ * into the new slots.
+ * @param map The map to grow.
+ */
+void _GrowMap(Map* map)
+{
+    KeyPair* old_values = map->map_values;
+    u32 old_size = map->max_size;
+
+    map->max_size *= 2;
+    map->filled_size = 0;
+    map->map_values = calloc(map->max_size, sizeof(KeyPair));
+    if (map->map_values == NULL)
+        PrintError("Failed to grow a map to %d slots. Code: %d.",
+                   map->max_size, errno);
+
+    for (u32 index = 0; index < old_size; index++)
+        if (old_values[index].distance != 0)
+            _PlaceKeyPair(map, old_values[index]);
+    free(old_values);
+}
+
+/**
+ * @brief Find the slot of the given key.
+ * @param map The map to search.
+ * @param key A pointer to the key.
+ * @return The index of the key's slot, or the map's size if the key
+ * isn't present.
+ */
+u32 _FindKeySlot(Map* map, void* key)
+{
+    const u32 mask = map->max_size - 1;
+    const u64 wanted = _ReadKey(map->key_type, key);
+    u32 index = _HashKey(map->key_type, wanted) & mask;
+
+    // Since pairs are kept sorted by distance along a probe sequence,
+    // we can stop as soon as we've gone further than the key could
+    // possibly be.
+    for (u32 distance = 1;
+         map->map_values[index].distance >= distance;
+         distance++, index = (index + 1) & mask)
+        if (_ReadKey(map->key_type, &map->map_values[index].key) ==
+            wanted)
+            return index;
+    return map->max_size;
+}
+
 Map* CreateMap(AmbiguousTypeSpecifier key_type,
                AmbiguousTypeSpecifier value_type, u32 max_size)
 {
@@ -9,15 +139,21 @@ Map* CreateMap(AmbiguousTypeSpecifier key_type,
         ("Failed to allocate map with keypair %dx%d and size "
          "%d. Code: %d",
          key_type, value_type, max_size, errno));
-    created_map->max_size = max_size;
+
+    // Size the map so that the expected number of pairs fits without
+    // growing.
+    u32 slot_count = 8;
+    while (slot_count * MAP_MAX_LOAD / 8 < max_size) slot_count *= 2;
+
+    created_map->max_size = slot_count;
     created_map->filled_size = 0;
     created_map->key_type = key_type;
     created_map->value_type = value_type;
-    created_map->map_values = __MALLOC(
-        KeyPair, created_map->map_values,
-        ("Failed to allocate map value array of type %dx%d and "
-         "size %d. Code: %d.",
-         key_type, value_type, max_size, errno));
+    created_map->map_values = calloc(slot_count, sizeof(KeyPair));
+    if (created_map->map_values == NULL)
+        PrintError("Failed to allocate map value array of type %dx%d "
+                   "and size %d. Code: %d.",
+                   key_type, value_type, slot_count, errno);
 
     return created_map;
 }
@@ -31,22 +167,25 @@ void KillMap(Map* map)
 
 void __AppendMapItem(Map* map, void* key, void* value)
 {
-    for (u32 index = 0; index < map->max_size; index++)
+    u32 index = _FindKeySlot(map, key);
+    if (index != map->max_size)
     {
-        if (map->map_values[index].set == true) continue;
-        map->map_values[index] =
-            CreateKeyPair(map->key_type, map->value_type, key, value);
-        map->filled_size++;
-
+        AssignAmbiguousType(&map->map_values[index].value,
+                            map->value_type, value);
         return;
     }
+
+    if ((map->filled_size + 1) * 8 > map->max_size * MAP_MAX_LOAD)
+        _GrowMap(map);
+    _PlaceKeyPair(map, CreateKeyPair(map->key_type, map->value_type,
+                                     key, value));
 }
 
 KeyPair CreateKeyPair(AmbiguousTypeSpecifier key_type,
                       AmbiguousTypeSpecifier value_type, void* key,
                       void* value)
 {
-    KeyPair created = {true};
+    KeyPair created = {1};
     AssignAmbiguousType(&created.key, key_type, key);
     AssignAmbiguousType(&created.value, value_type, value);
 
@@ -55,48 +194,43 @@ KeyPair CreateKeyPair(AmbiguousTypeSpecifier key_type,
 
 void* __GetMapItemValue(Map* map, void* key_value)
 {
-    for (u32 index = 0; index < map->max_size; index++)
-    {
-        if (!CompareAmbiguousType(&map->map_values[index].key,
-                                  map->key_type, key_value))
-            continue;
+    u32 index = _FindKeySlot(map, key_value);
+    if (index == map->max_size) return NULL;
 
-        return GetAmbiguousType(&map->map_values[index].value,
-                                map->value_type);
-    }
-    return NULL;
+    return GetAmbiguousType(&map->map_values[index].value,
+                            map->value_type);
 }
 
 void __RemoveMapItem(Map* map, void* key)
 {
-    for (u32 index = 0; index < map->max_size; index++)
+    u32 index = _FindKeySlot(map, key);
+    if (index == map->max_size) return;
+
+    // Shift every following pair of the probe sequence back a slot,
+    // until we hit an empty slot or a pair already at home.
+    const u32 mask = map->max_size - 1;
+    u32 next = (index + 1) & mask;
+    while (map->map_values[next].distance > 1)
     {
-        if (!CompareAmbiguousType(&map->map_values[index].key,
-                                  map->key_type, key))
-            continue;
-
-        for (u32 inner_index = index; inner_index < map->max_size - 1;
-             inner_index++)
-            map->map_values[inner_index] =
-                map->map_values[inner_index + 1];
+        map->map_values[index] = map->map_values[next];
+        map->map_values[index].distance--;
+        index = next;
+        next = (next + 1) & mask;
     }
+
+    map->map_values[index].distance = 0;
+    map->filled_size--;
 }
 
 KeyPair* __GetMapKeyPair(Map* map, void* key)
 {
-    for (u32 index = 0; index < map->max_size; index++)
-    {
-        if (!CompareAmbiguousType(&map->map_values[index].key,
-                                  map->key_type, key))
-            continue;
-
-        return &map->map_values[index];
-    }
-    return NULL;
+    u32 index = _FindKeySlot(map, key);
+    if (index == map->max_size) return NULL;
+    return &map->map_values[index];
 }
 
 void ClearMap(Map* map)
 {
-    free(map->map_values);
-    map->map_values = calloc(map->max_size, sizeof(KeyPair));
+    memset(map->map_values, 0, sizeof(KeyPair) * map->max_size);
+    map->filled_size = 0;
 }
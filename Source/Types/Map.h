@@ -13,19 +13,47 @@
 #include <Ambiguous.h>
 #include <Declarations.h>
 
+/**
+ * @brief The largest fraction of a map's slots that may be filled
+ * before the map grows, as a numerator over 8.
+ */
+#define MAP_MAX_LOAD 7
+
 typedef struct KeyPair
 {
-    u8 set;
+    /**
+     * @brief How far this pair sits from the slot its key hashes to,
+     * plus one. Zero marks an empty slot.
+     */
+    u32 distance;
     AmbiguousType key, value;
 } KeyPair;
 
+/**
+ * @brief An open-addressed Robin Hood hash map. Pairs that have
+ * probed further from home take the slots of pairs that haven't,
+ * which keeps every probe sequence short and lets removal shift pairs
+ * back instead of leaving tombstones.
+ */
 typedef struct Map
 {
+    /**
+     * @brief The number of slots in the map (always a power of two),
+     * and the number of them currently filled.
+     */
     u32 max_size, filled_size;
     AmbiguousTypeSpecifier value_type, key_type;
     KeyPair* map_values;
 } Map;
 
+/**
+ * @brief Create a map. Kills the process on failure.
+ * @param key_type The type of the map's keys.
+ * @param value_type The type of the map's values.
+ * @param max_size The number of pairs the map is expected to hold.
+ * This is only a hint; the map grows as needed.
+ * @return A pointer to the created map.
+ */
 Map* CreateMap(AmbiguousTypeSpecifier key_type,
                AmbiguousTypeSpecifier value_type, u32 max_size);
 void KillMap(Map* map);
@@ -37,6 +65,10 @@ void KillMap(Map* map);
         __AppendMapItem(map, (void*)&key_value,                      \
                         (void*)&value_value);                        \
     }
+/**
+ * @brief Insert a pair into the map. If the key is already present,
+ * its value is replaced instead.
+ */
 void __AppendMapItem(Map* map, void* key, void* value);
 
 #define GetMapItemValue(map, key_value)                              \
@@ -79,16 +111,9 @@ __INLINE void EditMapValue(Map* map, AmbiguousTypeSpecifier key_type,
                            AmbiguousTypeSpecifier value_type,
                            void* new_value)
 {
-    for (u32 index = 0; index < map->max_size; index++)
-    {
-        if (!CompareAmbiguousType(&map->map_values[index].key,
-                                  map->key_type, key))
-            continue;
-
-        AssignAmbiguousType(&map->map_values[index].value, value_type,
-                            new_value);
-        return;
-    }
+    KeyPair* pair = __GetMapKeyPair(map, key);
+    if (pair == NULL) return;
+    AssignAmbiguousType(&pair->value, value_type, new_value);
 }
 
 void ClearMap(Map* map);
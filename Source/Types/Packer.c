@@ -0,0 +1,174 @@
+#include "Packer.h"
+
+/**
+ * @brief The number of skyline segments a packer starts out with room
+ * for.
+ */
+#define __SKYLINE_DEFAULT_CAPACITY 64
+
+__CREATE_STRUCT_KILLFAIL(SkylinePacker)
+CreateSkylinePacker(u16 width, u16 height)
+{
+    SkylinePacker* packer = __MALLOC(
+        SkylinePacker, packer,
+        ("Failed to allocate a %dx%d packer. Code: %d.", width,
+         height, errno));
+    packer->width = width;
+    packer->height = height;
+    packer->node_capacity = __SKYLINE_DEFAULT_CAPACITY;
+    packer->skyline =
+        malloc(sizeof(SkylineNode) * packer->node_capacity);
+    if (packer->skyline == NULL)
+        PrintError("Failed to allocate the skyline of a %dx%d "
+                   "packer. Code: %d.",
+                   width, height, errno);
+
+    ResetSkylinePacker(packer);
+    return packer;
+}
+
+void ResetSkylinePacker(SkylinePacker* packer)
+{
+    // An empty packer is just one flat segment along the bottom.
+    packer->skyline[0] = (SkylineNode){0, 0, packer->width};
+    packer->node_count = 1;
+    packer->used_area = 0;
+}
+
+/**
+ * @brief Figure out how high a rectangle of the given width would sit
+ * if its left edge was placed at the given skyline segment.
+ * @param packer The packer to check.
+ * @param index The index of the skyline segment.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param y The resulting Y position of the rectangle.
+ * @return A boolean value; true if the rectangle fits, false if not.
+ */
+__BOOLEAN _FitSkylineNode(SkylinePacker* packer, u32 index, u16 width,
+                          u16 height, u16* y)
+{
+    if ((u32)packer->skyline[index].x + width > packer->width)
+        return false;
+
+    // Walk right across every segment the rectangle would cover; it
+    // has to sit on top of the tallest of them.
+    i32 remaining = width;
+    u16 top = 0;
+    for (; remaining > 0; index++)
+    {
+        if (packer->skyline[index].y > top)
+            top = packer->skyline[index].y;
+        if ((u32)top + height > packer->height) return false;
+        remaining -= packer->skyline[index].width;
+    }
+
+    *y = top;
+    return true;
+}
+
+/**
+ * @brief Insert a new segment into the skyline at the given index,
+ * growing the skyline array if needed.
+ */
+__KILLFAIL _InsertSkylineNode(SkylinePacker* packer, u32 index,
+                              SkylineNode node)
+{
+    if (packer->node_count == packer->node_capacity)
+    {
+        packer->node_capacity *= 2;
+        packer->skyline =
+            realloc(packer->skyline,
+                    sizeof(SkylineNode) * packer->node_capacity);
+        if (packer->skyline == NULL)
+            PrintError("Failed to grow a packer's skyline. Code: %d.",
+                       errno);
+    }
+
+    memmove(&packer->skyline[index + 1], &packer->skyline[index],
+            sizeof(SkylineNode) * (packer->node_count - index));
+    packer->skyline[index] = node;
+    packer->node_count++;
+}
+
+/**
+ * @brief Remove the skyline segment at the given index.
+ */
+__INLINE void _RemoveSkylineNode(SkylinePacker* packer, u32 index)
+{
+    memmove(&packer->skyline[index], &packer->skyline[index + 1],
+            sizeof(SkylineNode) * (packer->node_count - index - 1));
+    packer->node_count--;
+}
+
+__BOOLEAN PackRectangle(SkylinePacker* packer, u16 width, u16 height,
+                        PackerRect* placed)
+{
+    if (width == 0 || height == 0) return false;
+
+    // Find the segment that keeps the skyline the lowest after
+    // placement, breaking ties by picking the narrowest segment.
+    u32 best_index = UINT32_MAX, best_bottom = UINT32_MAX,
+        best_width = UINT32_MAX;
+    u16 best_y = 0;
+    for (u32 index = 0; index < packer->node_count; index++)
+    {
+        u16 y;
+        if (!_FitSkylineNode(packer, index, width, height, &y))
+            continue;
+
+        u32 bottom = (u32)y + height;
+        if (bottom < best_bottom ||
+            (bottom == best_bottom &&
+             packer->skyline[index].width < best_width))
+        {
+            best_index = index;
+            best_bottom = bottom;
+            best_width = packer->skyline[index].width;
+            best_y = y;
+        }
+    }
+    if (best_index == UINT32_MAX) return false;
+
+    *placed = (PackerRect){packer->skyline[best_index].x, best_y,
+                           width, height};
+    _InsertSkylineNode(
+        packer, best_index,
+        (SkylineNode){placed->x, (u16)(best_y + height), width});
+
+    // Shrink or remove every segment now hidden underneath the new
+    // one.
+    u32 index = best_index + 1;
+    while (index < packer->node_count)
+    {
+        SkylineNode *previous = &packer->skyline[index - 1],
+                    *current = &packer->skyline[index];
+        u32 previous_end = (u32)previous->x + previous->width;
+        if (current->x >= previous_end) break;
+
+        u32 shrink = previous_end - current->x;
+        if (current->width > shrink)
+        {
+            current->x += shrink;
+            current->width -= shrink;
+            break;
+        }
+        _RemoveSkylineNode(packer, index);
+    }
+
+    // Merge neighbouring segments that ended up at the same height.
+    for (index = 0; index + 1 < packer->node_count;)
+    {
+        if (packer->skyline[index].y != packer->skyline[index + 1].y)
+        {
+            index++;
+            continue;
+        }
+        packer->skyline[index].width +=
+            packer->skyline[index + 1].width;
+        _RemoveSkylineNode(packer, index + 1);
+    }
+
+    packer->used_area += (u64)width * height;
+    return true;
+}
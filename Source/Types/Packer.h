@@ -0,0 +1,116 @@
+/**
+ * @file Packer.h
+ * @author Zenais Argos
+ * @brief Provides a skyline rectangle packer, used to lay images out
+ * within texture atlas pages. This is purely CPU-side and never
+ * touches OpenGL, so it can be used both at runtime and by offline
+ * tooling.
+ * @date 2024-07-04
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_PACKER_
+#define _RENAI_PACKER_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the logging functions used by the inline functions below.
+#include <Logger.h>
+
+/**
+ * @brief A rectangle placed by the packer, in pixels.
+ */
+typedef struct PackerRect
+{
+    u16 x, y, width, height;
+} PackerRect;
+
+/**
+ * @brief A single segment of the packer's skyline; the top edge of
+ * everything packed so far within [x, x + width).
+ */
+typedef struct SkylineNode
+{
+    u16 x, y, width;
+} SkylineNode;
+
+/**
+ * @brief A skyline bottom-left rectangle packer. Every placement
+ * picks the position that keeps the skyline lowest, which gives good
+ * density for the roughly uniform tile and sprite sizes Renai deals
+ * with.
+ */
+typedef struct SkylinePacker
+{
+    /**
+     * @brief The dimensions of the area being packed into.
+     */
+    u16 width, height;
+    /**
+     * @brief The number of skyline segments in use, and how many the
+     * skyline array has room for.
+     */
+    u32 node_count, node_capacity;
+    /**
+     * @brief The skyline itself, sorted left to right.
+     */
+    SkylineNode* skyline;
+    /**
+     * @brief The total area of every rectangle packed so far.
+     */
+    u64 used_area;
+} SkylinePacker;
+
+/**
+ * @brief Create a packer covering an area of the given size.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ * @return A pointer to the created packer.
+ */
+__CREATE_STRUCT_KILLFAIL(SkylinePacker)
+CreateSkylinePacker(u16 width, u16 height);
+
+/**
+ * @brief Free the given packer and its skyline.
+ * @param packer The packer to kill.
+ */
+__INLINE void KillSkylinePacker(SkylinePacker* packer)
+{
+    free(packer->skyline);
+    __FREE(packer, ("The packer freer was given an invalid packer."));
+}
+
+/**
+ * @brief Forget everything placed within the packer, leaving its
+ * area entirely empty.
+ * @param packer The packer to reset.
+ */
+void ResetSkylinePacker(SkylinePacker* packer);
+
+/**
+ * @brief Try to find room for a rectangle of the given size.
+ * @param packer The packer to place within.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param placed The rectangle's final placement, if one was found.
+ * @return A boolean value; true if the rectangle was placed, false if
+ * the packer has no room for it.
+ */
+__BOOLEAN PackRectangle(SkylinePacker* packer, u16 width, u16 height,
+                        PackerRect* placed);
+
+/**
+ * @brief Get how much of the packer's area is covered by packed
+ * rectangles.
+ * @param packer The packer to query.
+ * @return The covered fraction of the area, from 0 to 1.
+ */
+__INLINE f32 GetPackerOccupancy(SkylinePacker* packer)
+{
+    return (f32)packer->used_area /
+           ((f32)packer->width * (f32)packer->height);
+}
+
+#endif // _RENAI_PACKER_
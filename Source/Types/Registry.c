@@ -0,0 +1,244 @@
+#include "Registry.h"
+
+/**
+ * @brief Every name interned so far, indexed by ID.
+ */
+static char** _interned_names = NULL;
+static u32 _interned_count = 0, _interned_capacity = 0;
+
+/**
+ * @brief An open-addressed table of interned IDs (plus one, so that
+ * zero marks an empty slot), keyed by the hash of their names.
+ */
+static u32* _intern_table = NULL;
+static u32 _intern_table_size = 0;
+
+/**
+ * @brief Hash the given string with 32-bit FNV-1a.
+ * @param name The string to hash.
+ * @return The hash of the string.
+ */
+__INLINE u32 _HashName(const char* name)
+{
+    u32 hash = 0x811C9DC5U;
+    for (; *name != '\0'; name++)
+        hash = (hash ^ (u8)*name) * 0x01000193U;
+    return hash;
+}
+
+/**
+ * @brief Double the size of the intern table, rehashing every name
+ * into it.
+ */
+void _GrowInternTable(void)
+{
+    u32 new_size =
+        (_intern_table_size == 0 ? 64 : _intern_table_size * 2);
+    u32* new_table = calloc(new_size, sizeof(u32));
+    if (new_table == NULL)
+        PrintError("Failed to grow the intern table to %d slots. "
+                   "Code: %d.",
+                   new_size, errno);
+
+    for (u32 id = 0; id < _interned_count; id++)
+    {
+        u32 index = _HashName(_interned_names[id]) & (new_size - 1);
+        while (new_table[index] != 0)
+            index = (index + 1) & (new_size - 1);
+        new_table[index] = id + 1;
+    }
+
+    free(_intern_table);
+    _intern_table = new_table;
+    _intern_table_size = new_size;
+}
+
+/**
+ * @brief Find the intern table slot of the given name.
+ * @param name The name to search for.
+ * @return The index of the name's slot if it's been interned, or the
+ * index of the empty slot it would be interned into if not.
+ */
+u32 _FindInternSlot(const char* name)
+{
+    const u32 mask = _intern_table_size - 1;
+    u32 index = _HashName(name) & mask;
+    for (; _intern_table[index] != 0; index = (index + 1) & mask)
+        if (strcmp(_interned_names[_intern_table[index] - 1], name) ==
+            0)
+            break;
+    return index;
+}
+
+u32 InternName(const char* name)
+{
+    // Keep the table at most half full, so probes stay short.
+    if ((_interned_count + 1) * 2 > _intern_table_size)
+        _GrowInternTable();
+
+    u32 index = _FindInternSlot(name);
+    if (_intern_table[index] != 0) return _intern_table[index] - 1;
+
+    if (_interned_count == _interned_capacity)
+    {
+        _interned_capacity =
+            (_interned_capacity == 0 ? 32 : _interned_capacity * 2);
+        _interned_names = realloc(_interned_names,
+                                  sizeof(char*) * _interned_capacity);
+        if (_interned_names == NULL)
+            PrintError("Failed to grow the interned name list. Code: "
+                       "%d.",
+                       errno);
+    }
+
+    _interned_names[_interned_count] = strdup(name);
+    if (_interned_names[_interned_count] == NULL)
+        PrintError("Failed to intern the name '%s'. Code: %d.", name,
+                   errno);
+    _intern_table[index] = ++_interned_count;
+    return _interned_count - 1;
+}
+
+const char* GetInternedName(u32 id) { return _interned_names[id]; }
+
+void KillInternedNames(void)
+{
+    for (u32 id = 0; id < _interned_count; id++)
+        free(_interned_names[id]);
+    free(_interned_names);
+    free(_intern_table);
+
+    _interned_names = NULL;
+    _intern_table = NULL;
+    _interned_count = _interned_capacity = _intern_table_size = 0;
+}
+
+__CREATE_STRUCT_KILLFAIL(Registry)
+CreateRegistry(const char* type_name, u32 capacity,
+               ResourceKiller killer)
+{
+    Registry* registry = __MALLOC(
+        Registry, registry,
+        ("Failed to allocate the %s registry. Code: %d.", type_name,
+         errno));
+    if (capacity == 0) capacity = 1;
+
+    registry->type_name = type_name;
+    registry->count = 0;
+    registry->capacity = capacity;
+    registry->free_count = 0;
+    registry->killer = killer;
+    registry->resources = malloc(sizeof(void*) * capacity);
+    registry->generations = malloc(sizeof(u32) * capacity);
+    registry->names = malloc(sizeof(u32) * capacity);
+    registry->free_slots = malloc(sizeof(u32) * capacity);
+    if (registry->resources == NULL ||
+        registry->generations == NULL || registry->names == NULL ||
+        registry->free_slots == NULL)
+        PrintError("Failed to allocate the slots of the %s registry. "
+                   "Code: %d.",
+                   type_name, errno);
+    registry->lookup = CreateMap(unsigned32, unsigned32, capacity);
+
+    return registry;
+}
+
+void KillRegistry(Registry* registry)
+{
+    if (registry->killer != NULL)
+        for (u32 index = 0; index < registry->count; index++)
+            if (registry->resources[index] != NULL)
+                registry->killer(registry->resources[index]);
+
+    KillMap(registry->lookup);
+    free(registry->resources);
+    free(registry->generations);
+    free(registry->names);
+    free(registry->free_slots);
+    __FREE(registry,
+           ("The registry freer was given an invalid registry."));
+}
+
+ResourceHandle RegisterResource(Registry* registry, const char* name,
+                                void* resource)
+{
+    u32 name_id = InternName(name);
+    if (GetMapItemValue(registry->lookup, name_id) != NULL)
+        PrintError("Tried to register the %s '%s' twice.",
+                   registry->type_name, name);
+
+    u32 index;
+    if (registry->free_count != 0)
+        index = registry->free_slots[--registry->free_count];
+    else
+    {
+        if (registry->count == registry->capacity)
+        {
+            registry->capacity *= 2;
+            registry->resources =
+                realloc(registry->resources,
+                        sizeof(void*) * registry->capacity);
+            registry->generations =
+                realloc(registry->generations,
+                        sizeof(u32) * registry->capacity);
+            registry->names = realloc(
+                registry->names, sizeof(u32) * registry->capacity);
+            registry->free_slots =
+                realloc(registry->free_slots,
+                        sizeof(u32) * registry->capacity);
+            if (registry->resources == NULL ||
+                registry->generations == NULL ||
+                registry->names == NULL ||
+                registry->free_slots == NULL)
+                PrintError("Failed to grow the %s registry to %d "
+                           "slots. Code: %d.",
+                           registry->type_name, registry->capacity,
+                           errno);
+        }
+
+        index = registry->count++;
+        registry->generations[index] = 1;
+    }
+
+    registry->resources[index] = resource;
+    registry->names[index] = name_id;
+    AppendMapItem(registry->lookup, name_id, index);
+
+    return (ResourceHandle){index, registry->generations[index]};
+}
+
+void RemoveResource(Registry* registry, ResourceHandle handle)
+{
+    if (!IsHandleValid(registry, handle))
+    {
+        PrintWarning("Tried to remove a stale %s handle.",
+                     registry->type_name);
+        return;
+    }
+
+    if (registry->killer != NULL)
+        registry->killer(registry->resources[handle.index]);
+    RemoveMapItem(registry->lookup, registry->names[handle.index]);
+
+    // Bumping the generation is what invalidates every outstanding
+    // handle to the slot.
+    registry->resources[handle.index] = NULL;
+    registry->generations[handle.index]++;
+    registry->free_slots[registry->free_count++] = handle.index;
+}
+
+ResourceHandle FindResource(Registry* registry, const char* name)
+{
+    // Anything that's never been interned can't have been registered,
+    // so there's no point interning it now.
+    if (_intern_table_size == 0) return NULL_HANDLE;
+    u32 name_slot = _FindInternSlot(name);
+    if (_intern_table[name_slot] == 0) return NULL_HANDLE;
+
+    void* index = GetMapItemValue(registry->lookup,
+                                  _intern_table[name_slot] - 1);
+    if (index == NULL) return NULL_HANDLE;
+
+    return (ResourceHandle){VPTT(u32, index),
+                            registry->generations[VPTT(u32, index)]};
+}
@@ -0,0 +1,209 @@
+/**
+ * @file Registry.h
+ * @author Zenais Argos
+ * @brief Provides the resource registry; a contiguous store of
+ * resources of a single type, looked up by name once and by handle
+ * every time after that. Names are interned into integers as they're
+ * registered, so nothing past load time ever compares strings.
+ * @date 2024-07-07
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_REGISTRY_
+#define _RENAI_REGISTRY_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the logging functions used by the inline functions below.
+#include <Logger.h>
+// Provides the map used to find resources by their interned names.
+#include <Map.h>
+
+/**
+ * @brief A reference to a resource within a registry. The generation
+ * of a handle must match that of its slot for the handle to be valid,
+ * so handles to removed resources are caught instead of silently
+ * pointing at whatever took their place.
+ */
+typedef struct ResourceHandle
+{
+    u32 index, generation;
+} ResourceHandle;
+
+/**
+ * @brief A handle that never refers to anything, since slot
+ * generations start at 1.
+ */
+#define NULL_HANDLE ((ResourceHandle){0, 0})
+
+/**
+ * @brief A function that frees a single resource of a registry.
+ */
+typedef void (*ResourceKiller)(void* resource);
+
+/**
+ * @brief A registry of resources of a single type.
+ */
+typedef struct Registry
+{
+    /**
+     * @brief What's stored in the registry, for use in log messages.
+     */
+    const char* type_name;
+    /**
+     * @brief The number of slots in use (live or freed), and the
+     * number the arrays below have room for.
+     */
+    u32 count, capacity;
+    /**
+     * @brief The resources themselves, indexed by handle. Freed slots
+     * hold NULL.
+     */
+    void** resources;
+    /**
+     * @brief The current generation of every slot.
+     */
+    u32* generations;
+    /**
+     * @brief The interned name of every slot's resource.
+     */
+    u32* names;
+    /**
+     * @brief The slots that have been freed and can be reused, used
+     * as a stack.
+     */
+    u32* free_slots;
+    u32 free_count;
+    /**
+     * @brief A map of interned names to slot indices.
+     */
+    Map* lookup;
+    /**
+     * @brief The function called on every live resource when the
+     * registry is killed.
+     */
+    ResourceKiller killer;
+} Registry;
+
+/**
+ * @brief Intern the given name, giving back the same integer for the
+ * same string every time. The string is copied, so it needn't outlive
+ * this call.
+ * @param name The name to intern.
+ * @return The interned ID of the name.
+ */
+u32 InternName(const char* name);
+
+/**
+ * @brief Get the string an interned ID was created from.
+ * @param id The interned ID.
+ * @return The interned string.
+ */
+const char* GetInternedName(u32 id);
+
+/**
+ * @brief Free every interned name. Every ID handed out is invalid
+ * after this.
+ */
+void KillInternedNames(void);
+
+/**
+ * @brief Create a registry. Kills the process on failure.
+ * @param type_name What the registry stores, for use in log messages.
+ * @param capacity The number of resources the registry is expected
+ * to hold. This is only a hint; the registry grows as needed.
+ * @param killer The function to free resources with once the registry
+ * is killed, or NULL if the registry doesn't own its resources.
+ * @return A pointer to the created registry.
+ */
+__CREATE_STRUCT_KILLFAIL(Registry)
+CreateRegistry(const char* type_name, u32 capacity,
+               ResourceKiller killer);
+
+/**
+ * @brief Free the given registry, and every resource still within it.
+ * @param registry The registry to kill.
+ */
+void KillRegistry(Registry* registry);
+
+/**
+ * @brief Add a resource to the registry under the given name. Kills
+ * the process if the name is already taken.
+ * @param registry The registry to add to.
+ * @param name The name of the resource.
+ * @param resource The resource itself.
+ * @return The handle of the resource.
+ */
+ResourceHandle RegisterResource(Registry* registry, const char* name,
+                                void* resource);
+
+/**
+ * @brief Remove a resource from the registry, freeing it. Every
+ * handle to it is invalid after this.
+ * @param registry The registry to remove from.
+ * @param handle The handle of the resource.
+ */
+void RemoveResource(Registry* registry, ResourceHandle handle);
+
+/**
+ * @brief Find the handle of the resource with the given name. This is
+ * meant to be called once, at load time; the handle should be kept
+ * for everything after that.
+ * @param registry The registry to search.
+ * @param name The name of the resource.
+ * @return The resource's handle, or @ref NULL_HANDLE if the registry
+ * has nothing by that name.
+ */
+ResourceHandle FindResource(Registry* registry, const char* name);
+
+/**
+ * @brief Check whether the given handle refers to a live resource.
+ * @param registry The registry the handle belongs to.
+ * @param handle The handle to check.
+ * @return A boolean value; true if the handle is valid, false if not.
+ */
+__INLINE __BOOLEAN IsHandleValid(Registry* registry,
+                                 ResourceHandle handle)
+{
+    return handle.index < registry->count &&
+           registry->generations[handle.index] == handle.generation;
+}
+
+/**
+ * @brief Get the resource the given handle refers to. In debug
+ * builds, stale or foreign handles kill the process; otherwise they
+ * aren't checked at all.
+ * @param registry The registry the handle belongs to.
+ * @param handle The handle of the resource.
+ * @return The resource.
+ */
+__INLINE void* __GetResource(Registry* registry,
+                            ResourceHandle handle)
+{
+#ifdef DEBUG_MODE
+    if (!IsHandleValid(registry, handle))
+        PrintError("Used a stale %s handle (slot %d, generation %d).",
+                   registry->type_name, handle.index,
+                   handle.generation);
+#endif
+    return registry->resources[handle.index];
+}
+
+/**
+ * @brief Get the resource the given handle refers to, as the given
+ * type.
+ */
+#define GetResource(registry, handle, type)                          \
+    ((type*)__GetResource(registry, handle))
+
+/**
+ * @brief Get the resource in the given slot of the registry, as the
+ * given type. This is for iterating over every resource; freed slots
+ * give NULL.
+ */
+#define GetResourceSlot(registry, slot, type)                        \
+    ((type*)(registry)->resources[slot])
+
+#endif // _RENAI_REGISTRY_
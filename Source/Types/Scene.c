@@ -1,160 +1,503 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_assets
 #include "Scene.h"
-#include <LinkedList.h>
+#include <fcntl.h>
 #include <stbi/stb_image.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#define __READ_STRING(buffer, length, file)                          \
-    fread(buffer, length, 1, file);                                  \
-    buffer[length] = '\0'
-
-LinkedList* LoadScenes(f32 window_width, f32 window_height)
+/**
+ * @brief Copy the given number of bytes out of the mapped scene file,
+ * killing the process if the read would run past the end of it.
+ * @param file The file to read from.
+ * @param offset The offset to start reading at.
+ * @param destination The buffer to copy into.
+ * @param length The number of bytes to copy.
+ */
+__KILLFAIL _ReadSceneBytes(SceneFile* file, u64 offset,
+                           void* destination, u64 length)
 {
-    LinkedList* loaded_scenes = NULL;
+    if (offset + length > file->size || offset + length < offset)
+        PrintError("Loaded scene file is truncated/malformed. Unable "
+                   "to continue.");
+    memcpy(destination, file->data + offset, length);
+}
 
-    FILE* scene_file = fopen("./Assets/scenes.resource", "rb");
-    if (scene_file == NULL)
+__CREATE_STRUCT_KILLFAIL(SceneFile) OpenSceneFile(void)
+{
+    i32 descriptor = open(SCENE_FILE_PATH, O_RDONLY);
+    if (descriptor < 0)
         PrintError("Renai seems to not have a scene file.");
 
-    u8 header_beginning[2];
-    fread(header_beginning, 1, 2, scene_file);
-    if (header_beginning[0] != 0xFF || header_beginning[1] != 0x01)
+    struct stat file_stats;
+    if (fstat(descriptor, &file_stats) < 0 ||
+        file_stats.st_size < SCENE_HEADER_SIZE)
         PrintError("Loaded scene file has been tampered with/is "
                    "malformed. Unable to continue.");
 
-    u8 version[3];
-    fread(version, 1, 3, scene_file);
-    CheckVersionDifference("scenes", version);
+    SceneFile* file = __MALLOC(
+        SceneFile, file,
+        ("Failed to allocate space for the scene file. Code: %d.",
+         errno));
+    file->size = file_stats.st_size;
+    file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE,
+                      descriptor, 0);
+    // The mapping keeps its own reference to the file, so the
+    // descriptor isn't needed anymore.
+    close(descriptor);
+    if (file->data == MAP_FAILED)
+        PrintError("Failed to map the scene file. Code: %d.", errno);
 
-    u16 scene_count;
-    fread(&scene_count, 2, 1, scene_file);
-
-    u8 header_end[2];
-    fread(header_end, 1, 2, scene_file);
-    if (header_end[0] != 0xFF || header_end[1] != 0x02)
+    u8 header[SCENE_HEADER_SIZE];
+    _ReadSceneBytes(file, 0, header, SCENE_HEADER_SIZE);
+    if (header[0] != 0xFF || header[1] != 0x01 || header[8] != 0xFF ||
+        header[9] != 0x02)
         PrintError("Loaded scene file has been tampered with/is "
                    "malformed. Unable to continue.");
 
-    for (u16 scene_index = 0; scene_index < scene_count;
-         scene_index++)
+    CheckVersionDifference("scenes", header + 2);
+    if (header[5] != SCENE_FORMAT_VERSION)
+        PrintError("The scene file on your device uses format %d, "
+                   "but Renai expects format %d. Please regenerate "
+                   "it.",
+                   header[5], SCENE_FORMAT_VERSION);
+    memcpy(&file->scene_count, header + 6, 2);
+
+    file->entries =
+        malloc(sizeof(SceneFileEntry) * file->scene_count);
+    if (file->entries == NULL && file->scene_count != 0)
+        PrintError("Failed to allocate the scene file's table of "
+                   "contents. Code: %d.",
+                   errno);
+
+    for (u16 index = 0; index < file->scene_count; index++)
+    {
+        u64 entry_offset =
+            SCENE_HEADER_SIZE + (u64)index * SCENE_ENTRY_SIZE;
+        SceneFileEntry* entry = &file->entries[index];
+        _ReadSceneBytes(file, entry_offset, entry->name, 32);
+        _ReadSceneBytes(file, entry_offset + 32, &entry->offset, 8);
+        _ReadSceneBytes(file, entry_offset + 40, &entry->length, 8);
+        entry->name[31] = '\0';
+
+        if (entry->offset > file->size ||
+            entry->length > file->size - entry->offset)
+            PrintError("Scene '%s' runs past the end of the scene "
+                       "file. Unable to continue.",
+                       entry->name);
+    }
+
+    PrintSuccess("Mapped the scene file (%d scenes, %lu bytes).",
+                 file->scene_count, file->size);
+    return file;
+}
+
+void CloseSceneFile(SceneFile* file)
+{
+    munmap((void*)file->data, file->size);
+    free(file->entries);
+    __FREE(file,
+           ("The scene file closer was given an invalid file."));
+}
+
+__GET_STRUCT(SceneFileEntry)
+FindSceneEntry(SceneFile* file, const char* name)
+{
+    for (u16 index = 0; index < file->scene_count; index++)
+        if (strcmp(file->entries[index].name, name) == 0)
+            return &file->entries[index];
+    return NULL;
+}
+
+/**
+ * @brief A single image decode, run on the job system while a scene
+ * loads.
+ */
+typedef struct _DecodeJob
+{
+    /**
+     * @brief The job itself. This must stay the first member, so the
+     * job's data pointer can be the decode job.
+     */
+    Job job;
+    /**
+     * @brief The name of the image. This is null padded within the
+     * file, so it can be pointed to directly for as long as the file
+     * is mapped.
+     */
+    const char* name;
+    /**
+     * @brief The encoded image, within the mapped scene file.
+     */
+    const u8* image;
+    u64 image_size;
+    /**
+     * @brief The decoded RGBA8 pixels, or NULL if decoding failed.
+     */
+    u8* pixels;
+    i32 width, height;
+    /**
+     * @brief Where the finished job is handed back to the context
+     * thread.
+     */
+    CompletionQueue* completed;
+} _DecodeJob;
+
+/**
+ * @brief Decode a single image. This is run by the job system's
+ * workers, so it mustn't touch OpenGL or anything else tied to the
+ * context thread.
+ * @param data The @ref _DecodeJob to run.
+ */
+void _DecodeImage(void* data)
+{
+    _DecodeJob* decode = data;
+    i32 image_channels;
+    decode->pixels = stbi_load_from_memory(
+        decode->image, decode->image_size, &decode->width,
+        &decode->height, &image_channels, 4);
+    PushCompletion(decode->completed, decode);
+}
+
+/**
+ * @brief Free a texture of a scene's texture registry.
+ */
+void _KillSceneTexture(void* texture) { KillTexture(texture); }
+
+/**
+ * @brief Decode every image of a scene on the job system and pack
+ * them into the scene's atlas, registering a texture for each. This
+ * is what happens when the scene hasn't been cooked.
+ * @param file The mapped scene file.
+ * @param entry The scene's entry within the file.
+ * @param jobs The job system to decode on.
+ * @param scene The scene being loaded.
+ * @param names The names of the scene's images, in file order.
+ * @param offset The offset of the scene's asset table, which must
+ * already have been validated.
+ * @param asset_count The number of images.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ */
+__KILLFAIL _DecodeSceneImages(SceneFile* file, SceneFileEntry* entry,
+                              JobSystem* jobs, Scene* scene,
+                              const char** names, u64 offset,
+                              u16 asset_count, f32 window_width,
+                              f32 window_height)
+{
+    _DecodeJob* decodes =
+        ScratchAllocate(sizeof(_DecodeJob) * asset_count);
+    CompletionQueue* completed = CreateCompletionQueue(asset_count);
+
+    for (u16 asset_index = 0; asset_index < asset_count;
+         asset_index++, offset += SCENE_ASSET_SIZE)
     {
-        Scene* current_scene =
-            __MALLOC(Scene, current_scene,
-                     ("Failed to allocate space for a scene."));
-        current_scene->scene_contents = NULL;
-
-        u16 scene_data_lengths[3];
-        fread(scene_data_lengths, 2, 3, scene_file);
-
-        __READ_STRING(current_scene->name, scene_data_lengths[0],
-                      scene_file);
-        __READ_STRING(current_scene->description,
-                      scene_data_lengths[1], scene_file);
-
-        for (u16 texture_list_index = 0;
-             texture_list_index < scene_data_lengths[2];
-             texture_list_index++)
+        _DecodeJob* decode = &decodes[asset_index];
+        u64 image_offset, image_size;
+        _ReadSceneBytes(file, offset + 64, &image_offset, 8);
+        _ReadSceneBytes(file, offset + 72, &image_size, 8);
+
+        decode->job.function = _DecodeImage;
+        decode->job.data = decode;
+        decode->name = names[asset_index];
+        decode->image = file->data + image_offset;
+        decode->image_size = image_size;
+        decode->completed = completed;
+        SubmitJob(jobs, &decode->job);
+    }
+
+    // Images finish decoding in whatever order the workers get to
+    // them, but they're always packed in file order, so the atlas
+    // comes out the same no matter how many threads there are.
+    bool* decoded = ScratchAllocate(sizeof(bool) * asset_count);
+    memset(decoded, 0, sizeof(bool) * asset_count);
+    u16 next_asset = 0;
+    for (u16 received = 0; received < asset_count; received++)
+    {
+        _DecodeJob* finished = PopCompletion(completed, true);
+        decoded[finished - decodes] = true;
+
+        for (; next_asset < asset_count && decoded[next_asset];
+             next_asset++)
         {
-            u8 file_name_length;
-            fread(&file_name_length, 1, 1, scene_file);
-
-            char file_name[file_name_length];
-            __READ_STRING(file_name, file_name_length, scene_file);
-
-            u64 image_size;
-            fread(&image_size, 8, 1, scene_file);
-            u8 image[image_size];
-            fread(image, 1, image_size, scene_file);
-
-            Texture* loaded_texture = CreateTextureFromMemory(
-                file_name, image, image_size, tileset, window_width,
-                window_height);
-
-            if (current_scene->scene_contents == NULL)
-                current_scene->scene_contents = CreateLinkedList(
-                    __CreateNode(texture, loaded_texture->name,
-                                 loaded_texture));
-            else
-                AppendNode(current_scene->scene_contents,
-                           __CreateNode(texture, loaded_texture->name,
-                                        loaded_texture));
-            // printf("\n\n");
-            // printf("%s\n", GetNode(current_scene->scene_contents,
-            //                        "texture_missing.jpg")
-            //                    ->name);
-            printf("\n\n%s\n",
-                   current_scene->scene_contents->first_node->name);
+            _DecodeJob* decode = &decodes[next_asset];
+            if (decode->pixels == NULL)
+            {
+                PrintWarning("Failed to decode the image '%s'.",
+                             decode->name);
+                continue;
+            }
+
+            Texture* loaded_texture = CreateTextureFromPixels(
+                decode->name, tileset, scene->atlas, scene->arena,
+                decode->pixels, decode->width, decode->height,
+                window_width, window_height);
+            stbi_image_free(decode->pixels);
+            RegisterResource(scene->textures, loaded_texture->name,
+                             loaded_texture);
         }
-        printf("\n\n%s\n",
-               current_scene->scene_contents->first_node->name);
-
-        if (loaded_scenes == NULL)
-            loaded_scenes = CreateLinkedList(__CreateNode(
-                scene, current_scene->name, current_scene));
-        else
-            AppendNode(loaded_scenes,
-                       __CreateNode(scene, current_scene->name,
-                                    current_scene));
     }
+    KillCompletionQueue(completed);
 
-    return loaded_scenes;
+    // Every texture of the scene has been packed, so send the atlas
+    // pages off to the GPU.
+    UploadTextureAtlas(scene->atlas);
+}
+
+__CREATE_STRUCT_KILLFAIL(Scene)
+LoadScene(SceneFile* file, SceneFileEntry* entry, JobSystem* jobs,
+          f32 window_width, f32 window_height)
+{
+#ifdef DEBUG_MODE
+    // Load times are only ever reported in debug mode.
+    const u64 start_time = GetCurrentTimeNS();
+#endif
+
+    // Let the kernel know we're about to read the whole block, so it
+    // can start paging it in ahead of the decoders.
+    const u64 page_size = sysconf(_SC_PAGESIZE),
+              aligned_offset = entry->offset & ~(page_size - 1);
+    madvise((void*)(file->data + aligned_offset),
+            entry->offset - aligned_offset + entry->length,
+            MADV_WILLNEED);
+
+    // Everything the scene owns that never changes size once it's
+    // loaded comes out of one arena, so unloading it is one free.
+    MemoryArena* arena = CreateArena(entry->name, 0);
+    Scene* loaded_scene = ArenaAllocate(arena, sizeof(Scene));
+    loaded_scene->arena = arena;
+    loaded_scene->atlas = CreateTextureAtlas(ATLAS_PAGE_SIZE);
+
+    u64 offset = entry->offset;
+    u16 scene_data_lengths[3];
+    _ReadSceneBytes(file, offset, scene_data_lengths, 6);
+    offset += 6;
+
+    if (scene_data_lengths[0] > 31 || scene_data_lengths[1] > 63)
+        PrintError("Scene '%s' has been tampered with/is malformed. "
+                   "Unable to continue.",
+                   entry->name);
+    _ReadSceneBytes(file, offset, loaded_scene->name,
+                    scene_data_lengths[0]);
+    loaded_scene->name[scene_data_lengths[0]] = '\0';
+    offset += scene_data_lengths[0];
+    _ReadSceneBytes(file, offset, loaded_scene->description,
+                    scene_data_lengths[1]);
+    loaded_scene->description[scene_data_lengths[1]] = '\0';
+    offset += scene_data_lengths[1];
+    // The entry goes away with the scene file, the scene's own name
+    // doesn't.
+    arena->name = loaded_scene->name;
+
+    const u16 asset_count = scene_data_lengths[2];
+    if (asset_count == 0)
+        PrintError("Scene '%s' has no loadable textures.",
+                   entry->name);
+    loaded_scene->textures =
+        CreateRegistry("texture", asset_count, _KillSceneTexture);
+    loaded_scene->world = CreateWorld(SCENE_WORLD_CAPACITY);
+
+    // Validate the whole asset table before anything is loaded, so a
+    // malformed file can't leave jobs running when we die. Names are
+    // null padded within the file, so they can be pointed to directly
+    // for as long as it's mapped.
+    const char** names =
+        ScratchAllocate(sizeof(const char*) * asset_count);
+    for (u16 asset_index = 0; asset_index < asset_count;
+         asset_index++)
+    {
+        const u64 asset_offset =
+            offset + (u64)asset_index * SCENE_ASSET_SIZE;
+        u64 image_offset, image_size;
+        _ReadSceneBytes(file, asset_offset + 64, &image_offset, 8);
+        _ReadSceneBytes(file, asset_offset + 72, &image_size, 8);
+        names[asset_index] = (const char*)(file->data + asset_offset);
+        if (names[asset_index][63] != '\0' ||
+            image_offset > file->size ||
+            image_size > file->size - image_offset)
+            PrintError("Asset %d of scene '%s' has been tampered "
+                       "with/is malformed. Unable to continue.",
+                       asset_index, entry->name);
+    }
+
+    // A cooked atlas goes straight to the GPU, so the scene's own
+    // images are only decoded if there isn't one.
+    char cooked_path[128];
+    snprintf(cooked_path, 128, COOKED_DIRECTORY "/%s.cooked",
+             loaded_scene->name);
+    const bool cooked = LoadCookedAtlas(
+        cooked_path, loaded_scene->atlas, loaded_scene->arena,
+        loaded_scene->textures, names, asset_count, window_width,
+        window_height);
+    if (!cooked)
+        _DecodeSceneImages(file, entry, jobs, loaded_scene, names,
+                           offset, asset_count, window_width,
+                           window_height);
+
+    // Every scene has to have the placeholder texture, since it's
+    // what gets drawn in place of anything that's missing.
+    loaded_scene->missing =
+        FindResource(loaded_scene->textures, "texture_missing.jpg");
+    if (!IsHandleValid(loaded_scene->textures, loaded_scene->missing))
+        PrintError("Scene '%s' has no placeholder texture.",
+                   entry->name);
+
+    // Maps live beside the scene file rather than within it, so they
+    // can be edited and saved without regenerating every scene. Only
+    // the chunks around the camera are ever read, by the streamer.
+    char map_path[128];
+    snprintf(map_path, 128, TILEMAP_DIRECTORY "/%s.tilemap",
+             loaded_scene->name);
+    loaded_scene->tilemap = OpenTilemapStream(map_path);
+    if (loaded_scene->tilemap != NULL)
+        ResolveTilemapTiles(loaded_scene->tilemap,
+                            loaded_scene->textures,
+                            loaded_scene->missing);
+
+#ifdef DEBUG_MODE
+    f64 load_time = NSToSeconds(GetCurrentTimeNS() - start_time);
+    PrintSuccess("Loaded scene '%s' (%d textures, %s) in %.2f ms; "
+                 "%.1f images/sec across %d threads.",
+                 loaded_scene->name, asset_count,
+                 (cooked ? "cooked" : "decoded"), load_time * 1000.0,
+                 asset_count / (load_time > 0.0 ? load_time : 1.0),
+                 jobs->worker_count + 1);
+#endif
+    return loaded_scene;
+}
+
+/**
+ * @brief Get the size of the given file in bytes, killing the process
+ * if it can't be opened.
+ * @param file_path The path of the file.
+ * @return The size of the file.
+ */
+u64 _GetAssetSize(const char* file_path)
+{
+    struct stat file_stats;
+    if (stat(file_path, &file_stats) < 0)
+        PrintError("Failed to find the scene asset '%s'. Code: %d.",
+                   file_path, errno);
+    return file_stats.st_size;
+}
+
+/**
+ * @brief Copy the entire contents of the given file onto the end of
+ * the scene file being written.
+ * @param created_scene The scene file being written.
+ * @param file_path The path of the file to copy.
+ */
+__KILLFAIL _CopyAsset(FILE* created_scene, const char* file_path)
+{
+    FILE* image_file = fopen(file_path, "rb");
+    if (image_file == NULL)
+        PrintError("Failed to open the scene asset '%s'. Code: %d.",
+                   file_path, errno);
+
+    u8 buffer[4096];
+    u64 read_size;
+    while ((read_size = fread(buffer, 1, 4096, image_file)) > 0)
+        fwrite(buffer, 1, read_size, created_scene);
+    fclose(image_file);
 }
 
 void CreateScenes(char** name_array, char** description_array,
                   char** texture_array, u16 texture_array_length,
                   u16 scene_count)
 {
-    FILE* created_scene = fopen("./Assets/scenes.resource", "wb");
+    FILE* created_scene = fopen(SCENE_FILE_PATH, "wb");
+    if (created_scene == NULL)
+        PrintError("Failed to create the scene file. Code: %d.",
+                   errno);
 
-    u8 header_beginning[5] = {0xFF, 0x01, MAJOR, MINOR, REVIS};
-    fwrite(header_beginning, 1, 5, created_scene);
-    fwrite(&scene_count, 2, 1, created_scene);
+    u8 header[SCENE_HEADER_SIZE] = {
+        0xFF, 0x01, MAJOR, MINOR, REVIS, SCENE_FORMAT_VERSION};
+    memcpy(header + 6, &scene_count, 2);
+    header[8] = 0xFF;
+    header[9] = 0x02;
+    fwrite(header, 1, SCENE_HEADER_SIZE, created_scene);
 
-    u8 header_end[2] = {0xFF, 0x02};
-    fwrite(&header_end, 1, 2, created_scene);
+    // Every scene currently references the same textures, so their
+    // sizes only need to be found once.
+    u64* asset_sizes = malloc(sizeof(u64) * texture_array_length);
+    char* asset_paths = malloc(128 * texture_array_length);
+    if ((asset_sizes == NULL || asset_paths == NULL) &&
+        texture_array_length != 0)
+        PrintError("Failed to allocate the scene assets' sizes. "
+                   "Code: %d.",
+                   errno);
 
-    for (u16 scene_list_index = 0; scene_list_index < scene_count;
-         scene_list_index++)
+    u64 assets_size = 0;
+    for (u16 index = 0; index < texture_array_length; index++)
     {
-        const char *scene_name = name_array[scene_list_index],
+        snprintf(asset_paths + index * 128, 128,
+                 "./Assets/Tilesets/%s", texture_array[index]);
+        asset_sizes[index] = _GetAssetSize(asset_paths + index * 128);
+        assets_size += asset_sizes[index];
+    }
+
+    // Since every block's size is known up front, the table of
+    // contents can be written before any of the blocks are.
+    u64 block_offset =
+        SCENE_HEADER_SIZE + (u64)scene_count * SCENE_ENTRY_SIZE;
+    for (u16 scene_index = 0; scene_index < scene_count;
+         scene_index++)
+    {
+        u8 entry[SCENE_ENTRY_SIZE] = {0};
+        strncpy((char*)entry, name_array[scene_index], 31);
+
+        u64 block_length = 6 + strlen(name_array[scene_index]) +
+                           strlen(description_array[scene_index]) +
+                           (u64)texture_array_length *
+                               SCENE_ASSET_SIZE +
+                           assets_size;
+        memcpy(entry + 32, &block_offset, 8);
+        memcpy(entry + 40, &block_length, 8);
+        fwrite(entry, 1, SCENE_ENTRY_SIZE, created_scene);
+
+        block_offset += block_length;
+    }
+
+    for (u16 scene_index = 0; scene_index < scene_count;
+         scene_index++)
+    {
+        const char *scene_name = name_array[scene_index],
                    *scene_description =
-                       description_array[scene_list_index];
+                       description_array[scene_index];
         u16 scene_lengths[3] = {strlen(scene_name),
                                 strlen(scene_description),
                                 texture_array_length};
         fwrite(&scene_lengths, 2, 3, created_scene);
         fprintf(created_scene, "%s%s", scene_name, scene_description);
 
-        for (u16 texture_list_index = 0;
-             texture_list_index < texture_array_length;
-             texture_list_index++)
+        // The asset table points at the image data that immediately
+        // follows it.
+        u64 image_offset =
+            ftell(created_scene) +
+            (u64)texture_array_length * SCENE_ASSET_SIZE;
+        for (u16 texture_index = 0;
+             texture_index < texture_array_length; texture_index++)
         {
-            const char* file_name = texture_array[texture_list_index];
-            u8 file_name_length = strlen(file_name);
-
-            fwrite(&file_name_length, 1, 1, created_scene);
-            fprintf(created_scene, "%s", file_name);
-
-            char file_path[128];
-            snprintf(file_path, 128, "./Assets/Tilesets/%s",
-                     file_name);
-
-            FILE* image_file = fopen(file_path, "rb");
-            fseek(image_file, 0, SEEK_END);
-            u64 image_size = ftell(image_file);
-            fseek(image_file, 0, SEEK_SET);
+            u8 asset[SCENE_ASSET_SIZE] = {0};
+            strncpy((char*)asset, texture_array[texture_index], 63);
+            memcpy(asset + 64, &image_offset, 8);
+            memcpy(asset + 72, &asset_sizes[texture_index], 8);
+            fwrite(asset, 1, SCENE_ASSET_SIZE, created_scene);
 
-            u8* image_contents = malloc(image_size);
-            fread(image_contents, image_size, 1, image_file);
-            fclose(image_file);
-
-            fwrite(&image_size, 8, 1, created_scene);
-            fwrite(image_contents, image_size, 1, created_scene);
-
-            free(image_contents);
+            image_offset += asset_sizes[texture_index];
         }
 
-        u8 file_end[2] = {0xFF, 0x03};
-        fwrite(&file_end, 1, 1, created_scene);
-
-        fclose(created_scene);
+        for (u16 texture_index = 0;
+             texture_index < texture_array_length; texture_index++)
+            _CopyAsset(created_scene,
+                       asset_paths + texture_index * 128);
     }
+    free(asset_sizes);
+    free(asset_paths);
+
+    u8 file_end[2] = {0xFF, 0x03};
+    fwrite(&file_end, 1, 2, created_scene);
+    fclose(created_scene);
 }
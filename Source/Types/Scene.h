@@ -11,16 +11,127 @@
 #ifndef _RENAI_SCENE_
 #define _RENAI_SCENE_
 
+#include <Cooked.h>
 #include <Declarations.h>
+#include <Jobs.h>
+#include <Registry.h>
 #include <Texture.h>
+#include <Tilemap.h>
+#include <World.h>
+
+/**
+ * @brief The path of the scene file, relative to the executable.
+ */
+#define SCENE_FILE_PATH "./Assets/scenes.resource"
+
+/**
+ * @brief The version of the scene file's container format. This is
+ * separate from the application version, and only changes when the
+ * layout of the file does.
+ */
+#define SCENE_FORMAT_VERSION 2
+
+/**
+ * @brief The size of a scene file's header, in bytes; the magic
+ * number, application version, format version, scene count, and end
+ * marker.
+ */
+#define SCENE_HEADER_SIZE 10
+
+/**
+ * @brief The size of a single table of contents entry, in bytes; a
+ * 32 byte name followed by a 64-bit offset and length.
+ */
+#define SCENE_ENTRY_SIZE 48
+
+/**
+ * @brief The size of a single asset table entry within a scene, in
+ * bytes; a 64 byte name followed by a 64-bit offset and length.
+ */
+#define SCENE_ASSET_SIZE 80
+
+/**
+ * @brief The number of entities a scene's world starts with room
+ * for.
+ */
+#define SCENE_WORLD_CAPACITY 1024
 
-typedef struct LinkedList LinkedList;
 typedef struct Scene
 {
-    LinkedList* scene_contents;
+    /**
+     * @brief The textures loaded by the scene. The registry owns its
+     * contents.
+     */
+    Registry* textures;
+    /**
+     * @brief Every entity placed within the scene.
+     */
+    World* world;
+    /**
+     * @brief The terrain of the scene, or NULL if the scene has no
+     * map file.
+     */
+    Tilemap* tilemap;
+    /**
+     * @brief The handle of the scene's placeholder texture, resolved
+     * once at load time.
+     */
+    ResourceHandle missing;
+    /**
+     * @brief The atlas every texture of the scene is packed into.
+     */
+    TextureAtlas* atlas;
+    /**
+     * @brief The arena the scene and its textures are allocated from,
+     * all of which is freed at once when the scene is killed.
+     */
+    MemoryArena* arena;
     char name[32], description[64];
 } Scene;
 
+/**
+ * @brief An entry in the scene file's table of contents, describing
+ * where in the file a scene's block lives.
+ */
+typedef struct SceneFileEntry
+{
+    /**
+     * @brief The name of the scene. This is always null terminated.
+     */
+    char name[32];
+    /**
+     * @brief The offset of the scene's block from the start of the
+     * file, and its length, in bytes.
+     */
+    u64 offset, length;
+} SceneFileEntry;
+
+/**
+ * @brief An opened scene file. The file is memory mapped for as long
+ * as it's open, so scenes are decoded straight from the mapped pages,
+ * and only the pages of scenes that actually get loaded are read.
+ */
+typedef struct SceneFile
+{
+    /**
+     * @brief The mapped contents of the file.
+     */
+    const u8* data;
+    /**
+     * @brief The size of the mapping, in bytes.
+     */
+    u64 size;
+    /**
+     * @brief The number of scenes within the file.
+     */
+    u16 scene_count;
+    /**
+     * @brief The file's table of contents, @ref scene_count entries
+     * long.
+     */
+    SceneFileEntry* entries;
+} SceneFile;
+
 /**
  * @brief Since we don't ship the program with scene files, we have to
  * generate them on first startup for use in the future. This takes in
@@ -31,13 +142,57 @@ void CreateScenes(char** name_array, char** description_array,
                   char** texture_array, u16 texture_array_length,
                   u16 scene_count);
 
-LinkedList* LoadScenes(f32 window_width, f32 window_height);
+/**
+ * @brief Open and map the scene file, and read its table of contents.
+ * None of the file's scenes are loaded by this. Kills the process if
+ * the file is missing or malformed.
+ * @return A pointer to the opened file.
+ */
+__CREATE_STRUCT_KILLFAIL(SceneFile) OpenSceneFile(void);
+
+/**
+ * @brief Unmap and close the given scene file. Any texture names
+ * pointing into the file are invalid after this.
+ * @param file The file to close.
+ */
+void CloseSceneFile(SceneFile* file);
+
+/**
+ * @brief Find the given scene within the scene file's table of
+ * contents.
+ * @param file The file to search.
+ * @param name The name of the scene.
+ * @return A pointer to the scene's entry, or NULL if the file has no
+ * scene of that name.
+ */
+__GET_STRUCT(SceneFileEntry)
+FindSceneEntry(SceneFile* file, const char* name);
+
+/**
+ * @brief Load a single scene from the scene file, decoding its images
+ * straight from the mapped file and uploading them into the scene's
+ * atlas. Decoding is spread across the job system, while packing and
+ * uploading stay on the calling (context) thread.
+ * @param file The file to load from.
+ * @param entry The table of contents entry of the scene to load.
+ * @param jobs The job system to decode the scene's images with.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ * @return A pointer to the loaded scene.
+ */
+__CREATE_STRUCT_KILLFAIL(Scene)
+LoadScene(SceneFile* file, SceneFileEntry* entry, JobSystem* jobs,
+          f32 window_width, f32 window_height);
 
 __INLINE void KillScene(Scene* scene)
 {
-    const char* name = scene->name;
-    __FREE(scene, ("The scene freer was given an invalid scene."));
-    PrintWarning("Freed scene '%s'.", name);
+    KillWorld(scene->world);
+    if (scene->tilemap != NULL) KillTilemap(scene->tilemap);
+    KillRegistry(scene->textures);
+    KillTextureAtlas(scene->atlas);
+    PrintWarning("Freed scene '%s'.", scene->name);
+    // The scene itself lives within its arena, so this goes last.
+    KillArena(scene->arena);
 }
 
 #endif // _RENAI_SCENE_
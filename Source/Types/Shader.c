@@ -1,4 +1,10 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_render
 #include "Shader.h"
+#include <Extensions.h>
+#include <StateCache.h>
+#include <sys/stat.h>
 
 __BOOLEAN _FileRead(FILE* file, char* buffer, i64 length)
 {
@@ -70,6 +76,272 @@ __KILLFAIL _GetCompilationError(u32 program, u8 type)
     }
 }
 
+/**
+ * @brief The shader cache's hit and miss counts since startup.
+ */
+static ShaderCacheStatistics _cache_statistics = {0};
+
+/**
+ * @brief Mix the given string into a running 64-bit FNV-1a hash,
+ * terminator included, so that ("ab", "c") and ("a", "bc") differ.
+ * @param hash The hash so far.
+ * @param string The string to mix in.
+ * @return The new hash.
+ */
+__INLINE u64 _MixCacheKey(u64 hash, const char* string)
+{
+    do hash = (hash ^ (u8)*string) * 0x100000001B3ULL;
+    while (*string++ != '\0');
+    return hash;
+}
+
+/**
+ * @brief Get the cache key of a shader; a hash of both its sources
+ * and the driver that's compiling them, since binaries are only valid
+ * for the exact driver that produced them.
+ * @param vertex_source The source of the vertex shader.
+ * @param fragment_source The source of the fragment shader.
+ * @return The cache key.
+ */
+u64 _GetShaderCacheKey(const char* vertex_source,
+                       const char* fragment_source)
+{
+    u64 hash = 0xCBF29CE484222325ULL;
+    hash = _MixCacheKey(hash, vertex_source);
+    hash = _MixCacheKey(hash, fragment_source);
+    hash = _MixCacheKey(hash, (const char*)glGetString(GL_VENDOR));
+    hash = _MixCacheKey(hash, (const char*)glGetString(GL_RENDERER));
+    return _MixCacheKey(hash, (const char*)glGetString(GL_VERSION));
+}
+
+/**
+ * @brief Try to load the given shader's program from the binary
+ * cache.
+ * @param name The name of the shader.
+ * @param cache_key The shader's current cache key.
+ * @return The linked program, or 0 if there was no usable binary.
+ */
+u32 _LoadCachedProgram(const char* name, u64 cache_key)
+{
+    const Extensions* extensions = GetExtensions();
+    if (!extensions->program_binary) return 0;
+
+    char cache_path[SHADER_PATH_MAX_LENGTH];
+    snprintf(cache_path, SHADER_PATH_MAX_LENGTH, "%s/%s.bin",
+             SHADER_CACHE_PATH, name);
+    FILE* cache_file = fopen(cache_path, "rb");
+    if (cache_file == NULL) return 0;
+
+    // The header; the magic number, binary format, cache key, and
+    // binary length.
+    u32 header[2], binary_length = 0;
+    u64 stored_key = 0;
+    void* binary = NULL;
+    if (fread(header, 4, 2, cache_file) == 2 &&
+        fread(&stored_key, 8, 1, cache_file) == 1 &&
+        fread(&binary_length, 4, 1, cache_file) == 1 &&
+        header[0] == SHADER_CACHE_MAGIC && stored_key == cache_key &&
+        binary_length != 0 &&
+        (binary = malloc(binary_length)) != NULL)
+    {
+        if (fread(binary, 1, binary_length, cache_file) !=
+            binary_length)
+        {
+            free(binary);
+            binary = NULL;
+        }
+    }
+    (void)fclose(cache_file);
+    if (binary == NULL) return 0;
+
+    u32 program = glCreateProgram();
+    extensions->ProgramBinary(program, header[1], binary,
+                              binary_length);
+    free(binary);
+
+    // Drivers are free to reject binaries whenever they like (after
+    // an update, for instance), so this can fail even with a matching
+    // key.
+    i32 success_flag = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success_flag);
+    if (!success_flag)
+    {
+        PrintWarning("The driver rejected the cached binary of "
+                     "shader '%s'.",
+                     name);
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    _cache_statistics.hits++;
+    return program;
+}
+
+/**
+ * @brief Write the given linked program into the binary cache. This
+ * is best effort; failing to write the cache isn't an error.
+ * @param name The name of the shader.
+ * @param cache_key The shader's cache key.
+ * @param program The linked program.
+ */
+void _StoreCachedProgram(const char* name, u64 cache_key,
+                         u32 program)
+{
+    const Extensions* extensions = GetExtensions();
+    if (!extensions->program_binary) return;
+
+    i32 binary_length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    void* binary = malloc(binary_length > 0 ? binary_length : 1);
+    if (binary_length <= 0 || binary == NULL)
+    {
+        free(binary);
+        return;
+    }
+
+    u32 header[2] = {SHADER_CACHE_MAGIC, 0};
+    extensions->GetProgramBinary(program, binary_length,
+                                 &binary_length, &header[1], binary);
+
+    // The directories might already exist, which is fine.
+    (void)mkdir(SHADER_CACHE_ROOT, 0755);
+    (void)mkdir(SHADER_CACHE_PATH, 0755);
+
+    // Write to a temporary file and move it into place, so a crash
+    // mid-write never leaves a truncated binary behind.
+    char cache_path[SHADER_PATH_MAX_LENGTH],
+        temporary_path[SHADER_PATH_MAX_LENGTH + 4];
+    snprintf(cache_path, SHADER_PATH_MAX_LENGTH, "%s/%s.bin",
+             SHADER_CACHE_PATH, name);
+    snprintf(temporary_path, SHADER_PATH_MAX_LENGTH + 4, "%s.tmp",
+             cache_path);
+
+    FILE* cache_file = fopen(temporary_path, "wb");
+    if (cache_file == NULL)
+    {
+        PrintWarning("Failed to open the cache file of shader '%s'. "
+                     "Code: %d.",
+                     name, errno);
+        free(binary);
+        return;
+    }
+
+    u32 stored_length = binary_length;
+    bool written =
+        fwrite(header, 4, 2, cache_file) == 2 &&
+        fwrite(&cache_key, 8, 1, cache_file) == 1 &&
+        fwrite(&stored_length, 4, 1, cache_file) == 1 &&
+        fwrite(binary, 1, stored_length, cache_file) == stored_length;
+    written = (fclose(cache_file) == 0) && written;
+    free(binary);
+
+    if (!written || rename(temporary_path, cache_path) != 0)
+    {
+        PrintWarning("Failed to write the cache file of shader '%s'.",
+                     name);
+        (void)remove(temporary_path);
+    }
+}
+
+/**
+ * @brief Compile and link a program from the given sources. Kills the
+ * process if either fails to compile or the program fails to link.
+ * @param vertex_raw The source of the vertex shader.
+ * @param fragment_raw The source of the fragment shader.
+ * @return The linked program.
+ */
+u32 _CompileProgram(const char* vertex_raw, const char* fragment_raw)
+{
+    _cache_statistics.misses++;
+
+    // Initialize the memory needed for the vertex and fragment
+    // shaders.
+    u32 vertex = glCreateShader(GL_VERTEX_SHADER),
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    // Set the source char* of the shaders, and fail if we can't.
+    _SetShaderSource(&vertex, vertex_raw);
+    _SetShaderSource(&fragment, fragment_raw);
+
+    // Try to compile each shader. If that fails, grab the error
+    // codes.
+    _GetCompilationError(vertex, 1);
+    _GetCompilationError(fragment, 1);
+
+    // Create the final program. This is basically just mashing the
+    // shaders together in a special way so they work together in a
+    // pipeline.
+    u32 program = glCreateProgram();
+    // Let the driver know we'll want the program's binary back, so it
+    // can be cached.
+    const Extensions* extensions = GetExtensions();
+    if (extensions->program_binary)
+        extensions->ProgramParameteri(
+            program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    // Attach each shader to the final program, ready to be compiled.
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    // Try to compile the final program. If that fails, kill the
+    // function.
+    _GetCompilationError(program, 0);
+
+    // Delete the now useless individual shader programs.
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    return program;
+}
+
+/**
+ * @brief Reflect every active uniform of the given linked shader into
+ * its uniform table, and bind its per-frame block (if it has one) to
+ * the shared binding.
+ * @param shader The shader to reflect.
+ */
+__KILLFAIL _ReflectShader(Shader* shader)
+{
+    i32 uniform_count = 0;
+    glGetProgramiv(shader->shader, GL_ACTIVE_UNIFORMS,
+                   &uniform_count);
+    shader->uniform_count = 0;
+    shader->uniforms =
+        malloc(sizeof(ShaderUniform) *
+               (uniform_count > 0 ? uniform_count : 1));
+    if (shader->uniforms == NULL)
+        PrintError("Failed to allocate the uniform table of shader "
+                   "'%s'. Code: %d.",
+                   shader->name, errno);
+
+    for (i32 index = 0; index < uniform_count; index++)
+    {
+        char uniform_name[64];
+        i32 name_length, size;
+        u32 type;
+        glGetActiveUniform(shader->shader, index, 64, &name_length,
+                           &size, &type, uniform_name);
+
+        // Uniforms within a block have no location of their own, and
+        // are set through the block's buffer instead.
+        i32 location =
+            glGetUniformLocation(shader->shader, uniform_name);
+        if (location < 0) continue;
+
+        // Arrays are reported as "name[0]"; we only want the name.
+        char* bracket = strchr(uniform_name, '[');
+        if (bracket != NULL) *bracket = '\0';
+
+        shader->uniforms[shader->uniform_count++] =
+            (ShaderUniform){InternName(uniform_name), location, type};
+    }
+
+    u32 block_index =
+        glGetUniformBlockIndex(shader->shader, FRAME_UNIFORM_BLOCK);
+    if (block_index != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader->shader, block_index,
+                              FRAME_UNIFORM_BINDING);
+
+    PrintSuccess("Reflected %d uniforms of shader '%s'.",
+                 shader->uniform_count, shader->name);
+}
+
 Shader* LoadShader(const char* name)
 {
     // Set up the full shader paths, taking advantage of snprintf to
@@ -152,22 +424,6 @@ Shader* LoadShader(const char* name)
         (void)fclose(vertex_file);
         (void)fclose(fragment_file);
 
-        // Convert the strings into ones OpenGL will accept, and then
-        // initialize the memory needed for the vertex and fragment
-        // shaders.
-        const char *vertex_raw = vertex_buffer,
-                   *fragment_raw = fragment_buffer;
-        u32 vertex = glCreateShader(GL_VERTEX_SHADER),
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        // Set the source char* of the shaders, and fail if we can't.
-        _SetShaderSource(&vertex, vertex_raw);
-        _SetShaderSource(&fragment, fragment_raw);
-
-        // Try to compile each shader. If that fails, grab the error
-        // codes.
-        _GetCompilationError(vertex, 1);
-        _GetCompilationError(fragment, 1);
-
         Shader* created_shader =
             __MALLOC(Shader, created_shader,
                      ("Failed to allocate space for a shader object "
@@ -175,24 +431,27 @@ Shader* LoadShader(const char* name)
                       name, errno));
         created_shader->name = name;
 
-        // Create the final program. This is basically just mashing
-        // the shaders together in a special way so they work together
-        // in a pipeline.
-        created_shader->shader = glCreateProgram();
-        // Attach each shader to the final program, ready to be
-        // compiled.
-        glAttachShader(created_shader->shader, vertex);
-        glAttachShader(created_shader->shader, fragment);
-        // Try to compile the final program. If that fails, kill the
-        // function.
-        _GetCompilationError(created_shader->shader, 0);
-
-        // Delete the now useless individual shader programs.
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        // Try the program binary cache first, and only compile from
+        // source if it doesn't have a usable binary for us.
+        u64 cache_key =
+            _GetShaderCacheKey(vertex_buffer, fragment_buffer);
+        created_shader->shader = _LoadCachedProgram(name, cache_key);
+        if (created_shader->shader == 0)
+        {
+            created_shader->shader =
+                _CompileProgram(vertex_buffer, fragment_buffer);
+            _StoreCachedProgram(name, cache_key,
+                                created_shader->shader);
+        }
+        LabelObject(GL_PROGRAM, created_shader->shader, "Shader '%s'",
+                    name);
+
+        // Now that the program's linked, find out what uniforms it
+        // has, so they never have to be looked up by string again.
+        _ReflectShader(created_shader);
 
         // Gloat upon our success.
-        PrintSuccess("Compiled the shader '%s' successfully.", name);
+        PrintSuccess("Loaded the shader '%s' successfully.", name);
         return created_shader;
     }
 
@@ -205,30 +464,50 @@ Shader* LoadShader(const char* name)
 
 __KILLFAIL UseShader(u32 shader)
 {
-    // Try to use the program. Afterward, run the PrintOpenGLError
-    // function, which checks to see if there are any errors and
-    // prints them if so.
-    glUseProgram(shader);
+    // Try to use the program. Validation builds check that went
+    // through; otherwise the driver reports it if it didn't.
+    BindProgram(shader);
     PollOpenGLErrors();
 }
 
-void SetBoolean(u32 shader, const char* name, i8 value)
+__GET_STRUCT(const ShaderCacheStatistics)
+GetShaderCacheStatistics(void)
 {
-    glUniform1i(glGetUniformLocation(shader, name), (i32)value);
+    return &_cache_statistics;
 }
 
-void SetInteger(u32 shader, const char* name, i32 value)
+i32 GetUniformLocation(Shader* shader, const char* name)
 {
-    glUniform1i(glGetUniformLocation(shader, name), value);
+    u32 interned_name = InternName(name);
+    for (u8 index = 0; index < shader->uniform_count; index++)
+        if (shader->uniforms[index].name == interned_name)
+            return shader->uniforms[index].location;
+
+    PrintWarning("Shader '%s' has no active uniform '%s'.",
+                 shader->name, name);
+    return -1;
 }
 
-void SetFloat(u32 shader, const char* name, f32 value)
+u32 CreateFrameUniforms(void)
 {
-    glUniform1f(glGetUniformLocation(shader, name), value);
+    u32 buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    LabelObject(GL_BUFFER, buffer, "Frame uniforms");
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL,
+                 GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING,
+                     buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    PollOpenGLErrors();
+
+    return buffer;
 }
 
-void SetMat4(u32 shader, const char* name, mat4 value)
+void UploadFrameUniforms(u32 buffer, const FrameUniforms* uniforms)
 {
-    glUniformMatrix4fv(glGetUniformLocation(shader, name), 1,
-                       GL_FALSE, &value[0][0]);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms),
+                    uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
@@ -14,75 +14,209 @@
 // Again, gimme them typedefs
 #include <Declarations.h>
 #include <Logger.h>
+// Provides name interning, which the uniform tables are keyed by.
+#include <Registry.h>
 #include <cglm/cglm.h>
 
+/**
+ * @brief A single active uniform of a shader, reflected once the
+ * shader's been linked.
+ */
+typedef struct ShaderUniform
+{
+    /**
+     * @brief The interned name of the uniform.
+     */
+    u32 name;
+    /**
+     * @brief The location of the uniform within its shader.
+     */
+    i32 location;
+    /**
+     * @brief The OpenGL type of the uniform (GL_FLOAT_MAT4, etc.).
+     */
+    u32 type;
+} ShaderUniform;
+
 typedef struct Shader
 {
     u32 shader;
     const char* name;
+    /**
+     * @brief Every active uniform of the shader outside of a uniform
+     * block. Shaders have a handful of these at most, so this is
+     * searched linearly.
+     */
+    ShaderUniform* uniforms;
+    u8 uniform_count;
 } Shader;
 
+/**
+ * @brief The name of the uniform block holding per-frame state,
+ * shared by every shader.
+ */
+#define FRAME_UNIFORM_BLOCK "FrameData"
+
+/**
+ * @brief The uniform buffer binding the per-frame block is bound to.
+ */
+#define FRAME_UNIFORM_BINDING 0
+
+/**
+ * @brief The per-frame state shared by every shader, laid out to
+ * match the std140 @ref FRAME_UNIFORM_BLOCK block.
+ */
+typedef struct FrameUniforms
+{
+    /**
+     * @brief The projection and view matrices of the frame.
+     */
+    mat4 projection, view;
+    /**
+     * @brief The time since startup and the time since the last frame
+     * (both in seconds), followed by the window's dimensions.
+     */
+    vec4 frame;
+} FrameUniforms;
+
+_Static_assert(sizeof(FrameUniforms) == 144,
+               "FrameUniforms must match the std140 block layout.");
+
 /**
  * @brief The max length a shader path can be. This is in place to
  * prevent buffer overflows.
  */
 #define SHADER_PATH_MAX_LENGTH 128
 
+/**
+ * @brief The directory compiled program binaries are cached in, and
+ * its parent; both relative to the executable.
+ */
+#define SHADER_CACHE_ROOT "./Cache"
+#define SHADER_CACHE_PATH SHADER_CACHE_ROOT "/Shaders"
+
+/**
+ * @brief The magic number every program binary cache file starts
+ * with ("RSPB").
+ */
+#define SHADER_CACHE_MAGIC 0x42505352
+
+/**
+ * @brief How many shaders were loaded from the program binary cache,
+ * and how many had to be compiled from source.
+ */
+typedef struct ShaderCacheStatistics
+{
+    u32 hits, misses;
+} ShaderCacheStatistics;
+
 /**
  * @brief Load a shader file from the 'Assets/Shaders/' folder. The
  * "name" is simply the name of the containing folder, everything else
  * will be automatically concatenated on.
  * @param name The shader's containing folder's name.
+ * If the program binary cache has a binary of the shader built from
+ * the same sources by the same driver, it's used instead of compiling
+ * the sources; otherwise the freshly compiled program is cached.
  * @return An object containing the OpenGL shader ID, or NULL if a
  * problem occurred.
  */
 Shader* LoadShader(const char* name);
 
+/**
+ * @brief Get how the program binary cache has fared since startup.
+ * @return A pointer to the cache's statistics.
+ */
+__GET_STRUCT(const ShaderCacheStatistics)
+GetShaderCacheStatistics(void);
+
 __INLINE void KillShader(Shader* shader)
 {
-    const char* name = shader->name;
+    PrintWarning("Freeing shader '%s'.", shader->name);
+    free(shader->uniforms);
     __FREE(shader, ("The shader freer was given an invalid shader."));
-    PrintWarning("Freed shader '%s'.", name);
 }
 
 /**
- * @brief Use the specified shader. Wrapper around @ref glUseProgram.
+ * @brief Use the specified shader, unless it's already in use.
+ * Wrapper around @ref BindProgram.
  * @param shader The shader to use.
  */
 __KILLFAIL UseShader(u32 shader);
 
-//! check for glerror in each fo these!
+/**
+ * @brief Get the location of one of the shader's uniforms from its
+ * reflected uniform table. This should be called once, at load time,
+ * and the location kept.
+ * @param shader The shader to search.
+ * @param name The name of the uniform.
+ * @return The location of the uniform, or -1 if the shader has no
+ * active uniform of that name. OpenGL silently ignores writes to -1.
+ */
+i32 GetUniformLocation(Shader* shader, const char* name);
 
 /**
- * @brief Set a boolean variable inside the shader.
- * @param shader The shader we're changing.
- * @param name The name of the boolean.
+ * @brief Set a boolean variable inside the bound shader.
+ * @param location The location of the boolean.
  * @param value The new value of the boolean.
  */
-void SetBoolean(u32 shader, const char* name, i8 value);
+__INLINE void SetBoolean(i32 location, i8 value)
+{
+    glUniform1i(location, (i32)value);
+}
 
 /**
- * @brief Set an integer variable inside the shader.
- * @param shader The shader we're changing.
- * @param name The name of the integer.
+ * @brief Set an integer variable inside the bound shader.
+ * @param location The location of the integer.
  * @param value The new value of the integer.
  */
-void SetInteger(u32 shader, const char* name, i32 value);
+__INLINE void SetInteger(i32 location, i32 value)
+{
+    glUniform1i(location, value);
+}
 
 /**
- * @brief Set a float variable inside the shader.
- * @param shader The shader we're changing.
- * @param name The name of the float.
+ * @brief Set a float variable inside the bound shader.
+ * @param location The location of the float.
  * @param value The new value of the float.
  */
-void SetFloat(u32 shader, const char* name, f32 value);
+__INLINE void SetFloat(i32 location, f32 value)
+{
+    glUniform1f(location, value);
+}
 
 /**
- * @brief Set a 4x4 matrix variable inside the given shader.
- * @param shader The shader we're changing.
- * @param name The name of the mat4.
+ * @brief Set a 4x4 matrix variable inside the bound shader.
+ * @param location The location of the mat4.
  * @param value The new value of the mat4.
  */
-void SetMat4(u32 shader, const char* name, mat4 value);
+__INLINE void SetMat4(i32 location, mat4 value)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+/**
+ * @brief Create the uniform buffer backing the per-frame block, and
+ * bind it to @ref FRAME_UNIFORM_BINDING.
+ * @return The OpenGL name of the buffer.
+ */
+u32 CreateFrameUniforms(void);
+
+/**
+ * @brief Upload the given per-frame state into the per-frame uniform
+ * buffer, where every shader sees it.
+ * @param buffer The per-frame uniform buffer.
+ * @param uniforms The state to upload.
+ */
+void UploadFrameUniforms(u32 buffer, const FrameUniforms* uniforms);
+
+/**
+ * @brief Delete the given per-frame uniform buffer.
+ * @param buffer The buffer to delete.
+ */
+__INLINE void KillFrameUniforms(u32 buffer)
+{
+    glDeleteBuffers(1, &buffer);
+}
 
 #endif // _RENAI_SHADER_
@@ -11,8 +11,14 @@
 #ifndef _RENAI_TEXTURE_
 #define _RENAI_TEXTURE_
 
+// Provides the atlases every texture's image is packed into.
+#include <Atlas.h>
 #include <Declarations.h>
 #include <Logger.h>
+// Provides the arenas textures can be allocated from.
+#include <Memory.h>
+// Provides the cached binds textures are bound through.
+#include <StateCache.h>
 
 typedef enum TextureType
 {
@@ -25,19 +31,31 @@ typedef struct Texture
 {
     TextureType type;
     u16 width, height;
-    u32 texture, vao;
+    /**
+     * @brief The index of the atlas page the texture's image was
+     * packed into.
+     */
+    u16 page;
+    /**
+     * @brief The texture coordinate rectangle (u0, v0, u1, v1) of the
+     * texture's image within its atlas page.
+     */
+    f32 uv[4];
+    /**
+     * @brief The atlas the texture's image lives within. The texture
+     * doesn't own this; it's shared with every other texture of the
+     * same scene.
+     */
+    TextureAtlas* atlas;
+    /**
+     * @brief The arena the texture was allocated from, or NULL if it
+     * was allocated on its own. Textures within an arena are freed
+     * along with it.
+     */
+    MemoryArena* arena;
     char* name;
 } Texture;
 
-typedef struct TextureInstance
-{
-    Texture* inherits;
-    f32 x, y;
-    u8 z;
-    u8 scale;
-    f32 brightness, rotation;
-} TextureInstance;
-
 /**
  * @brief Load a complete texture object from the given file,
  * OpenGL-ready bitmap and all.
@@ -46,46 +64,119 @@ typedef struct TextureInstance
  * This means the image name can be, at most, 46 or 47 characters long
  * (depending on the type).
  * @param type The type of image it is.
+ * @param atlas The atlas to pack the image into. The image is only
+ * visible once the atlas has been uploaded.
  * @param window_width The width of the key window.
  * @param window_height The height of the key window.
  * @return A pointer to the created texture.
  */
 __CREATE_STRUCT(Texture)
-CreateTexture(const char* name, TextureType type, f32 window_width,
-              f32 window_height);
+CreateTexture(const char* name, TextureType type, TextureAtlas* atlas,
+              f32 window_width, f32 window_height);
 
+/**
+ * @brief Decode a complete texture object from an encoded image
+ * already in memory, and pack it into the given atlas.
+ * @param name The name of the texture.
+ * @param image The encoded image.
+ * @param image_size The size of the encoded image, in bytes.
+ * @param type The type of image it is.
+ * @param atlas The atlas to pack the image into.
+ * @param arena The arena to allocate the texture from, or NULL.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ * @return A pointer to the created texture, or NULL if the image
+ * couldn't be decoded.
+ */
 __CREATE_STRUCT(Texture)
 CreateTextureFromMemory(const char* name, u8* image, u64 image_size,
-                        TextureType type, f32 window_width,
+                        TextureType type, TextureAtlas* atlas,
+                        MemoryArena* arena, f32 window_width,
                         f32 window_height);
 
 /**
- * @brief Free all resources to do with the given texture.
- * @param texture The texture to kill.
+ * @brief Create a texture object from an already decoded image, and
+ * pack it into the given atlas. Unlike the other constructors, this
+ * does no decoding, so the (thread-safe) decode can happen elsewhere;
+ * this itself must be called from the context thread. Kills the
+ * process on failure.
+ * @param name The name of the texture.
+ * @param type The type of image it is.
+ * @param atlas The atlas to pack the image into.
+ * @param arena The arena to allocate the texture from, or NULL.
+ * @param pixels The RGBA8 pixels of the image. These are copied into
+ * the atlas, so they may be freed afterward.
+ * @param image_width The width of the image.
+ * @param image_height The height of the image.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ * @return A pointer to the created texture.
  */
-__INLINE void KillTexture(Texture* texture)
+__CREATE_STRUCT_KILLFAIL(Texture)
+CreateTextureFromPixels(const char* name, TextureType type,
+                        TextureAtlas* atlas, MemoryArena* arena,
+                        u8* pixels, i32 image_width, i32 image_height,
+                        f32 window_width, f32 window_height);
+
+/**
+ * @brief Create a texture object from an image that's already within
+ * the given atlas, as it is once an atlas has been cooked. Nothing is
+ * decoded or packed. Kills the process on failure.
+ * @param name The name of the texture.
+ * @param type The type of image it is.
+ * @param atlas The atlas the image lives within.
+ * @param arena The arena to allocate the texture from, or NULL.
+ * @param page The index of the atlas page the image is on.
+ * @param uv The texture coordinate rectangle of the image within its
+ * page.
+ * @param image_width The width of the image.
+ * @param image_height The height of the image.
+ * @param window_width The width of the key window.
+ * @param window_height The height of the key window.
+ * @return A pointer to the created texture.
+ */
+__CREATE_STRUCT_KILLFAIL(Texture)
+CreateTextureFromAtlas(const char* name, TextureType type,
+                       TextureAtlas* atlas, MemoryArena* arena,
+                       u16 page, const f32 uv[4], i32 image_width,
+                       i32 image_height, f32 window_width,
+                       f32 window_height);
+
+/**
+ * @brief Get the OpenGL texture the given texture's image lives
+ * within; that being its atlas page. This should only be called for
+ * textures about to be drawn, since it marks the page as in use, and
+ * uploads it again if it's been evicted.
+ * @param texture The texture to query.
+ * @return The OpenGL texture name of the texture's atlas page.
+ */
+__INLINE u32 GetTextureHandle(Texture* texture)
 {
-    const char* freed_name = texture->name;
-    __FREE(texture,
-           ("The texture freer was given an invalid texture."));
-    PrintWarning("Freed the texture '%s'.", freed_name);
+    return UseAtlasPage(texture->atlas, texture->page);
 }
 
-__CREATE_STRUCT(TextureInstance)
-RegisterTexture(Texture* from, f32 x, f32 y, u8 z, u8 scale,
-                f32 brightness, f32 rotation);
-
-__INLINE void DeregisterTexture(TextureInstance* texture)
+/**
+ * @brief Free all resources to do with the given texture. The image
+ * itself stays within its atlas page until the atlas is killed, and
+ * textures allocated from an arena stay until the arena is.
+ * @param texture The texture to kill.
+ */
+__INLINE void KillTexture(Texture* texture)
 {
-    __FREE(texture, ("The texture deregisterer was given an invalid "
-                     "texture instance."));
+    // This is logged first, since the texture's name can't be read
+    // once it's gone.
+    PrintWarning("Freeing the texture '%s'.", texture->name);
+    ReleaseAtlasPage(texture->atlas, texture->page);
+    if (texture->arena == NULL)
+    {
+        __FREE(texture,
+               ("The texture freer was given an invalid texture."));
+    }
 }
 
 __INLINE void BindTexture(Texture* texture)
 {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->texture);
-    glBindVertexArray(texture->vao);
+    BindTexture2D(GetTextureHandle(texture));
 }
 
 #endif
@@ -0,0 +1,785 @@
+// Tag everything logged from here, before any header pulls in the
+// logger.
+#define LOG_CATEGORY log_streaming
+#include "Tilemap.h"
+#include <Extensions.h>
+#include <Logger.h>
+#include <StateCache.h>
+#include <math.h>
+#include <unistd.h>
+
+/**
+ * @brief Get the chunk holding the given tile.
+ * @param map The map to search.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @return A pointer to the chunk.
+ */
+__INLINE TilemapChunk* _GetTileChunk(Tilemap* map, u32 x, u32 y)
+{
+    const u32 row = y / TILEMAP_CHUNK_SIZE,
+              column = x / TILEMAP_CHUNK_SIZE;
+    return &map->chunks[row * map->chunk_columns + column];
+}
+
+/**
+ * @brief Get the index of the given tile within its chunk's tiles.
+ * @param layer The layer of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @return The index of the tile.
+ */
+__INLINE u32 _GetTileIndex(u8 layer, u32 x, u32 y)
+{
+    return layer * TILEMAP_CHUNK_TILES +
+           (y % TILEMAP_CHUNK_SIZE) * TILEMAP_CHUNK_SIZE +
+           x % TILEMAP_CHUNK_SIZE;
+}
+
+/**
+ * @brief Grow the map's palette so it can hold at least the given
+ * number of tiles.
+ * @param map The map to grow.
+ * @param capacity The new minimum capacity of the palette.
+ */
+__KILLFAIL _GrowTilemapPalette(Tilemap* map, u32 capacity)
+{
+    if (capacity <= map->palette_capacity) return;
+    if (capacity > UINT16_MAX)
+        PrintError("A map's palette can't hold more than %d tiles.",
+                   UINT16_MAX);
+
+    map->palette =
+        realloc(map->palette, sizeof(TilemapTile) * capacity);
+    if (map->palette == NULL)
+        PrintError("Failed to grow a map's palette to %d tiles. "
+                   "Code: %d.",
+                   capacity, errno);
+    map->palette_capacity = capacity;
+}
+
+/**
+ * @brief Create an empty tilemap, either with every chunk resident or
+ * with every chunk unloaded.
+ * @param width The width of the map, in tiles.
+ * @param height The height of the map, in tiles.
+ * @param layer_count The number of layers of the map.
+ * @param tile_size The width and height of a single tile.
+ * @param resident Whether or not to allocate the tiles of every
+ * chunk. Streamed maps leave this until each chunk is paged in.
+ * @return A pointer to the created map.
+ */
+__CREATE_STRUCT_KILLFAIL(Tilemap)
+_CreateTilemap(u32 width, u32 height, u8 layer_count, f32 tile_size,
+               bool resident)
+{
+    if (width == 0 || height == 0 || layer_count == 0 ||
+        layer_count > TILEMAP_MAX_LAYERS || tile_size <= 0.0f)
+        PrintError("Tried to create a %dx%d map with %d layers and "
+                   "tiles of size %.2f.",
+                   width, height, layer_count, tile_size);
+
+    Tilemap* map = __MALLOC(
+        Tilemap, map,
+        ("Failed to allocate space for a map. Code: %d.", errno));
+    map->width = width;
+    map->height = height;
+    map->chunk_columns =
+        (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    map->chunk_rows =
+        (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    map->layer_count = layer_count;
+    map->tile_size = tile_size;
+    map->palette = NULL;
+    map->palette_count = map->palette_capacity = 0;
+    map->ebo = 0;
+    map->stream = -1;
+    map->tile_offset = 0;
+    _GrowTilemapPalette(map, 8);
+
+    const u32 chunk_count = map->chunk_columns * map->chunk_rows;
+    map->chunks = calloc(chunk_count, sizeof(TilemapChunk));
+    map->vertices = malloc(sizeof(f32) * SPRITE_QUAD_FLOATS *
+                           TILEMAP_CHUNK_TILES * layer_count);
+    if (map->chunks == NULL || map->vertices == NULL)
+        PrintError("Failed to allocate the chunks of a %dx%d map. "
+                   "Code: %d.",
+                   width, height, errno);
+
+    for (u32 index = 0; index < chunk_count && resident; index++)
+    {
+        TilemapChunk* chunk = &map->chunks[index];
+        chunk->tiles =
+            calloc(TILEMAP_CHUNK_TILES * layer_count, sizeof(TileID));
+        if (chunk->tiles == NULL)
+            PrintError("Failed to allocate the tiles of a map chunk. "
+                       "Code: %d.",
+                       errno);
+        chunk->dirty = true;
+        chunk->state = chunk_resident;
+    }
+
+    PrintSuccess("Created a %dx%d map (%d chunks, %d layers).", width,
+                 height, chunk_count, layer_count);
+    return map;
+}
+
+__CREATE_STRUCT_KILLFAIL(Tilemap)
+CreateTilemap(u32 width, u32 height, u8 layer_count, f32 tile_size)
+{
+    return _CreateTilemap(width, height, layer_count, tile_size,
+                          true);
+}
+
+void KillTilemap(Tilemap* map)
+{
+    for (u32 index = 0; index < map->chunk_columns * map->chunk_rows;
+         index++)
+    {
+        TilemapChunk* chunk = &map->chunks[index];
+        if (chunk->vao != 0)
+        {
+            ForgetState(state_vertex_array, chunk->vao);
+            glDeleteVertexArrays(1, &chunk->vao);
+            glDeleteBuffers(1, &chunk->vbo);
+        }
+        free(chunk->tiles);
+        free(chunk->runs);
+    }
+    if (map->ebo != 0) glDeleteBuffers(1, &map->ebo);
+    if (map->stream != -1) close(map->stream);
+
+    free(map->chunks);
+    free(map->palette);
+    free(map->vertices);
+    __FREE(map, ("The map freer was given an invalid map."));
+    PrintWarning("The map was freed.");
+}
+
+TileID AddTilemapTile(Tilemap* map, const char* name)
+{
+    for (u16 index = 0; index < map->palette_count; index++)
+        if (strcmp(map->palette[index].name, name) == 0)
+            return index + 1;
+
+    if (map->palette_count == map->palette_capacity)
+        _GrowTilemapPalette(map, (u32)map->palette_capacity * 2);
+
+    TilemapTile* tile = &map->palette[map->palette_count];
+    strncpy(tile->name, name, TILEMAP_PALETTE_ENTRY_SIZE - 1);
+    tile->name[TILEMAP_PALETTE_ENTRY_SIZE - 1] = '\0';
+    tile->texture = NULL;
+    return ++map->palette_count;
+}
+
+void ResolveTilemapTiles(Tilemap* map, Registry* textures,
+                         ResourceHandle missing)
+{
+    for (u16 index = 0; index < map->palette_count; index++)
+    {
+        TilemapTile* tile = &map->palette[index];
+        ResourceHandle handle = FindResource(textures, tile->name);
+        if (!IsHandleValid(textures, handle))
+        {
+            PrintWarning("The map tile '%s' has no texture. Using "
+                         "the placeholder instead.",
+                         tile->name);
+            handle = missing;
+        }
+        tile->texture = GetResource(textures, handle, Texture);
+    }
+
+    for (u32 index = 0; index < map->chunk_columns * map->chunk_rows;
+         index++)
+        map->chunks[index].dirty = true;
+}
+
+TileID GetTile(Tilemap* map, u8 layer, u32 x, u32 y)
+{
+    if (layer >= map->layer_count || x >= map->width ||
+        y >= map->height)
+        return EMPTY_TILE;
+
+    TilemapChunk* chunk = _GetTileChunk(map, x, y);
+    if (chunk->tiles == NULL) return EMPTY_TILE;
+    return chunk->tiles[_GetTileIndex(layer, x, y)];
+}
+
+void SetTile(Tilemap* map, u8 layer, u32 x, u32 y, TileID tile)
+{
+    if (layer >= map->layer_count || x >= map->width ||
+        y >= map->height || tile > map->palette_count)
+    {
+        PrintWarning("Tried to paint tile %d at (%d, %d) on layer %d "
+                     "of a %dx%d map.",
+                     tile, x, y, layer, map->width, map->height);
+        return;
+    }
+
+    TilemapChunk* chunk = _GetTileChunk(map, x, y);
+    if (chunk->tiles == NULL)
+    {
+        PrintWarning("Tried to paint tile %d at (%d, %d), but its "
+                     "chunk isn't resident.",
+                     tile, x, y);
+        return;
+    }
+
+    TileID* painted = &chunk->tiles[_GetTileIndex(layer, x, y)];
+    if (*painted == tile) return;
+    *painted = tile;
+    chunk->dirty = true;
+    // The file still has the old tile, so the chunk has to stay in
+    // memory from here on.
+    if (map->stream != -1) chunk->state = chunk_pinned;
+}
+
+/**
+ * @brief Write the vertices of a single tile.
+ * @param texture The texture of the tile.
+ * @param x The X coordinate of the tile's top left corner.
+ * @param y The Y coordinate of the tile's top left corner.
+ * @param size The width and height of the tile.
+ * @param depth The depth of the tile's layer.
+ * @param vertices The buffer to write into.
+ */
+__INLINE void _BuildTileVertices(Texture* texture, f32 x, f32 y,
+                                 f32 size, f32 depth, f32* vertices)
+{
+    // Same corner order and texture coordinates as the sprite
+    // kernels, minus the rotation.
+    const f32* uv = texture->uv;
+    const f32 corners[4][4] = {{x + size, y, uv[2], uv[3]},
+                               {x + size, y + size, uv[2], uv[1]},
+                               {x, y + size, uv[0], uv[1]},
+                               {x, y, uv[0], uv[3]}};
+    for (u8 corner = 0; corner < 4; corner++)
+    {
+        vertices[0] = corners[corner][0];
+        vertices[1] = corners[corner][1];
+        vertices[2] = depth;
+        vertices[3] = corners[corner][2];
+        vertices[4] = corners[corner][3];
+        vertices[5] = 1.0f;
+        vertices += SPRITE_VERTEX_FLOATS;
+    }
+}
+
+/**
+ * @brief Create the OpenGL objects of the given chunk, creating the
+ * map's shared index buffer too if this is the first chunk built.
+ * @param map The map the chunk belongs to.
+ * @param chunk The chunk.
+ */
+__KILLFAIL _CreateChunkObjects(Tilemap* map, TilemapChunk* chunk)
+{
+    glGenVertexArrays(1, &chunk->vao);
+    glGenBuffers(1, &chunk->vbo);
+    BindVertexArray(chunk->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->vbo);
+    LabelObject(GL_VERTEX_ARRAY, chunk->vao, "Tilemap chunk %d",
+                (i32)(chunk - map->chunks));
+    LabelObject(GL_BUFFER, chunk->vbo, "Tilemap chunk %d vertices",
+                (i32)(chunk - map->chunks));
+
+    if (map->ebo == 0)
+    {
+        const u32 quad_count = TILEMAP_CHUNK_TILES * map->layer_count;
+        u32* indices = malloc(sizeof(u32) * 6 * quad_count);
+        if (indices == NULL)
+            PrintError("Failed to allocate a map's index buffer. "
+                       "Code: %d.",
+                       errno);
+        BuildQuadIndices(quad_count, indices);
+
+        glGenBuffers(1, &map->ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, map->ebo);
+        LabelObject(GL_BUFFER, map->ebo, "Tilemap indices");
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     sizeof(u32) * 6 * quad_count, indices,
+                     GL_STATIC_DRAW);
+        free(indices);
+    }
+    else glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, map->ebo);
+
+    SetSpriteVertexLayout();
+}
+
+/**
+ * @brief Bake the tiles of the given chunk into its vertex buffer,
+ * grouped into runs by atlas page.
+ * @param map The map the chunk belongs to.
+ * @param chunk The chunk to build.
+ * @param column The column of the chunk within the map.
+ * @param row The row of the chunk within the map.
+ */
+__KILLFAIL _BuildTilemapChunk(Tilemap* map, TilemapChunk* chunk,
+                              u32 column, u32 row)
+{
+    if (chunk->vao == 0) _CreateChunkObjects(map, chunk);
+
+    const u32 layer_tiles = TILEMAP_CHUNK_TILES;
+    const f32 origin_x = column * TILEMAP_CHUNK_SIZE * map->tile_size,
+              origin_y = row * TILEMAP_CHUNK_SIZE * map->tile_size;
+
+    // Find every atlas page the chunk samples from. There's rarely
+    // more than one or two, so the tiles are simply walked once per
+    // page rather than sorted.
+    chunk->run_count = 0;
+    for (u32 index = 0; index < layer_tiles * map->layer_count;
+         index++)
+    {
+        const TileID tile = chunk->tiles[index];
+        if (tile == EMPTY_TILE) continue;
+        Texture* texture = map->palette[tile - 1].texture;
+        if (texture == NULL) continue;
+
+        const u32 page = GetTextureHandle(texture);
+        u16 run = 0;
+        while (run < chunk->run_count &&
+               chunk->runs[run].texture != page)
+            run++;
+        if (run < chunk->run_count) continue;
+
+        if (chunk->run_count == chunk->run_capacity)
+        {
+            chunk->run_capacity = chunk->run_capacity == 0
+                                      ? 1
+                                      : chunk->run_capacity * 2;
+            chunk->runs =
+                realloc(chunk->runs,
+                        sizeof(TilemapRun) * chunk->run_capacity);
+            if (chunk->runs == NULL)
+                PrintError("Failed to grow a map chunk's runs. Code: "
+                           "%d.",
+                           errno);
+        }
+        chunk->runs[chunk->run_count++] =
+            (TilemapRun){page, texture, 0, 0};
+    }
+
+    u32 quad_count = 0;
+    for (u16 run = 0; run < chunk->run_count; run++)
+    {
+        TilemapRun* current = &chunk->runs[run];
+        current->first = quad_count;
+        for (u32 index = 0; index < layer_tiles * map->layer_count;
+             index++)
+        {
+            const TileID tile = chunk->tiles[index];
+            if (tile == EMPTY_TILE) continue;
+            Texture* texture = map->palette[tile - 1].texture;
+            if (texture == NULL ||
+                GetTextureHandle(texture) != current->texture)
+                continue;
+
+            // Layers sit at the same depths as sprites of the same
+            // layer.
+            const u32 layer = index / layer_tiles,
+                      cell = index % layer_tiles;
+            const f32 size = map->tile_size;
+            _BuildTileVertices(
+                texture,
+                origin_x + (cell % TILEMAP_CHUNK_SIZE) * size,
+                origin_y + (cell / TILEMAP_CHUNK_SIZE) * size, size,
+                (f32)layer - 255.0f,
+                map->vertices + quad_count * SPRITE_QUAD_FLOATS);
+            quad_count++;
+        }
+        current->count = quad_count - current->first;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 sizeof(f32) * SPRITE_QUAD_FLOATS * quad_count,
+                 map->vertices, GL_STATIC_DRAW);
+    chunk->dirty = false;
+}
+
+/**
+ * @brief Get the range of chunks along one axis of the map that
+ * overlap the given span.
+ * @param start The start of the span, in screen units.
+ * @param length The length of the span, in screen units.
+ * @param chunk_length The length of a chunk, in screen units.
+ * @param chunk_count The number of chunks along the axis.
+ * @param first The first overlapping chunk.
+ * @param last One past the last overlapping chunk.
+ */
+__INLINE void _GetChunkRange(f32 start, f32 length, f32 chunk_length,
+                             u32 chunk_count, u32* first, u32* last)
+{
+    const f32 first_chunk = floorf(start / chunk_length),
+              last_chunk =
+                  floorf((start + length) / chunk_length) + 1.0f;
+    *first = first_chunk < 0.0f ? 0 : (u32)first_chunk;
+    *last = last_chunk < 0.0f ? 0 : (u32)last_chunk;
+    if (*first > chunk_count) *first = chunk_count;
+    if (*last > chunk_count) *last = chunk_count;
+}
+
+void GetTilemapChunkRange(const Tilemap* map, const f32 view[4],
+                          u32 range[4])
+{
+    const f32 chunk_length = TILEMAP_CHUNK_SIZE * map->tile_size;
+    _GetChunkRange(view[0], view[2], chunk_length, map->chunk_columns,
+                   &range[0], &range[2]);
+    _GetChunkRange(view[1], view[3], chunk_length, map->chunk_rows,
+                   &range[1], &range[3]);
+}
+
+u32 DrawTilemap(Tilemap* map, const f32 view[4])
+{
+    u32 range[4];
+    GetTilemapChunkRange(map, view, range);
+
+    u32 draws = 0;
+    for (u32 row = range[1]; row < range[3]; row++)
+        for (u32 column = range[0]; column < range[2]; column++)
+        {
+            TilemapChunk* chunk =
+                &map->chunks[row * map->chunk_columns + column];
+            // Streamed chunks that haven't arrived yet are simply
+            // left out until they do.
+            if (chunk->tiles == NULL) continue;
+            if (chunk->dirty)
+                _BuildTilemapChunk(map, chunk, column, row);
+            if (chunk->run_count == 0) continue;
+
+            // Neighbouring chunks mostly draw from the same pages,
+            // so most of these binds never reach the driver.
+            BindVertexArray(chunk->vao);
+            for (u16 run = 0; run < chunk->run_count; run++)
+            {
+                const TilemapRun* current = &chunk->runs[run];
+                BindTexture2D(GetTextureHandle(current->source));
+
+                glDrawElements(
+                    GL_TRIANGLES, current->count * 6, GL_UNSIGNED_INT,
+                    (void*)(sizeof(u32) * 6 * current->first));
+                draws++;
+            }
+        }
+
+    return draws;
+}
+
+__BOOLEAN SaveTilemap(Tilemap* map, const char* path)
+{
+    for (u32 index = 0; index < map->chunk_columns * map->chunk_rows;
+         index++)
+        if (map->chunks[index].tiles == NULL)
+        {
+            PrintWarning("Tried to save the map '%s' while some of "
+                         "its chunks are paged out.",
+                         path);
+            return false;
+        }
+
+    // Rows are as wide as the map, so they're far too big for the
+    // stack.
+    TileID* row_tiles = malloc(sizeof(TileID) * map->width);
+    if (row_tiles == NULL && map->width != 0)
+    {
+        PrintWarning("Failed to allocate a row of the map '%s'. "
+                     "Code: %d.",
+                     path, errno);
+        return false;
+    }
+
+    FILE* map_file = fopen(path, "wb");
+    if (map_file == NULL)
+    {
+        PrintWarning("Failed to open the map file '%s'. Code: %d.",
+                     path, errno);
+        free(row_tiles);
+        return false;
+    }
+
+    u8 header[TILEMAP_HEADER_SIZE] = {0xFF,
+                                      0x01,
+                                      MAJOR,
+                                      MINOR,
+                                      REVIS,
+                                      TILEMAP_FORMAT_VERSION,
+                                      map->layer_count};
+    memcpy(header + 8, &map->width, 4);
+    memcpy(header + 12, &map->height, 4);
+    memcpy(header + 16, &map->palette_count, 2);
+    memcpy(header + 18, &map->tile_size, 4);
+    header[22] = 0xFF;
+    header[23] = 0x02;
+    fwrite(header, 1, TILEMAP_HEADER_SIZE, map_file);
+
+    // Palette names are always null padded, so they can be written
+    // as is.
+    for (u16 index = 0; index < map->palette_count; index++)
+        fwrite(map->palette[index].name, 1,
+               TILEMAP_PALETTE_ENTRY_SIZE, map_file);
+
+    // Tiles are stored layer by layer, row by row, rather than chunk
+    // by chunk, so the file doesn't depend on the chunk size.
+    for (u8 layer = 0; layer < map->layer_count; layer++)
+        for (u32 y = 0; y < map->height; y++)
+        {
+            for (u32 x = 0; x < map->width; x++)
+                row_tiles[x] = GetTile(map, layer, x, y);
+            fwrite(row_tiles, sizeof(TileID), map->width, map_file);
+        }
+    free(row_tiles);
+
+    u8 file_end[2] = {0xFF, 0x03};
+    fwrite(file_end, 1, 2, map_file);
+    bool written = !ferror(map_file);
+    fclose(map_file);
+
+    if (!written)
+    {
+        PrintWarning("Failed to write the map file '%s'.", path);
+        return false;
+    }
+    PrintSuccess("Saved a %dx%d map to '%s'.", map->width,
+                 map->height, path);
+    return true;
+}
+
+/**
+ * @brief Read the given number of bytes from a map file, killing the
+ * process if the file ends first.
+ * @param map_file The file to read from.
+ * @param path The path of the file, for use in log messages.
+ * @param destination The buffer to read into.
+ * @param length The number of bytes to read.
+ */
+__KILLFAIL _ReadTilemapBytes(FILE* map_file, const char* path,
+                             void* destination, u64 length)
+{
+    if (fread(destination, 1, length, map_file) != length)
+        PrintError("The map file '%s' is truncated/malformed. Unable "
+                   "to continue.",
+                   path);
+}
+
+/**
+ * @brief Read the header and palette of a map file, and create the
+ * map they describe.
+ * @param map_file The file to read from, positioned at its start.
+ * @param path The path of the file, for use in log messages.
+ * @param resident Whether or not to allocate the tiles of every
+ * chunk.
+ * @return A pointer to the created map.
+ */
+__CREATE_STRUCT_KILLFAIL(Tilemap)
+_ReadTilemapHeader(FILE* map_file, const char* path, bool resident)
+{
+    u8 header[TILEMAP_HEADER_SIZE];
+    _ReadTilemapBytes(map_file, path, header, TILEMAP_HEADER_SIZE);
+    if (header[0] != 0xFF || header[1] != 0x01 ||
+        header[22] != 0xFF || header[23] != 0x02)
+        PrintError("The map file '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+
+    CheckVersionDifference("maps", header + 2);
+    if (header[5] != TILEMAP_FORMAT_VERSION)
+        PrintError("The map file '%s' uses format %d, but Renai "
+                   "expects format %d. Please regenerate it.",
+                   path, header[5], TILEMAP_FORMAT_VERSION);
+
+    u32 width, height;
+    u16 palette_count;
+    f32 tile_size;
+    memcpy(&width, header + 8, 4);
+    memcpy(&height, header + 12, 4);
+    memcpy(&palette_count, header + 16, 2);
+    memcpy(&tile_size, header + 18, 4);
+    Tilemap* map = _CreateTilemap(width, height, header[6], tile_size,
+                                  resident);
+
+    _GrowTilemapPalette(map, palette_count);
+    for (u16 index = 0; index < palette_count; index++)
+    {
+        TilemapTile* tile = &map->palette[index];
+        _ReadTilemapBytes(map_file, path, tile->name,
+                          TILEMAP_PALETTE_ENTRY_SIZE);
+        if (tile->name[TILEMAP_PALETTE_ENTRY_SIZE - 1] != '\0')
+            PrintError("Tile %d of the map file '%s' has been "
+                       "tampered with/is malformed. Unable to "
+                       "continue.",
+                       index, path);
+        tile->texture = NULL;
+    }
+    map->palette_count = palette_count;
+    map->tile_offset = TILEMAP_HEADER_SIZE +
+                       TILEMAP_PALETTE_ENTRY_SIZE * palette_count;
+
+    return map;
+}
+
+__CREATE_STRUCT(Tilemap) LoadTilemap(const char* path)
+{
+    FILE* map_file = fopen(path, "rb");
+    if (map_file == NULL)
+    {
+        PrintWarning("There's no map file at '%s'.", path);
+        return NULL;
+    }
+
+    Tilemap* map = _ReadTilemapHeader(map_file, path, true);
+    const u32 width = map->width, height = map->height;
+
+    // The width comes straight from the file, so the row can't go on
+    // the stack.
+    TileID* row_tiles = malloc(sizeof(TileID) * width);
+    if (row_tiles == NULL && width != 0)
+        PrintError("Failed to allocate a row of the map file '%s'. "
+                   "Code: %d.",
+                   path, errno);
+    for (u8 layer = 0; layer < map->layer_count; layer++)
+        for (u32 y = 0; y < height; y++)
+        {
+            _ReadTilemapBytes(map_file, path, row_tiles,
+                              sizeof(TileID) * width);
+            for (u32 x = 0; x < width; x++)
+            {
+                if (row_tiles[x] > map->palette_count)
+                    PrintError("The map file '%s' paints an unknown "
+                               "tile at (%d, %d). Unable to "
+                               "continue.",
+                               path, x, y);
+                TilemapChunk* chunk = _GetTileChunk(map, x, y);
+                chunk->tiles[_GetTileIndex(layer, x, y)] =
+                    row_tiles[x];
+            }
+        }
+    free(row_tiles);
+
+    u8 file_end[2];
+    _ReadTilemapBytes(map_file, path, file_end, 2);
+    if (file_end[0] != 0xFF || file_end[1] != 0x03)
+        PrintError("The map file '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+    fclose(map_file);
+
+    PrintSuccess("Loaded the map file '%s'.", path);
+    return map;
+}
+
+__CREATE_STRUCT(Tilemap) OpenTilemapStream(const char* path)
+{
+    FILE* map_file = fopen(path, "rb");
+    if (map_file == NULL)
+    {
+        PrintWarning("There's no map file at '%s'.", path);
+        return NULL;
+    }
+
+    Tilemap* map = _ReadTilemapHeader(map_file, path, false);
+
+    // None of the tiles are read yet, so make sure they're all there
+    // before promising them to anyone.
+    const u64 tile_bytes = sizeof(TileID) * (u64)map->layer_count *
+                           map->width * map->height;
+    u8 file_end[2];
+    if (fseek(map_file, map->tile_offset + tile_bytes, SEEK_SET) != 0)
+        PrintError("The map file '%s' is truncated/malformed. Unable "
+                   "to continue.",
+                   path);
+    _ReadTilemapBytes(map_file, path, file_end, 2);
+    if (file_end[0] != 0xFF || file_end[1] != 0x03)
+        PrintError("The map file '%s' has been tampered with/is "
+                   "malformed. Unable to continue.",
+                   path);
+
+    map->stream = dup(fileno(map_file));
+    fclose(map_file);
+    if (map->stream == -1)
+        PrintError("Failed to keep the map file '%s' open. Code: %d.",
+                   path, errno);
+
+    PrintSuccess("Opened the map file '%s' for streaming.", path);
+    return map;
+}
+
+__BOOLEAN ReadTilemapChunk(const Tilemap* map, u32 chunk,
+                           TileID* tiles)
+{
+    const u32 first_x = (chunk % map->chunk_columns) *
+                        TILEMAP_CHUNK_SIZE,
+              first_y = (chunk / map->chunk_columns) *
+                        TILEMAP_CHUNK_SIZE;
+    const u32 columns = map->width - first_x < TILEMAP_CHUNK_SIZE
+                            ? map->width - first_x
+                            : TILEMAP_CHUNK_SIZE,
+              rows = map->height - first_y < TILEMAP_CHUNK_SIZE
+                         ? map->height - first_y
+                         : TILEMAP_CHUNK_SIZE;
+    memset(tiles, 0,
+           sizeof(TileID) * TILEMAP_CHUNK_TILES * map->layer_count);
+
+    // Each row of the chunk is a separate span of the file, since
+    // tiles are stored row by row across the whole map.
+    for (u8 layer = 0; layer < map->layer_count; layer++)
+        for (u32 y = 0; y < rows; y++)
+        {
+            TileID* row = tiles + layer * TILEMAP_CHUNK_TILES +
+                          y * TILEMAP_CHUNK_SIZE;
+            const u64 offset =
+                map->tile_offset +
+                sizeof(TileID) *
+                    (((u64)layer * map->height + first_y + y) *
+                         map->width +
+                     first_x);
+            const i64 length = sizeof(TileID) * columns;
+            if (pread(map->stream, row, length, offset) != length)
+                return false;
+
+            for (u32 x = 0; x < columns; x++)
+                if (row[x] > map->palette_count) return false;
+        }
+
+    return true;
+}
+
+void PageInTilemapChunk(Tilemap* map, u32 chunk, TileID* tiles)
+{
+    TilemapChunk* paged = &map->chunks[chunk];
+    paged->tiles = tiles;
+    paged->state = chunk_resident;
+    paged->dirty = true;
+}
+
+void PageOutTilemapChunk(Tilemap* map, u32 chunk)
+{
+    TilemapChunk* paged = &map->chunks[chunk];
+    if (paged->vao != 0)
+    {
+        ForgetState(state_vertex_array, paged->vao);
+        glDeleteVertexArrays(1, &paged->vao);
+        glDeleteBuffers(1, &paged->vbo);
+        paged->vao = paged->vbo = 0;
+    }
+    free(paged->tiles);
+    free(paged->runs);
+    paged->tiles = NULL;
+    paged->runs = NULL;
+    paged->run_count = paged->run_capacity = 0;
+    paged->state = chunk_unloaded;
+}
+
+u64 GetTilemapChunkBytes(const Tilemap* map,
+                         const TilemapChunk* chunk)
+{
+    if (chunk->tiles == NULL) return 0;
+
+    u64 quad_count = 0;
+    if (chunk->run_count != 0)
+    {
+        const TilemapRun* last = &chunk->runs[chunk->run_count - 1];
+        quad_count = last->first + last->count;
+    }
+    return sizeof(TileID) * TILEMAP_CHUNK_TILES * map->layer_count +
+           sizeof(TilemapRun) * chunk->run_capacity +
+           sizeof(f32) * SPRITE_QUAD_FLOATS * quad_count;
+}
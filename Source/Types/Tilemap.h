@@ -0,0 +1,396 @@
+/**
+ * @file Tilemap.h
+ * @author Zenais Argos
+ * @brief Provides tilemaps; layered grids of tiles drawn from a
+ * scene's tilesets. Maps are split into square chunks, each of which
+ * bakes its tiles into its own static vertex buffer, so a screen of
+ * terrain costs a handful of draws no matter how large the map is,
+ * and the CPU only touches a chunk again once it's edited. Maps can
+ * also be streamed, keeping only the chunks around the camera in
+ * memory and reading the rest from disk as they're needed.
+ * @date 2024-07-13
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_TILEMAP_
+#define _RENAI_TILEMAP_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the vertex layout tiles share with sprites.
+#include <Geometry.h>
+// Provides the registry tile names are looked up within.
+#include <Registry.h>
+// Provides the textures tiles are drawn from.
+#include <Texture.h>
+
+/**
+ * @brief The width and height of a single chunk, in tiles.
+ */
+#define TILEMAP_CHUNK_SIZE 32
+
+/**
+ * @brief The number of tiles within a single layer of a chunk.
+ */
+#define TILEMAP_CHUNK_TILES (TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE)
+
+/**
+ * @brief The most layers a single map can have. Layers are drawn at
+ * the same depths as sprites of the same layer.
+ */
+#define TILEMAP_MAX_LAYERS 8
+
+/**
+ * @brief The tile ID of an empty cell. Every other ID is one more
+ * than the index of its tile within the map's palette.
+ */
+#define EMPTY_TILE 0
+
+/**
+ * @brief The directory maps are saved to and loaded from, relative to
+ * the executable. Each scene's map is named after the scene.
+ */
+#define TILEMAP_DIRECTORY "./Assets/Maps"
+
+/**
+ * @brief The version of the map file format. This is separate from
+ * the application version, and only changes when the layout of the
+ * file does.
+ */
+#define TILEMAP_FORMAT_VERSION 1
+
+/**
+ * @brief The size of a map file's header, in bytes; the magic number,
+ * application version, format version, layer count, dimensions,
+ * palette size, tile size, and end marker.
+ */
+#define TILEMAP_HEADER_SIZE 24
+
+/**
+ * @brief The size of a single palette entry within a map file, in
+ * bytes; a null padded texture name.
+ */
+#define TILEMAP_PALETTE_ENTRY_SIZE 64
+
+/**
+ * @brief The ID of a tile within a map's palette.
+ */
+typedef u16 TileID;
+
+/**
+ * @brief A single entry of a map's palette.
+ */
+typedef struct TilemapTile
+{
+    /**
+     * @brief The name of the texture the tile is drawn with. This is
+     * always null terminated.
+     */
+    char name[TILEMAP_PALETTE_ENTRY_SIZE];
+    /**
+     * @brief The texture itself, or NULL until the map's palette has
+     * been resolved. The map doesn't own this.
+     */
+    Texture* texture;
+} TilemapTile;
+
+/**
+ * @brief Where a chunk's tiles currently are.
+ */
+typedef enum TilemapChunkState
+{
+    /**
+     * @brief The chunk's tiles are only on disk.
+     */
+    chunk_unloaded,
+    /**
+     * @brief The chunk's tiles are being read from disk.
+     */
+    chunk_pending,
+    /**
+     * @brief The chunk's tiles are in memory.
+     */
+    chunk_resident,
+    /**
+     * @brief The chunk's tiles are in memory, and have been edited
+     * since they were read, so they can't be paged out again without
+     * losing the edits.
+     */
+    chunk_pinned
+} TilemapChunkState;
+
+/**
+ * @brief A run of quads within a chunk's vertex buffer that all
+ * sample from the same atlas page, and so are drawn together.
+ */
+typedef struct TilemapRun
+{
+    /**
+     * @brief The OpenGL texture of the run's atlas page.
+     */
+    u32 texture;
+    /**
+     * @brief One of the tiles' textures on the run's atlas page. The
+     * run is drawn through this, so the page is kept resident.
+     */
+    Texture* source;
+    /**
+     * @brief The first quad of the run, and the number of quads in
+     * it.
+     */
+    u32 first, count;
+} TilemapRun;
+
+/**
+ * @brief A single square chunk of a map.
+ */
+typedef struct TilemapChunk
+{
+    /**
+     * @brief The chunk's tiles, one layer after the other, each
+     * stored row by row. Cells past the edge of the map are always
+     * empty. This is NULL while the chunk isn't resident.
+     */
+    TileID* tiles;
+    /**
+     * @brief The chunk's vertex array and buffer. Both are 0 until
+     * the chunk is first built.
+     */
+    u32 vao, vbo;
+    /**
+     * @brief The runs of the chunk's vertex buffer, in drawing order.
+     */
+    TilemapRun* runs;
+    u16 run_count, run_capacity;
+    /**
+     * @brief Whether the chunk's tiles have changed since its vertex
+     * buffer was last built.
+     */
+    bool dirty;
+    /**
+     * @brief Where the chunk's tiles are. Chunks of maps that aren't
+     * streamed are always resident.
+     */
+    TilemapChunkState state;
+    /**
+     * @brief The last frame the chunk was near enough to the camera
+     * to be wanted, used by the streamer to page out the chunks that
+     * have gone unused the longest.
+     */
+    u32 last_seen;
+} TilemapChunk;
+
+/**
+ * @brief A tilemap.
+ */
+typedef struct Tilemap
+{
+    /**
+     * @brief The dimensions of the map, in tiles.
+     */
+    u32 width, height;
+    /**
+     * @brief The dimensions of the map, in chunks.
+     */
+    u32 chunk_columns, chunk_rows;
+    /**
+     * @brief The number of layers the map has.
+     */
+    u8 layer_count;
+    /**
+     * @brief The width and height of a single tile, in screen units.
+     */
+    f32 tile_size;
+    /**
+     * @brief The tiles the map can be painted with.
+     */
+    TilemapTile* palette;
+    u16 palette_count, palette_capacity;
+    /**
+     * @brief The map's chunks, row by row.
+     */
+    TilemapChunk* chunks;
+    /**
+     * @brief The index buffer every chunk shares, since every quad is
+     * laid out the same way. This is 0 until the first chunk is
+     * built.
+     */
+    u32 ebo;
+    /**
+     * @brief The staging area chunks are built within, large enough
+     * for every layer of a full chunk.
+     */
+    f32* vertices;
+    /**
+     * @brief The descriptor of the file the map's chunks are streamed
+     * from, or -1 if every chunk is always resident.
+     */
+    i32 stream;
+    /**
+     * @brief Where the map's tiles start within its file.
+     */
+    u64 tile_offset;
+} Tilemap;
+
+/**
+ * @brief Create an empty tilemap. No OpenGL objects are created until
+ * the map is first drawn, so this is safe without a context.
+ * @param width The width of the map, in tiles.
+ * @param height The height of the map, in tiles.
+ * @param layer_count The number of layers of the map, at most @ref
+ * TILEMAP_MAX_LAYERS.
+ * @param tile_size The width and height of a single tile, in screen
+ * units.
+ * @return A pointer to the created map.
+ */
+__CREATE_STRUCT_KILLFAIL(Tilemap)
+CreateTilemap(u32 width, u32 height, u8 layer_count, f32 tile_size);
+
+/**
+ * @brief Destroy the given map, deleting every OpenGL object it
+ * created.
+ * @param map The map to kill.
+ */
+void KillTilemap(Tilemap* map);
+
+/**
+ * @brief Add a tile to the map's palette. If the palette already has
+ * a tile drawn with the given texture, its ID is returned instead.
+ * @param map The map to add to.
+ * @param name The name of the texture the tile is drawn with.
+ * @return The ID of the tile.
+ */
+TileID AddTilemapTile(Tilemap* map, const char* name);
+
+/**
+ * @brief Look up every tile of the map's palette within the given
+ * texture registry. Tiles whose textures can't be found are drawn
+ * with the placeholder texture instead. Every chunk is rebuilt the
+ * next time it's drawn.
+ * @param map The map to resolve.
+ * @param textures The registry to look within.
+ * @param missing The handle of the placeholder texture.
+ */
+void ResolveTilemapTiles(Tilemap* map, Registry* textures,
+                         ResourceHandle missing);
+
+/**
+ * @brief Get a single tile of the map.
+ * @param map The map to query.
+ * @param layer The layer of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @return The ID of the tile, or @ref EMPTY_TILE if the tile is out
+ * of bounds or its chunk isn't resident.
+ */
+TileID GetTile(Tilemap* map, u8 layer, u32 x, u32 y);
+
+/**
+ * @brief Paint a single tile of the map, marking its chunk for
+ * rebuilding. Out of bounds tiles, unknown IDs, and tiles of chunks
+ * that aren't resident are ignored. Painting a streamed chunk pins
+ * it in memory.
+ * @param map The map to paint.
+ * @param layer The layer of the tile.
+ * @param x The column of the tile.
+ * @param y The row of the tile.
+ * @param tile The ID to paint, or @ref EMPTY_TILE to clear it.
+ */
+void SetTile(Tilemap* map, u8 layer, u32 x, u32 y, TileID tile);
+
+/**
+ * @brief Get the chunks of the map that overlap the given area.
+ * @param map The map to search.
+ * @param view The area, in screen units; its X, Y, width, and
+ * height.
+ * @param range Where to write the chunks; the first column, first
+ * row, and one past the last column and row.
+ */
+void GetTilemapChunkRange(const Tilemap* map, const f32 view[4],
+                          u32 range[4]);
+
+/**
+ * @brief Draw every resident chunk of the map that overlaps the given
+ * area, rebuilding any that have been edited first. The map is drawn
+ * with whatever shader is currently bound, and its palette must have
+ * been resolved.
+ * @param map The map to draw.
+ * @param view The area to draw, in screen units; its X, Y, width,
+ * and height.
+ * @return The number of draw calls issued.
+ */
+u32 DrawTilemap(Tilemap* map, const f32 view[4]);
+
+/**
+ * @brief Write the given map to a file. Streamed maps can only be
+ * saved while every one of their chunks is resident.
+ * @param map The map to save.
+ * @param path The path of the file.
+ * @return A boolean value; true if the file was written.
+ */
+__BOOLEAN SaveTilemap(Tilemap* map, const char* path);
+
+/**
+ * @brief Load a map from the given file. The palette of the loaded
+ * map still has to be resolved before it's drawn. Kills the process
+ * if the file is malformed.
+ * @param path The path of the file.
+ * @return A pointer to the loaded map, or NULL if the file doesn't
+ * exist.
+ */
+__CREATE_STRUCT(Tilemap) LoadTilemap(const char* path);
+
+/**
+ * @brief Open a map file for streaming. Only the header and palette
+ * are read; every chunk starts out unloaded, and is read by @ref
+ * ReadTilemapChunk once it's wanted. The file stays open until the
+ * map is killed. Kills the process if the file is malformed.
+ * @param path The path of the file.
+ * @return A pointer to the opened map, or NULL if the file doesn't
+ * exist.
+ */
+__CREATE_STRUCT(Tilemap) OpenTilemapStream(const char* path);
+
+/**
+ * @brief Read the tiles of a single chunk of a streamed map. This
+ * touches nothing but the map's file, so it's safe to call from any
+ * thread.
+ * @param map The map to read from.
+ * @param chunk The index of the chunk.
+ * @param tiles Where to write the chunk's tiles; room for every layer
+ * of a full chunk.
+ * @return A boolean value; true if the tiles were read.
+ */
+__BOOLEAN ReadTilemapChunk(const Tilemap* map, u32 chunk,
+                           TileID* tiles);
+
+/**
+ * @brief Make a chunk of a streamed map resident, handing it tiles
+ * read by @ref ReadTilemapChunk. The map takes ownership of them.
+ * @param map The map the chunk belongs to.
+ * @param chunk The index of the chunk.
+ * @param tiles The chunk's tiles.
+ */
+void PageInTilemapChunk(Tilemap* map, u32 chunk, TileID* tiles);
+
+/**
+ * @brief Free the tiles and OpenGL objects of a chunk of a streamed
+ * map, leaving it unloaded.
+ * @param map The map the chunk belongs to.
+ * @param chunk The index of the chunk.
+ */
+void PageOutTilemapChunk(Tilemap* map, u32 chunk);
+
+/**
+ * @brief Get the memory a resident chunk takes up; its tiles and its
+ * vertex buffer, in bytes.
+ * @param map The map the chunk belongs to.
+ * @param chunk The chunk.
+ * @return The size of the chunk.
+ */
+u64 GetTilemapChunkBytes(const Tilemap* map,
+                         const TilemapChunk* chunk);
+
+#endif // _RENAI_TILEMAP_
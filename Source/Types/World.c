@@ -0,0 +1,647 @@
+#include "World.h"
+#include <math.h>
+
+/**
+ * @brief Add an array to the given pool. The array itself is
+ * allocated once every column's been added.
+ * @param pool The pool to add to.
+ * @param column A pointer to the typed pool's pointer to the array.
+ * @param size The size of a single element of the array.
+ */
+void _AddPoolColumn(ComponentPool* pool, void** column, u16 size)
+{
+    if (pool->column_count == POOL_MAX_COLUMNS)
+        PrintError("Tried to give a component pool more than %d "
+                   "columns.",
+                   POOL_MAX_COLUMNS);
+    pool->columns[pool->column_count] = column;
+    pool->column_sizes[pool->column_count++] = size;
+    *column = NULL;
+}
+
+/**
+ * @brief Resize every array of the given pool.
+ * @param pool The pool to resize.
+ * @param capacity The number of components the pool should have room
+ * for.
+ */
+void _ResizePool(ComponentPool* pool, u32 capacity)
+{
+    pool->dense = realloc(pool->dense, sizeof(Entity) * capacity);
+    if (pool->dense == NULL)
+        PrintError("Failed to grow a component pool to %d "
+                   "components. Code: %d.",
+                   capacity, errno);
+
+    for (u8 column = 0; column < pool->column_count; column++)
+    {
+        *pool->columns[column] =
+            realloc(*pool->columns[column],
+                    (u64)pool->column_sizes[column] * capacity);
+        if (*pool->columns[column] == NULL)
+            PrintError("Failed to grow a component pool to %d "
+                       "components. Code: %d.",
+                       capacity, errno);
+    }
+    pool->capacity = capacity;
+}
+
+/**
+ * @brief Set up the shared part of a pool, once all its columns have
+ * been added.
+ * @param pool The pool to set up.
+ * @param capacity The number of components to make room for.
+ */
+void _CreatePool(ComponentPool* pool, u32 capacity)
+{
+    pool->sparse = NULL;
+    pool->sparse_size = 0;
+    pool->dense = NULL;
+    pool->count = 0;
+    _ResizePool(pool, capacity);
+}
+
+/**
+ * @brief Free every array of the given pool.
+ * @param pool The pool to free.
+ */
+void _KillPool(ComponentPool* pool)
+{
+    for (u8 column = 0; column < pool->column_count; column++)
+        free(*pool->columns[column]);
+    free(pool->dense);
+    free(pool->sparse);
+}
+
+/**
+ * @brief Add a component for the given entity to a pool, leaving its
+ * fields for the caller to fill in. Kills the process if the entity
+ * already has one.
+ * @param pool The pool to add to.
+ * @param entity The entity getting the component.
+ * @param name The name of the component, for the error message.
+ * @return The dense index of the new component.
+ */
+u32 _AddComponent(ComponentPool* pool, Entity entity,
+                  const char* name)
+{
+    u32 entity_index = GetEntityIndex(entity);
+    if (entity_index >= pool->sparse_size)
+    {
+        u32 sparse_size =
+            (pool->sparse_size == 0 ? 64 : pool->sparse_size * 2);
+        while (sparse_size <= entity_index) sparse_size *= 2;
+
+        pool->sparse =
+            realloc(pool->sparse, sizeof(u32) * sparse_size);
+        if (pool->sparse == NULL)
+            PrintError("Failed to grow the sparse array of the %s "
+                       "pool. Code: %d.",
+                       name, errno);
+        // Every byte of POOL_EMPTY is 0xFF, so this fills in the
+        // whole new range.
+        memset(pool->sparse + pool->sparse_size, 0xFF,
+               sizeof(u32) * (sparse_size - pool->sparse_size));
+        pool->sparse_size = sparse_size;
+    }
+    else if (GetComponentIndex(pool, entity) != POOL_EMPTY)
+        PrintError("Tried to give entity %d a second %s.",
+                   entity_index, name);
+
+    if (pool->count == pool->capacity)
+        _ResizePool(pool, pool->capacity * 2);
+
+    pool->sparse[entity_index] = pool->count;
+    pool->dense[pool->count] = entity;
+    return pool->count++;
+}
+
+void RemoveComponent(ComponentPool* pool, Entity entity)
+{
+    u32 index = GetComponentIndex(pool, entity);
+    if (index == POOL_EMPTY) return;
+
+    // Move the last component into the hole, so the arrays stay
+    // packed.
+    u32 last = --pool->count;
+    if (index != last)
+    {
+        for (u8 column = 0; column < pool->column_count; column++)
+        {
+            u8* data = *pool->columns[column];
+            u16 size = pool->column_sizes[column];
+            memcpy(data + (u64)index * size, data + (u64)last * size,
+                   size);
+        }
+        pool->dense[index] = pool->dense[last];
+        pool->sparse[GetEntityIndex(pool->dense[index])] = index;
+    }
+    pool->sparse[GetEntityIndex(entity)] = POOL_EMPTY;
+}
+
+/**
+ * @brief Get the given pool of a world.
+ * @param world The world.
+ * @param component The component (a single @ref ComponentType bit)
+ * whose pool to get.
+ * @return A pointer to the pool.
+ */
+ComponentPool* _GetPool(World* world, u8 component)
+{
+    switch (component)
+    {
+        case transform_component: return &world->transforms.pool;
+        case sprite_component:    return &world->sprites.pool;
+        case animation_component: return &world->animations.pool;
+        case ai_component:        return &world->ai.pool;
+        default:                  return NULL;
+    }
+}
+
+__CREATE_STRUCT_KILLFAIL(World) CreateWorld(u32 capacity)
+{
+    World* world =
+        __MALLOC(World, world,
+                 ("Failed to allocate a world. Code: %d.", errno));
+    if (capacity == 0) capacity = 1;
+
+    world->entity_count = 0;
+    world->entity_capacity = capacity;
+    world->free_count = 0;
+    world->alive_count = 0;
+    world->generations = malloc(sizeof(u8) * capacity);
+    world->free_entities = malloc(sizeof(u32) * capacity);
+    if (world->generations == NULL || world->free_entities == NULL)
+        PrintError("Failed to allocate the entity slots of a world. "
+                   "Code: %d.",
+                   errno);
+
+    TransformPool* transforms = &world->transforms;
+    transforms->pool.column_count = 0;
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->x,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->y,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->previous_x,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->previous_y,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->rotation,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->scale,
+                   sizeof(f32));
+    _AddPoolColumn(&transforms->pool, (void**)&transforms->z,
+                   sizeof(u8));
+    _CreatePool(&transforms->pool, capacity);
+
+    SpritePool* sprites = &world->sprites;
+    sprites->pool.column_count = 0;
+    _AddPoolColumn(&sprites->pool, (void**)&sprites->texture,
+                   sizeof(Texture*));
+    _AddPoolColumn(&sprites->pool, (void**)&sprites->uv,
+                   sizeof(f32[4]));
+    _AddPoolColumn(&sprites->pool, (void**)&sprites->width,
+                   sizeof(f32));
+    _AddPoolColumn(&sprites->pool, (void**)&sprites->height,
+                   sizeof(f32));
+    _AddPoolColumn(&sprites->pool, (void**)&sprites->brightness,
+                   sizeof(f32));
+    _CreatePool(&sprites->pool, capacity);
+
+    // Far fewer entities animate or think than are drawn, so these
+    // start smaller.
+    AnimationPool* animations = &world->animations;
+    animations->pool.column_count = 0;
+    _AddPoolColumn(&animations->pool, (void**)&animations->frame,
+                   sizeof(u16));
+    _AddPoolColumn(&animations->pool,
+                   (void**)&animations->frame_count, sizeof(u16));
+    _AddPoolColumn(&animations->pool,
+                   (void**)&animations->frame_length, sizeof(f32));
+    _AddPoolColumn(&animations->pool, (void**)&animations->elapsed,
+                   sizeof(f32));
+    _CreatePool(&animations->pool, capacity / 4 + 1);
+
+    AIPool* ai = &world->ai;
+    ai->pool.column_count = 0;
+    _AddPoolColumn(&ai->pool, (void**)&ai->state, sizeof(u8));
+    _AddPoolColumn(&ai->pool, (void**)&ai->speed, sizeof(f32));
+    _AddPoolColumn(&ai->pool, (void**)&ai->timer, sizeof(f32));
+    _AddPoolColumn(&ai->pool, (void**)&ai->velocity_x, sizeof(f32));
+    _AddPoolColumn(&ai->pool, (void**)&ai->velocity_y, sizeof(f32));
+    _AddPoolColumn(&ai->pool, (void**)&ai->seed, sizeof(u32));
+    _CreatePool(&ai->pool, capacity / 4 + 1);
+
+    world->grid = CreateSpatialGrid(WORLD_CELL_SIZE, capacity);
+    world->largest_sprite = 0.0f;
+    return world;
+}
+
+void KillWorld(World* world)
+{
+    _KillPool(&world->transforms.pool);
+    _KillPool(&world->sprites.pool);
+    _KillPool(&world->animations.pool);
+    _KillPool(&world->ai.pool);
+    KillSpatialGrid(world->grid);
+    free(world->generations);
+    free(world->free_entities);
+    __FREE(world, ("The world freer was given an invalid world."));
+}
+
+Entity CreateEntity(World* world)
+{
+    u32 index;
+    if (world->free_count != 0)
+        index = world->free_entities[--world->free_count];
+    else
+    {
+        if (world->entity_count == ENTITY_INDEX_MASK)
+            PrintError("Ran out of entity slots (%d).",
+                       ENTITY_INDEX_MASK);
+
+        if (world->entity_count == world->entity_capacity)
+        {
+            world->entity_capacity *= 2;
+            world->generations =
+                realloc(world->generations,
+                        sizeof(u8) * world->entity_capacity);
+            world->free_entities =
+                realloc(world->free_entities,
+                        sizeof(u32) * world->entity_capacity);
+            if (world->generations == NULL ||
+                world->free_entities == NULL)
+                PrintError("Failed to grow a world to %d entities. "
+                           "Code: %d.",
+                           world->entity_capacity, errno);
+        }
+
+        index = world->entity_count++;
+        world->generations[index] = 1;
+    }
+
+    world->alive_count++;
+    return ((Entity)world->generations[index] << ENTITY_INDEX_BITS) |
+           index;
+}
+
+void DestroyEntity(World* world, Entity entity)
+{
+    if (!IsEntityAlive(world, entity))
+    {
+        PrintWarning("Tried to destroy a dead entity.");
+        return;
+    }
+
+    RemoveComponent(&world->transforms.pool, entity);
+    RemoveComponent(&world->sprites.pool, entity);
+    RemoveComponent(&world->animations.pool, entity);
+    RemoveComponent(&world->ai.pool, entity);
+    RemoveGridItem(world->grid, GetEntityIndex(entity));
+
+    // Bumping the generation is what kills every copy of the entity's
+    // ID. Generation 0 is skipped, so no live entity is ever 0.
+    u32 index = GetEntityIndex(entity);
+    if (++world->generations[index] == 0)
+        world->generations[index] = 1;
+    world->free_entities[world->free_count++] = index;
+    world->alive_count--;
+}
+
+/**
+ * @brief Grow the world's largest sprite to fit the given entity's,
+ * if it has both a sprite and a transform.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ */
+void _FitLargestSprite(World* world, Entity entity)
+{
+    u32 transform =
+            GetComponentIndex(&world->transforms.pool, entity),
+        sprite = GetComponentIndex(&world->sprites.pool, entity);
+    if (transform == POOL_EMPTY || sprite == POOL_EMPTY) return;
+
+    f32 scale = world->transforms.scale[transform],
+        size = fmaxf(world->sprites.width[sprite],
+                     world->sprites.height[sprite]) *
+               fabsf(scale);
+    if (size > world->largest_sprite) world->largest_sprite = size;
+}
+
+u32 AddTransform(World* world, Entity entity, f32 x, f32 y, u8 z,
+                 f32 scale, f32 rotation)
+{
+    TransformPool* transforms = &world->transforms;
+    u32 index = _AddComponent(&transforms->pool, entity, "transform");
+    transforms->x[index] = transforms->previous_x[index] = x;
+    transforms->y[index] = transforms->previous_y[index] = y;
+    transforms->z[index] = z;
+    transforms->scale[index] = scale;
+    transforms->rotation[index] = rotation;
+
+    PlaceGridItem(world->grid, GetEntityIndex(entity), x, y);
+    _FitLargestSprite(world, entity);
+    return index;
+}
+
+void MoveEntity(World* world, Entity entity, f32 x, f32 y)
+{
+    TransformPool* transforms = &world->transforms;
+    u32 index = GetComponentIndex(&transforms->pool, entity);
+    if (index == POOL_EMPTY) return;
+
+    transforms->x[index] = x;
+    transforms->y[index] = y;
+    PlaceGridItem(world->grid, GetEntityIndex(entity), x, y);
+}
+
+u32 AddSprite(World* world, Entity entity, Texture* texture,
+              f32 brightness)
+{
+    SpritePool* sprites = &world->sprites;
+    u32 index = _AddComponent(&sprites->pool, entity, "sprite");
+    sprites->texture[index] = texture;
+    memcpy(sprites->uv[index], texture->uv, sizeof(f32[4]));
+    sprites->width[index] = texture->width;
+    sprites->height[index] = texture->height;
+    sprites->brightness[index] = brightness;
+
+    _FitLargestSprite(world, entity);
+    return index;
+}
+
+/**
+ * @brief Point a sprite at the given frame of its texture.
+ * @param sprites The sprite pool.
+ * @param sprite The dense index of the sprite.
+ * @param frame The frame to show.
+ * @param frame_count The number of frames across the texture.
+ */
+__INLINE void _SetSpriteFrame(SpritePool* sprites, u32 sprite,
+                              u16 frame, u16 frame_count)
+{
+    const f32* uv = sprites->texture[sprite]->uv;
+    f32 frame_width = (uv[2] - uv[0]) / frame_count;
+    sprites->uv[sprite][0] = uv[0] + frame_width * frame;
+    sprites->uv[sprite][2] = sprites->uv[sprite][0] + frame_width;
+}
+
+u32 AddAnimation(World* world, Entity entity, u16 frame_count,
+                 f32 frame_length)
+{
+    u32 sprite = GetComponentIndex(&world->sprites.pool, entity);
+    if (sprite == POOL_EMPTY)
+        PrintError("Tried to animate entity %d, which has no sprite.",
+                   GetEntityIndex(entity));
+    if (frame_count == 0) frame_count = 1;
+
+    AnimationPool* animations = &world->animations;
+    u32 index = _AddComponent(&animations->pool, entity, "animation");
+    animations->frame[index] = 0;
+    animations->frame_count[index] = frame_count;
+    animations->frame_length[index] = frame_length;
+    animations->elapsed[index] = 0.0f;
+
+    // The sprite only shows a single frame from now on.
+    world->sprites.width[sprite] /= frame_count;
+    _SetSpriteFrame(&world->sprites, sprite, 0, frame_count);
+    return index;
+}
+
+u32 AddAI(World* world, Entity entity, f32 speed)
+{
+    AIPool* ai = &world->ai;
+    u32 index = _AddComponent(&ai->pool, entity, "AI");
+    ai->state[index] = idle_state;
+    ai->speed[index] = speed;
+    ai->timer[index] = 0.0f;
+    ai->velocity_x[index] = ai->velocity_y[index] = 0.0f;
+    // Seed from the entity itself, so a given world always plays out
+    // the same way. Xorshift can't be seeded with 0.
+    ai->seed[index] = entity * 2654435761U | 1;
+    return index;
+}
+
+EntityView ViewEntities(World* world, u8 components)
+{
+    EntityView view = {world, components, NULL, 0, NULL_ENTITY,
+                       0,     0,          0,    0};
+
+    // Walk whichever pool is smallest, since every entity of the view
+    // has to be in it anyway.
+    for (u8 bit = 1; bit <= ai_component; bit <<= 1)
+    {
+        if (!(components & bit)) continue;
+        ComponentPool* pool = _GetPool(world, bit);
+        if (view.driver == NULL || pool->count < view.driver->count)
+            view.driver = pool;
+    }
+    if (view.driver != NULL) view.cursor = view.driver->count;
+
+    return view;
+}
+
+/**
+ * @brief Find the current entity of a view within one of its pools.
+ * The pool being walked needs no lookup, since the view's position
+ * within it is the entity's index.
+ * @param view The view.
+ * @param pool The pool to search.
+ * @param entity The current entity of the view.
+ * @return The entity's dense index within the pool, or @ref
+ * POOL_EMPTY if it isn't in the pool.
+ */
+__INLINE u32 _GetViewIndex(EntityView* view, ComponentPool* pool,
+                           Entity entity)
+{
+    if (pool == view->driver) return view->cursor;
+    return GetComponentIndex(pool, entity);
+}
+
+__BOOLEAN NextEntity(EntityView* view)
+{
+    World* world = view->world;
+    while (view->cursor > 0)
+    {
+        Entity entity = view->driver->dense[--view->cursor];
+
+        if (view->components & transform_component)
+        {
+            view->transform = _GetViewIndex(
+                view, &world->transforms.pool, entity);
+            if (view->transform == POOL_EMPTY) continue;
+        }
+        if (view->components & sprite_component)
+        {
+            view->sprite =
+                _GetViewIndex(view, &world->sprites.pool, entity);
+            if (view->sprite == POOL_EMPTY) continue;
+        }
+        if (view->components & animation_component)
+        {
+            view->animation = _GetViewIndex(
+                view, &world->animations.pool, entity);
+            if (view->animation == POOL_EMPTY) continue;
+        }
+        if (view->components & ai_component)
+        {
+            view->ai = _GetViewIndex(view, &world->ai.pool, entity);
+            if (view->ai == POOL_EMPTY) continue;
+        }
+
+        view->entity = entity;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Step a random number generator (xorshift32).
+ * @param state The state of the generator.
+ * @return A random number from 0 to 1.
+ */
+__INLINE f32 _RandomFloat(u32* state)
+{
+    u32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x >> 8) / 16777216.0f;
+}
+
+void UpdateWorld(World* world, f64 tick_length)
+{
+    const f32 step = (f32)tick_length;
+    TransformPool* transforms = &world->transforms;
+
+    // Remember where everything was, for drawing to blend from. Since
+    // each field is its own array, this is just two copies.
+    memcpy(transforms->previous_x, transforms->x,
+           sizeof(f32) * transforms->pool.count);
+    memcpy(transforms->previous_y, transforms->y,
+           sizeof(f32) * transforms->pool.count);
+
+    AIPool* ai = &world->ai;
+    EntityView view =
+        ViewEntities(world, transform_component | ai_component);
+    while (NextEntity(&view))
+    {
+        u32 index = view.ai;
+        ai->timer[index] -= step;
+        if (ai->timer[index] <= 0.0f)
+        {
+            // Alternate between standing around and walking off in a
+            // random direction, for a random amount of time.
+            ai->timer[index] =
+                1.0f + 2.0f * _RandomFloat(&ai->seed[index]);
+            if (ai->state[index] == idle_state)
+            {
+                f32 angle =
+                    _RandomFloat(&ai->seed[index]) * 6.2831853f;
+                ai->state[index] = wander_state;
+                ai->velocity_x[index] =
+                    cosf(angle) * ai->speed[index];
+                ai->velocity_y[index] =
+                    sinf(angle) * ai->speed[index];
+            }
+            else
+            {
+                ai->state[index] = idle_state;
+                ai->velocity_x[index] = ai->velocity_y[index] = 0.0f;
+            }
+        }
+
+        transforms->x[view.transform] += ai->velocity_x[index] * step;
+        transforms->y[view.transform] += ai->velocity_y[index] * step;
+        PlaceGridItem(world->grid, GetEntityIndex(view.entity),
+                      transforms->x[view.transform],
+                      transforms->y[view.transform]);
+    }
+
+    AnimationPool* animations = &world->animations;
+    view =
+        ViewEntities(world, sprite_component | animation_component);
+    while (NextEntity(&view))
+    {
+        u32 index = view.animation;
+        animations->elapsed[index] += step;
+        if (animations->elapsed[index] <
+            animations->frame_length[index])
+            continue;
+
+        // Skip however many frames the tick covered, in case frames
+        // are shorter than ticks.
+        while (animations->elapsed[index] >=
+                   animations->frame_length[index] &&
+               animations->frame_length[index] > 0.0f)
+        {
+            animations->elapsed[index] -=
+                animations->frame_length[index];
+            animations->frame[index] =
+                (animations->frame[index] + 1) %
+                animations->frame_count[index];
+        }
+        _SetSpriteFrame(&world->sprites, view.sprite,
+                        animations->frame[index],
+                        animations->frame_count[index]);
+    }
+}
+
+/**
+ * @brief Get the dense index of an entity slot's component within a
+ * pool. Unlike @ref GetComponentIndex, this doesn't need the entity
+ * itself, just its slot.
+ * @param pool The pool to search.
+ * @param slot The entity slot.
+ * @return The component's index, or @ref POOL_EMPTY if the slot has
+ * no component in the pool.
+ */
+__INLINE u32 _GetSlotComponent(const ComponentPool* pool, u32 slot)
+{
+    return (slot < pool->sparse_size ? pool->sparse[slot]
+                                     : POOL_EMPTY);
+}
+
+void SnapshotWorld(World* world, DrawSnapshot* snapshot,
+                   const f32 view[4])
+{
+    TransformPool* transforms = &world->transforms;
+    SpritePool* sprites = &world->sprites;
+
+    // The grid only knows where sprites start (their top left
+    // corner), so the area is widened by the largest sprite. A
+    // rotated sprite can reach about 1.21 times its size from there,
+    // so round up a little past that.
+    const f32 reach = world->largest_sprite * 1.25f;
+    const f32 area[4] = {view[0] - reach, view[1] - reach,
+                         view[2] + reach * 2.0f,
+                         view[3] + reach * 2.0f};
+    const u32* slots;
+    u32 slot_count = QuerySpatialGrid(world->grid, area, &slots);
+
+    for (u32 index = 0; index < slot_count; index++)
+    {
+        u32 transform =
+                _GetSlotComponent(&transforms->pool, slots[index]),
+            sprite = _GetSlotComponent(&sprites->pool, slots[index]);
+        if (transform == POOL_EMPTY || sprite == POOL_EMPTY) continue;
+
+        // Both positions are kept, so whoever draws this can blend
+        // between them however far it is into the next tick.
+        const f32 scale = transforms->scale[transform];
+        SpriteCommand* command = PushSpriteCommand(snapshot);
+        command->texture = sprites->texture[sprite];
+        memcpy(command->uv, sprites->uv[sprite], sizeof(command->uv));
+        command->x = transforms->x[transform];
+        command->y = transforms->y[transform];
+        command->previous_x = transforms->previous_x[transform];
+        command->previous_y = transforms->previous_y[transform];
+        command->z = transforms->z[transform];
+        command->width = sprites->width[sprite] * scale;
+        command->height = sprites->height[sprite] * scale;
+        command->rotation = transforms->rotation[transform];
+        command->brightness = sprites->brightness[sprite];
+    }
+}
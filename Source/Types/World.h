@@ -0,0 +1,436 @@
+/**
+ * @file World.h
+ * @author Zenais Argos
+ * @brief Provides the world; the store of every entity of a scene
+ * (NPCs, sprites, world objects) and their components. Each kind of
+ * component lives in its own sparse set, with every field of the
+ * component in its own packed array, so systems only ever touch the
+ * memory they actually read.
+ * @date 2024-07-11
+ *
+ * @copyright Copyright (c) 2024
+ */
+
+#ifndef _RENAI_WORLD_
+#define _RENAI_WORLD_
+
+// Provides the type definitions and allocation macros used in this
+// file.
+#include <Declarations.h>
+// Provides the spatial grid entities are culled with.
+#include <Grid.h>
+// Provides the snapshots entities are drawn from.
+#include <Snapshot.h>
+// Provides the textures sprites are drawn from.
+#include <Texture.h>
+
+/**
+ * @brief An entity of a world. The low @ref ENTITY_INDEX_BITS bits
+ * are the entity's slot, and the rest are the slot's generation when
+ * the entity was created, so IDs of destroyed entities are caught
+ * rather than referring to whatever reused their slot.
+ */
+typedef u32 Entity;
+
+/**
+ * @brief The number of bits of an entity given to its slot index.
+ */
+#define ENTITY_INDEX_BITS 24
+
+/**
+ * @brief The mask of an entity's slot index.
+ */
+#define ENTITY_INDEX_MASK ((1U << ENTITY_INDEX_BITS) - 1)
+
+/**
+ * @brief An entity that never exists, since generations start at 1.
+ */
+#define NULL_ENTITY 0
+
+/**
+ * @brief Get the slot index of the given entity.
+ */
+#define GetEntityIndex(entity) ((entity) & ENTITY_INDEX_MASK)
+
+/**
+ * @brief Get the generation of the given entity.
+ */
+#define GetEntityGeneration(entity) ((entity) >> ENTITY_INDEX_BITS)
+
+/**
+ * @brief The marker of an entity without a given component in that
+ * component's sparse array.
+ */
+#define POOL_EMPTY UINT32_MAX
+
+/**
+ * @brief The most fields (arrays) a single component can have.
+ */
+#define POOL_MAX_COLUMNS 8
+
+/**
+ * @brief The width and height of a single cell of a world's spatial
+ * grid. This should be a few times the size of a typical sprite.
+ */
+#define WORLD_CELL_SIZE 256.0f
+
+/**
+ * @brief The kinds of component an entity can have, as bits so that
+ * sets of them can be asked for at once.
+ */
+typedef enum ComponentType
+{
+    transform_component = 1 << 0,
+    sprite_component = 1 << 1,
+    animation_component = 1 << 2,
+    ai_component = 1 << 3
+} ComponentType;
+
+/**
+ * @brief The states an entity's AI can be in.
+ */
+typedef enum AIState
+{
+    idle_state,
+    wander_state
+} AIState;
+
+/**
+ * @brief A sparse set of a single kind of component. This is the part
+ * shared by every pool; the fields of the components themselves are
+ * arrays in the typed pool embedding it, all indexed by the same
+ * dense index.
+ */
+typedef struct ComponentPool
+{
+    /**
+     * @brief The dense index of every entity's component, indexed by
+     * entity slot, or @ref POOL_EMPTY for entities without one.
+     */
+    u32* sparse;
+    u32 sparse_size;
+    /**
+     * @brief The entity owning each component, in dense order.
+     */
+    Entity* dense;
+    /**
+     * @brief The number of components in the pool, and the number its
+     * arrays have room for.
+     */
+    u32 count, capacity;
+    /**
+     * @brief The arrays of the typed pool, and the size of a single
+     * element of each, so the pool can grow and reorder them without
+     * knowing their types.
+     */
+    void** columns[POOL_MAX_COLUMNS];
+    u16 column_sizes[POOL_MAX_COLUMNS];
+    u8 column_count;
+} ComponentPool;
+
+/**
+ * @brief Where entities are, and how they're oriented. The previous
+ * position is that of the last simulation tick, so drawing can blend
+ * between the two. Positions should only be changed through @ref
+ * MoveEntity, so the world's spatial grid stays in step.
+ */
+typedef struct TransformPool
+{
+    ComponentPool pool;
+    f32 *x, *y;
+    f32 *previous_x, *previous_y;
+    f32 *rotation, *scale;
+    u8* z;
+} TransformPool;
+
+/**
+ * @brief What entities look like; the texture they're drawn from, the
+ * region of it currently shown, and how big that region's drawn.
+ */
+typedef struct SpritePool
+{
+    ComponentPool pool;
+    Texture** texture;
+    f32 (*uv)[4];
+    f32 *width, *height;
+    f32* brightness;
+} SpritePool;
+
+/**
+ * @brief Flipbook animations, stepping through frames laid out left
+ * to right across an entity's sprite texture.
+ */
+typedef struct AnimationPool
+{
+    ComponentPool pool;
+    u16 *frame, *frame_count;
+    /**
+     * @brief How long each frame's shown, and how long the current
+     * one has been, in seconds.
+     */
+    f32 *frame_length, *elapsed;
+} AnimationPool;
+
+/**
+ * @brief The behavior of entities that move on their own. For now
+ * this is a simple wander; pick a direction, walk, stop, repeat.
+ */
+typedef struct AIPool
+{
+    ComponentPool pool;
+    u8* state;
+    /**
+     * @brief How fast the entity walks, in units a second, and how
+     * long until it changes its mind, in seconds.
+     */
+    f32 *speed, *timer;
+    f32 *velocity_x, *velocity_y;
+    /**
+     * @brief The state of each entity's random number generator, so
+     * every entity's decisions are reproducible.
+     */
+    u32* seed;
+} AIPool;
+
+/**
+ * @brief A world; every entity of a scene and their components.
+ */
+typedef struct World
+{
+    /**
+     * @brief The generation of every entity slot, the number of slots
+     * in use, and the number there's room for.
+     */
+    u8* generations;
+    u32 entity_count, entity_capacity;
+    /**
+     * @brief The slots of destroyed entities, used as a stack.
+     */
+    u32* free_entities;
+    u32 free_count;
+    /**
+     * @brief The number of entities currently alive.
+     */
+    u32 alive_count;
+    TransformPool transforms;
+    SpritePool sprites;
+    AnimationPool animations;
+    AIPool ai;
+    /**
+     * @brief Where every entity with a transform is, indexed by
+     * entity slot.
+     */
+    SpatialGrid* grid;
+    /**
+     * @brief The width or height of the largest sprite ever placed in
+     * the world, after scaling. Culling widens what it looks for by
+     * this, since the grid only knows where sprites start.
+     */
+    f32 largest_sprite;
+} World;
+
+/**
+ * @brief A walk over every entity having a given set of components.
+ * After each successful call to @ref NextEntity, the dense index of
+ * the current entity within each asked-for pool is in the field of
+ * the same name, ready to index that pool's arrays.
+ */
+typedef struct EntityView
+{
+    World* world;
+    u8 components;
+    /**
+     * @brief The pool being walked (the smallest of those asked for),
+     * and the position within it.
+     */
+    ComponentPool* driver;
+    u32 cursor;
+    Entity entity;
+    u32 transform, sprite, animation, ai;
+} EntityView;
+
+/**
+ * @brief Create a world. Kills the process on failure.
+ * @param capacity The number of entities the world is expected to
+ * hold. This is only a hint; the world grows as needed.
+ * @return A pointer to the created world.
+ */
+__CREATE_STRUCT_KILLFAIL(World) CreateWorld(u32 capacity);
+
+/**
+ * @brief Free the given world, and every entity within it.
+ * @param world The world to kill.
+ */
+void KillWorld(World* world);
+
+/**
+ * @brief Create an entity without any components.
+ * @param world The world to create the entity in.
+ * @return The created entity.
+ */
+Entity CreateEntity(World* world);
+
+/**
+ * @brief Destroy an entity and every component it has. The entity is
+ * dead afterward, and its slot may be reused.
+ * @param world The world the entity belongs to.
+ * @param entity The entity to destroy.
+ */
+void DestroyEntity(World* world, Entity entity);
+
+/**
+ * @brief Check whether the given entity is still alive.
+ * @param world The world the entity belongs to.
+ * @param entity The entity to check.
+ * @return A boolean value; true if the entity is alive, false if not.
+ */
+__INLINE __BOOLEAN IsEntityAlive(World* world, Entity entity)
+{
+    return GetEntityIndex(entity) < world->entity_count &&
+           world->generations[GetEntityIndex(entity)] ==
+               GetEntityGeneration(entity);
+}
+
+/**
+ * @brief Get the dense index of the given entity's component within
+ * a pool.
+ * @param pool The pool to search.
+ * @param entity The entity whose component to find.
+ * @return The component's index, or @ref POOL_EMPTY if the entity
+ * doesn't have one.
+ */
+__INLINE u32 GetComponentIndex(const ComponentPool* pool,
+                               Entity entity)
+{
+    u32 index = GetEntityIndex(entity);
+    if (index >= pool->sparse_size) return POOL_EMPTY;
+    index = pool->sparse[index];
+    return (index != POOL_EMPTY && pool->dense[index] == entity
+                ? index
+                : POOL_EMPTY);
+}
+
+/**
+ * @brief Check whether the given entity has a component in a pool.
+ * @param pool The pool to search.
+ * @param entity The entity to check.
+ * @return A boolean value; true if the entity has the component.
+ */
+__INLINE __BOOLEAN HasComponent(const ComponentPool* pool,
+                                Entity entity)
+{
+    return GetComponentIndex(pool, entity) != POOL_EMPTY;
+}
+
+/**
+ * @brief Remove the given entity's component from a pool. The last
+ * component of the pool is moved into its place, so the pool stays
+ * packed. Nothing happens if the entity doesn't have one.
+ * @param pool The pool to remove from.
+ * @param entity The entity whose component to remove.
+ */
+void RemoveComponent(ComponentPool* pool, Entity entity);
+
+/**
+ * @brief Give an entity a transform, placing it within the world's
+ * spatial grid. Kills the process if it already has one.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ * @param x The X coordinate of the entity.
+ * @param y The Y coordinate of the entity.
+ * @param z The depth layer of the entity.
+ * @param scale The scale of the entity.
+ * @param rotation The rotation of the entity around its center.
+ * @return The dense index of the transform.
+ */
+u32 AddTransform(World* world, Entity entity, f32 x, f32 y, u8 z,
+                 f32 scale, f32 rotation);
+
+/**
+ * @brief Move an entity with a transform to the given position.
+ * Nothing happens if the entity has no transform.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ * @param x The new X coordinate of the entity.
+ * @param y The new Y coordinate of the entity.
+ */
+void MoveEntity(World* world, Entity entity, f32 x, f32 y);
+
+/**
+ * @brief Give an entity a sprite, showing the whole of the given
+ * texture. Kills the process if it already has one.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ * @param texture The texture the sprite is drawn from.
+ * @param brightness The brightness multiplier of the sprite.
+ * @return The dense index of the sprite.
+ */
+u32 AddSprite(World* world, Entity entity, Texture* texture,
+              f32 brightness);
+
+/**
+ * @brief Give an entity an animation. The entity must already have a
+ * sprite, whose texture is split into the frames of the animation.
+ * Kills the process if it already has one, or has no sprite.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ * @param frame_count The number of frames across the sprite's
+ * texture.
+ * @param frame_length How long each frame's shown, in seconds.
+ * @return The dense index of the animation.
+ */
+u32 AddAnimation(World* world, Entity entity, u16 frame_count,
+                 f32 frame_length);
+
+/**
+ * @brief Give an entity a wandering AI. The entity needs a transform
+ * for the AI to move. Kills the process if it already has one.
+ * @param world The world the entity belongs to.
+ * @param entity The entity.
+ * @param speed How fast the entity walks, in units a second.
+ * @return The dense index of the AI.
+ */
+u32 AddAI(World* world, Entity entity, f32 speed);
+
+/**
+ * @brief Start a walk over every entity having all the given
+ * components. The walk goes from the back of the smallest pool to the
+ * front, so removing the current entity's components (or destroying
+ * it) mid-walk is safe; adding components isn't.
+ * @param world The world to walk.
+ * @param components The components (@ref ComponentType bits) the
+ * entities must have.
+ * @return The view, positioned before the first entity.
+ */
+EntityView ViewEntities(World* world, u8 components);
+
+/**
+ * @brief Move a view to its next entity.
+ * @param view The view to advance.
+ * @return A boolean value; true if the view is on a new entity, false
+ * if the walk is over.
+ */
+__BOOLEAN NextEntity(EntityView* view);
+
+/**
+ * @brief Step every system of the world by a single tick; animations,
+ * AI, and movement.
+ * @param world The world to update.
+ * @param tick_length The length of the tick, in seconds.
+ */
+void UpdateWorld(World* world, f64 tick_length);
+
+/**
+ * @brief Copy every entity with both a transform and a sprite that
+ * could be within the given area into the given snapshot, along with
+ * where each was a tick ago. Only the cells of the world's spatial
+ * grid overlapping the area are looked at.
+ * @param world The world to copy from.
+ * @param snapshot The snapshot to add to.
+ * @param view The area to copy; its X, Y, width, and height, in
+ * world units.
+ */
+void SnapshotWorld(World* world, DrawSnapshot* snapshot,
+                   const f32 view[4]);
+
+#endif // _RENAI_WORLD_